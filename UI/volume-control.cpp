@@ -415,6 +415,7 @@ VolControl::VolControl(OBSSource source_, bool showConfig, bool vertical)
 			 &VolControl::SetMuted);
 
 	obs_fader_attach_source(obs_fader, source);
+	obs_volmeter_set_async(obs_volmeter, true);
 	obs_volmeter_attach_source(obs_volmeter, source);
 
 	/* Call volume changed once to init the slider position and label */
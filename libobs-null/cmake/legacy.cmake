@@ -0,0 +1,17 @@
+project(libobs-null)
+
+add_library(libobs-null SHARED)
+add_library(OBS::libobs-null ALIAS libobs-null)
+
+target_sources(libobs-null PRIVATE null-buffers.c null-shader.c null-subsystem.c null-subsystem.h null-texture.c)
+
+target_link_libraries(libobs-null PRIVATE OBS::libobs)
+
+set_target_properties(
+  libobs-null
+  PROPERTIES FOLDER "core"
+             VERSION "${OBS_VERSION_MAJOR}"
+             SOVERSION "1"
+             PREFIX "")
+
+setup_binary_target(libobs-null)
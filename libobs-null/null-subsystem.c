@@ -0,0 +1,858 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "null-subsystem.h"
+
+/* Goofy Windows.h macros need to be removed */
+#ifdef near
+#undef near
+#endif
+#ifdef far
+#undef far
+#endif
+
+const char *device_get_name(void)
+{
+	return "Null";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_NULL;
+}
+
+bool device_enum_adapters(gs_device_t *device,
+			  bool (*callback)(void *param, const char *name,
+					   uint32_t id),
+			  void *param)
+{
+	UNUSED_PARAMETER(device);
+
+	callback(param, "Null renderer (CPU only)", 0);
+	return true;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_NULL";
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+
+	device->cur_color_space = GS_CS_SRGB;
+	matrix4_identity(&device->cur_proj);
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing null graphics device...");
+	blog(LOG_INFO, "Adapter %u: no GPU, draw calls will not be rendered",
+	     adapter);
+
+	*p_device = device;
+	return GS_SUCCESS;
+}
+
+static int cmp_skipped(const void *a, const void *b)
+{
+	const struct skipped_shader *sa = a;
+	const struct skipped_shader *sb = b;
+
+	if (sa->draws == sb->draws)
+		return 0;
+	return sa->draws > sb->draws ? -1 : 1;
+}
+
+static void log_skipped_draws(gs_device_t *device)
+{
+	if (!device->skipped_draws)
+		return;
+
+	qsort(device->skipped.array, device->skipped.num,
+	      sizeof(struct skipped_shader), cmp_skipped);
+
+	blog(LOG_INFO,
+	     "Null graphics device skipped %" PRIu64 " draw call(s):",
+	     device->skipped_draws);
+
+	for (size_t i = 0; i < device->skipped.num; i++) {
+		struct skipped_shader *skipped = &device->skipped.array[i];
+		blog(LOG_INFO, "\t%" PRIu64 "\t%s", skipped->draws,
+		     skipped->file);
+	}
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (!device)
+		return;
+
+	log_skipped_draws(device);
+
+	for (size_t i = 0; i < device->skipped.num; i++)
+		bfree(device->skipped.array[i].file);
+
+	da_free(device->skipped);
+	da_free(device->proj_stack);
+	bfree(device);
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void *device_get_device_obj(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return NULL;
+}
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device,
+					const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+
+	swap->device = device;
+	swap->info = *info;
+	return swap;
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	if (swapchain->device->cur_swap == swapchain)
+		device_load_swapchain(swapchain->device, NULL);
+
+	bfree(swapchain);
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	if (!device->cur_swap)
+		return;
+
+	device->cur_swap->info.cx = cx;
+	device->cur_swap->info.cy = cy;
+}
+
+enum gs_color_space device_get_color_space(gs_device_t *device)
+{
+	return device->cur_color_space;
+}
+
+void device_update_color_space(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap) {
+		*cx = device->cur_swap->info.cx;
+		*cy = device->cur_swap->info.cy;
+	} else {
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	return device->cur_swap ? device->cur_swap->info.cx : 0;
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	return device->cur_swap ? device->cur_swap->info.cy : 0;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vb)
+{
+	device->cur_vertex_buffer = vb;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *ib)
+{
+	device->cur_index_buffer = ib;
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device->cur_textures[unit] = tex;
+}
+
+void device_load_texture_srgb(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device->cur_textures[unit] = tex;
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *ss,
+			      int unit)
+{
+	device->cur_samplers[unit] = ss;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	device->cur_vertex_shader = vertshader;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	device->cur_pixel_shader = pixelshader;
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	/* deliberately a no-op, the null renderer never samples textures so
+	 * there is no sampler state to load */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(b_3d);
+	UNUSED_PARAMETER(unit);
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex,
+			      gs_zstencil_t *zstencil)
+{
+	device_set_render_target_with_color_space(device, tex, zstencil,
+						  GS_CS_SRGB);
+}
+
+void device_set_render_target_with_color_space(gs_device_t *device,
+					       gs_texture_t *tex,
+					       gs_zstencil_t *zstencil,
+					       enum gs_color_space space)
+{
+	if (tex && tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_set_render_target (null): "
+				"texture is not a 2D texture");
+		return;
+	}
+
+	if (tex && !(tex->flags & GS_RENDER_TARGET)) {
+		blog(LOG_ERROR, "device_set_render_target (null): "
+				"texture is not a render target");
+		return;
+	}
+
+	device->cur_render_target = tex;
+	device->cur_render_side = 0;
+	device->cur_zstencil_buffer = zstencil;
+	device->cur_color_space = space;
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex,
+				   int side, gs_zstencil_t *zstencil)
+{
+	if (cubetex && cubetex->type != GS_TEXTURE_CUBE) {
+		blog(LOG_ERROR, "device_set_cube_render_target (null): "
+				"texture is not a cube texture");
+		return;
+	}
+
+	device->cur_render_target = cubetex;
+	device->cur_render_side = side;
+	device->cur_zstencil_buffer = zstencil;
+	device->cur_color_space = GS_CS_SRGB;
+}
+
+void device_enable_framebuffer_srgb(gs_device_t *device, bool enable)
+{
+	device->framebuffer_srgb = enable;
+}
+
+bool device_framebuffer_srgb_enabled(gs_device_t *device)
+{
+	return device->framebuffer_srgb;
+}
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
+				uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x,
+				uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"source or destination texture is NULL");
+		return;
+	}
+
+	if (src->type != GS_TEXTURE_2D || dst->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"only 2D textures can be copied");
+		return;
+	}
+
+	if (src->format != dst->format) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"source and destination formats do not match");
+		return;
+	}
+
+	uint32_t copy_w = src_w ? src_w : src->width - src_x;
+	uint32_t copy_h = src_h ? src_h : src->height - src_y;
+
+	if (src_x + copy_w > src->width || src_y + copy_h > src->height ||
+	    dst_x + copy_w > dst->width || dst_y + copy_h > dst->height) {
+		blog(LOG_ERROR, "device_copy_texture_region (null): "
+				"region is out of bounds");
+		return;
+	}
+
+	if (gs_is_compressed_format(src->format)) {
+		/* block compressed data is only copied as a whole */
+		if (src->face_size == dst->face_size)
+			memcpy(dst->data, src->data, src->face_size);
+		return;
+	}
+
+	uint32_t bpp = gs_get_format_bpp(src->format) / 8;
+	size_t row_size = (size_t)copy_w * bpp;
+
+	for (uint32_t y = 0; y < copy_h; y++) {
+		const uint8_t *src_row = src->data +
+					 (size_t)(src_y + y) * src->linesize +
+					 (size_t)src_x * bpp;
+		uint8_t *dst_row = dst->data +
+				   (size_t)(dst_y + y) * dst->linesize +
+				   (size_t)dst_x * bpp;
+
+		memcpy(dst_row, src_row, row_size);
+	}
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+			 gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+			  gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"source or destination is NULL");
+		return;
+	}
+
+	if (src->type != GS_TEXTURE_2D || src->format != dst->format ||
+	    src->width != dst->width || src->height != dst->height) {
+		blog(LOG_ERROR, "device_stage_texture (null): "
+				"source and destination do not match");
+		return;
+	}
+
+	for (uint32_t y = 0; y < dst->height; y++)
+		memcpy(dst->data + (size_t)y * dst->linesize,
+		       src->data + (size_t)y * src->linesize, dst->linesize);
+}
+
+void device_begin_frame(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++)
+		device->cur_textures[i] = NULL;
+}
+
+static const char *unknown_shader_name = "(unknown shader)";
+
+static void skip_draw(gs_device_t *device)
+{
+	gs_shader_t *shader = device->cur_pixel_shader;
+	const char *file = shader && shader->file ? shader->file
+						  : unknown_shader_name;
+
+	device->skipped_draws++;
+
+	for (size_t i = 0; i < device->skipped.num; i++) {
+		struct skipped_shader *skipped = &device->skipped.array[i];
+
+		if (strcmp(skipped->file, file) == 0) {
+			skipped->draws++;
+			return;
+		}
+	}
+
+	blog(LOG_DEBUG, "Null graphics device: skipping draws with '%s'",
+	     file);
+
+	struct skipped_shader *skipped = da_push_back_new(device->skipped);
+	skipped->file = bstrdup(file);
+	skipped->draws = 1;
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		 uint32_t start_vert, uint32_t num_verts)
+{
+	UNUSED_PARAMETER(draw_mode);
+	UNUSED_PARAMETER(start_vert);
+	UNUSED_PARAMETER(num_verts);
+
+	if (!device->cur_vertex_shader || !device->cur_pixel_shader) {
+		blog(LOG_ERROR, "device_draw (null): No shader loaded");
+		return;
+	}
+
+	skip_draw(device);
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags,
+		  const struct vec4 *color, float depth, uint8_t stencil)
+{
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+
+	/* clearing the swap chain back buffer does nothing, there is none */
+	if ((clear_flags & GS_CLEAR_COLOR) != 0 && device->cur_render_target)
+		null_fill_texture(device->cur_render_target,
+				  device->cur_render_side, color);
+}
+
+bool device_is_present_ready(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return true;
+}
+
+void device_present(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green, bool blue,
+			 bool alpha)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(red);
+	UNUSED_PARAMETER(green);
+	UNUSED_PARAMETER(blue);
+	UNUSED_PARAMETER(alpha);
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src,
+			   enum gs_blend_type dest)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(dest);
+}
+
+void device_blend_function_separate(gs_device_t *device,
+				    enum gs_blend_type src_c,
+				    enum gs_blend_type dest_c,
+				    enum gs_blend_type src_a,
+				    enum gs_blend_type dest_a)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(src_c);
+	UNUSED_PARAMETER(dest_c);
+	UNUSED_PARAMETER(src_a);
+	UNUSED_PARAMETER(dest_a);
+}
+
+void device_blend_op(gs_device_t *device, enum gs_blend_op_type op)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(op);
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
+			     enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side,
+		       enum gs_stencil_op_type fail,
+		       enum gs_stencil_op_type zfail,
+		       enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width,
+			 int height)
+{
+	device->cur_viewport.x = x;
+	device->cur_viewport.y = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(rect);
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top,
+		  float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = 2.0f / rml;
+	dst->t.x = (left + right) / -rml;
+
+	dst->y.y = 2.0f / -bmt;
+	dst->t.y = (bottom + top) / bmt;
+
+	dst->z.z = -2.0f / fmn;
+	dst->t.z = (far + near) / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top,
+		    float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float tmb = top - bottom;
+	float nmf = near - far;
+	float nearx2 = 2.0f * near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = nearx2 / rml;
+	dst->z.x = (left + right) / rml;
+
+	dst->y.y = nearx2 / tmb;
+	dst->z.y = (bottom + top) / tmb;
+
+	dst->z.z = (far + near) / nmf;
+	dst->t.z = 2.0f * (near * far) / nmf;
+
+	dst->z.w = -1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	struct matrix4 *end;
+	if (!device->proj_stack.num)
+		return;
+
+	end = da_end(device->proj_stack);
+	device->cur_proj = *end;
+	da_pop_back(device->proj_stack);
+}
+
+void device_debug_marker_begin(gs_device_t *device, const char *markername,
+			       const float color[4])
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(markername);
+	UNUSED_PARAMETER(color);
+}
+
+void device_debug_marker_end(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+bool device_is_monitor_hdr(gs_device_t *device, void *monitor)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(monitor);
+	return false;
+}
+
+bool device_shared_texture_available(void)
+{
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Timers                                                                    */
+
+gs_timer_t *device_timer_create(gs_device_t *device)
+{
+	struct gs_timer *timer = bzalloc(sizeof(struct gs_timer));
+	timer->device = device;
+	return timer;
+}
+
+gs_timer_range_t *device_timer_range_create(gs_device_t *device)
+{
+	struct gs_timer_range *range = bzalloc(sizeof(struct gs_timer_range));
+	range->device = device;
+	return range;
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	bfree(timer);
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	timer->begin = os_gettime_ns();
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	timer->end = os_gettime_ns();
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	*ticks = timer->end - timer->begin;
+	return true;
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	bfree(range);
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency)
+{
+	UNUSED_PARAMETER(range);
+
+	*disjoint = false;
+	*frequency = 1000000000;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Platform specific texture sharing, none of which is available             */
+
+#ifdef __APPLE__
+gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device,
+						   void *iosurf)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(iosurf);
+	return NULL;
+}
+
+gs_texture_t *device_texture_open_shared(gs_device_t *device, uint32_t handle)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(handle);
+	return NULL;
+}
+
+bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
+{
+	UNUSED_PARAMETER(texture);
+	UNUSED_PARAMETER(iosurf);
+	return false;
+}
+
+#elif _WIN32
+bool device_gdi_texture_available(void)
+{
+	return false;
+}
+
+#elif defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
+gs_texture_t *device_texture_create_from_dmabuf(
+	gs_device_t *device, unsigned int width, unsigned int height,
+	uint32_t drm_format, enum gs_color_format color_format,
+	uint32_t n_planes, const int *fds, const uint32_t *strides,
+	const uint32_t *offsets, const uint64_t *modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(drm_format);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(n_planes);
+	UNUSED_PARAMETER(fds);
+	UNUSED_PARAMETER(strides);
+	UNUSED_PARAMETER(offsets);
+	UNUSED_PARAMETER(modifiers);
+	return NULL;
+}
+
+bool device_query_dmabuf_capabilities(gs_device_t *device,
+				      enum gs_dmabuf_flags *dmabuf_flags,
+				      uint32_t **drm_formats, size_t *n_formats)
+{
+	UNUSED_PARAMETER(device);
+
+	*dmabuf_flags = GS_DMABUF_FLAG_NONE;
+	*drm_formats = NULL;
+	*n_formats = 0;
+	return false;
+}
+
+bool device_query_dmabuf_modifiers_for_format(gs_device_t *device,
+					      uint32_t drm_format,
+					      uint64_t **modifiers,
+					      size_t *n_modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(drm_format);
+
+	*modifiers = NULL;
+	*n_modifiers = 0;
+	return false;
+}
+
+gs_texture_t *device_texture_create_from_pixmap(
+	gs_device_t *device, uint32_t width, uint32_t height,
+	enum gs_color_format color_format, uint32_t target, void *pixmap)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(target);
+	UNUSED_PARAMETER(pixmap);
+	return NULL;
+}
+#endif
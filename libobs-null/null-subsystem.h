@@ -0,0 +1,154 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/darray.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+
+/*
+ * CPU-only graphics subsystem
+ *
+ *   Resources live in system memory.  Texture uploads, maps, copies, clears
+ * and staging are performed on the CPU so that data written by sources or
+ * read back by outputs behaves as expected, but nothing is rasterized: draw
+ * calls are counted per pixel shader and skipped.  Meant for machines
+ * without a GPU that only need the audio pipeline, outputs and scene logic.
+ */
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t levels;
+	uint32_t flags;
+
+	/* only the first mip level is kept */
+	uint32_t linesize;
+	size_t face_size;
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	struct gs_sampler_info info;
+};
+
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	struct gs_vb_data *data;
+	uint32_t flags;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	enum gs_index_type type;
+	void *data;
+	size_t num;
+	uint32_t flags;
+};
+
+struct gs_timer {
+	gs_device_t *device;
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gs_timer_range {
+	gs_device_t *device;
+};
+
+struct gs_shader_param {
+	char *name;
+	enum gs_shader_param_type type;
+	int array_count;
+
+	gs_texture_t *texture;
+	bool srgb;
+	gs_samplerstate_t *next_sampler;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+	char *file;
+
+	gs_sparam_t *viewproj;
+	gs_sparam_t *world;
+	DARRAY(struct gs_shader_param) params;
+};
+
+struct skipped_shader {
+	char *file;
+	uint64_t draws;
+};
+
+struct gs_device {
+	gs_texture_t *cur_render_target;
+	gs_zstencil_t *cur_zstencil_buffer;
+	int cur_render_side;
+	gs_texture_t *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t *cur_vertex_buffer;
+	gs_indexbuffer_t *cur_index_buffer;
+	gs_shader_t *cur_vertex_shader;
+	gs_shader_t *cur_pixel_shader;
+	gs_swapchain_t *cur_swap;
+	enum gs_color_space cur_color_space;
+	bool framebuffer_srgb;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+
+	struct matrix4 cur_proj;
+	DARRAY(struct matrix4) proj_stack;
+
+	/* draw calls that were not rasterized, by pixel shader */
+	DARRAY(struct skipped_shader) skipped;
+	uint64_t skipped_draws;
+};
+
+extern void null_fill_texture(gs_texture_t *tex, int side,
+			      const struct vec4 *color);
@@ -0,0 +1,385 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include <graphics/vec4.h>
+#include "null-subsystem.h"
+
+static inline uint32_t get_linesize(enum gs_color_format format,
+				    uint32_t width)
+{
+	return (width * gs_get_format_bpp(format) + 7) / 8;
+}
+
+static gs_texture_t *texture_create(gs_device_t *device,
+				    enum gs_texture_type type, uint32_t width,
+				    uint32_t height, uint32_t depth,
+				    enum gs_color_format format,
+				    uint32_t levels, uint32_t flags)
+{
+	struct gs_texture *tex = bzalloc(sizeof(struct gs_texture));
+	size_t faces = type == GS_TEXTURE_CUBE ? 6 : 1;
+
+	tex->device = device;
+	tex->type = type;
+	tex->format = format;
+	tex->width = width;
+	tex->height = height;
+	tex->depth = depth;
+	tex->levels = levels;
+	tex->flags = flags;
+	tex->linesize = get_linesize(format, width);
+	tex->face_size = (size_t)tex->linesize * height * depth;
+	tex->data = bzalloc(tex->face_size * faces);
+
+	return tex;
+}
+
+static inline uint8_t *get_face(const gs_texture_t *tex, int side)
+{
+	return tex->data + tex->face_size * side;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+				    uint32_t height,
+				    enum gs_color_format color_format,
+				    uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_2D, width,
+					   height, 1, color_format, levels,
+					   flags);
+
+	if (data && *data)
+		memcpy(tex->data, *data, tex->face_size);
+
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+					enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data,
+					uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_CUBE, size, size,
+					   1, color_format, levels, flags);
+
+	if (data) {
+		uint32_t face_levels = levels ? levels : 1;
+
+		for (int i = 0; i < 6; i++) {
+			const uint8_t *face = data[i * face_levels];
+			if (face)
+				memcpy(get_face(tex, i), face, tex->face_size);
+		}
+	}
+
+	return tex;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+				       uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format,
+				       uint32_t levels,
+				       const uint8_t *const *data,
+				       uint32_t flags)
+{
+	gs_texture_t *tex = texture_create(device, GS_TEXTURE_3D, width,
+					   height, depth, color_format, levels,
+					   flags);
+
+	if (data && *data)
+		memcpy(tex->data, *data, tex->face_size);
+
+	return tex;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	gs_device_t *device = tex->device;
+	if (device->cur_render_target == tex)
+		device->cur_render_target = NULL;
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_textures[i] == tex)
+			device->cur_textures[i] = NULL;
+	}
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "gs_texture_map (null): "
+				"texture is not a 2D texture");
+		return false;
+	}
+
+	if (!(tex->flags & GS_DYNAMIC)) {
+		blog(LOG_ERROR, "gs_texture_map (null): "
+				"texture is not dynamic");
+		return false;
+	}
+
+	*ptr = tex->data;
+	*linesize = tex->linesize;
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return NULL;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	gs_texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format
+gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	gs_texture_destroy(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	return voltex->depth;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint8_t to_unorm8(float val)
+{
+	if (val <= 0.0f)
+		return 0;
+	if (val >= 1.0f)
+		return 255;
+	return (uint8_t)(val * 255.0f + 0.5f);
+}
+
+static void fill_pixels(uint8_t *data, size_t size, const void *pixel,
+			size_t pixel_size)
+{
+	for (size_t i = 0; i + pixel_size <= size; i += pixel_size)
+		memcpy(data + i, pixel, pixel_size);
+}
+
+void null_fill_texture(gs_texture_t *tex, int side, const struct vec4 *color)
+{
+	uint8_t *data = get_face(tex, side);
+	size_t size = tex->face_size;
+	uint8_t r = to_unorm8(color->x);
+	uint8_t g = to_unorm8(color->y);
+	uint8_t b = to_unorm8(color->z);
+	uint8_t a = to_unorm8(color->w);
+
+	switch (tex->format) {
+	case GS_RGBA:
+	case GS_RGBA_UNORM: {
+		const uint8_t pixel[4] = {r, g, b, a};
+		fill_pixels(data, size, pixel, sizeof(pixel));
+		break;
+	}
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+	case GS_BGRX:
+	case GS_BGRX_UNORM: {
+		const uint8_t pixel[4] = {b, g, r, a};
+		fill_pixels(data, size, pixel, sizeof(pixel));
+		break;
+	}
+	case GS_R8G8: {
+		const uint8_t pixel[2] = {r, g};
+		fill_pixels(data, size, pixel, sizeof(pixel));
+		break;
+	}
+	case GS_R8:
+		memset(data, r, size);
+		break;
+	case GS_A8:
+		memset(data, a, size);
+		break;
+	case GS_RGBA32F:
+		fill_pixels(data, size, color->ptr, sizeof(float) * 4);
+		break;
+	case GS_R32F:
+		fill_pixels(data, size, &color->x, sizeof(float));
+		break;
+	default:
+		/* packed/half float formats are not worth converting for a
+		 * renderer that never samples them */
+		memset(data, 0, size);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device,
+					   uint32_t width, uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf =
+		bzalloc(sizeof(struct gs_stage_surface));
+
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = get_linesize(color_format, width);
+	surf->data = bzalloc((size_t)surf->linesize * height);
+
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf)
+		return;
+
+	bfree(stagesurf->data);
+	bfree(stagesurf);
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format
+gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+				      uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs =
+		bzalloc(sizeof(struct gs_zstencil_buffer));
+
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zstencil)
+{
+	bfree(zstencil);
+}
+
+gs_samplerstate_t *
+device_samplerstate_create(gs_device_t *device,
+			   const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *ss = bzalloc(sizeof(struct gs_sampler_state));
+
+	ss->device = device;
+	ss->info = *info;
+	return ss;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	gs_device_t *device = samplerstate->device;
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_samplers[i] == samplerstate)
+			device->cur_samplers[i] = NULL;
+	}
+
+	bfree(samplerstate);
+}
@@ -123,7 +123,7 @@ static inline void cd_set_first_param(calldata_t *data, const char *name,
 		capacity = 128;
 
 	data->capacity = capacity;
-	data->stack = bmalloc(capacity);
+	data->stack = bmalloc_tagged(BMEM_TAG_CALLDATA, capacity);
 
 	pos = data->stack;
 	cd_copy_string(&pos, name, name_len);
@@ -29,6 +29,8 @@ target_sources(
     obs-audio.c
     obs-audio-controls.c
     obs-audio-controls.h
+    obs-audio-latency.c
+    obs-audio-latency.h
     obs-av1.c
     obs-av1.h
     obs-avc.c
@@ -47,6 +49,8 @@ target_sources(
     obs-missing-files.h
     obs-nal.c
     obs-nal.h
+    obs-hotkey-events.c
+    obs-hotkey-events.h
     obs-hotkey-name-map.c
     obs-interaction.h
     obs-internal.h
@@ -59,11 +63,14 @@ target_sources(
     obs-properties.h
     obs-service.c
     obs-service.h
+    obs-scene-cull.c
+    obs-scene-cull.h
     obs-scene.c
     obs-scene.h
     obs-source.c
     obs-source.h
     obs-source-deinterlace.c
+    obs-source-fusion.c
     obs-source-transition.c
     obs-video.c
     obs-video-gpu-encode.c
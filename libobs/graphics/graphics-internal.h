@@ -383,6 +383,13 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+struct gs_pooled_target {
+	gs_texture_t *tex;
+	enum gs_color_format format;
+	uint32_t cx, cy;
+	uint64_t released_frame;
+};
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -416,4 +423,11 @@ struct graphics_subsystem {
 	DARRAY(struct blend_state) blend_state_stack;
 
 	bool linear_srgb;
+
+	DARRAY(struct gs_pooled_target) free_targets;
+	DARRAY(gs_texrender_t *) transient_texrenders;
+	struct gs_render_target_pool_info pool_info;
+	uint64_t pool_frame;
 };
+
+extern void gs_render_target_pool_free(graphics_t *graphics);
@@ -240,6 +240,8 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		gs_render_target_pool_free(graphics);
+
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
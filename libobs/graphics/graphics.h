@@ -477,6 +477,36 @@ EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 EXPORT enum gs_color_format
 gs_texrender_get_format(const gs_texrender_t *texrender);
 
+/* texrender whose target is returned to the render target pool when it has
+ * not been drawn to for a while, for targets that are rendered every frame
+ * they are used */
+EXPORT gs_texrender_t *
+gs_texrender_create_transient(enum gs_color_format format,
+			      enum gs_zstencil_format zsformat);
+
+/* ---------------------------------------------------
+ * render target pool
+ * --------------------------------------------------- */
+
+struct gs_render_target_pool_info {
+	uint32_t free_count;
+	uint32_t leased_count;
+	uint64_t free_bytes;
+	uint64_t leased_bytes;
+
+	uint64_t created;
+	uint64_t reused;
+	uint64_t trimmed;
+	uint64_t reclaimed;
+};
+
+EXPORT gs_texture_t *gs_render_target_acquire(enum gs_color_format format,
+					      uint32_t cx, uint32_t cy);
+EXPORT void gs_render_target_release(gs_texture_t *tex);
+EXPORT void gs_render_target_pool_next_frame(uint32_t max_idle_frames);
+EXPORT void
+gs_render_target_pool_get_info(struct gs_render_target_pool_info *info);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -522,6 +552,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL 1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_NULL 3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -26,7 +26,7 @@
 
 static void *bi_def_bitmap_create(int width, int height)
 {
-	return bmalloc((size_t)4 * width * height);
+	return bmalloc_tagged(BMEM_TAG_IMAGES, (size_t)4 * width * height);
 }
 
 static void bi_def_bitmap_set_opaque(void *bitmap, bool opaque)
@@ -69,7 +69,7 @@ static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
 
 	if (mem_usage)
 		*mem_usage += size;
-	return bzalloc(size);
+	return bzalloc_tagged(BMEM_TAG_IMAGES, size);
 }
 
 static bool init_animated_gif(gs_image_file_t *image, const char *path,
@@ -101,7 +101,7 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 	size = (size_t)os_ftelli64(file);
 	fseek(file, 0, SEEK_SET);
 
-	image->gif_data = bmalloc(size);
+	image->gif_data = bmalloc_tagged(BMEM_TAG_IMAGES, size);
 	size_read = fread(image->gif_data, 1, size, file);
 	if (size_read != size) {
 		blog(LOG_WARNING, "Failed to fully read gif file '%s'.", path);
@@ -217,6 +217,7 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 	image->texture_data =
 		gs_create_texture_file_data3(file, alpha_mode, &image->format,
 					     &image->cx, &image->cy, space);
+	bmem_set_tag(image->texture_data, BMEM_TAG_IMAGES);
 
 	if (mem_usage) {
 		*mem_usage += image->cx * image->cy *
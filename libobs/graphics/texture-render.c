@@ -21,7 +21,7 @@
  */
 
 #include <assert.h>
-#include "graphics.h"
+#include "graphics-internal.h"
 
 struct gs_texture_render {
 	gs_texture_t *target, *prev_target;
@@ -34,8 +34,195 @@ struct gs_texture_render {
 	enum gs_zstencil_format zsformat;
 
 	bool rendered;
+
+	bool transient;
+	/* context whose pool the texrender is registered with */
+	graphics_t *pool_graphics;
+	uint64_t last_frame;
 };
 
+/* ------------------------------------------------------------------------- */
+/* render target pool
+ *
+ *   Render targets are handed out by format and size.  A released target is
+ * kept in the free list of the current graphics context and given to the
+ * next acquire with the same format and size, the most recently released
+ * one first.  The pool generation is advanced once per frame, free targets
+ * that have not been reused for the given number of frames are destroyed. */
+
+static inline uint64_t target_size(enum gs_color_format format, uint32_t cx,
+				   uint32_t cy)
+{
+	return (uint64_t)gs_get_format_bpp(format) * cx * cy / 8;
+}
+
+static void trim_free_targets(graphics_t *graphics, uint64_t max_idle_frames)
+{
+	size_t idx = 0;
+
+	while (idx < graphics->free_targets.num) {
+		struct gs_pooled_target *pt =
+			&graphics->free_targets.array[idx];
+
+		if (graphics->pool_frame - pt->released_frame <=
+		    max_idle_frames) {
+			idx++;
+			continue;
+		}
+
+		gs_texture_destroy(pt->tex);
+		graphics->pool_info.trimmed++;
+		da_erase(graphics->free_targets, idx);
+	}
+}
+
+gs_texture_t *gs_render_target_acquire(enum gs_color_format format,
+				       uint32_t cx, uint32_t cy)
+{
+	graphics_t *graphics = gs_get_context();
+	gs_texture_t *tex;
+
+	if (!graphics || !cx || !cy)
+		return NULL;
+
+	for (size_t i = graphics->free_targets.num; i > 0; i--) {
+		struct gs_pooled_target *pt =
+			&graphics->free_targets.array[i - 1];
+
+		if (pt->format == format && pt->cx == cx && pt->cy == cy) {
+			tex = pt->tex;
+			da_erase(graphics->free_targets, i - 1);
+			graphics->pool_info.reused++;
+			goto leased;
+		}
+	}
+
+	tex = gs_texture_create(cx, cy, format, 1, NULL, GS_RENDER_TARGET);
+
+	/* out of video memory, give back what the pool holds on to */
+	if (!tex && graphics->free_targets.num) {
+		graphics->pool_info.trimmed += graphics->free_targets.num;
+		for (size_t i = 0; i < graphics->free_targets.num; i++)
+			gs_texture_destroy(graphics->free_targets.array[i].tex);
+		da_resize(graphics->free_targets, 0);
+
+		tex = gs_texture_create(cx, cy, format, 1, NULL,
+					GS_RENDER_TARGET);
+	}
+
+	if (!tex)
+		return NULL;
+
+	graphics->pool_info.created++;
+
+leased:
+	graphics->pool_info.leased_count++;
+	graphics->pool_info.leased_bytes += target_size(format, cx, cy);
+	return tex;
+}
+
+void gs_render_target_release(gs_texture_t *tex)
+{
+	graphics_t *graphics = gs_get_context();
+	struct gs_pooled_target *pt;
+
+	if (!tex)
+		return;
+	if (!graphics) {
+		gs_texture_destroy(tex);
+		return;
+	}
+
+	pt = da_push_back_new(graphics->free_targets);
+	pt->tex = tex;
+	pt->format = gs_texture_get_color_format(tex);
+	pt->cx = gs_texture_get_width(tex);
+	pt->cy = gs_texture_get_height(tex);
+	pt->released_frame = graphics->pool_frame;
+
+	const uint64_t size = target_size(pt->format, pt->cx, pt->cy);
+
+	if (graphics->pool_info.leased_count) {
+		graphics->pool_info.leased_count--;
+		graphics->pool_info.leased_bytes -=
+			size < graphics->pool_info.leased_bytes
+				? size
+				: graphics->pool_info.leased_bytes;
+	}
+}
+
+static void texrender_release_target(gs_texrender_t *texrender)
+{
+	gs_render_target_release(texrender->target);
+	gs_zstencil_destroy(texrender->zs);
+
+	texrender->target = NULL;
+	texrender->zs = NULL;
+	texrender->cx = 0;
+	texrender->cy = 0;
+	texrender->rendered = false;
+}
+
+void gs_render_target_pool_next_frame(uint32_t max_idle_frames)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!graphics)
+		return;
+
+	graphics->pool_frame++;
+
+	for (size_t i = 0; i < graphics->transient_texrenders.num; i++) {
+		gs_texrender_t *texrender =
+			graphics->transient_texrenders.array[i];
+
+		if (texrender->target &&
+		    graphics->pool_frame - texrender->last_frame >
+			    max_idle_frames) {
+			texrender_release_target(texrender);
+			graphics->pool_info.reclaimed++;
+		}
+	}
+
+	trim_free_targets(graphics, max_idle_frames);
+}
+
+void gs_render_target_pool_get_info(struct gs_render_target_pool_info *info)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!info)
+		return;
+	if (!graphics) {
+		memset(info, 0, sizeof(*info));
+		return;
+	}
+
+	*info = graphics->pool_info;
+	info->free_count = (uint32_t)graphics->free_targets.num;
+	info->free_bytes = 0;
+
+	for (size_t i = 0; i < graphics->free_targets.num; i++) {
+		struct gs_pooled_target *pt = &graphics->free_targets.array[i];
+		info->free_bytes += target_size(pt->format, pt->cx, pt->cy);
+	}
+}
+
+void gs_render_target_pool_free(graphics_t *graphics)
+{
+	for (size_t i = 0; i < graphics->free_targets.num; i++)
+		gs_texture_destroy(graphics->free_targets.array[i].tex);
+
+	/* texrenders destroyed after this no longer unregister */
+	for (size_t i = 0; i < graphics->transient_texrenders.num; i++)
+		graphics->transient_texrenders.array[i]->pool_graphics = NULL;
+
+	da_free(graphics->free_targets);
+	da_free(graphics->transient_texrenders);
+}
+
+/* ------------------------------------------------------------------------- */
+
 gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 				    enum gs_zstencil_format zsformat)
 {
@@ -47,11 +234,35 @@ gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 	return texrender;
 }
 
+gs_texrender_t *gs_texrender_create_transient(enum gs_color_format format,
+					      enum gs_zstencil_format zsformat)
+{
+	gs_texrender_t *texrender = gs_texrender_create(format, zsformat);
+	texrender->transient = true;
+	return texrender;
+}
+
 void gs_texrender_destroy(gs_texrender_t *texrender)
 {
 	if (texrender) {
-		gs_texture_destroy(texrender->target);
+		graphics_t *graphics = texrender->pool_graphics;
+
+		/* the pool walks its texrenders every frame, so it has to
+		 * forget this one even if there is no current context */
+		const bool enter = graphics && !gs_get_context();
+		if (enter)
+			gs_enter_context(graphics);
+
+		if (graphics)
+			da_erase_item(graphics->transient_texrenders,
+				      &texrender);
+
+		gs_render_target_release(texrender->target);
 		gs_zstencil_destroy(texrender->zs);
+
+		if (enter)
+			gs_leave_context();
+
 		bfree(texrender);
 	}
 }
@@ -62,7 +273,7 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx,
 	if (!texrender)
 		return false;
 
-	gs_texture_destroy(texrender->target);
+	gs_render_target_release(texrender->target);
 	gs_zstencil_destroy(texrender->zs);
 
 	texrender->target = NULL;
@@ -70,15 +281,15 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx,
 	texrender->cx = cx;
 	texrender->cy = cy;
 
-	texrender->target = gs_texture_create(cx, cy, texrender->format, 1,
-					      NULL, GS_RENDER_TARGET);
+	texrender->target =
+		gs_render_target_acquire(texrender->format, cx, cy);
 	if (!texrender->target)
 		return false;
 
 	if (texrender->zsformat != GS_ZS_NONE) {
 		texrender->zs = gs_zstencil_create(cx, cy, texrender->zsformat);
 		if (!texrender->zs) {
-			gs_texture_destroy(texrender->target);
+			gs_render_target_release(texrender->target);
 			texrender->target = NULL;
 
 			return false;
@@ -103,6 +314,18 @@ bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender, uint32_t cx,
 	if (!cx || !cy)
 		return false;
 
+	if (texrender->transient) {
+		graphics_t *graphics = gs_get_context();
+
+		if (graphics && !texrender->pool_graphics) {
+			da_push_back(graphics->transient_texrenders,
+				     &texrender);
+			texrender->pool_graphics = graphics;
+		}
+		if (graphics)
+			texrender->last_frame = graphics->pool_frame;
+	}
+
 	if (texrender->cx != cx || texrender->cy != cy)
 		if (!texrender_resetbuffer(texrender, cx, cy))
 			return false;
@@ -75,6 +75,7 @@ struct audio_output {
 
 	audio_input_callback_t input_cb;
 	void *input_param;
+	bool catch_up;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
 };
@@ -161,30 +162,16 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 	}
 }
 
-static void input_and_output(struct audio_output *audio, uint64_t audio_time,
-			     uint64_t prev_time)
+static void mix_and_output(struct audio_output *audio, uint64_t audio_time,
+			   uint64_t prev_time, uint32_t active_mixes)
 {
 	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
-	uint32_t active_mixes = 0;
 	uint64_t new_ts = 0;
 	bool success;
 
 	memset(data, 0, sizeof(data));
 
-#ifdef DEBUG_AUDIO
-	blog(LOG_DEBUG, "audio_time: %llu, prev_time: %llu, bytes: %lu",
-	     audio_time, prev_time, bytes);
-#endif
-
-	/* get mixers */
-	pthread_mutex_lock(&audio->input_mutex);
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-		if (audio->mixes[i].inputs.num)
-			active_mixes |= (1 << i);
-	}
-	pthread_mutex_unlock(&audio->input_mutex);
-
 	/* clear mix buffers */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
@@ -209,6 +196,34 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
 }
 
+static void input_and_output(struct audio_output *audio, uint64_t audio_time,
+			     uint64_t prev_time)
+{
+	uint32_t active_mixes = 0;
+
+#ifdef DEBUG_AUDIO
+	blog(LOG_DEBUG, "audio_time: %llu, prev_time: %llu, bytes: %lu",
+	     audio_time, prev_time,
+	     (unsigned long)(AUDIO_OUTPUT_FRAMES * audio->block_size));
+#endif
+
+	/* get mixers */
+	pthread_mutex_lock(&audio->input_mutex);
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if (audio->mixes[i].inputs.num)
+			active_mixes |= (1 << i);
+	}
+	pthread_mutex_unlock(&audio->input_mutex);
+
+	audio->catch_up = false;
+	mix_and_output(audio, audio_time, prev_time, active_mixes);
+
+	while (audio->catch_up) {
+		audio->catch_up = false;
+		mix_and_output(audio, audio_time, audio_time, active_mixes);
+	}
+}
+
 static void *audio_thread(void *param)
 {
 #ifdef _WIN32
@@ -452,6 +467,12 @@ bool audio_output_active(const audio_t *audio)
 	return false;
 }
 
+void audio_output_catch_up(audio_t *audio)
+{
+	if (audio)
+		audio->catch_up = true;
+}
+
 size_t audio_output_get_block_size(const audio_t *audio)
 {
 	return audio->block_size;
@@ -232,6 +232,14 @@ EXPORT void audio_output_disconnect(audio_t *video, size_t mix_idx,
 
 EXPORT bool audio_output_active(const audio_t *audio);
 
+/**
+ * Only valid from within the input callback.  The callback is called again
+ * right away with an empty time range (start_ts == end_ts) to output audio
+ * that was buffered ahead of time, which is how buffering is reduced without
+ * skipping any audio.
+ */
+EXPORT void audio_output_catch_up(audio_t *audio);
+
 EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
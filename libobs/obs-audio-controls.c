@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/sse-intrin.h"
 
 #include "util/threading.h"
+#include "util/platform.h"
 #include "util/bmem.h"
 #include "media-io/audio-math.h"
 #include "obs.h"
@@ -61,6 +62,47 @@ struct meter_cb {
 	void *param;
 };
 
+/* frames per channel, must be a power of two */
+#define METER_RING_FRAMES 8192
+#define METER_RING_MASK (METER_RING_FRAMES - 1)
+
+#define METER_SERVICE_INTERVAL_MS 10
+#define METER_DEFAULT_UPDATE_MS 50
+
+#define LOUDNESS_BLOCK_MS 100
+#define LOUDNESS_MOMENTARY_BLOCKS 4
+#define LOUDNESS_SHORT_TERM_BLOCKS 30
+
+/* Single producer (the source's audio capture callback, which is serialized by
+ * the source) and single consumer (the metering thread). */
+struct meter_ring {
+	float *data[MAX_AUDIO_CHANNELS];
+	size_t channels;
+
+	volatile long write_pos;
+	volatile long read_pos;
+	volatile long nr_channels;
+	volatile long dropped;
+	volatile bool silenced;
+};
+
+struct meter_loudness {
+	double coef[2][5];
+	double state[MAX_AUDIO_CHANNELS][2][2];
+	double weight[MAX_AUDIO_CHANNELS];
+
+	double block_energy[MAX_AUDIO_CHANNELS];
+	size_t block_frames;
+	size_t block_size;
+
+	double blocks[LOUDNESS_SHORT_TERM_BLOCKS];
+	size_t block_idx;
+	size_t block_count;
+
+	float momentary;
+	float short_term;
+};
+
 struct obs_volmeter {
 	pthread_mutex_t mutex;
 	obs_source_t *source;
@@ -76,8 +118,24 @@ struct obs_volmeter {
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
+
+	volatile bool async;
+	struct meter_ring ring;
+	struct meter_loudness loudness;
+	double interval_sum[MAX_AUDIO_CHANNELS];
+	size_t interval_frames;
+	bool interval_silenced;
+	uint64_t last_publish_ns;
 };
 
+/* shared metering thread for volume meters in async mode */
+static pthread_mutex_t meter_service_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t meter_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct obs_volmeter *) meter_list;
+static os_event_t *meter_stop_event;
+static pthread_t meter_thread;
+static bool meter_thread_active = false;
+
 static float cubic_def_to_db(const float def)
 {
 	if (def == 1.0f)
@@ -517,6 +575,408 @@ static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
 	volmeter_process_magnitude(volmeter, data, nr_channels);
 }
 
+/* ------------------------------------------------------------------------- */
+/* async metering */
+
+static void volmeter_ring_push(struct obs_volmeter *volmeter,
+			       const struct audio_data *data, bool silenced)
+{
+	struct meter_ring *ring = &volmeter->ring;
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	size_t frames = data->frames;
+
+	unsigned long w = (unsigned long)os_atomic_load_long(&ring->write_pos);
+	unsigned long r = (unsigned long)os_atomic_load_long(&ring->read_pos);
+
+	if (frames > METER_RING_FRAMES - (size_t)(w - r)) {
+		os_atomic_inc_long(&ring->dropped);
+		return;
+	}
+
+	size_t offset = w & METER_RING_MASK;
+	size_t first = METER_RING_FRAMES - offset;
+	if (first > frames)
+		first = frames;
+
+	int channel_nr = 0;
+	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
+		const float *samples = (const float *)data->data[plane_nr];
+		if (!samples)
+			continue;
+
+		if ((size_t)channel_nr < ring->channels) {
+			float *dst = ring->data[channel_nr];
+			memcpy(dst + offset, samples, first * sizeof(float));
+			memcpy(dst, samples + first,
+			       (frames - first) * sizeof(float));
+		}
+
+		channel_nr++;
+	}
+
+	if ((size_t)nr_channels > ring->channels)
+		nr_channels = (int)ring->channels;
+
+	os_atomic_set_long(&ring->nr_channels, nr_channels);
+	os_atomic_set_bool(&ring->silenced, silenced);
+	os_atomic_set_long(&ring->write_pos, (long)(w + frames));
+}
+
+/* ITU-R BS.1770 K-weighting: a high shelf followed by a high pass, with the
+ * coefficients derived for the actual sample rate */
+static void loudness_init(struct meter_loudness *l, uint32_t sample_rate,
+			  enum speaker_layout speakers)
+{
+	double *shelf = l->coef[0];
+	double *hp = l->coef[1];
+
+	double K = tan(M_PI * 1681.974450955533 / sample_rate);
+	double Q = 0.7071752369554196;
+	double Vh = pow(10.0, 3.999843853973347 / 20.0);
+	double Vb = pow(Vh, 0.4996667741545416);
+	double a0 = 1.0 + K / Q + K * K;
+
+	shelf[0] = (Vh + Vb * K / Q + K * K) / a0;
+	shelf[1] = 2.0 * (K * K - Vh) / a0;
+	shelf[2] = (Vh - Vb * K / Q + K * K) / a0;
+	shelf[3] = 2.0 * (K * K - 1.0) / a0;
+	shelf[4] = (1.0 - K / Q + K * K) / a0;
+
+	K = tan(M_PI * 38.13547087602444 / sample_rate);
+	Q = 0.5003270373238773;
+	a0 = 1.0 + K / Q + K * K;
+
+	hp[0] = 1.0;
+	hp[1] = -2.0;
+	hp[2] = 1.0;
+	hp[3] = 2.0 * (K * K - 1.0) / a0;
+	hp[4] = (1.0 - K / Q + K * K) / a0;
+
+	memset(l->state, 0, sizeof(l->state));
+	memset(l->block_energy, 0, sizeof(l->block_energy));
+	l->block_frames = 0;
+	l->block_size = sample_rate * LOUDNESS_BLOCK_MS / 1000;
+	l->block_idx = 0;
+	l->block_count = 0;
+	l->momentary = -INFINITY;
+	l->short_term = -INFINITY;
+
+	/* the LFE channel is excluded, surround channels are weighted up */
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		l->weight[i] = 1.0;
+
+	switch (speakers) {
+	case SPEAKERS_2POINT1:
+		l->weight[2] = 0.0;
+		break;
+	case SPEAKERS_4POINT0:
+		l->weight[3] = 1.41;
+		break;
+	case SPEAKERS_4POINT1:
+		l->weight[3] = 0.0;
+		l->weight[4] = 1.41;
+		break;
+	case SPEAKERS_5POINT1:
+		l->weight[3] = 0.0;
+		l->weight[4] = 1.41;
+		l->weight[5] = 1.41;
+		break;
+	case SPEAKERS_7POINT1:
+		l->weight[3] = 0.0;
+		for (size_t i = 4; i < 8; i++)
+			l->weight[i] = 1.41;
+		break;
+	default:
+		break;
+	}
+}
+
+static inline float energy_to_lufs(double energy)
+{
+	return energy > 0.0 ? (float)(-0.691 + 10.0 * log10(energy))
+			    : -INFINITY;
+}
+
+static float loudness_average(const struct meter_loudness *l, size_t count)
+{
+	double sum = 0.0;
+
+	if (count > l->block_count)
+		count = l->block_count;
+	if (!count)
+		return -INFINITY;
+
+	for (size_t i = 1; i <= count; i++) {
+		size_t idx = (l->block_idx + LOUDNESS_SHORT_TERM_BLOCKS - i) %
+			     LOUDNESS_SHORT_TERM_BLOCKS;
+		sum += l->blocks[idx];
+	}
+
+	return energy_to_lufs(sum / (double)count);
+}
+
+static void loudness_finish_block(struct meter_loudness *l, int nr_channels)
+{
+	double energy = 0.0;
+
+	for (int ch = 0; ch < nr_channels; ch++) {
+		energy += l->weight[ch] * l->block_energy[ch] /
+			  (double)l->block_size;
+		l->block_energy[ch] = 0.0;
+	}
+
+	l->blocks[l->block_idx] = energy;
+	l->block_idx = (l->block_idx + 1) % LOUDNESS_SHORT_TERM_BLOCKS;
+	if (l->block_count < LOUDNESS_SHORT_TERM_BLOCKS)
+		l->block_count++;
+	l->block_frames = 0;
+
+	l->momentary = loudness_average(l, LOUDNESS_MOMENTARY_BLOCKS);
+	l->short_term = loudness_average(l, LOUDNESS_SHORT_TERM_BLOCKS);
+}
+
+static inline void k_weight(struct meter_loudness *l, int ch, float *samples,
+			    size_t frames)
+{
+	for (int stage = 0; stage < 2; stage++) {
+		const double *c = l->coef[stage];
+		double z1 = l->state[ch][stage][0];
+		double z2 = l->state[ch][stage][1];
+
+		for (size_t i = 0; i < frames; i++) {
+			double in = samples[i];
+			double out = c[0] * in + z1;
+			z1 = c[1] * in - c[3] * out + z2;
+			z2 = c[2] * in - c[4] * out;
+			samples[i] = (float)out;
+		}
+
+		l->state[ch][stage][0] = z1;
+		l->state[ch][stage][1] = z2;
+	}
+}
+
+/* filters the samples in place */
+static void loudness_process(struct meter_loudness *l, float **channels,
+			     int nr_channels, size_t frames)
+{
+	if (!l->block_size)
+		return;
+
+	for (int ch = 0; ch < nr_channels; ch++)
+		k_weight(l, ch, channels[ch], frames);
+
+	size_t pos = 0;
+	while (pos < frames) {
+		size_t n = l->block_size - l->block_frames;
+		if (n > frames - pos)
+			n = frames - pos;
+
+		for (int ch = 0; ch < nr_channels; ch++) {
+			const float *samples = channels[ch] + pos;
+			double sum = 0.0;
+			for (size_t i = 0; i < n; i++)
+				sum += (double)samples[i] * samples[i];
+			l->block_energy[ch] += sum;
+		}
+
+		pos += n;
+		l->block_frames += n;
+		if (l->block_frames == l->block_size)
+			loudness_finish_block(l, nr_channels);
+	}
+}
+
+/* called with volmeter->mutex held */
+static void volmeter_async_process(struct obs_volmeter *volmeter,
+				   float **scratch, size_t frames,
+				   int nr_channels)
+{
+	for (int ch = 0; ch < nr_channels; ch++) {
+		float *samples = scratch[ch];
+		__m128 previous_samples =
+			_mm_loadu_ps(volmeter->prev_samples[ch]);
+		float peak;
+
+		if (volmeter->peak_meter_type == TRUE_PEAK_METER)
+			peak = get_true_peak(previous_samples, samples, frames);
+		else
+			peak = get_sample_peak(previous_samples, samples,
+					       frames);
+
+		volmeter_process_peak_last_samples(volmeter, ch, samples,
+						   frames);
+
+		if (peak > volmeter->peak[ch])
+			volmeter->peak[ch] = peak;
+
+		double sum = 0.0;
+		for (size_t i = 0; i < frames; i++)
+			sum += (double)samples[i] * samples[i];
+		volmeter->interval_sum[ch] += sum;
+	}
+
+	loudness_process(&volmeter->loudness, scratch, nr_channels, frames);
+	volmeter->interval_frames += frames;
+}
+
+static void volmeter_async_tick(struct obs_volmeter *volmeter,
+				float **scratch, uint64_t now)
+{
+	struct meter_ring *ring = &volmeter->ring;
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+
+	unsigned long r = (unsigned long)os_atomic_load_long(&ring->read_pos);
+	unsigned long w = (unsigned long)os_atomic_load_long(&ring->write_pos);
+	int nr_channels = (int)os_atomic_load_long(&ring->nr_channels);
+
+	/* the peak functions work on groups of 4 samples, leave the remainder
+	 * for the next pass */
+	size_t frames = (size_t)(w - r) & ~(size_t)3;
+	size_t offset = r & METER_RING_MASK;
+	size_t first = METER_RING_FRAMES - offset;
+	if (first > frames)
+		first = frames;
+
+	pthread_mutex_lock(&volmeter->mutex);
+
+	if (frames) {
+		for (int ch = 0; ch < nr_channels; ch++) {
+			const float *src = ring->data[ch];
+			memcpy(scratch[ch], src + offset,
+			       first * sizeof(float));
+			memcpy(scratch[ch] + first, src,
+			       (frames - first) * sizeof(float));
+		}
+
+		os_atomic_set_long(&ring->read_pos, (long)(r + frames));
+
+		if (os_atomic_load_bool(&ring->silenced))
+			volmeter->interval_silenced = true;
+
+		volmeter_async_process(volmeter, scratch, frames, nr_channels);
+	}
+
+	uint64_t interval_ns = (uint64_t)(volmeter->update_ms
+						  ? volmeter->update_ms
+						  : METER_DEFAULT_UPDATE_MS) *
+			       1000000ULL;
+
+	if (!volmeter->interval_frames ||
+	    now - volmeter->last_publish_ns < interval_ns) {
+		pthread_mutex_unlock(&volmeter->mutex);
+		return;
+	}
+
+	float mul = volmeter->interval_silenced ? 0.0f
+						: db_to_mul(volmeter->cur_db);
+
+	for (int ch = 0; ch < MAX_AUDIO_CHANNELS; ch++) {
+		float rms = 0.0f;
+		if (ch < nr_channels)
+			rms = (float)sqrt(volmeter->interval_sum[ch] /
+					  (double)volmeter->interval_frames);
+		else
+			volmeter->peak[ch] = 0.0f;
+
+		magnitude[ch] = mul_to_db(rms * mul);
+		peak[ch] = mul_to_db(volmeter->peak[ch] * mul);
+		input_peak[ch] = mul_to_db(volmeter->peak[ch]);
+
+		volmeter->peak[ch] = 0.0f;
+		volmeter->interval_sum[ch] = 0.0;
+	}
+
+	volmeter->interval_frames = 0;
+	volmeter->interval_silenced = false;
+	volmeter->last_publish_ns = now;
+
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+}
+
+static void *meter_thread_func(void *unused)
+{
+	float *scratch[MAX_AUDIO_CHANNELS];
+	float *buf = bmalloc(sizeof(float) * METER_RING_FRAMES *
+			     MAX_AUDIO_CHANNELS);
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		scratch[i] = buf + i * METER_RING_FRAMES;
+
+	os_set_thread_name("libobs: volume meter thread");
+
+	while (os_event_timedwait(meter_stop_event,
+				  METER_SERVICE_INTERVAL_MS) == ETIMEDOUT) {
+		uint64_t now = os_gettime_ns();
+
+		pthread_mutex_lock(&meter_list_mutex);
+		for (size_t i = 0; i < meter_list.num; i++)
+			volmeter_async_tick(meter_list.array[i], scratch, now);
+		pthread_mutex_unlock(&meter_list_mutex);
+	}
+
+	bfree(buf);
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static bool meter_service_add(struct obs_volmeter *volmeter)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&meter_service_mutex);
+
+	if (!meter_thread_active) {
+		if (os_event_init(&meter_stop_event, OS_EVENT_TYPE_MANUAL) !=
+		    0) {
+			success = false;
+			goto finish;
+		}
+		if (pthread_create(&meter_thread, NULL, meter_thread_func,
+				   NULL) != 0) {
+			os_event_destroy(meter_stop_event);
+			meter_stop_event = NULL;
+			success = false;
+			goto finish;
+		}
+		meter_thread_active = true;
+	}
+
+	pthread_mutex_lock(&meter_list_mutex);
+	da_push_back(meter_list, &volmeter);
+	pthread_mutex_unlock(&meter_list_mutex);
+
+finish:
+	pthread_mutex_unlock(&meter_service_mutex);
+	return success;
+}
+
+static void meter_service_remove(struct obs_volmeter *volmeter)
+{
+	pthread_mutex_lock(&meter_service_mutex);
+
+	pthread_mutex_lock(&meter_list_mutex);
+	da_erase_item(meter_list, &volmeter);
+	bool empty = meter_list.num == 0;
+	pthread_mutex_unlock(&meter_list_mutex);
+
+	if (empty && meter_thread_active) {
+		os_event_signal(meter_stop_event);
+		pthread_join(meter_thread, NULL);
+		os_event_destroy(meter_stop_event);
+		meter_stop_event = NULL;
+		meter_thread_active = false;
+		da_free(meter_list);
+	}
+
+	pthread_mutex_unlock(&meter_service_mutex);
+}
+
 static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 					  const struct audio_data *data,
 					  bool muted)
@@ -527,6 +987,12 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 	float peak[MAX_AUDIO_CHANNELS];
 	float input_peak[MAX_AUDIO_CHANNELS];
 
+	if (os_atomic_load_bool(&volmeter->async)) {
+		volmeter_ring_push(volmeter, data,
+				   muted && !obs_source_muted(source));
+		return;
+	}
+
 	pthread_mutex_lock(&volmeter->mutex);
 
 	volmeter_process_audio_data(volmeter, data);
@@ -792,7 +1258,10 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 		return;
 
 	obs_volmeter_detach_source(volmeter);
+	obs_volmeter_set_async(volmeter, false);
 	da_free(volmeter->callbacks);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		bfree(volmeter->ring.data[i]);
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
 
@@ -906,6 +1375,73 @@ int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter)
 	return CLAMP(source_nr_audio_channels, 0, obs_nr_audio_channels);
 }
 
+bool obs_volmeter_set_async(obs_volmeter_t *volmeter, bool async)
+{
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_set_async"))
+		return false;
+	if (os_atomic_load_bool(&volmeter->async) == async)
+		return true;
+
+	if (!async) {
+		os_atomic_set_bool(&volmeter->async, false);
+		meter_service_remove(volmeter);
+		return true;
+	}
+
+	struct obs_audio_info oai;
+	if (!obs_get_audio_info(&oai))
+		return false;
+
+	struct meter_ring *ring = &volmeter->ring;
+
+	/* the ring is only freed with the meter, a capture callback may still
+	 * be writing to it after async mode has been turned off */
+	if (!ring->channels) {
+		ring->channels = get_audio_channels(oai.speakers);
+		for (size_t i = 0; i < ring->channels; i++)
+			ring->data[i] = bmalloc(sizeof(float) *
+						METER_RING_FRAMES);
+	}
+
+	/* discard anything left over from a previous session */
+	os_atomic_set_long(&ring->read_pos,
+			   os_atomic_load_long(&ring->write_pos));
+
+	pthread_mutex_lock(&volmeter->mutex);
+	loudness_init(&volmeter->loudness, oai.samples_per_sec, oai.speakers);
+	memset(volmeter->peak, 0, sizeof(volmeter->peak));
+	memset(volmeter->interval_sum, 0, sizeof(volmeter->interval_sum));
+	volmeter->interval_frames = 0;
+	volmeter->interval_silenced = false;
+	volmeter->last_publish_ns = 0;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	if (!meter_service_add(volmeter))
+		return false;
+
+	os_atomic_set_bool(&volmeter->async, true);
+	return true;
+}
+
+bool obs_volmeter_get_loudness(obs_volmeter_t *volmeter, float *momentary,
+			       float *short_term)
+{
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_get_loudness"))
+		return false;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	bool valid = os_atomic_load_bool(&volmeter->async) &&
+		     volmeter->loudness.block_count > 0;
+	if (momentary)
+		*momentary = valid ? volmeter->loudness.momentary : -INFINITY;
+	if (short_term)
+		*short_term = valid ? volmeter->loudness.short_term
+				    : -INFINITY;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	return valid;
+}
+
 void obs_volmeter_add_callback(obs_volmeter_t *volmeter,
 			       obs_volmeter_updated_t callback, void *param)
 {
@@ -267,6 +267,36 @@ EXPORT unsigned int obs_volmeter_get_update_interval(obs_volmeter_t *volmeter);
  */
 EXPORT int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter);
 
+/**
+ * @brief Move the level calculation of the volume meter off the audio thread
+ * @param volmeter pointer to the volume meter object
+ * @param async true to enable async metering
+ * @return true on success
+ *
+ * In async mode the audio capture callback of the source only copies the
+ * audio data into a ring buffer.  Peaks, magnitude and EBU R128 loudness are
+ * calculated by a metering thread shared by all async volume meters, and the
+ * levels_updated callbacks are called from that thread once per update
+ * interval (50 ms unless set otherwise) with the peak over the interval.
+ *
+ * Callbacks of an async volume meter must not enable or disable async mode or
+ * destroy a volume meter.
+ */
+EXPORT bool obs_volmeter_set_async(obs_volmeter_t *volmeter, bool async);
+
+/**
+ * @brief Get the EBU R128 loudness of an async volume meter
+ * @param volmeter pointer to the volume meter object
+ * @param momentary momentary loudness (400 ms window) in LUFS
+ * @param short_term short-term loudness (3 s window) in LUFS
+ * @return false if the meter is not in async mode or has no data yet, in
+ *         which case both values are set to -inf
+ *
+ * The loudness is measured before the volume of the source is applied.
+ */
+EXPORT bool obs_volmeter_get_loudness(obs_volmeter_t *volmeter,
+				      float *momentary, float *short_term);
+
 typedef void (*obs_volmeter_updated_t)(
 	void *param, const float magnitude[MAX_AUDIO_CHANNELS],
 	const float peak[MAX_AUDIO_CHANNELS],
@@ -0,0 +1,64 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-audio-latency.h"
+
+long audio_latency_comp_step(long target, long applied, uint32_t frames)
+{
+	long diff = target - applied;
+	long max_step = (long)(frames / AUDIO_LATENCY_STRETCH_DIV);
+
+	if (!diff || !frames)
+		return 0;
+
+	if (max_step < 1)
+		max_step = 1;
+
+	if (diff > 0)
+		return diff < max_step ? diff : max_step;
+
+	/* never squeeze a packet down to nothing */
+	if (max_step >= (long)frames)
+		max_step = (long)frames - 1;
+	return -diff < max_step ? diff : -max_step;
+}
+
+void audio_latency_stretch(float *out[], const float *const in[], float *last,
+			   size_t channels, uint32_t in_frames,
+			   uint32_t out_frames)
+{
+	if (!in_frames || !out_frames)
+		return;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *src = in[ch];
+		float *dst = out[ch];
+
+		/* output frame i is at input position (i + 1) * in / out - 1,
+		 * between the previous input frame and the next one.  The
+		 * last output frame lands exactly on the last input frame. */
+		for (uint32_t i = 0; i < out_frames; i++) {
+			uint64_t pos = (uint64_t)(i + 1) * in_frames;
+			uint32_t next = (uint32_t)(pos / out_frames);
+			float t = (float)(pos % out_frames) / (float)out_frames;
+			float a = next ? src[next - 1] : last[ch];
+			float b = next < in_frames ? src[next] : a;
+
+			dst[i] = a + (b - a) * t;
+		}
+
+		last[ch] = src[in_frames - 1];
+	}
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/c99defs.h"
+
+/*
+ *   The latency compensation of a late audio source is never applied in one
+ * go, that would leave a gap in its audio (or skip some of it).  Instead the
+ * audio of the source is stretched (or squeezed) by a small fraction until
+ * the compensation reaches its target, so the change is inaudible apart from
+ * a slight change of pitch while it lasts.
+ */
+
+/* at most 1/200th (0.5%) of the frames of a packet are added or removed */
+#define AUDIO_LATENCY_STRETCH_DIV 200
+
+/* frames to add to a packet of the given size (negative to remove) to move
+ * the applied compensation towards the target, both in frames */
+long audio_latency_comp_step(long target, long applied, uint32_t frames);
+
+/* resamples planar audio from in_frames to out_frames with linear
+ * interpolation.  last holds the last sample of the previous packet of every
+ * channel and is updated, so consecutive packets join up without a click. */
+void audio_latency_stretch(float *out[], const float *const in[], float *last,
+			   size_t channels, uint32_t in_frames,
+			   uint32_t out_frames);
+
+/* keeps track of the last samples of a packet that was not stretched */
+static inline void audio_latency_keep_last(float *last,
+					   const float *const in[],
+					   size_t channels, uint32_t frames)
+{
+	if (!frames)
+		return;
+
+	for (size_t ch = 0; ch < channels; ch++)
+		last[ch] = in[ch][frames - 1];
+}
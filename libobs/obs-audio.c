@@ -297,6 +297,50 @@ static inline bool audio_buffering_maxed(struct obs_core_audio *audio)
 	return audio->total_buffering_ticks == audio->max_buffering_ticks;
 }
 
+static inline int ticks_to_ms(int ticks, size_t sample_rate)
+{
+	return (int)((int64_t)ticks * AUDIO_OUTPUT_FRAMES * 1000 /
+		     (int64_t)sample_rate);
+}
+
+static void record_buffering_change(struct obs_core_audio *audio,
+				    size_t sample_rate, int ticks)
+{
+	struct obs_audio_buffering_event *event;
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+
+	event = &audio->buffering_history[audio->buffering_history_pos];
+	event->timestamp = os_gettime_ns();
+	event->change_ms = ticks_to_ms(ticks, sample_rate);
+	event->total_ms = (uint32_t)ticks_to_ms(audio->total_buffering_ticks,
+						sample_rate);
+	audio->buffering_ms = event->total_ms;
+
+	audio->buffering_history_pos =
+		(audio->buffering_history_pos + 1) % AUDIO_BUFFERING_HISTORY;
+	if (audio->buffering_history_count < AUDIO_BUFFERING_HISTORY)
+		audio->buffering_history_count++;
+
+	pthread_mutex_unlock(&audio->buffering_mutex);
+}
+
+/* a source fell behind again, so stop removing buffering and start over */
+static void reset_adaptive_buffering(struct obs_core_audio *audio,
+				     size_t sample_rate)
+{
+	int removed = audio->shrink_total_ticks - audio->shrink_ticks;
+
+	if (audio->shrink_ticks && removed)
+		record_buffering_change(audio, sample_rate, -removed);
+
+	audio->shrink_ticks = 0;
+	audio->shrink_total_ticks = 0;
+	audio->adapt_ticks = 0;
+	audio->late_source = NULL;
+	audio->late_periods = 0;
+}
+
 static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 				      size_t sample_rate, struct ts_info *ts)
 {
@@ -312,6 +356,7 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 
 	ticks = audio->max_buffering_ticks - audio->total_buffering_ticks;
 	audio->total_buffering_ticks += ticks;
+	record_buffering_change(audio, sample_rate, ticks);
 
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
 		   sample_rate;
@@ -361,6 +406,8 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	if (audio_buffering_maxed(audio))
 		return;
 
+	reset_adaptive_buffering(audio, sample_rate);
+
 	if (!audio->buffering_wait_ticks)
 		audio->buffered_ts = ts->start;
 
@@ -377,6 +424,8 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
+	record_buffering_change(audio, sample_rate, ticks);
+
 	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
 		   sample_rate;
@@ -492,6 +541,239 @@ static inline const char *calc_min_ts(struct obs_core_data *data,
 	return buffering_name;
 }
 
+/* ------------------------------------------------------------------------- */
+/* adaptive buffering
+ *
+ *   Buffering is added as soon as any source falls behind, but it is only
+ * ever removed once every source has kept enough audio queued beyond the
+ * window being mixed for a whole period.  That margin ("slack") minus each
+ * source's jitter over the period is what can safely be removed.  Removing
+ * a tick outputs one extra block of already buffered audio, so nothing is
+ * skipped or stretched and timestamps stay continuous.
+ *
+ *   If a single source is what keeps the buffering up for several periods,
+ * that source alone is delayed by the amount the others could give up.  The
+ * delay is applied gradually by the thread outputting the source's audio
+ * (see obs-audio-latency.h), after which the source has enough slack for the
+ * whole mix to get its latency back.  Once a delayed source has more slack
+ * than it needs, its delay is reduced again the same way. */
+
+#define ADAPT_PERIOD_MS 2000
+#define ISOLATE_LATE_PERIODS 5
+
+static void sample_audio_slack(struct obs_core_audio *audio,
+			       obs_source_t *source, size_t sample_rate,
+			       const struct ts_info *ts)
+{
+	size_t frames = source->audio_input_buf[0].size / sizeof(float);
+	uint64_t end;
+	uint64_t slack;
+
+	if (!audio->adapt_ticks)
+		source->audio_slack_sampled = false;
+
+	if (source->info.audio_render || source->audio_pending ||
+	    !source->audio_ts)
+		return;
+
+	end = source->audio_ts + audio_frames_to_ns(sample_rate, frames);
+	slack = end > ts->end ? end - ts->end : 0;
+
+	if (!source->audio_slack_sampled) {
+		source->audio_slack_min = slack;
+		source->audio_slack_max = slack;
+		source->audio_slack_sampled = true;
+	} else if (slack < source->audio_slack_min) {
+		source->audio_slack_min = slack;
+	} else if (slack > source->audio_slack_max) {
+		source->audio_slack_max = slack;
+	}
+}
+
+static inline int get_removable_ticks(const obs_source_t *source,
+				      uint64_t tick_ns)
+{
+	uint64_t jitter = source->audio_slack_max - source->audio_slack_min;
+	uint64_t margin = jitter > tick_ns ? jitter : tick_ns;
+
+	if (source->audio_slack_min <= margin)
+		return 0;
+	return (int)((source->audio_slack_min - margin) / tick_ns);
+}
+
+/* returns whether the latency compensation of the source is still moving
+ * towards its target */
+static inline bool audio_latency_comp_pending(obs_source_t *source)
+{
+	return os_atomic_load_long(&source->audio_latency_comp_target) !=
+	       os_atomic_load_long(&source->audio_latency_comp);
+}
+
+/* the sync offset can reset the delay of the source at any time */
+static void move_audio_latency_comp(obs_source_t *source, long frames)
+{
+	long target = os_atomic_load_long(&source->audio_latency_comp_target);
+	long new_target;
+
+	do {
+		new_target = target + frames;
+		if (new_target < 0)
+			new_target = 0;
+	} while (!os_atomic_compare_exchange_long(
+		&source->audio_latency_comp_target, &target, new_target));
+}
+
+/* gives back the delay a compensated source no longer needs, returns whether
+ * it did */
+static bool reduce_audio_latency_comp(obs_source_t *source, int ticks,
+				      size_t sample_rate)
+{
+	long target = os_atomic_load_long(&source->audio_latency_comp_target);
+	long frames = (long)ticks * AUDIO_OUTPUT_FRAMES;
+
+	if (!target || ticks <= 0)
+		return false;
+
+	if (frames > target)
+		frames = target;
+	move_audio_latency_comp(source, -frames);
+
+	blog(LOG_INFO,
+	     "Source '%s' caught up, reducing its audio delay by %d "
+	     "milliseconds",
+	     obs_source_get_name(source),
+	     (int)((int64_t)frames * 1000 / (int64_t)sample_rate));
+	return true;
+}
+
+static void shrink_audio_buffering(struct obs_core_audio *audio,
+				   size_t sample_rate, int ticks)
+{
+	audio->shrink_ticks = ticks;
+	audio->shrink_total_ticks = ticks;
+
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering will be %d milliseconds",
+	     ticks_to_ms(ticks, sample_rate),
+	     ticks_to_ms(audio->total_buffering_ticks - ticks, sample_rate));
+}
+
+/* called once per tick with the audio sources locked */
+static void adapt_audio_buffering(struct obs_core_audio *audio,
+				  struct obs_core_data *data,
+				  size_t sample_rate)
+{
+	const int period_ticks = (int)(sample_rate * ADAPT_PERIOD_MS / 1000 /
+				       AUDIO_OUTPUT_FRAMES);
+	uint64_t tick_ns = audio_frames_to_ns(sample_rate, AUDIO_OUTPUT_FRAMES);
+	int removable = audio->total_buffering_ticks;
+	int removable_others = audio->total_buffering_ticks;
+	obs_source_t *late_source = NULL;
+	bool reduced = false;
+
+	if (++audio->adapt_ticks < period_ticks)
+		return;
+
+	audio->adapt_ticks = 0;
+
+	if (!audio->total_buffering_ticks || audio->buffering_wait_ticks ||
+	    audio->shrink_ticks)
+		return;
+
+	/* wait until every delay change has been applied, the slack sampled
+	 * in the meantime doesn't show the effect yet */
+	obs_source_t *source = data->first_audio_source;
+	while (source) {
+		if (source->audio_slack_sampled &&
+		    audio_latency_comp_pending(source))
+			return;
+
+		source = (struct obs_source *)source->next_audio_source;
+	}
+
+	source = data->first_audio_source;
+	while (source) {
+		if (source->audio_slack_sampled) {
+			int ticks = get_removable_ticks(source, tick_ns);
+
+			if (reduce_audio_latency_comp(source, ticks,
+						      sample_rate)) {
+				reduced = true;
+			} else if (ticks < removable) {
+				removable_others = removable;
+				removable = ticks;
+				late_source = source;
+			} else if (ticks < removable_others) {
+				removable_others = ticks;
+			}
+		}
+
+		source = (struct obs_source *)source->next_audio_source;
+	}
+
+	if (reduced)
+		return;
+
+	if (removable > 0) {
+		audio->late_source = NULL;
+		shrink_audio_buffering(audio, sample_rate, removable);
+		return;
+	}
+
+	if (!late_source || removable_others <= 0) {
+		audio->late_source = NULL;
+		return;
+	}
+
+	if (audio->late_source != late_source) {
+		audio->late_source = late_source;
+		audio->late_periods = 0;
+	}
+
+	if (++audio->late_periods < ISOLATE_LATE_PERIODS)
+		return;
+
+	/* the buffering is removed once the delay has been applied and the
+	 * source has the slack for it */
+	move_audio_latency_comp(late_source,
+				(long)removable_others * AUDIO_OUTPUT_FRAMES);
+	audio->late_source = NULL;
+
+	blog(LOG_INFO,
+	     "Source '%s' is holding back audio buffering, delaying it by "
+	     "%d milliseconds instead of the whole mix",
+	     obs_source_get_name(late_source),
+	     ticks_to_ms(removable_others, sample_rate));
+}
+
+/* one extra block of buffered audio was output */
+static void finish_catch_up(struct obs_core_audio *audio, size_t sample_rate)
+{
+	audio->total_buffering_ticks--;
+
+	if (--audio->shrink_ticks == 0) {
+		record_buffering_change(audio, sample_rate,
+					-audio->shrink_total_ticks);
+		audio->shrink_total_ticks = 0;
+	}
+}
+
+static void record_render_time(struct obs_core_audio *audio,
+			       uint64_t start_time, size_t sample_rate)
+{
+	uint64_t render_ns = os_gettime_ns() - start_time;
+	uint64_t tick_ns = util_mul_div64(AUDIO_OUTPUT_FRAMES, 1000000000ULL,
+					  sample_rate);
+	long render_us = (long)(render_ns / 1000);
+
+	os_atomic_inc_long(&audio->render_ticks);
+	if (render_ns > tick_ns)
+		os_atomic_inc_long(&audio->render_deadline_misses);
+	if (render_us > os_atomic_load_long(&audio->render_max_us))
+		os_atomic_set_long(&audio->render_max_us, render_us);
+}
+
 static inline void release_audio_sources(struct obs_core_audio *audio)
 {
 	for (size_t i = 0; i < audio->render_order.num; i++)
@@ -525,13 +807,22 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	bool catching_up = start_ts_in == end_ts_in;
+	bool adaptive = !audio->fixed_buffer && !catching_up;
+	uint64_t start_time = os_gettime_ns();
 	size_t audio_size;
 	uint64_t min_ts;
 
+	/* catching up outputs a window that is already buffered */
+	if (catching_up && (!audio->shrink_ticks ||
+			    !audio->buffered_timestamps.size))
+		return false;
+
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
 
-	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	if (!catching_up)
+		deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
 	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -633,7 +924,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		if (!audio_buffering_maxed(audio)) {
 			set_fixed_audio_buffering(audio, sample_rate, &ts);
 		}
-	} else if (min_ts < ts.start) {
+	} else if (min_ts < ts.start && !catching_up) {
 		add_audio_buffering(audio, sample_rate, &ts, min_ts,
 				    buffering_name);
 	}
@@ -664,12 +955,17 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	source = data->first_audio_source;
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
+		if (adaptive)
+			sample_audio_slack(audio, source, sample_rate, &ts);
 		discard_audio(audio, source, channels, sample_rate, &ts);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source *)source->next_audio_source;
 	}
 
+	if (adaptive)
+		adapt_audio_buffering(audio, data, sample_rate);
+
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
@@ -680,11 +976,20 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	*out_ts = ts.start;
 
+	/* catch up ticks are extra ticks run within the same period */
+	if (!catching_up)
+		record_render_time(audio, start_time, sample_rate);
+
 	if (audio->buffering_wait_ticks) {
 		audio->buffering_wait_ticks--;
 		return false;
 	}
 
+	if (catching_up)
+		finish_catch_up(audio, sample_rate);
+	else if (audio->shrink_ticks)
+		audio_output_catch_up(audio->audio);
+
 	execute_audio_tasks();
 
 	UNUSED_PARAMETER(param);
@@ -278,7 +278,7 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	name_size = get_name_align_size(name);
 	total_size = name_size + sizeof(struct obs_data_item) + size;
 
-	item = bzalloc(total_size);
+	item = bzalloc_tagged(BMEM_TAG_DATA, total_size);
 
 	item->capacity = total_size;
 	item->type = type;
@@ -1755,7 +1755,8 @@ void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 	long *p_refs;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
+	p_refs = bmalloc_tagged(BMEM_TAG_ENCODER_PACKETS,
+				src->size + sizeof(long));
 	dst->data = (void *)(p_refs + 1);
 	*p_refs = 1;
 	memcpy(dst->data, src->data, src->size);
@@ -0,0 +1,173 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-hotkey-events.h"
+
+static inline bool is_modifier_key(obs_key_t key)
+{
+	return key == OBS_KEY_SHIFT || key == OBS_KEY_CONTROL ||
+	       key == OBS_KEY_ALT || key == OBS_KEY_META;
+}
+
+static void
+rebuild_key_bindings(struct obs_hotkey_event_index *index,
+		     const struct obs_hotkey_event_dispatch *dispatch)
+{
+	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
+		da_resize(index->key_bindings[i], 0);
+
+	for (size_t i = 0; i < dispatch->num_bindings; i++) {
+		obs_key_t key = dispatch->bindings[i].key.key;
+		if (key >= OBS_KEY_NONE && key < OBS_KEY_LAST_VALUE)
+			da_push_back(index->key_bindings[key], &i);
+	}
+
+	index->key_bindings_dirty = false;
+}
+
+static inline uint32_t
+get_event_modifiers(const struct obs_hotkey_event_index *index)
+{
+	const bool *state = index->key_state;
+	uint32_t modifiers = 0;
+
+	if (state[OBS_KEY_SHIFT])
+		modifiers |= INTERACT_SHIFT_KEY;
+	if (state[OBS_KEY_CONTROL])
+		modifiers |= INTERACT_CONTROL_KEY;
+	if (state[OBS_KEY_ALT])
+		modifiers |= INTERACT_ALT_KEY;
+	if (state[OBS_KEY_META])
+		modifiers |= INTERACT_COMMAND_KEY;
+	return modifiers;
+}
+
+static inline obs_hotkey_binding_t *
+get_key_binding(const struct obs_hotkey_event_index *index,
+		const struct obs_hotkey_event_dispatch *dispatch,
+		obs_key_t key, size_t i)
+{
+	return &dispatch->bindings[index->key_bindings[key].array[i]];
+}
+
+static inline void set_pressed(const struct obs_hotkey_event_dispatch *dispatch,
+			       obs_hotkey_binding_t *binding, bool pressed)
+{
+	dispatch->set_pressed(dispatch->data, binding, pressed);
+}
+
+/* same rules as polling: the modifiers have to be down before the key is
+ * pressed, and a binding is released as soon as they change */
+static void dispatch_key(const struct obs_hotkey_event_index *index,
+			 const struct obs_hotkey_event_dispatch *dispatch,
+			 obs_key_t key, bool pressed, uint32_t modifiers)
+{
+	size_t num = index->key_bindings[key].num;
+
+	for (size_t i = 0; i < num; i++) {
+		obs_hotkey_binding_t *binding =
+			get_key_binding(index, dispatch, key, i);
+
+		if (!pressed) {
+			binding->modifiers_match = false;
+			if (binding->pressed)
+				set_pressed(dispatch, binding, false);
+			continue;
+		}
+
+		binding->modifiers_match = hotkey_modifiers_match(
+			binding, modifiers, dispatch->strict_modifiers);
+		if (!binding->modifiers_match || binding->pressed ||
+		    dispatch->disable_press)
+			continue;
+
+		set_pressed(dispatch, binding, true);
+	}
+}
+
+static void dispatch_modifiers(const struct obs_hotkey_event_index *index,
+			       const struct obs_hotkey_event_dispatch *dispatch,
+			       obs_key_t event_key, uint32_t modifiers)
+{
+	bool strict = dispatch->strict_modifiers;
+
+	/* modifier only bindings */
+	for (size_t i = 0; i < index->key_bindings[OBS_KEY_NONE].num; i++) {
+		obs_hotkey_binding_t *binding =
+			get_key_binding(index, dispatch, OBS_KEY_NONE, i);
+		bool match = binding->key.modifiers &&
+			     hotkey_modifiers_match(binding, modifiers, strict);
+
+		if (match && !binding->pressed && !dispatch->disable_press)
+			set_pressed(dispatch, binding, true);
+		else if (!match && binding->pressed)
+			set_pressed(dispatch, binding, false);
+	}
+
+	/* bindings of keys that are held while the modifiers change */
+	for (obs_key_t key = OBS_KEY_NONE + 1; key < OBS_KEY_LAST_VALUE;
+	     key++) {
+		if (!index->key_state[key] || key == event_key)
+			continue;
+
+		for (size_t i = 0; i < index->key_bindings[key].num; i++) {
+			obs_hotkey_binding_t *binding =
+				get_key_binding(index, dispatch, key, i);
+
+			binding->modifiers_match = hotkey_modifiers_match(
+				binding, modifiers, strict);
+			if (binding->modifiers_match || !binding->pressed)
+				continue;
+
+			set_pressed(dispatch, binding, false);
+		}
+	}
+}
+
+bool obs_hotkey_event_index_process(
+	struct obs_hotkey_event_index *index,
+	const struct obs_hotkey_event_dispatch *dispatch, obs_key_t key,
+	bool pressed)
+{
+	if (key <= OBS_KEY_NONE || key >= OBS_KEY_LAST_VALUE)
+		return false;
+
+	/* ignore auto repeat, but always let releases through so bindings
+	 * pressed while polling still get released */
+	if (pressed && index->key_state[key])
+		return false;
+
+	index->key_state[key] = pressed;
+
+	if (index->key_bindings_dirty)
+		rebuild_key_bindings(index, dispatch);
+
+	uint32_t modifiers = get_event_modifiers(index);
+	if (is_modifier_key(key))
+		dispatch_modifiers(index, dispatch, key, modifiers);
+	dispatch_key(index, dispatch, key, pressed, modifiers);
+	return true;
+}
+
+void obs_hotkey_event_index_reset(struct obs_hotkey_event_index *index)
+{
+	memset(index->key_state, 0, sizeof(index->key_state));
+}
+
+void obs_hotkey_event_index_free(struct obs_hotkey_event_index *index)
+{
+	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
+		da_free(index->key_bindings[i]);
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "obs.h"
+#include "util/darray.h"
+
+/*
+ *   Dispatch of key events pushed by platform backends.  Instead of polling
+ * every binding, each event only visits the bindings of its key (and of the
+ * keys held down when a modifier changes), through an index of binding
+ * indices per key.  The index doesn't touch the core, the hotkey thread
+ * calls it with the bindings under the hotkey lock.
+ */
+
+struct obs_hotkey_binding {
+	obs_key_combination_t key;
+	bool pressed;
+	bool modifiers_match;
+
+	obs_hotkey_id hotkey_id;
+	obs_hotkey_t *hotkey;
+};
+
+static inline bool hotkey_modifiers_match(const obs_hotkey_binding_t *binding,
+					  uint32_t modifiers_,
+					  bool strict_modifiers)
+{
+	uint32_t modifiers = binding->key.modifiers;
+	if (!strict_modifiers)
+		return (modifiers & modifiers_) == modifiers;
+	else
+		return modifiers == modifiers_;
+}
+
+struct obs_hotkey_event_index {
+	bool key_state[OBS_KEY_LAST_VALUE];
+	DARRAY(size_t) key_bindings[OBS_KEY_LAST_VALUE];
+	/* set whenever bindings are added or removed, bindings are stored by
+	 * value and shift around, so the index is rebuilt on the next event */
+	bool key_bindings_dirty;
+};
+
+struct obs_hotkey_event_dispatch {
+	obs_hotkey_binding_t *bindings;
+	size_t num_bindings;
+	bool strict_modifiers;
+	bool disable_press;
+
+	/* presses or releases a binding, has to update binding->pressed */
+	void (*set_pressed)(void *data, obs_hotkey_binding_t *binding,
+			    bool pressed);
+	void *data;
+};
+
+/* returns false for repeated key presses, which are ignored */
+extern bool
+obs_hotkey_event_index_process(struct obs_hotkey_event_index *index,
+			       const struct obs_hotkey_event_dispatch *dispatch,
+			       obs_key_t key, bool pressed);
+
+/* forgets the keys held down, once polling takes over they go stale */
+extern void obs_hotkey_event_index_reset(struct obs_hotkey_event_index *index);
+extern void obs_hotkey_event_index_free(struct obs_hotkey_event_index *index);
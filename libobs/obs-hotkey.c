@@ -518,6 +518,8 @@ static inline void create_binding(obs_hotkey_t *hotkey,
 	binding->key = combo;
 	binding->hotkey_id = hotkey->id;
 	binding->hotkey = hotkey;
+
+	obs->hotkeys.event_index.key_bindings_dirty = true;
 }
 
 static inline void load_binding(obs_hotkey_t *hotkey, obs_data_t *data)
@@ -876,6 +878,9 @@ static inline bool remove_bindings(obs_hotkey_id id)
 		removed = true;
 	}
 
+	if (removed)
+		obs->hotkeys.event_index.key_bindings_dirty = true;
+
 	return removed;
 }
 
@@ -1021,6 +1026,18 @@ void obs_hotkeys_free(void)
 
 	da_free(obs->hotkeys.bindings);
 
+	const struct obs_hotkey_event_stats *stats = &obs->hotkeys.event_stats;
+	if (stats->callbacks)
+		blog(LOG_INFO,
+		     "Hotkey events: %" PRIu64 " key events, %" PRIu64
+		     " callbacks, latency avg %.3f ms, max %.3f ms",
+		     stats->events, stats->callbacks,
+		     (double)stats->total_latency_ns /
+			     (double)stats->callbacks / 1000000.0,
+		     (double)stats->max_latency_ns / 1000000.0);
+
+	obs_hotkey_event_index_free(&obs->hotkeys.event_index);
+
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++) {
 		if (obs->hotkeys.translations[i]) {
 			bfree(obs->hotkeys.translations[i]);
@@ -1052,16 +1069,6 @@ void obs_enum_hotkey_bindings(obs_hotkey_binding_enum_func func, void *data)
 	unlock();
 }
 
-static inline bool modifiers_match(obs_hotkey_binding_t *binding,
-				   uint32_t modifiers_, bool strict_modifiers)
-{
-	uint32_t modifiers = binding->key.modifiers;
-	if (!strict_modifiers)
-		return (modifiers & modifiers_) == modifiers;
-	else
-		return modifiers == modifiers_;
-}
-
 static inline bool is_pressed(obs_key_t key)
 {
 	return obs_hotkeys_platform_is_pressed(obs->hotkeys.platform_context,
@@ -1103,7 +1110,7 @@ static inline void handle_binding(obs_hotkey_binding_t *binding,
 				  bool strict_modifiers, bool *pressed)
 {
 	bool modifiers_match_ =
-		modifiers_match(binding, modifiers, strict_modifiers);
+		hotkey_modifiers_match(binding, modifiers, strict_modifiers);
 	bool modifiers_only = binding->key.key == OBS_KEY_NONE;
 
 	if (!strict_modifiers && !binding->key.modifiers)
@@ -1148,8 +1155,8 @@ static inline bool inject_hotkey(void *data, size_t idx,
 	UNUSED_PARAMETER(idx);
 	struct obs_hotkey_internal_inject *event = data;
 
-	if (modifiers_match(binding, event->hotkey.modifiers,
-			    event->strict_modifiers)) {
+	if (hotkey_modifiers_match(binding, event->hotkey.modifiers,
+				   event->strict_modifiers)) {
 		bool pressed = binding->key.key == event->hotkey.key &&
 			       event->pressed;
 		if (binding->key.key == OBS_KEY_NONE)
@@ -1236,6 +1243,147 @@ static inline void query_hotkeys()
 	enum_bindings(query_hotkey, &param);
 }
 
+/* ------------------------------------------------------------------------- */
+/* event driven dispatch */
+
+struct obs_hotkey_key_event {
+	obs_key_t key;
+	bool pressed;
+	uint64_t ts;
+};
+
+static inline bool valid_event_key(obs_key_t key)
+{
+	return key > OBS_KEY_NONE && key < OBS_KEY_LAST_VALUE;
+}
+
+static inline void record_latency(const struct obs_hotkey_key_event *event)
+{
+	struct obs_hotkey_event_stats *stats = &obs->hotkeys.event_stats;
+	uint64_t latency = os_gettime_ns() - event->ts;
+
+	stats->callbacks++;
+	stats->total_latency_ns += latency;
+	if (latency > stats->max_latency_ns)
+		stats->max_latency_ns = latency;
+}
+
+static void set_binding_pressed(void *data, obs_hotkey_binding_t *binding,
+				bool pressed)
+{
+	record_latency(data);
+
+	if (pressed)
+		press_released_binding(binding);
+	else
+		release_pressed_binding(binding);
+}
+
+static void process_key_event(struct obs_hotkey_key_event *event)
+{
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+	struct obs_hotkey_event_dispatch dispatch = {
+		.bindings = hotkeys->bindings.array,
+		.num_bindings = hotkeys->bindings.num,
+		.strict_modifiers = hotkeys->strict_modifiers,
+		.disable_press = hotkeys->thread_disable_press,
+		.set_pressed = set_binding_pressed,
+		.data = event,
+	};
+
+	if (obs_hotkey_event_index_process(&hotkeys->event_index, &dispatch,
+					   event->key, event->pressed))
+		hotkeys->event_stats.events++;
+}
+
+static inline bool pop_key_event(struct obs_hotkey_key_event *event)
+{
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+	bool success = false;
+
+	pthread_mutex_lock(&hotkeys->events_mutex);
+	if (hotkeys->events.size >= sizeof(*event)) {
+		deque_pop_front(&hotkeys->events, event, sizeof(*event));
+		success = true;
+	}
+	pthread_mutex_unlock(&hotkeys->events_mutex);
+
+	return success;
+}
+
+static inline void process_key_events(void)
+{
+	struct obs_hotkey_key_event event;
+
+	while (pop_key_event(&event))
+		process_key_event(&event);
+}
+
+void obs_hotkey_push_key_event(obs_key_t key, bool pressed)
+{
+	if (!obs || !valid_event_key(key))
+		return;
+
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+	struct obs_hotkey_key_event event = {key, pressed, os_gettime_ns()};
+
+	pthread_mutex_lock(&hotkeys->events_mutex);
+	deque_push_back(&hotkeys->events, &event, sizeof(event));
+	pthread_mutex_unlock(&hotkeys->events_mutex);
+
+	os_event_signal(hotkeys->events_event);
+}
+
+void obs_hotkey_enable_key_events(bool enable)
+{
+	if (!lock())
+		return;
+
+	/* key state tracked from events goes stale once polling takes over */
+	if (!enable)
+		obs_hotkey_event_index_reset(&obs->hotkeys.event_index);
+
+	os_atomic_set_bool(&obs->hotkeys.key_events, enable);
+	unlock();
+
+	os_event_signal(obs->hotkeys.events_event);
+}
+
+/* the platform stops pushing events without holding the hotkey lock, so the
+ * hotkey thread makes the switch to polling on its behalf */
+void obs_hotkey_key_events_lost(void)
+{
+	os_atomic_set_bool(&obs->hotkeys.key_events_lost, true);
+	os_event_signal(obs->hotkeys.events_event);
+}
+
+static void fall_back_to_polling(void)
+{
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+
+	pthread_mutex_lock(&hotkeys->events_mutex);
+	deque_pop_front(&hotkeys->events, NULL, hotkeys->events.size);
+	pthread_mutex_unlock(&hotkeys->events_mutex);
+
+	obs_hotkey_event_index_reset(&hotkeys->event_index);
+	os_atomic_set_bool(&hotkeys->key_events, false);
+	os_atomic_set_bool(&hotkeys->key_events_lost, false);
+}
+
+void obs_hotkey_get_event_stats(struct obs_hotkey_event_stats *stats)
+{
+	if (!stats)
+		return;
+
+	if (!lock()) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	*stats = obs->hotkeys.event_stats;
+	unlock();
+}
+
 #define NBSP "\xC2\xA0"
 
 void *obs_hotkey_thread(void *arg)
@@ -1249,12 +1397,30 @@ void *obs_hotkey_thread(void *arg)
 				   "obs_hotkey_thread(%g" NBSP "ms)", 25.);
 	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
+	for (;;) {
+		bool key_events = os_atomic_load_bool(&obs->hotkeys.key_events);
+
+		if (key_events) {
+			os_event_wait(obs->hotkeys.events_event);
+			if (os_event_try(obs->hotkeys.stop_event) != EAGAIN)
+				break;
+		} else if (os_event_timedwait(obs->hotkeys.stop_event, 25) !=
+			   ETIMEDOUT) {
+			break;
+		}
+
 		if (!lock())
 			continue;
 
+		if (os_atomic_load_bool(&obs->hotkeys.key_events_lost)) {
+			fall_back_to_polling();
+			key_events = false;
+		}
+
 		profile_start(hotkey_thread_name);
-		query_hotkeys();
+		process_key_events();
+		if (!key_events)
+			query_hotkeys();
 		profile_end(hotkey_thread_name);
 
 		unlock();
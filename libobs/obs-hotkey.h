@@ -279,6 +279,29 @@ EXPORT void obs_hotkey_enable_background_press(bool enable);
 
 OBS_DEPRECATED EXPORT void obs_hotkey_enable_strict_modifiers(bool enable);
 
+/* event driven hotkeys
+ *
+ * Backends that see every key press and release (e.g. a global keyboard
+ * hook) can push them with obs_hotkey_push_key_event instead of having the
+ * hotkey thread poll the state of every bound key.  Once key events are
+ * enabled the hotkey thread sleeps until an event arrives; polling is only
+ * used while they are disabled.  The X11 backend enables them itself when
+ * XInput 2 raw events are available, elsewhere polling is the default. */
+
+struct obs_hotkey_event_stats {
+	uint64_t events;
+	uint64_t callbacks;
+	uint64_t total_latency_ns;
+	uint64_t max_latency_ns;
+};
+
+EXPORT void obs_hotkey_enable_key_events(bool enable);
+
+EXPORT void obs_hotkey_push_key_event(obs_key_t key, bool pressed);
+
+/* latency is measured from obs_hotkey_push_key_event to the callback */
+EXPORT void obs_hotkey_get_event_stats(struct obs_hotkey_event_stats *stats);
+
 /* hotkey callback routing (trigger callbacks through e.g. a UI thread) */
 
 typedef void (*obs_hotkey_callback_router_func)(void *data, obs_hotkey_id id,
@@ -37,6 +37,7 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-hotkey-events.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -52,6 +53,7 @@
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define AUDIO_BUFFERING_HISTORY 64
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -180,6 +182,7 @@ typedef struct obs_hotkey_pair obs_hotkey_pair_t;
 typedef struct obs_hotkeys_platform obs_hotkeys_platform_t;
 
 void *obs_hotkey_thread(void *param);
+void obs_hotkey_key_events_lost(void);
 
 struct obs_core_hotkeys;
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys);
@@ -194,15 +197,6 @@ void obs_hotkeys_context_release(struct obs_context_data *context);
 
 void obs_hotkeys_free(void);
 
-struct obs_hotkey_binding {
-	obs_key_combination_t key;
-	bool pressed;
-	bool modifiers_match;
-
-	obs_hotkey_id hotkey_id;
-	obs_hotkey_t *hotkey;
-};
-
 struct obs_hotkey_name_map_item;
 void obs_hotkey_name_map_free(void);
 
@@ -300,6 +294,17 @@ struct obs_core_video_mix {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	/* copies mapped staging surfaces into video-io off the graphics
+	 * thread, the surfaces stay mapped until readback_done is set */
+	os_sem_t *readback_semaphore;
+	os_event_t *readback_done;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
+	bool readback_pending;
+	struct video_data readback_frame;
+	int readback_count;
+
 	video_t *video;
 	struct obs_video_info ovi;
 
@@ -318,6 +323,8 @@ struct obs_core_video_mix {
 extern struct obs_core_video_mix *
 obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
+extern bool init_video_readback(struct obs_core_video_mix *video);
+extern void free_video_readback(struct obs_core_video_mix *video);
 
 struct obs_core_video {
 	graphics_t *graphics;
@@ -358,6 +365,10 @@ struct obs_core_video {
 	float sdr_white_level;
 	float hdr_nominal_peak_level;
 
+	volatile bool readback_inline;
+	volatile bool filter_fusion_disabled;
+	volatile bool scene_culling_disabled;
+
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
 
@@ -386,6 +397,20 @@ struct obs_core_audio {
 	int max_buffering_ticks;
 	bool fixed_buffer;
 
+	/* adaptive buffering, see adapt_audio_buffering */
+	int adapt_ticks;
+	int shrink_ticks;
+	int shrink_total_ticks;
+	const struct obs_source *late_source;
+	int late_periods;
+
+	pthread_mutex_t buffering_mutex;
+	uint32_t buffering_ms;
+	struct obs_audio_buffering_event
+		buffering_history[AUDIO_BUFFERING_HISTORY];
+	size_t buffering_history_pos;
+	size_t buffering_history_count;
+
 	pthread_mutex_t monitoring_mutex;
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
@@ -393,6 +418,11 @@ struct obs_core_audio {
 
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
+
+	/* render time of the ticks, see record_render_time */
+	volatile long render_ticks;
+	volatile long render_deadline_misses;
+	volatile long render_max_us;
 };
 
 /* user sources, output channels, and displays */
@@ -400,6 +430,10 @@ struct obs_core_data {
 	/* Hash tables (uthash) */
 	struct obs_source *sources;        /* Lookup by UUID (hh_uuid) */
 	struct obs_source *public_sources; /* Lookup by name (hh) */
+	/* Lookup by name for transitions, public or private.  Private ones
+	 * can share a name, those are kept in creation order */
+	struct obs_name_entry *transitions;
+	uint64_t next_transition_order;
 
 	/* Linked lists */
 	struct obs_source *first_audio_source;
@@ -447,6 +481,15 @@ struct obs_core_hotkeys {
 	bool reroute_hotkeys;
 	DARRAY(obs_hotkey_binding_t) bindings;
 
+	/* key events pushed by backends, see obs-hotkey-events.h */
+	pthread_mutex_t events_mutex;
+	struct deque events;
+	os_event_t *events_event;
+	volatile bool key_events;
+	volatile bool key_events_lost;
+	struct obs_hotkey_event_index event_index;
+	struct obs_hotkey_event_stats event_stats;
+
 	obs_hotkey_callback_router_func router_func;
 	void *router_func_data;
 
@@ -604,6 +647,58 @@ extern void obs_context_data_remove_name(struct obs_context_data *context,
 extern void obs_context_data_remove_uuid(struct obs_context_data *context,
 					 void *puuid_head);
 
+struct obs_name_entry {
+	char *name;
+	DARRAY(struct obs_source *) sources;
+	UT_hash_handle hh;
+};
+
+/* Lazily rebuilt name index (filters of a source, items of a scene).  The
+ * entries are owned by the index and hold a copy of the name, so clearing
+ * the index never touches the objects it pointed to, which may have been
+ * freed since it was built. */
+struct obs_name_index_entry {
+	char *name;
+	void *ptr;
+	UT_hash_handle hh;
+};
+
+static inline void obs_name_index_clear(struct obs_name_index_entry **index)
+{
+	struct obs_name_index_entry *entry, *tmp;
+
+	HASH_ITER (hh, *index, entry, tmp) {
+		HASH_DEL(*index, entry);
+		bfree(entry->name);
+		bfree(entry);
+	}
+}
+
+/* keeps the first pointer added for a name */
+static inline void obs_name_index_add(struct obs_name_index_entry **index,
+				      const char *name, void *ptr)
+{
+	struct obs_name_index_entry *entry;
+
+	HASH_FIND_STR(*index, name, entry);
+	if (entry)
+		return;
+
+	entry = bmalloc(sizeof(*entry));
+	entry->name = bstrdup(name);
+	entry->ptr = ptr;
+	HASH_ADD_STR(*index, name, entry);
+}
+
+static inline void *obs_name_index_find(struct obs_name_index_entry *index,
+					const char *name)
+{
+	struct obs_name_index_entry *entry;
+
+	HASH_FIND_STR(index, name, entry);
+	return entry ? entry->ptr : NULL;
+}
+
 extern void obs_context_wait(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
@@ -659,9 +754,75 @@ static inline bool obs_weak_ref_expired(struct obs_weak_ref *ref)
 struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
-	bool used;
+	volatile bool used;
+};
+
+/* Frames waiting to be displayed.  This is a single producer/single consumer
+ * ring: only the thread outputting video pushes (serialized by
+ * async_output_mutex) and only the graphics thread pops (with async_mutex
+ * held), so delivering a frame never has to wait for the graphics thread. */
+#define ASYNC_QUEUE_SIZE 32
+
+struct async_frame_queue {
+	struct obs_source_frame *frames[ASYNC_QUEUE_SIZE];
+	uint64_t queued_ts[ASYNC_QUEUE_SIZE];
+	volatile long head;
+	volatile long tail;
 };
 
+static inline size_t async_queue_size(struct async_frame_queue *q)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&q->head);
+	unsigned long tail = (unsigned long)os_atomic_load_long(&q->tail);
+	return (size_t)(head - tail);
+}
+
+static inline size_t async_queue_idx(struct async_frame_queue *q, size_t idx)
+{
+	return ((unsigned long)q->tail + idx) & (ASYNC_QUEUE_SIZE - 1);
+}
+
+/* consumer only, idx must be less than async_queue_size() */
+static inline struct obs_source_frame *
+async_queue_peek(struct async_frame_queue *q, size_t idx)
+{
+	return q->frames[async_queue_idx(q, idx)];
+}
+
+static inline uint64_t async_queue_peek_ts(struct async_frame_queue *q,
+					   size_t idx)
+{
+	return q->queued_ts[async_queue_idx(q, idx)];
+}
+
+static inline void async_queue_pop(struct async_frame_queue *q)
+{
+	os_atomic_inc_long(&q->tail);
+}
+
+/* producer only */
+static inline bool async_queue_push(struct async_frame_queue *q,
+				    struct obs_source_frame *frame)
+{
+	unsigned long head = (unsigned long)q->head;
+	size_t idx = head & (ASYNC_QUEUE_SIZE - 1);
+
+	if (async_queue_size(q) >= ASYNC_QUEUE_SIZE)
+		return false;
+
+	q->frames[idx] = frame;
+	q->queued_ts[idx] = os_gettime_ns();
+	os_atomic_inc_long(&q->head);
+	return true;
+}
+
+/* drops every queued frame, must be called by the consumer or by the
+ * producer while holding async_mutex */
+static inline void async_queue_clear(struct async_frame_queue *q)
+{
+	os_atomic_store_long(&q->tail, os_atomic_load_long(&q->head));
+}
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -711,6 +872,13 @@ struct media_action {
 	};
 };
 
+struct obs_fused_stage_key {
+	struct obs_source *filter;
+	long settings_version;
+	const char *shader;
+	bool premultiplied;
+};
+
 struct obs_source {
 	struct obs_context_data context;
 	struct obs_source_info info;
@@ -723,9 +891,15 @@ struct obs_source {
 	/* indicates ownership of the info.id buffer */
 	bool owns_info_id;
 
+	/* creation order of transitions, see obs_get_transition_by_name */
+	uint64_t transition_order;
+
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* incremented after every call of the source update */
+	volatile long settings_version;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -791,12 +965,28 @@ struct obs_source {
 	float volume;
 	int64_t sync_offset;
 	int64_t last_sync_offset;
+
+	/* audio thread: how far the buffered audio reaches past the window
+	 * being mixed, over the current adaptive buffering period */
+	bool audio_slack_sampled;
+	uint64_t audio_slack_min;
+	uint64_t audio_slack_max;
+
+	/* delay added to a late source by adaptive buffering, in frames.  The
+	 * audio thread sets the target, the thread outputting the audio moves
+	 * the applied delay towards it, see obs-audio-latency.h */
+	volatile long audio_latency_comp_target;
+	volatile long audio_latency_comp;
+	float audio_latency_last[MAX_AUDIO_CHANNELS];
+	float *audio_latency_buf;
+	uint32_t audio_latency_buf_frames;
 	float balance;
 
 	/* async video data */
 	gs_texture_t *async_textures[MAX_AV_PLANES];
 	gs_texrender_t *async_texrender;
 	struct obs_source_frame *cur_async_frame;
+	struct obs_source_frame *async_culled_frame;
 	bool async_gpu_conversion;
 	enum video_format async_format;
 	bool async_full_range;
@@ -815,8 +1005,9 @@ struct obs_source {
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
-	DARRAY(struct obs_source_frame *) async_frames;
+	struct async_frame_queue async_frames;
 	pthread_mutex_t async_mutex;
+	pthread_mutex_t async_output_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
 	uint32_t async_cache_width;
@@ -845,10 +1036,20 @@ struct obs_source {
 	struct obs_source *filter_target;
 	DARRAY(struct obs_source *) filters;
 	pthread_mutex_t filter_mutex;
+	/* first filter of each name (owned obs_name_index_entry copies),
+	 * rebuilt by obs_source_get_filter_by_name when dirty, which is set
+	 * whenever a filter is added, removed or renamed, or the filter list
+	 * is replaced */
+	struct obs_name_index_entry *filters_by_name;
+	bool filters_by_name_dirty;
 	gs_texrender_t *filter_texrender;
 	enum obs_allow_direct_render allow_direct;
 	bool rendering_filter;
 	bool filter_bypass_active;
+	/* effect of the filter stages drawn by this filter and the stages it
+	 * was made for, see obs-source-fusion.c */
+	gs_effect_t *fused_effect;
+	DARRAY(struct obs_fused_stage_key) fused_keys;
 
 	/* sources specific hotkeys */
 	obs_hotkey_pair_id mute_unmute_key;
@@ -933,6 +1134,10 @@ obs_source_create_set_last_ver(const char *id, const char *name,
 			       bool is_private);
 extern void obs_source_destroy(struct obs_source *source);
 
+/* Maintains obs->data.transitions, call with the current name */
+extern void obs_transition_insert_name(struct obs_source *source);
+extern void obs_transition_remove_name(struct obs_source *source);
+
 enum view_type {
 	MAIN_VIEW,
 	AUX_VIEW,
@@ -1022,6 +1227,8 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source,
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern bool obs_source_video_opaque(const obs_source_t *source);
+extern void obs_source_cull_video(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
@@ -1052,6 +1259,9 @@ extern void deinterlace_process_last_frame(obs_source_t *source,
 extern void deinterlace_update_async_video(obs_source_t *source);
 extern void deinterlace_render(obs_source_t *s);
 
+extern bool filter_fusion_render(obs_source_t *filter);
+extern void filter_fusion_free(obs_source_t *filter);
+
 /* ------------------------------------------------------------------------- */
 /* outputs  */
 
@@ -1417,6 +1627,13 @@ extern void source_profiler_reset_video(struct obs_video_info *ovi);
 
 /* Signal that source received an async frame */
 extern void source_profiler_async_frame_received(obs_source_t *source);
+/* Submit the time an async frame was queued when it gets displayed */
+extern void source_profiler_async_frame_dequeued(obs_source_t *source,
+						 uint64_t queued_ts);
+/* Signal that outputting an async frame had to wait for async_mutex */
+extern void source_profiler_async_lock_contended(obs_source_t *source);
+/* Signal that a scene skipped drawing the source */
+extern void source_profiler_source_culled(obs_source_t *source, bool occluded);
 
 /* Get timestamp for start of tick */
 extern uint64_t source_profiler_source_tick_start(void);
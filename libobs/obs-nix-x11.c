@@ -24,6 +24,9 @@
 #include <xcb/xcb.h>
 #if defined(XCB_XINPUT_FOUND)
 #include <xcb/xinput.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
 #endif
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -95,9 +98,20 @@ struct obs_hotkeys_platform {
 	int syms_per_code;
 
 #if defined(XCB_XINPUT_FOUND)
+	bool mouse_events_selected;
 	bool pressed[XINPUT_MOUSE_LEN];
 	bool update[XINPUT_MOUSE_LEN];
 	bool button_pressed[XINPUT_MOUSE_LEN];
+
+	/* raw key events, see start_key_events */
+	xcb_connection_t *event_connection;
+	pthread_t event_thread;
+	bool event_thread_active;
+	int event_pipe[2];
+	obs_key_t code_keys[256];
+	bool code_down[256];
+	bool event_button_down[XINPUT_MOUSE_LEN + 1];
+	uint8_t key_down[OBS_KEY_LAST_VALUE];
 #endif
 };
 
@@ -830,9 +844,8 @@ static inline xcb_window_t root_window(obs_hotkeys_platform_t *context,
 }
 
 #if defined(XCB_XINPUT_FOUND)
-static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
+static inline void registerMouseEvents(obs_hotkeys_platform_t *context)
 {
-	obs_hotkeys_platform_t *context = hotkeys->platform_context;
 	xcb_connection_t *connection = XGetXCBConnection(context->display);
 	xcb_window_t window = root_window(context, connection);
 
@@ -847,6 +860,223 @@ static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
 
 	xcb_input_xi_select_events(connection, window, 1, &mask.head);
 	xcb_flush(connection);
+	context->mouse_events_selected = true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* key events
+ *
+ *   Raw key and button events are read on a connection of their own by a
+ * thread that pushes them to the hotkey thread, so the bound keys no longer
+ * have to be polled.  Several keycodes can map to the same key (e.g. both
+ * shift keys), a key is only released once all of them are. */
+
+static void fill_code_keys(obs_hotkeys_platform_t *context)
+{
+	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++) {
+		struct keycode_list *codes = &context->keycodes[i];
+
+		for (size_t j = 0; j < codes->list.num; j++)
+			context->code_keys[codes->list.array[j]] = (obs_key_t)i;
+	}
+
+	if (context->super_l_code)
+		context->code_keys[context->super_l_code] = OBS_KEY_META;
+	if (context->super_r_code)
+		context->code_keys[context->super_r_code] = OBS_KEY_META;
+}
+
+/* same buttons as mouse_button_pressed, the wheel (4 to 7) is ignored */
+static obs_key_t key_from_button(uint32_t button)
+{
+	switch (button) {
+	case 1:
+		return OBS_KEY_MOUSE1;
+	case 2:
+		return OBS_KEY_MOUSE3;
+	case 3:
+		return OBS_KEY_MOUSE2;
+	}
+
+	if (button >= 8 && button <= XINPUT_MOUSE_LEN)
+		return (obs_key_t)(OBS_KEY_MOUSE4 + (button - 8));
+	return OBS_KEY_NONE;
+}
+
+/* down is the state of the keycode or button, raw key presses repeat */
+static void push_key_event(obs_hotkeys_platform_t *context, bool *down,
+			   obs_key_t key, bool pressed)
+{
+	uint8_t *num_down = &context->key_down[key];
+
+	if (*down == pressed || key == OBS_KEY_NONE)
+		return;
+
+	*down = pressed;
+
+	if (pressed) {
+		if ((*num_down)++ == 0)
+			obs_hotkey_push_key_event(key, true);
+	} else if (*num_down && --(*num_down) == 0) {
+		obs_hotkey_push_key_event(key, false);
+	}
+}
+
+static void handle_raw_event(obs_hotkeys_platform_t *context,
+			     xcb_generic_event_t *ev)
+{
+	if ((ev->response_type & ~0x80) != XCB_GE_GENERIC)
+		return;
+
+	uint16_t type = ((xcb_ge_event_t *)ev)->event_type;
+
+	switch (type) {
+	case XCB_INPUT_RAW_KEY_PRESS:
+	case XCB_INPUT_RAW_KEY_RELEASE: {
+		xcb_input_raw_key_press_event_t *raw =
+			(xcb_input_raw_key_press_event_t *)ev;
+		uint32_t code = raw->detail;
+
+		if (code < 256)
+			push_key_event(context, &context->code_down[code],
+				       context->code_keys[code],
+				       type == XCB_INPUT_RAW_KEY_PRESS);
+		break;
+	}
+	case XCB_INPUT_RAW_BUTTON_PRESS:
+	case XCB_INPUT_RAW_BUTTON_RELEASE: {
+		xcb_input_raw_button_press_event_t *raw =
+			(xcb_input_raw_button_press_event_t *)ev;
+		uint32_t button = raw->detail;
+
+		if (button <= XINPUT_MOUSE_LEN)
+			push_key_event(context,
+				       &context->event_button_down[button],
+				       key_from_button(button),
+				       type == XCB_INPUT_RAW_BUTTON_PRESS);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void *key_event_thread(void *data)
+{
+	obs_hotkeys_platform_t *context = data;
+	xcb_connection_t *connection = context->event_connection;
+	struct pollfd fds[2] = {
+		{.fd = xcb_get_file_descriptor(connection), .events = POLLIN},
+		{.fd = context->event_pipe[0], .events = POLLIN},
+	};
+
+	os_set_thread_name("libobs: x11 key events");
+
+	for (;;) {
+		xcb_generic_event_t *ev;
+		while ((ev = xcb_poll_for_event(connection))) {
+			handle_raw_event(context, ev);
+			free(ev);
+		}
+
+		if (xcb_connection_has_error(connection))
+			break;
+
+		if (poll(fds, 2, -1) < 0 && errno != EINTR)
+			break;
+		if (fds[1].revents)
+			return NULL;
+	}
+
+	/* the hotkey mutex may not even exist yet, so this can't go through
+	 * obs_hotkey_enable_key_events */
+	blog(LOG_WARNING, "Lost the X11 connection for key events, "
+			  "polling hotkeys instead");
+	obs_hotkey_key_events_lost();
+	return NULL;
+}
+
+static bool start_key_events(obs_hotkeys_platform_t *context)
+{
+	const xcb_query_extension_reply_t *ext;
+	xcb_input_xi_query_version_reply_t *version;
+	xcb_connection_t *connection;
+	xcb_screen_iterator_t iter;
+	int screen = 0;
+
+	connection = xcb_connect(NULL, &screen);
+	if (xcb_connection_has_error(connection))
+		goto fail;
+
+	ext = xcb_get_extension_data(connection, &xcb_input_id);
+	if (!ext || !ext->present)
+		goto fail;
+
+	/* raw events keep coming during grabs from XInput 2.1 on */
+	version = xcb_input_xi_query_version_reply(
+		connection, xcb_input_xi_query_version(connection, 2, 2),
+		NULL);
+	if (!version || version->major_version < 2) {
+		free(version);
+		goto fail;
+	}
+	free(version);
+
+	iter = xcb_setup_roots_iterator(xcb_get_setup(connection));
+	for (; iter.rem && screen > 0; screen--)
+		xcb_screen_next(&iter);
+	if (!iter.rem)
+		goto fail;
+
+	struct {
+		xcb_input_event_mask_t head;
+		xcb_input_xi_event_mask_t mask;
+	} mask;
+	mask.head.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+	mask.head.mask_len = sizeof(mask.mask) / sizeof(uint32_t);
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE;
+
+	xcb_input_xi_select_events(connection, iter.data->root, 1, &mask.head);
+	xcb_flush(connection);
+
+	if (pipe(context->event_pipe) != 0)
+		goto fail;
+
+	context->event_connection = connection;
+	if (pthread_create(&context->event_thread, NULL, key_event_thread,
+			   context) != 0) {
+		close(context->event_pipe[0]);
+		close(context->event_pipe[1]);
+		context->event_connection = NULL;
+		goto fail;
+	}
+
+	context->event_thread_active = true;
+	return true;
+
+fail:
+	xcb_disconnect(connection);
+	return false;
+}
+
+static void stop_key_events(obs_hotkeys_platform_t *context)
+{
+	if (!context->event_thread_active)
+		return;
+
+	if (write(context->event_pipe[1], "", 1) != 1)
+		blog(LOG_WARNING, "Failed to stop the X11 key event thread");
+	else
+		pthread_join(context->event_thread, NULL);
+
+	close(context->event_pipe[0]);
+	close(context->event_pipe[1]);
+	xcb_disconnect(context->event_connection);
+	context->event_connection = NULL;
+	context->event_thread_active = false;
 }
 #endif
 
@@ -860,11 +1090,18 @@ static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 	hotkeys->platform_context = bzalloc(sizeof(obs_hotkeys_platform_t));
 	hotkeys->platform_context->display = display;
 
-#if defined(XCB_XINPUT_FOUND)
-	registerMouseEvents(hotkeys);
-#endif
 	fill_base_keysyms(hotkeys);
 	fill_keycodes(hotkeys);
+
+#if defined(XCB_XINPUT_FOUND)
+	fill_code_keys(hotkeys->platform_context);
+
+	/* the hotkey thread isn't running yet */
+	if (start_key_events(hotkeys->platform_context)) {
+		os_atomic_set_bool(&hotkeys->key_events, true);
+		blog(LOG_INFO, "Using XInput raw key events for hotkeys");
+	}
+#endif
 	return true;
 }
 
@@ -874,6 +1111,10 @@ static void obs_nix_x11_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	if (!context)
 		return;
 
+#if defined(XCB_XINPUT_FOUND)
+	stop_key_events(context);
+#endif
+
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		da_free(context->keycodes[i].list);
 
@@ -890,6 +1131,10 @@ static bool mouse_button_pressed(xcb_connection_t *connection,
 	bool ret = false;
 
 #if defined(XCB_XINPUT_FOUND)
+	/* only needed while polling, the events would pile up otherwise */
+	if (!context->mouse_events_selected)
+		registerMouseEvents(context);
+
 	memset(context->pressed, 0, XINPUT_MOUSE_LEN);
 	memset(context->update, 0, XINPUT_MOUSE_LEN);
 
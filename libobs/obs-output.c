@@ -1733,6 +1733,8 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	return avc || hevc || av1;
 }
 
+static const char *output_encoded_packet_name = "output_encoded_packet";
+
 static inline void send_interleaved(struct obs_output *output)
 {
 	struct encoder_packet out = output->interleaved_packets.array[0];
@@ -1781,7 +1783,9 @@ static inline void send_interleaved(struct obs_output *output)
 		pthread_mutex_unlock(&ctrack->caption_mutex);
 	}
 
+	profile_start(output_encoded_packet_name);
 	output->info.encoded_packet(output->context.data, &out);
+	profile_end(output_encoded_packet_name);
 	obs_encoder_packet_release(&out);
 }
 
@@ -2242,6 +2246,8 @@ check_encoder_group_keyframe_alignment(obs_output_t *output,
 	da_insert(output->keyframe_group_tracking, idx, &insert_data);
 }
 
+static const char *interleave_packets_name = "interleave_packets";
+
 static void interleave_packets(void *data, struct encoder_packet *packet)
 {
 	struct obs_output *output = data;
@@ -2254,6 +2260,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 
 	packet->track_idx = get_encoder_index(output, packet);
 
+	profile_start(interleave_packets_name);
 	pthread_mutex_lock(&output->interleaved_mutex);
 
 	/* if first video frame is not a keyframe, discard until received */
@@ -2261,6 +2268,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	    !output->received_video[packet->track_idx] && !packet->keyframe) {
 		discard_unused_audio_packets(output, packet->dts_usec);
 		pthread_mutex_unlock(&output->interleaved_mutex);
+		profile_end(interleave_packets_name);
 
 		if (output->active_delay_ns)
 			obs_encoder_packet_release(packet);
@@ -2315,6 +2323,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	}
 
 	pthread_mutex_unlock(&output->interleaved_mutex);
+	profile_end(interleave_packets_name);
 }
 
 static void default_encoded_callback(void *param, struct encoder_packet *packet)
@@ -2324,7 +2333,9 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 	if (data_active(output)) {
 		packet->track_idx = get_encoder_index(output, packet);
 
+		profile_start(output_encoded_packet_name);
 		output->info.encoded_packet(output->context.data, packet);
+		profile_end(output_encoded_packet_name);
 
 		if (packet->type == OBS_ENCODER_VIDEO)
 			output->total_frames++;
@@ -0,0 +1,105 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+
+#include "graphics/vec3.h"
+#include "obs-scene-cull.h"
+
+static inline uint32_t cropped_size(uint32_t size, uint32_t crop)
+{
+	return (crop > size) ? 2 : (size - crop);
+}
+
+void scene_cull_item_bounds(const struct matrix4 *draw_transform,
+			    uint32_t width, uint32_t height,
+			    const struct obs_sceneitem_crop *crop,
+			    const struct obs_sceneitem_crop *bounds_crop,
+			    struct vec2 *draw_min, struct vec2 *draw_max)
+{
+	const float cx = (float)cropped_size(
+		width, crop->left + crop->right + bounds_crop->left +
+			       bounds_crop->right);
+	const float cy = (float)cropped_size(
+		height, crop->top + crop->bottom + bounds_crop->top +
+				bounds_crop->bottom);
+	const float corners[4][2] = {
+		{0.0f, 0.0f},
+		{cx, 0.0f},
+		{0.0f, cy},
+		{cx, cy},
+	};
+
+	vec2_set(draw_min, M_INFINITE, M_INFINITE);
+	vec2_set(draw_max, -M_INFINITE, -M_INFINITE);
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 v;
+		vec3_set(&v, corners[i][0], corners[i][1], 0.0f);
+		vec3_transform(&v, &v, draw_transform);
+
+		draw_min->x = fminf(draw_min->x, v.x);
+		draw_min->y = fminf(draw_min->y, v.y);
+		draw_max->x = fmaxf(draw_max->x, v.x);
+		draw_max->y = fmaxf(draw_max->y, v.y);
+	}
+}
+
+void scene_culler_init(struct scene_culler *culler, uint32_t cx, uint32_t cy)
+{
+	culler->cx = (float)cx;
+	culler->cy = (float)cy;
+	culler->num_occluders = 0;
+}
+
+static inline bool rect_contains(const struct scene_cull_rect *outer,
+				 const struct scene_cull_rect *inner)
+{
+	return inner->x0 >= outer->x0 && inner->y0 >= outer->y0 &&
+	       inner->x1 <= outer->x1 && inner->y1 <= outer->y1;
+}
+
+enum item_cull scene_culler_add(struct scene_culler *culler,
+				const struct vec2 *draw_min,
+				const struct vec2 *draw_max, bool opaque)
+{
+	const struct scene_cull_rect touched = {
+		fmaxf(floorf(draw_min->x), 0.0f),
+		fmaxf(floorf(draw_min->y), 0.0f),
+		fminf(ceilf(draw_max->x), culler->cx),
+		fminf(ceilf(draw_max->y), culler->cy),
+	};
+
+	if (touched.x0 >= touched.x1 || touched.y0 >= touched.y1)
+		return ITEM_CULL_OFFSCREEN;
+
+	for (size_t i = 0; i < culler->num_occluders; i++) {
+		if (rect_contains(&culler->occluders[i], &touched))
+			return ITEM_CULL_OCCLUDED;
+	}
+
+	if (!opaque || culler->num_occluders == SCENE_CULL_MAX_OCCLUDERS)
+		return ITEM_CULL_NONE;
+
+	/* only pixels the item covers completely, the small margin absorbs
+	 * the rounding of rotations by multiples of 90 */
+	struct scene_cull_rect *covered =
+		&culler->occluders[culler->num_occluders++];
+	covered->x0 = ceilf(draw_min->x - 0.001f);
+	covered->y0 = ceilf(draw_min->y - 0.001f);
+	covered->x1 = floorf(draw_max->x + 0.001f);
+	covered->y1 = floorf(draw_max->y + 0.001f);
+	return ITEM_CULL_NONE;
+}
@@ -0,0 +1,59 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "obs.h"
+#include "graphics/vec2.h"
+#include "graphics/matrix4.h"
+
+#define SCENE_CULL_MAX_OCCLUDERS 8
+
+enum item_cull {
+	ITEM_CULL_NONE,
+	ITEM_CULL_OFFSCREEN,
+	ITEM_CULL_OCCLUDED,
+};
+
+struct scene_cull_rect {
+	float x0, y0;
+	float x1, y1;
+};
+
+/* collects the opaque items of a scene, items have to be added front to
+ * back */
+struct scene_culler {
+	float cx, cy;
+	struct scene_cull_rect occluders[SCENE_CULL_MAX_OCCLUDERS];
+	size_t num_occluders;
+};
+
+/* bounds in the scene of an item of the given source size, the size is
+ * cropped by both the user crop and the crop to bounds before the draw
+ * transform is applied */
+void scene_cull_item_bounds(const struct matrix4 *draw_transform,
+			    uint32_t width, uint32_t height,
+			    const struct obs_sceneitem_crop *crop,
+			    const struct obs_sceneitem_crop *bounds_crop,
+			    struct vec2 *draw_min, struct vec2 *draw_max);
+
+void scene_culler_init(struct scene_culler *culler, uint32_t cx, uint32_t cy);
+
+/* returns whether the item is outside the scene or hidden behind an opaque
+ * item added before it.  An opaque item that is not culled is remembered as
+ * an occluder for the items behind it. */
+enum item_cull scene_culler_add(struct scene_culler *culler,
+				const struct vec2 *draw_min,
+				const struct vec2 *draw_max, bool opaque);
@@ -32,6 +32,8 @@ static void get_ungrouped_transform(obs_sceneitem_t *group, struct vec2 *pos,
 				    struct vec2 *scale, float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
 static inline bool item_texture_enabled(const struct obs_scene_item *item);
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
 static void init_hotkeys(obs_scene_t *scene, obs_sceneitem_t *item,
 			 const char *name);
 
@@ -237,6 +239,8 @@ static void scene_destroy(void *data)
 
 	remove_all_items(scene);
 
+	obs_name_index_clear(&scene->items_by_name);
+	da_free(scene->group_items);
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
 	da_free(scene->mix_sources);
@@ -307,8 +311,15 @@ static void scene_enum_all_sources(void *data,
 	scene_enum_sources(data, enum_callback, param, false);
 }
 
+static inline void invalidate_items_by_name(struct obs_scene *scene)
+{
+	os_atomic_set_bool(&scene->items_by_name_dirty, true);
+}
+
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
+	invalidate_items_by_name(item->parent);
+
 	if (item->prev)
 		item->prev->next = item->next;
 	else
@@ -327,6 +338,8 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 	item->prev = prev;
 	item->parent = parent;
 
+	invalidate_items_by_name(parent);
+
 	if (prev) {
 		item->next = prev->next;
 		if (prev->next)
@@ -545,6 +558,13 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	item->output_scale = scale;
 
+	/* bounds_crop is only known after calculate_bounds_data */
+	scene_cull_item_bounds(&item->draw_transform, item->last_width,
+			       item->last_height, &item->crop,
+			       &item->bounds_crop, &item->draw_min,
+			       &item->draw_max);
+	item->draw_axis_aligned = fmodf(item->rot, 90.0f) == 0.0f;
+
 	/* ----------------------- */
 
 	if (item->bounds_type != OBS_BOUNDS_NONE) {
@@ -810,7 +830,8 @@ static inline void render_item(struct obs_scene_item *item)
 	}
 
 	if (!item->item_render && use_texrender) {
-		item->item_render = gs_texrender_create(format, GS_ZS_NONE);
+		item->item_render =
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (item->item_render) {
@@ -969,6 +990,45 @@ update_transforms_and_prune_sources(obs_scene_t *scene,
 		resize_group(group_sceneitem);
 }
 
+static inline bool item_cullable(const struct obs_scene_item *item)
+{
+	/* a transition has to be drawn to notice that it ended */
+	return item->user_visible && !item->is_group &&
+	       !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition) && item->last_width &&
+	       item->last_height;
+}
+
+static inline bool item_opaque(const struct obs_scene_item *item)
+{
+	return item->draw_axis_aligned && default_blending_enabled(item) &&
+	       obs_source_video_opaque(item->source);
+}
+
+/* assumes video lock.  Goes through the items front to back, an item is
+ * culled if none of the pixels it would touch are inside the scene, or if
+ * all of them are covered by a single opaque item above it. */
+static void cull_items(struct obs_scene *scene)
+{
+	struct scene_culler culler;
+	struct obs_scene_item *item = scene->first_item;
+
+	scene_culler_init(&culler, scene_getwidth(scene),
+			  scene_getheight(scene));
+
+	while (item && item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		item->cull = ITEM_CULL_NONE;
+
+		if (item_cullable(item))
+			item->cull = scene_culler_add(&culler, &item->draw_min,
+						      &item->draw_max,
+						      item_opaque(item));
+	}
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	obs_scene_item_ptr_array_t remove_items;
@@ -983,14 +1043,30 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items, NULL);
 	}
 
+	const bool cull =
+		!scene->is_group &&
+		!os_atomic_load_bool(&obs->video.scene_culling_disabled);
+	if (cull)
+		cull_items(scene);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible ||
-		    transition_active(item->hide_transition))
+		if (!item->user_visible &&
+		    !transition_active(item->hide_transition)) {
+			item = item->next;
+			continue;
+		}
+
+		if (cull && item->cull != ITEM_CULL_NONE) {
+			obs_source_cull_video(item->source);
+			source_profiler_source_culled(
+				item->source, item->cull == ITEM_CULL_OCCLUDED);
+		} else {
 			render_item(item);
+		}
 
 		item = item->next;
 	}
@@ -2016,23 +2092,53 @@ obs_scene_t *obs_group_from_source(const obs_source_t *source)
 	return source->context.data;
 }
 
-obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name)
+/* must be called with the scene locked */
+static void rebuild_items_by_name(obs_scene_t *scene)
 {
-	struct obs_scene_item *item;
+	struct obs_scene_item *item = scene->first_item;
+	size_t order = 0;
 
-	if (!scene)
-		return NULL;
+	/* cleared first so that changes made during the rebuild are not
+	 * lost */
+	os_atomic_set_bool(&scene->items_by_name_dirty, false);
 
-	full_lock(scene);
+	obs_name_index_clear(&scene->items_by_name);
+	da_resize(scene->group_items, 0);
 
-	item = scene->first_item;
 	while (item) {
-		if (strcmp(item->source->context.name, name) == 0)
-			break;
+		const char *name = item->source->context.name;
+
+		item->order = order++;
+
+		if (name)
+			obs_name_index_add(&scene->items_by_name, name, item);
+
+		if (item->is_group)
+			da_push_back(scene->group_items, &item);
 
 		item = item->next;
 	}
+}
+
+/* must be called with the scene locked */
+static struct obs_scene_item *find_item_by_name(obs_scene_t *scene,
+						const char *name)
+{
+	if (os_atomic_load_bool(&scene->items_by_name_dirty))
+		rebuild_items_by_name(scene);
+
+	return obs_name_index_find(scene->items_by_name, name);
+}
+
+obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name)
+{
+	struct obs_scene_item *item;
+
+	if (!scene || !name)
+		return NULL;
 
+	full_lock(scene);
+	item = find_item_by_name(scene, name);
 	full_unlock(scene);
 
 	return item;
@@ -2043,27 +2149,26 @@ obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
 {
 	struct obs_scene_item *item;
 
-	if (!scene)
+	if (!scene || !name)
 		return NULL;
 
 	full_lock(scene);
 
-	item = scene->first_item;
-	while (item) {
-		if (strcmp(item->source->context.name, name) == 0)
+	item = find_item_by_name(scene, name);
+
+	/* groups above the first match in the list are searched first */
+	for (size_t i = 0; i < scene->group_items.num; i++) {
+		struct obs_scene_item *group_item = scene->group_items.array[i];
+
+		if (item && group_item->order >= item->order)
 			break;
 
-		if (item->is_group) {
-			obs_scene_t *group = item->source->context.data;
-			obs_sceneitem_t *child =
-				obs_scene_find_source(group, name);
-			if (child) {
-				item = child;
-				break;
-			}
+		obs_scene_t *group = group_item->source->context.data;
+		obs_sceneitem_t *child = obs_scene_find_source(group, name);
+		if (child) {
+			item = child;
+			break;
 		}
-
-		item = item->next;
 	}
 
 	full_unlock(scene);
@@ -2266,6 +2371,10 @@ static void sceneitem_renamed(void *param, calldata_t *data)
 {
 	obs_sceneitem_t *scene_item = param;
 	const char *name = calldata_string(data, "new_name");
+	obs_scene_t *parent = scene_item->parent;
+
+	if (parent)
+		invalidate_items_by_name(parent);
 
 	sceneitem_rename_hotkey(scene_item, name);
 }
@@ -2340,6 +2449,8 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene,
 
 	full_lock(scene);
 
+	invalidate_items_by_name(scene);
+
 	if (insert_after) {
 		obs_sceneitem_t *next = insert_after->next;
 		if (next)
@@ -3169,6 +3280,7 @@ bool obs_scene_reorder_items(obs_scene_t *scene,
 	}
 
 	scene->first_item = item_order[0];
+	invalidate_items_by_name(scene);
 
 	obs_sceneitem_t *prev = NULL;
 	for (size_t i = 0; i < item_order_size; i++) {
@@ -3568,6 +3680,7 @@ obs_sceneitem_t *obs_scene_insert_group(obs_scene_t *scene, const char *name,
 	full_lock(scene);
 	full_lock(sub_scene);
 	sub_scene->first_item = items[0];
+	invalidate_items_by_name(sub_scene);
 
 	for (size_t i = count; i > 0; i--) {
 		size_t idx = i - 1;
@@ -3900,7 +4013,15 @@ bool obs_scene_reorder_items2(obs_scene_t *scene,
 		}
 	}
 
+	/* items can move between the scene and its groups */
+	for (size_t i = 0; i < item_order_size; i++) {
+		obs_scene_t *parent = item_order[i].item->parent;
+		if (parent)
+			invalidate_items_by_name(parent);
+	}
+
 	scene->first_item = item_order[0].item;
+	invalidate_items_by_name(scene);
 
 	obs_sceneitem_t *prev = NULL;
 	for (size_t i = 0; i < item_order_size; i++) {
@@ -3913,6 +4034,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene,
 				info->item->source->context.data;
 
 			sub_scene->first_item = NULL;
+			invalidate_items_by_name(sub_scene);
 
 			obs_scene_addref(sub_scene);
 			full_lock(sub_scene);
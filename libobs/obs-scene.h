@@ -18,7 +18,9 @@
 #pragma once
 
 #include "obs.h"
+#include "obs-scene-cull.h"
 #include "graphics/matrix4.h"
+#include "util/uthash.h"
 
 /* how obs scene! */
 
@@ -70,6 +72,13 @@ struct obs_scene_item {
 	struct vec2 box_scale;
 	struct matrix4 draw_transform;
 
+	/* bounds of the drawn area in the scene, updated with the
+	 * transform */
+	struct vec2 draw_min;
+	struct vec2 draw_max;
+	bool draw_axis_aligned;
+	enum item_cull cull;
+
 	enum obs_bounds_type bounds_type;
 	uint32_t bounds_align;
 	struct vec2 bounds;
@@ -91,6 +100,10 @@ struct obs_scene_item {
 	/* would do **prev_next, but not really great for reordering */
 	struct obs_scene_item *prev;
 	struct obs_scene_item *next;
+
+	/* position in the parent, only valid while the parent's index is not
+	 * dirty */
+	size_t order;
 };
 
 struct scene_source_mix {
@@ -116,5 +129,11 @@ struct obs_scene {
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
 
+	/* first item of each source name and the group items in order,
+	 * rebuilt on lookup after the items or their names change */
+	struct obs_name_index_entry *items_by_name;
+	DARRAY(struct obs_scene_item *) group_items;
+	volatile bool items_by_name_dirty;
+
 	DARRAY(struct scene_source_mix) mix_sources;
 };
@@ -19,7 +19,8 @@
 
 static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 {
-	struct obs_source_frame *next_frame = source->async_frames.array[0];
+	struct async_frame_queue *frames = &source->async_frames;
+	struct obs_source_frame *next_frame = async_queue_peek(frames, 0);
 	struct obs_source_frame *prev_frame = NULL;
 	struct obs_source_frame *frame = NULL;
 	uint64_t sys_offset = sys_time - source->last_sys_timestamp;
@@ -28,20 +29,20 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 	size_t idx = 1;
 
 	if (source->async_unbuffered) {
-		while (source->async_frames.num > 2) {
-			da_erase(source->async_frames, 0);
+		while (async_queue_size(frames) > 2) {
+			async_queue_pop(frames);
 			remove_async_frame(source, next_frame);
-			next_frame = source->async_frames.array[0];
+			next_frame = async_queue_peek(frames, 0);
 		}
 
-		if (source->async_frames.num == 2) {
+		if (async_queue_size(frames) == 2) {
 			bool prev_frame = true;
 			if (source->async_unbuffered &&
 			    source->deinterlace_offset) {
 				const uint64_t timestamp =
-					source->async_frames.array[0]->timestamp;
+					async_queue_peek(frames, 0)->timestamp;
 				const uint64_t after_timestamp =
-					source->async_frames.array[1]->timestamp;
+					async_queue_peek(frames, 1)->timestamp;
 				const uint64_t duration =
 					after_timestamp - timestamp;
 				const uint64_t frame_end =
@@ -54,7 +55,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 						timestamp - duration;
 				}
 			}
-			source->async_frames.array[0]->prev_frame = prev_frame;
+			async_queue_peek(frames, 0)->prev_frame = prev_frame;
 		}
 		source->deinterlace_offset = 0;
 		source->last_frame_ts = next_frame->timestamp;
@@ -81,17 +82,17 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 			break;
 
 		if (prev_frame) {
-			da_erase(source->async_frames, 0);
+			async_queue_pop(frames);
 			remove_async_frame(source, prev_frame);
 		}
 
-		if (source->async_frames.num <= 2) {
+		if (async_queue_size(frames) <= 2) {
 			bool exit = true;
 
 			if (prev_frame) {
 				prev_frame->prev_frame = true;
 
-			} else if (!frame && source->async_frames.num == 2) {
+			} else if (!frame && async_queue_size(frames) == 2) {
 				exit = false;
 			}
 
@@ -108,7 +109,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 
 		prev_frame = frame;
 		frame = next_frame;
-		next_frame = source->async_frames.array[idx];
+		next_frame = async_queue_peek(frames, idx);
 
 		/* more timestamp checking and compensating */
 		if ((next_frame->timestamp - frame_time) > MAX_TS_VAR) {
@@ -132,8 +133,8 @@ static inline bool first_frame(obs_source_t *s)
 	if (s->last_frame_ts)
 		return false;
 
-	if (s->async_frames.num >= 2)
-		s->async_frames.array[0]->prev_frame = true;
+	if (async_queue_size(&s->async_frames) >= 2)
+		async_queue_peek(&s->async_frames, 0)->prev_frame = true;
 	return true;
 }
 
@@ -145,6 +146,16 @@ static inline uint64_t uint64_diff(uint64_t ts1, uint64_t ts2)
 #define TWOX_TOLERANCE 1000000
 #define TS_JUMP_THRESHOLD 70000000ULL
 
+static inline struct obs_source_frame *pop_frame(obs_source_t *s)
+{
+	struct async_frame_queue *frames = &s->async_frames;
+	struct obs_source_frame *frame = async_queue_peek(frames, 0);
+
+	source_profiler_async_frame_dequeued(s, async_queue_peek_ts(frames, 0));
+	async_queue_pop(frames);
+	return frame;
+}
+
 static inline void deinterlace_get_closest_frames(obs_source_t *s,
 						  uint64_t sys_time)
 {
@@ -165,7 +176,7 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 		}
 	}
 
-	if (!s->async_frames.num)
+	if (!async_queue_size(&s->async_frames))
 		return;
 
 	half_interval = obs->video.video_half_frame_interval_ns;
@@ -174,16 +185,12 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 		uint64_t offset;
 
 		s->prev_async_frame = NULL;
-		s->cur_async_frame = s->async_frames.array[0];
-
-		da_erase(s->async_frames, 0);
+		s->cur_async_frame = pop_frame(s);
 
-		if ((s->async_frames.num > 0) &&
+		if ((async_queue_size(&s->async_frames) > 0) &&
 		    s->cur_async_frame->prev_frame) {
 			s->prev_async_frame = s->cur_async_frame;
-			s->cur_async_frame = s->async_frames.array[0];
-
-			da_erase(s->async_frames, 0);
+			s->cur_async_frame = pop_frame(s);
 
 			s->deinterlace_half_duration =
 				(uint32_t)((s->cur_async_frame->timestamp -
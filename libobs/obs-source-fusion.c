@@ -0,0 +1,315 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/*
+ * Filter fusion: a run of consecutive filters that all provide a per-pixel
+ * shader stage is drawn by the outermost filter of the run with a single
+ * generated effect.  Only the target of the innermost filter of the run is
+ * rendered to a texture (or drawn directly when the filter can bypass), the
+ * render targets of the other filters are never touched.
+ *
+ * Every filter draws into a cleared render target, so the texture the next
+ * filter samples holds the color the stage returned if the stage is drawn
+ * premultiplied, or the color multiplied by its alpha with the default
+ * blending.  The generated shader applies the same step between the stages,
+ * which makes the result match the separate passes up to the rounding of
+ * the intermediate render targets.
+ */
+
+#define MAX_FUSED_STAGES 16
+
+struct fused_stage {
+	obs_source_t *filter;
+	struct obs_filter_stage stage;
+};
+
+static const char *fused_effect_head = "\
+uniform float4x4 ViewProj;\n\
+uniform texture2d image;\n\
+\n\
+sampler_state def_sampler {\n\
+	Filter   = Linear;\n\
+	AddressU = Clamp;\n\
+	AddressV = Clamp;\n\
+};\n\
+\n\
+struct VertData {\n\
+	float4 pos : POSITION;\n\
+	float2 uv  : TEXCOORD0;\n\
+};\n\
+\n\
+VertData VSDefault(VertData v_in)\n\
+{\n\
+	VertData vert_out;\n\
+	vert_out.pos = mul(float4(v_in.pos.xyz, 1.0), ViewProj);\n\
+	vert_out.uv  = v_in.uv;\n\
+	return vert_out;\n\
+}\n";
+
+static const char *fused_effect_tail = "\
+	return rgba;\n\
+}\n\
+\n\
+technique Draw\n\
+{\n\
+	pass\n\
+	{\n\
+		vertex_shader = VSDefault(v_in);\n\
+		pixel_shader  = PSFused(v_in);\n\
+	}\n\
+}\n";
+
+static inline void get_stage_prefix(char *prefix, size_t size, size_t idx)
+{
+	snprintf(prefix, size, "s%u_", (unsigned int)idx);
+}
+
+static void cat_stage_shader(struct dstr *effect, const char *shader,
+			     const char *prefix)
+{
+	const char *start = shader;
+	const char *pos;
+
+	while ((pos = strchr(start, '$')) != NULL) {
+		dstr_ncat(effect, start, pos - start);
+		dstr_cat(effect, prefix);
+		start = pos + 1;
+	}
+
+	dstr_cat(effect, start);
+	dstr_cat_ch(effect, '\n');
+}
+
+/* stages are in drawing order, innermost filter first */
+static void build_fused_effect(struct dstr *effect,
+			       const struct fused_stage *stages, size_t count)
+{
+	char prefix[16];
+
+	dstr_copy(effect, fused_effect_head);
+
+	for (size_t i = 0; i < count; i++) {
+		get_stage_prefix(prefix, sizeof(prefix), i);
+		dstr_cat_ch(effect, '\n');
+		cat_stage_shader(effect, stages[i].stage.shader, prefix);
+	}
+
+	dstr_cat(effect, "\nfloat4 PSFused(VertData v_in) : TARGET\n{\n"
+			 "\tfloat4 rgba = image.Sample(def_sampler, v_in.uv);\n");
+
+	for (size_t i = 0; i < count; i++) {
+		get_stage_prefix(prefix, sizeof(prefix), i);
+		dstr_catf(effect, "\trgba = %sapply(rgba);\n", prefix);
+
+		/* what the next filter would have read back from the
+		 * render target of this one */
+		if (i + 1 < count && !stages[i].stage.premultiplied)
+			dstr_cat(effect, "\trgba.rgb *= rgba.a;\n");
+	}
+
+	dstr_cat(effect, fused_effect_tail);
+}
+
+static inline bool can_fuse(const obs_source_t *filter, uint32_t srgb_flag)
+{
+	return filter->info.type == OBS_SOURCE_TYPE_FILTER &&
+	       filter->context.data && filter->info.filter_get_stage &&
+	       filter->info.filter_set_stage_params &&
+	       (filter->info.output_flags & OBS_SOURCE_SRGB) == srgb_flag;
+}
+
+/* collects the run of filters starting at filter, innermost filter first */
+static size_t get_fused_stages(obs_source_t *filter, struct fused_stage *stages)
+{
+	const uint32_t srgb_flag = filter->info.output_flags & OBS_SOURCE_SRGB;
+	struct fused_stage reversed[MAX_FUSED_STAGES];
+	size_t count = 0;
+
+	while (filter && count < MAX_FUSED_STAGES &&
+	       can_fuse(filter, srgb_flag)) {
+		/* a disabled filter passes its target through unchanged */
+		if (filter->enabled) {
+			struct fused_stage *fs = &reversed[count];
+
+			fs->filter = filter;
+			memset(&fs->stage, 0, sizeof(fs->stage));
+			if (!filter->info.filter_get_stage(filter->context.data,
+							   &fs->stage) ||
+			    !fs->stage.shader)
+				break;
+
+			count++;
+		}
+
+		filter = filter->filter_target;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		stages[i] = reversed[count - i - 1];
+
+	return count;
+}
+
+static inline void get_stage_key(struct obs_fused_stage_key *key,
+				 const struct fused_stage *stage)
+{
+	key->filter = stage->filter;
+	key->settings_version =
+		os_atomic_load_long(&stage->filter->settings_version);
+	key->shader = stage->stage.shader;
+	key->premultiplied = stage->stage.premultiplied;
+}
+
+/* the shader of a stage only changes with the settings of its filter */
+static bool fused_keys_match(const obs_source_t *filter,
+			     const struct fused_stage *stages, size_t count)
+{
+	if (filter->fused_keys.num != count)
+		return false;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct obs_fused_stage_key *cached =
+			&filter->fused_keys.array[i];
+		struct obs_fused_stage_key key;
+
+		get_stage_key(&key, &stages[i]);
+		if (key.filter != cached->filter ||
+		    key.settings_version != cached->settings_version ||
+		    key.shader != cached->shader ||
+		    key.premultiplied != cached->premultiplied)
+			return false;
+	}
+
+	return true;
+}
+
+static gs_effect_t *get_fused_effect(obs_source_t *filter,
+				     const struct fused_stage *stages,
+				     size_t count)
+{
+	/* a failed effect is cached too, so that it is not compiled again
+	 * every frame */
+	if (fused_keys_match(filter, stages, count))
+		return filter->fused_effect;
+
+	struct dstr shader = {0};
+	char *errors = NULL;
+
+	build_fused_effect(&shader, stages, count);
+
+	gs_effect_destroy(filter->fused_effect);
+	filter->fused_effect =
+		gs_effect_create(shader.array, "fused filters", &errors);
+	if (!filter->fused_effect)
+		blog(LOG_WARNING,
+		     "Failed to create fused effect for filter '%s', "
+		     "drawing the filters separately: %s",
+		     filter->context.name, errors ? errors : "(null)");
+
+	da_resize(filter->fused_keys, count);
+	for (size_t i = 0; i < count; i++)
+		get_stage_key(&filter->fused_keys.array[i], &stages[i]);
+
+	bfree(errors);
+	dstr_free(&shader);
+	return filter->fused_effect;
+}
+
+bool filter_fusion_render(obs_source_t *filter)
+{
+	struct fused_stage stages[MAX_FUSED_STAGES];
+
+	if (!filter->info.filter_get_stage ||
+	    os_atomic_load_bool(&obs->video.filter_fusion_disabled))
+		return false;
+
+	/* a single stage is drawn by the filter itself */
+	size_t count = get_fused_stages(filter, stages);
+	if (count < 2)
+		return false;
+
+	obs_source_t *first = stages[0].filter;
+	obs_source_t *target = obs_filter_get_target(first);
+	if (!target)
+		return false;
+
+	const enum gs_color_space preferred_spaces[] = {
+		GS_CS_SRGB,
+		GS_CS_SRGB_16F,
+		GS_CS_709_EXTENDED,
+	};
+
+	const enum gs_color_space space = obs_source_get_color_space(
+		target, OBS_COUNTOF(preferred_spaces), preferred_spaces);
+	if (space == GS_CS_709_EXTENDED)
+		return false;
+
+	gs_effect_t *effect = get_fused_effect(filter, stages, count);
+	if (!effect)
+		return false;
+
+	if (!obs_source_process_filter_begin_with_color_space(
+		    first, gs_get_format_from_space(space), space,
+		    OBS_ALLOW_DIRECT_RENDERING))
+		return true;
+
+	char prefix[16];
+
+	for (size_t i = 0; i < count; i++) {
+		obs_source_t *stage_filter = stages[i].filter;
+
+		get_stage_prefix(prefix, sizeof(prefix), i);
+		stage_filter->info.filter_set_stage_params(
+			stage_filter->context.data, effect, prefix);
+	}
+
+	const bool premultiplied = stages[count - 1].stage.premultiplied;
+
+	if (premultiplied) {
+		gs_blend_state_push();
+		gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+	}
+
+	obs_source_process_filter_tech_end(first, effect, 0, 0, "Draw");
+
+	if (premultiplied)
+		gs_blend_state_pop();
+
+	return true;
+}
+
+void filter_fusion_free(obs_source_t *filter)
+{
+	gs_effect_destroy(filter->fused_effect);
+	filter->fused_effect = NULL;
+	da_free(filter->fused_keys);
+}
+
+gs_eparam_t *obs_filter_stage_get_param(gs_effect_t *effect,
+					const char *prefix, const char *name)
+{
+	struct dstr param_name = {0};
+	gs_eparam_t *param;
+
+	if (!effect || !prefix || !name)
+		return NULL;
+
+	dstr_printf(&param_name, "%s%s", prefix, name);
+	param = gs_effect_get_param_by_name(effect, param_name.array);
+	dstr_free(&param_name);
+	return param;
+}
@@ -53,9 +53,9 @@ bool obs_transition_init(obs_source_t *transition)
 
 	transition->transition_alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
 	transition->transition_texrender[0] =
-		gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
 	transition->transition_texrender[1] =
-		gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
 	transition->transition_source_active[0] = true;
 
 	return transition->transition_texrender[0] != NULL &&
@@ -645,7 +645,7 @@ static inline void render_child(obs_source_t *transition, obs_source_t *child,
 	    format) {
 		gs_texrender_destroy(transition->transition_texrender[idx]);
 		transition->transition_texrender[idx] =
-			gs_texrender_create(format, GS_ZS_NONE);
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(
@@ -30,6 +30,7 @@
 
 #include "obs.h"
 #include "obs-internal.h"
+#include "obs-audio-latency.h"
 
 #define get_weak(source) ((obs_weak_source_t *)source->context.control)
 
@@ -139,7 +140,7 @@ static void allocate_audio_output_buffer(struct obs_source *source)
 {
 	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
 		      MAX_AUDIO_MIXES;
-	float *ptr = bzalloc(size);
+	float *ptr = bzalloc_tagged(BMEM_TAG_AUDIO, size);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
@@ -154,7 +155,7 @@ static void allocate_audio_output_buffer(struct obs_source *source)
 static void allocate_audio_mix_buffer(struct obs_source *source)
 {
 	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
-	float *ptr = bzalloc(size);
+	float *ptr = bzalloc_tagged(BMEM_TAG_AUDIO, size);
 
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		source->audio_mix_buf[i] = ptr + AUDIO_OUTPUT_FRAMES * i;
@@ -183,6 +184,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_output_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -201,13 +203,21 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init_recursive(&source->async_mutex) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_output_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
 		return false;
 
-	if (is_audio_source(source) || is_composite_source(source))
+	if (is_audio_source(source) || is_composite_source(source)) {
 		allocate_audio_output_buffer(source);
+
+		/* lets audio rendering read the buffers without splitting
+		 * reads at the end of the ring */
+		for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+			deque_init_mirrored(&source->audio_input_buf[i]);
+	}
 	if (source->info.audio_mix)
 		allocate_audio_mix_buffer(source);
 
@@ -246,6 +256,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 					     &obs->data.sources_mutex,
 					     &obs->data.public_sources);
 	}
+	obs_transition_insert_name(source);
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex,
 				     &obs->data.sources);
 }
@@ -610,6 +621,8 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 		frame->data[i] = vid_frame.data[i];
 		frame->linesize[i] = vid_frame.linesize[i];
 	}
+
+	bmem_set_tag(frame->data[0], BMEM_TAG_ASYNC_FRAMES);
 }
 
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
@@ -667,6 +680,7 @@ void obs_source_destroy(struct obs_source *source)
 	if (!source->context.private)
 		obs_context_data_remove_name(&source->context,
 					     &obs->data.public_sources);
+	obs_transition_remove_name(source);
 
 	source_profiler_remove_source(source);
 
@@ -699,6 +713,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	if (source->async_culled_frame)
+		obs_source_frame_decref(source->async_culled_frame);
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -713,6 +729,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	}
 	if (source->filter_texrender)
 		gs_texrender_destroy(source->filter_texrender);
+	filter_fusion_free(source);
 	if (source->color_space_texrender)
 		gs_texrender_destroy(source->color_space_texrender);
 	gs_leave_context();
@@ -724,6 +741,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	audio_resampler_destroy(source->resampler);
 	bfree(source->audio_output_buf[0][0]);
 	bfree(source->audio_mix_buf[0]);
+	bfree(source->audio_latency_buf);
 
 	obs_source_frame_destroy(source->async_preload_frame);
 
@@ -734,7 +752,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->audio_cb_list);
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
-	da_free(source->async_frames);
+	obs_name_index_clear(&source->filters_by_name);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -744,6 +762,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_output_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
@@ -976,6 +995,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data,
 				    source->context.settings);
+		os_atomic_inc_long(&source->settings_version);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
 		obs_source_dosignal(source, "source_update", "update");
@@ -996,6 +1016,7 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				    source->context.settings);
+		os_atomic_inc_long(&source->settings_version);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1453,6 +1474,13 @@ static inline size_t get_buf_placement(audio_t *audio, uint64_t offset)
 	return (size_t)util_mul_div64(offset, sample_rate, 1000000000ULL);
 }
 
+/* mirrored memory is not allocated with bmalloc */
+static inline void tag_audio_input_buf(struct deque *buf)
+{
+	if (!buf->mirrored)
+		bmem_set_tag(buf->data, BMEM_TAG_AUDIO);
+}
+
 static void source_output_audio_place(obs_source_t *source,
 				      const struct audio_data *in)
 {
@@ -1486,6 +1514,7 @@ static void source_output_audio_place(obs_source_t *source,
 		deque_pop_back(&source->audio_input_buf[i], NULL,
 			       source->audio_input_buf[i].size -
 				       (buf_placement + size));
+		tag_audio_input_buf(&source->audio_input_buf[i]);
 	}
 
 	source->last_audio_input_buf_size = 0;
@@ -1502,8 +1531,10 @@ static inline void source_output_audio_push_back(obs_source_t *source,
 	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE)
 		return;
 
-	for (size_t i = 0; i < channels; i++)
+	for (size_t i = 0; i < channels; i++) {
 		deque_push_back(&source->audio_input_buf[i], in->data[i], size);
+		tag_audio_input_buf(&source->audio_input_buf[i]);
+	}
 
 	/* reset audio input buffer size to ensure that audio doesn't get
 	 * perpetually cut */
@@ -1530,6 +1561,50 @@ static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 	       (source->push_to_talk_enabled && !push_to_talk_active);
 }
 
+/* moves the latency compensation towards its target by stretching the audio
+ * a little, returns the number of frames it was moved by */
+static long stretch_audio_latency_comp(obs_source_t *source,
+				       struct audio_data *in, long comp)
+{
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	long target = os_atomic_load_long(&source->audio_latency_comp_target);
+	long step = audio_latency_comp_step(target, comp, in->frames);
+	float *out[MAX_AUDIO_CHANNELS];
+	uint32_t frames;
+
+	if (!step) {
+		audio_latency_keep_last(source->audio_latency_last,
+					(const float *const *)in->data,
+					channels, in->frames);
+		return 0;
+	}
+
+	frames = (uint32_t)((long)in->frames + step);
+	if (frames > source->audio_latency_buf_frames) {
+		source->audio_latency_buf =
+			brealloc(source->audio_latency_buf,
+				 frames * channels * sizeof(float));
+		source->audio_latency_buf_frames = frames;
+	}
+
+	for (size_t ch = 0; ch < channels; ch++)
+		out[ch] = source->audio_latency_buf + ch * frames;
+
+	audio_latency_stretch(out, (const float *const *)in->data,
+			      source->audio_latency_last, channels, in->frames,
+			      frames);
+
+	for (size_t ch = 0; ch < channels; ch++)
+		in->data[ch] = (uint8_t *)out[ch];
+	in->frames = frames;
+
+	/* the sync offset was set in the meantime, which resets it */
+	if (!os_atomic_compare_exchange_long(&source->audio_latency_comp,
+					     &comp, comp + step))
+		return 0;
+	return step;
+}
+
 static void source_output_audio_data(obs_source_t *source,
 				     const struct audio_data *data)
 {
@@ -1538,6 +1613,8 @@ static void source_output_audio_data(obs_source_t *source,
 	uint64_t diff;
 	uint64_t os_time = os_gettime_ns();
 	int64_t sync_offset;
+	long comp = os_atomic_load_long(&source->audio_latency_comp);
+	long comp_step;
 	bool using_direct_ts = false;
 	bool push_back = false;
 
@@ -1600,7 +1677,8 @@ static void source_output_audio_data(obs_source_t *source,
 		}
 	}
 
-	sync_offset = source->sync_offset;
+	sync_offset = source->sync_offset +
+		      (int64_t)conv_frames_to_time(sample_rate, (size_t)comp);
 	in.timestamp += sync_offset;
 	in.timestamp -= source->resample_offset;
 
@@ -1613,6 +1691,16 @@ static void source_output_audio_data(obs_source_t *source,
 		source->last_sync_offset = sync_offset;
 	}
 
+	/* the stretched audio lines up with the next packet, so moving the
+	 * compensation doesn't count as a change of the sync offset */
+	comp_step = stretch_audio_latency_comp(source, &in, comp);
+	if (comp_step) {
+		comp += comp_step;
+		source->last_sync_offset =
+			source->sync_offset +
+			(int64_t)conv_frames_to_time(sample_rate, (size_t)comp);
+	}
+
 	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
 		if (push_back && source->audio_ts)
 			source_output_audio_push_back(source, &in);
@@ -2558,32 +2646,123 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source,
 	}
 }
 
+/* takes the frame picked by the last tick and syncs the timing to it */
+static struct obs_source_frame *take_async_frame(obs_source_t *source)
+{
+	struct obs_source_frame *frame = obs_source_get_frame(source);
+	if (frame) {
+		check_to_swap_bgrx_bgra(source, frame);
+
+		if (!source->async_decoupled || !source->async_unbuffered) {
+			source->timing_adjust =
+				obs->video.video_time - frame->timestamp;
+			source->timing_set = true;
+		}
+
+		source->async_last_rendered_ts = frame->timestamp;
+	}
+
+	return frame;
+}
+
 static void obs_source_update_async_video(obs_source_t *source)
 {
+	struct obs_source_frame *frame = NULL;
+
 	if (!source->async_rendered) {
 		source->async_rendered = true;
+		frame = take_async_frame(source);
+	}
 
-		struct obs_source_frame *frame = obs_source_get_frame(source);
-		if (frame) {
-			check_to_swap_bgrx_bgra(source, frame);
+	/* the newest frame may have been taken while the source was culled
+	 * (possibly earlier in this frame), it has not been uploaded yet */
+	if (frame)
+		obs_source_release_frame(source, source->async_culled_frame);
+	else
+		frame = source->async_culled_frame;
+	source->async_culled_frame = NULL;
 
-			if (!source->async_decoupled ||
-			    !source->async_unbuffered) {
-				source->timing_adjust = obs->video.video_time -
-							frame->timestamp;
-				source->timing_set = true;
-			}
+	if (frame) {
+		if (source->async_update_texture) {
+			update_async_textures(source, frame,
+					      source->async_textures,
+					      source->async_texrender);
+			source->async_update_texture = false;
+		}
 
-			if (source->async_update_texture) {
-				update_async_textures(source, frame,
-						      source->async_textures,
-						      source->async_texrender);
-				source->async_update_texture = false;
-			}
+		obs_source_release_frame(source, frame);
+	}
+}
 
-			source->async_last_rendered_ts = frame->timestamp;
-			obs_source_release_frame(source, frame);
-		}
+static inline bool video_format_opaque(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I210:
+	case VIDEO_FORMAT_I412:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+	case VIDEO_FORMAT_V210:
+	case VIDEO_FORMAT_R10L:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* whether rendering the source covers its whole area with opaque pixels,
+ * only known for async sources without filters showing a frame without
+ * alpha */
+bool obs_source_video_opaque(const obs_source_t *source)
+{
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    (source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) !=
+		    OBS_SOURCE_ASYNC_VIDEO ||
+	    source->info.video_render || !source->context.data ||
+	    !source->enabled || source->filters.num ||
+	    deinterlacing_enabled(source))
+		return false;
+
+	return source->async_active && source->async_textures[0] &&
+	       video_format_opaque(source->async_format);
+}
+
+void obs_source_cull_video(obs_source_t *source)
+{
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    (source->info.output_flags & OBS_SOURCE_ASYNC) == 0 ||
+	    source->rendering_filter)
+		return;
+
+	/* deinterlacing needs the textures of every frame */
+	if (deinterlacing_enabled(source)) {
+		deinterlace_update_async_video(source);
+		obs_source_update_async_video(source);
+		return;
+	}
+
+	if (source->async_rendered)
+		return;
+
+	source->async_rendered = true;
+
+	/* keep the newest frame around instead of uploading it, it is
+	 * uploaded when the source is drawn again */
+	struct obs_source_frame *frame = take_async_frame(source);
+	if (frame) {
+		obs_source_release_frame(source, source->async_culled_frame);
+		source->async_culled_frame = frame;
 	}
 }
 
@@ -2865,7 +3044,8 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 
 		if (!source->color_space_texrender) {
 			source->color_space_texrender =
-				gs_texrender_create(format, GS_ZS_NONE);
+				gs_texrender_create_transient(format,
+							      GS_ZS_NONE);
 		}
 
 		gs_texrender_reset(source->color_space_texrender);
@@ -3018,10 +3198,12 @@ static inline void render_video(obs_source_t *source)
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
 
-	else if (source->info.video_render)
-		obs_source_main_render(source);
+	else if (source->info.video_render) {
+		/* a filter may draw the run of filters it starts at once */
+		if (!source->filter_parent || !filter_fusion_render(source))
+			obs_source_main_render(source);
 
-	else if (source->filter_target)
+	} else if (source->filter_target)
 		obs_source_video_render(source->filter_target);
 
 	else if (deinterlacing_enabled(source))
@@ -3212,6 +3394,7 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 						     : source->filters.array[0];
 
 	da_insert(source->filters, 0, &filter);
+	source->filters_by_name_dirty = true;
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
@@ -3251,6 +3434,7 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 	}
 
 	da_erase(source->filters, idx);
+	source->filters_by_name_dirty = true;
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
@@ -3610,28 +3794,52 @@ static inline void free_async_cache(struct obs_source *source)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
 	da_resize(source->async_cache, 0);
-	da_resize(source->async_frames, 0);
+	async_queue_clear(&source->async_frames);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
 
+/* The output thread only needs async_mutex to grow, trim or reset the frame
+ * cache, so count how often it actually has to wait for the graphics
+ * thread */
+static inline void lock_async_cache(obs_source_t *source)
+{
+	if (pthread_mutex_trylock(&source->async_mutex) != 0) {
+		source_profiler_async_lock_contended(source);
+		pthread_mutex_lock(&source->async_mutex);
+	}
+}
+
 /* frees frame allocations if they haven't been used for a specific period
  * of time */
 static void clean_cache(obs_source_t *source)
 {
+	bool locked = false;
+
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
+		if (!os_atomic_load_bool(&af->used)) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
+				if (!locked) {
+					lock_async_cache(source);
+					locked = true;
+				}
+
 				obs_source_frame_destroy(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
 	}
+
+	if (locked)
+		pthread_mutex_unlock(&source->async_mutex);
 }
 
+/* Called with async_output_mutex held.  Only the output thread modifies the
+ * frame cache and the graphics thread only ever marks frames as unused, so
+ * picking an unused frame does not need to lock out the graphics thread. */
 #define MAX_ASYNC_FRAMES 30
 //if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
 static inline struct obs_source_frame *
@@ -3639,9 +3847,8 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 {
 	struct obs_source_frame *new_frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
-
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+	if (async_queue_size(&source->async_frames) >= MAX_ASYNC_FRAMES) {
+		lock_async_cache(source);
 		free_async_cache(source);
 		source->last_frame_ts = 0;
 		pthread_mutex_unlock(&source->async_mutex);
@@ -3649,7 +3856,9 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	}
 
 	if (async_texture_changed(source, frame)) {
+		lock_async_cache(source);
 		free_async_cache(source);
+		pthread_mutex_unlock(&source->async_mutex);
 		source->async_cache_width = frame->width;
 		source->async_cache_height = frame->height;
 	}
@@ -3661,10 +3870,10 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!os_atomic_load_bool(&af->used)) {
 			new_frame = af->frame;
 			new_frame->format = format;
-			af->used = true;
+			os_atomic_set_bool(&af->used, true);
 			af->unused_count = 0;
 			break;
 		}
@@ -3682,13 +3891,13 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		new_af.unused_count = 0;
 		new_frame->refs = 1;
 
+		lock_async_cache(source);
 		da_push_back(source->async_cache, &new_af);
+		pthread_mutex_unlock(&source->async_mutex);
 	}
 
 	os_atomic_inc_long(&new_frame->refs);
 
-	pthread_mutex_unlock(&source->async_mutex);
-
 	copy_frame_data(new_frame, frame);
 
 	return new_frame;
@@ -3701,12 +3910,15 @@ obs_source_output_video_internal(obs_source_t *source,
 	if (!obs_source_valid(source, "obs_source_output_video"))
 		return;
 
+	pthread_mutex_lock(&source->async_output_mutex);
+
 	if (!frame) {
-		pthread_mutex_lock(&source->async_mutex);
+		lock_async_cache(source);
 		source->async_active = false;
 		source->last_frame_ts = 0;
 		free_async_cache(source);
 		pthread_mutex_unlock(&source->async_mutex);
+		pthread_mutex_unlock(&source->async_output_mutex);
 		return;
 	}
 
@@ -3715,17 +3927,19 @@ obs_source_output_video_internal(obs_source_t *source,
 	struct obs_source_frame *output = cache_video(source, frame);
 
 	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
 			obs_source_frame_destroy(output);
 			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
+		} else if (async_queue_push(&source->async_frames, output)) {
 			source->async_active = true;
+		} else {
+			/* queue full, hand the frame back to the cache */
+			obs_source_release_frame(source, output);
 		}
 	}
-	pthread_mutex_unlock(&source->async_mutex);
+
+	pthread_mutex_unlock(&source->async_output_mutex);
 }
 
 void obs_source_output_video(obs_source_t *source,
@@ -4256,6 +4470,7 @@ void obs_source_output_audio(obs_source_t *source,
 	pthread_mutex_unlock(&source->filter_mutex);
 }
 
+/* must be called with async_mutex held */
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
 	if (frame)
@@ -4265,7 +4480,7 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			os_atomic_set_bool(&f->used, false);
 			break;
 		}
 	}
@@ -4275,17 +4490,18 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 {
-	struct obs_source_frame *next_frame = source->async_frames.array[0];
+	struct async_frame_queue *frames = &source->async_frames;
+	struct obs_source_frame *next_frame = async_queue_peek(frames, 0);
 	struct obs_source_frame *frame = NULL;
 	uint64_t sys_offset = sys_time - source->last_sys_timestamp;
 	uint64_t frame_time = next_frame->timestamp;
 	uint64_t frame_offset = 0;
 
 	if (source->async_unbuffered) {
-		while (source->async_frames.num > 1) {
-			da_erase(source->async_frames, 0);
+		while (async_queue_size(frames) > 1) {
+			async_queue_pop(frames);
 			remove_async_frame(source, next_frame);
-			next_frame = source->async_frames.array[0];
+			next_frame = async_queue_peek(frames, 0);
 		}
 
 		source->last_frame_ts = next_frame->timestamp;
@@ -4299,7 +4515,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 	     "number of frames: %lu",
 	     source->last_frame_ts, frame_time, sys_offset,
 	     frame_time - source->last_frame_ts,
-	     (unsigned long)source->async_frames.num);
+	     (unsigned long)async_queue_size(frames));
 #endif
 
 	/* account for timestamp invalidation */
@@ -4325,7 +4541,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 			break;
 
 		if (frame)
-			da_erase(source->async_frames, 0);
+			async_queue_pop(frames);
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -4337,11 +4553,11 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 
 		remove_async_frame(source, frame);
 
-		if (source->async_frames.num == 1)
+		if (async_queue_size(frames) == 1)
 			return true;
 
 		frame = next_frame;
-		next_frame = source->async_frames.array[1];
+		next_frame = async_queue_peek(frames, 1);
 
 		/* more timestamp checking and compensating */
 		if ((next_frame->timestamp - frame_time) > MAX_TS_VAR) {
@@ -4367,12 +4583,16 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 							 uint64_t sys_time)
 {
-	if (!source->async_frames.num)
+	struct async_frame_queue *frames = &source->async_frames;
+
+	if (!async_queue_size(frames))
 		return NULL;
 
 	if (!source->last_frame_ts || ready_async_frame(source, sys_time)) {
-		struct obs_source_frame *frame = source->async_frames.array[0];
-		da_erase(source->async_frames, 0);
+		struct obs_source_frame *frame = async_queue_peek(frames, 0);
+		source_profiler_async_frame_dequeued(
+			source, async_queue_peek_ts(frames, 0));
+		async_queue_pop(frames);
 
 		if (!source->last_frame_ts)
 			source->last_frame_ts = frame->timestamp;
@@ -4454,12 +4674,23 @@ void obs_source_set_name(obs_source_t *source, const char *name)
 		struct calldata data;
 		char *prev_name = bstrdup(source->context.name);
 
+		pthread_mutex_lock(&obs->data.sources_mutex);
+		obs_transition_remove_name(source);
 		if (!source->context.private) {
 			obs_context_data_setname_ht(&source->context, name,
 						    &obs->data.public_sources);
 		} else {
 			obs_context_data_setname(&source->context, name);
 		}
+		obs_transition_insert_name(source);
+		pthread_mutex_unlock(&obs->data.sources_mutex);
+
+		obs_source_t *parent = source->filter_parent;
+		if (parent) {
+			pthread_mutex_lock(&parent->filter_mutex);
+			parent->filters_by_name_dirty = true;
+			pthread_mutex_unlock(&parent->filter_mutex);
+		}
 
 		calldata_init(&data);
 		calldata_set_ptr(&data, "source", source);
@@ -4619,7 +4850,7 @@ bool obs_source_process_filter_begin_with_color_space(
 
 	if (!filter->filter_texrender) {
 		filter->filter_texrender =
-			gs_texrender_create(format, GS_ZS_NONE);
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(filter->filter_texrender, cx,
@@ -4792,6 +5023,8 @@ void obs_source_set_sync_offset(obs_source_t *source, int64_t offset)
 				      &data);
 
 		source->sync_offset = calldata_int(&data, "offset");
+		os_atomic_set_long(&source->audio_latency_comp_target, 0);
+		os_atomic_set_long(&source->audio_latency_comp, 0);
 	}
 }
 
@@ -4802,6 +5035,20 @@ int64_t obs_source_get_sync_offset(const obs_source_t *source)
 		       : 0;
 }
 
+int64_t obs_source_get_audio_latency_compensation(const obs_source_t *source)
+{
+	long comp;
+
+	if (!obs_source_valid(source,
+			      "obs_source_get_audio_latency_compensation") ||
+	    !obs->audio.audio)
+		return 0;
+
+	comp = os_atomic_load_long(&source->audio_latency_comp);
+	return (int64_t)conv_frames_to_time(
+		audio_output_get_sample_rate(obs->audio.audio), (size_t)comp);
+}
+
 struct source_enum_data {
 	obs_source_enum_proc_t enum_callback;
 	void *param;
@@ -5247,6 +5494,23 @@ bool obs_source_is_hidden(obs_source_t *source)
 	return source->temp_removed;
 }
 
+/* must be called with filter_mutex held */
+static void rebuild_filters_by_name(obs_source_t *source)
+{
+	obs_name_index_clear(&source->filters_by_name);
+
+	/* keep the first filter of each name like a linear search would */
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		if (filter->context.name)
+			obs_name_index_add(&source->filters_by_name,
+					   filter->context.name, filter);
+	}
+
+	source->filters_by_name_dirty = false;
+}
+
 obs_source_t *obs_source_get_filter_by_name(obs_source_t *source,
 					    const char *name)
 {
@@ -5259,13 +5523,12 @@ obs_source_t *obs_source_get_filter_by_name(obs_source_t *source,
 
 	pthread_mutex_lock(&source->filter_mutex);
 
-	for (size_t i = 0; i < source->filters.num; i++) {
-		struct obs_source *cur_filter = source->filters.array[i];
-		if (strcmp(cur_filter->context.name, name) == 0) {
-			filter = obs_source_get_ref(cur_filter);
-			break;
-		}
-	}
+	if (source->filters_by_name_dirty)
+		rebuild_filters_by_name(source);
+
+	filter = obs_name_index_find(source->filters_by_name, name);
+	if (filter)
+		filter = obs_source_get_ref(filter);
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
@@ -5596,12 +5859,12 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 	}
 }
 
-static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
-			       size_t channels, size_t sample_rate)
+/* whether volume/mute changes have to be applied within the current tick */
+static bool audio_actions_due(obs_source_t *source, size_t sample_rate)
 {
 	struct audio_action action;
 	bool actions_pending;
-	float vol;
+	uint64_t duration;
 
 	pthread_mutex_lock(&source->audio_actions_mutex);
 
@@ -5611,14 +5874,21 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
-	if (actions_pending) {
-		uint64_t duration =
-			conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
+	if (!actions_pending)
+		return false;
 
-		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
-			return;
-		}
+	duration = conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
+	return action.timestamp < (source->audio_ts + duration);
+}
+
+static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
+			       size_t channels, size_t sample_rate)
+{
+	float vol;
+
+	if (audio_actions_due(source, sample_rate)) {
+		apply_audio_actions(source, channels, sample_rate);
+		return;
 	}
 
 	vol = get_source_volume(source, source->audio_ts);
@@ -5716,11 +5986,65 @@ static void audio_submix(obs_source_t *source, size_t channels,
 	obs_source_output_audio(source, &audio);
 }
 
+static void copy_audio_spans(float *out, const struct deque_span *spans,
+			     size_t num_spans, float vol)
+{
+	for (size_t i = 0; i < num_spans; i++) {
+		const float *in = spans[i].data;
+		size_t frames = spans[i].size / sizeof(float);
+
+		if (vol == 1.0f) {
+			memcpy(out, in, spans[i].size);
+		} else {
+			for (size_t j = 0; j < frames; j++)
+				out[j] = in[j] * vol;
+		}
+
+		out += frames;
+	}
+}
+
+/* Reads the input buffers straight into each enabled mix with the volume
+ * applied, rather than copying them into the first mix, duplicating that
+ * into the other mixes and then scaling every mix in a separate pass.
+ * Must be called with audio_buf_mutex held. */
+static void render_audio_spans(obs_source_t *source, uint32_t mixers,
+			       size_t channels, size_t size, float vol)
+{
+	struct deque_span spans[MAX_AUDIO_CHANNELS][2];
+	size_t num_spans[MAX_AUDIO_CHANNELS];
+
+	for (size_t ch = 0; ch < channels; ch++)
+		num_spans[ch] = deque_peek_span(&source->audio_input_buf[ch],
+						size, spans[ch]);
+
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		uint32_t mix_and_val = (1 << mix);
+
+		if (vol == 0.0f || (source->audio_mixers & mix_and_val) == 0 ||
+		    (mixers & mix_and_val) == 0) {
+			memset(source->audio_output_buf[mix][0], 0,
+			       size * channels);
+			continue;
+		}
+
+		for (size_t ch = 0; ch < channels; ch++)
+			copy_audio_spans(source->audio_output_buf[mix][ch],
+					 spans[ch], num_spans[ch], vol);
+	}
+}
+
 static inline void process_audio_source_tick(obs_source_t *source,
 					     uint32_t mixers, size_t channels,
 					     size_t sample_rate, size_t size)
 {
 	bool audio_submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
+	bool direct = !audio_submix && !audio_actions_due(source, sample_rate);
+	float vol = 1.0f;
+
+	if (direct)
+		vol = mixers ? get_source_volume(source, source->audio_ts)
+			     : 0.0f;
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
@@ -5730,9 +6054,21 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		return;
 	}
 
-	for (size_t ch = 0; ch < channels; ch++)
-		deque_peek_front(&source->audio_input_buf[ch],
-				 source->audio_output_buf[0][ch], size);
+	if (direct) {
+		render_audio_spans(source, mixers, channels, size, vol);
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+		source->audio_pending = false;
+		return;
+	}
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		struct deque_span spans[2];
+		size_t num_spans = deque_peek_span(
+			&source->audio_input_buf[ch], size, spans);
+
+		copy_audio_spans(source->audio_output_buf[0][ch], spans,
+				 num_spans, 1.0f);
+	}
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
@@ -6276,6 +6612,7 @@ void obs_source_restore_filters(obs_source_t *source, obs_data_array_t *array)
 	}
 
 	da_free(source->filters);
+	source->filters_by_name_dirty = true;
 	pthread_mutex_unlock(&source->filter_mutex);
 
 	/* add backed up filters */
@@ -6313,6 +6650,7 @@ void obs_source_restore_filters(obs_source_t *source, obs_data_array_t *array)
 
 	pthread_mutex_lock(&source->filter_mutex);
 	da_move(source->filters, new_filters);
+	source->filters_by_name_dirty = true;
 	pthread_mutex_unlock(&source->filter_mutex);
 
 	/* release filters */
@@ -212,6 +212,33 @@ struct obs_source_audio_mix {
 	struct audio_output_data output[MAX_AUDIO_MIXES];
 };
 
+/**
+ * Per-pixel shader stage of a video filter.
+ *
+ * Consecutive filters that provide a stage are drawn together in a single
+ * generated effect pass instead of one render target per filter.  The shader
+ * code declares the uniforms, samplers and functions the stage needs and
+ * must define the function "float4 $apply(float4 rgba)", which gets the
+ * color of the current pixel and returns the filtered color.  Every '$' is
+ * replaced by a prefix that is unique to the stage within the effect.
+ *
+ * The stage can not sample the image at any other position, filters that
+ * read neighboring pixels, change the size or move the image must not
+ * provide a stage.
+ */
+struct obs_filter_stage {
+	/** Shader code of the stage, must stay valid until the next call */
+	const char *shader;
+
+	/**
+	 * The stage returns premultiplied alpha and is drawn with
+	 * GS_BLEND_ONE, GS_BLEND_INVSRCALPHA, like most filters that
+	 * unpremultiply the image first.  Otherwise the color is drawn with
+	 * the default blending.
+	 */
+	bool premultiplied;
+};
+
 /**
  * Source definition structure
  */
@@ -560,6 +587,29 @@ struct obs_source_info {
 	 * @param  source  Source that the filter is being added to
 	 */
 	void (*filter_add)(void *data, obs_source_t *source);
+
+	/**
+	 * Gets the per-pixel shader stage of a video filter, which allows the
+	 * filter to be drawn in the same pass as the filters next to it.
+	 * video_render is still used when the filter can not be combined.
+	 *
+	 * @param       data   Filter data
+	 * @param[out]  stage  Stage of the filter
+	 * @return             false if the filter can not be drawn as a stage
+	 *                     with its current settings
+	 */
+	bool (*filter_get_stage)(void *data, struct obs_filter_stage *stage);
+
+	/**
+	 * Sets the parameters of the stage returned by filter_get_stage.  Use
+	 * obs_filter_stage_get_param to look up the parameters.
+	 *
+	 * @param  data    Filter data
+	 * @param  effect  Effect the stage is drawn with
+	 * @param  prefix  Prefix that replaced '$' in the shader code
+	 */
+	void (*filter_set_stage_params)(void *data, gs_effect_t *effect,
+					const char *prefix);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info,
@@ -29,6 +29,10 @@
 #include <windows.h>
 #endif
 
+/* render targets that have not been drawn to for this many frames are
+ * returned to the pool, pooled targets unused for as long are destroyed */
+#define RENDER_TARGET_IDLE_FRAMES 120
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
@@ -121,8 +125,24 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
+static const char *readback_wait_name = "readback_wait";
+static inline void wait_readback(struct obs_core_video_mix *video)
+{
+	if (!video->readback_pending)
+		return;
+
+	profile_start(readback_wait_name);
+	os_event_wait(video->readback_done);
+	profile_end(readback_wait_name);
+
+	video->readback_pending = false;
+}
+
 static inline void unmap_last_surface(struct obs_core_video_mix *video)
 {
+	/* the readback thread may still be copying out of them */
+	wait_readback(video);
+
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
 		if (video->mapped_surfaces[c]) {
 			gs_stagesurface_unmap(video->mapped_surfaces[c]);
@@ -889,6 +909,98 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 	}
 }
 
+#define NBSP "\xC2\xA0"
+
+static const char *readback_copy_name = "output_video_data";
+static void *readback_thread(void *data)
+{
+	struct obs_core_video_mix *video = data;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("obs video readback thread");
+	const char *readback_thread_name = profile_store_name(
+		obs_get_profiler_name_store(),
+		"obs_video_readback_thread(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(readback_thread_name, interval);
+
+	while (os_sem_wait(video->readback_semaphore) == 0) {
+		if (os_atomic_load_bool(&video->readback_stop))
+			break;
+
+		profile_start(readback_thread_name);
+
+		profile_start(readback_copy_name);
+		output_video_data(video, &video->readback_frame,
+				  video->readback_count);
+		profile_end(readback_copy_name);
+
+		os_event_signal(video->readback_done);
+
+		profile_end(readback_thread_name);
+		profile_reenable_thread();
+	}
+
+	os_event_signal(video->readback_done);
+	return NULL;
+}
+
+bool init_video_readback(struct obs_core_video_mix *video)
+{
+	video->readback_stop = false;
+	video->readback_pending = false;
+
+	if (os_sem_init(&video->readback_semaphore, 0) != 0)
+		return false;
+	if (os_event_init(&video->readback_done, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+	if (pthread_create(&video->readback_thread, NULL, readback_thread,
+			   video) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+void free_video_readback(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized) {
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_semaphore);
+		pthread_join(video->readback_thread, NULL);
+		video->readback_thread_initialized = false;
+	}
+
+	if (video->readback_semaphore) {
+		os_sem_destroy(video->readback_semaphore);
+		video->readback_semaphore = NULL;
+	}
+	if (video->readback_done) {
+		os_event_destroy(video->readback_done);
+		video->readback_done = NULL;
+	}
+
+	video->readback_pending = false;
+}
+
+/* the mapped surfaces are only unmapped by the next stage_output_texture,
+ * which waits for the copy to finish first */
+static inline void queue_readback(struct obs_core_video_mix *video,
+				  const struct video_data *frame, int count)
+{
+	video->readback_frame = *frame;
+	video->readback_count = count;
+	video->readback_pending = true;
+
+	os_event_reset(video->readback_done);
+	os_sem_post(video->readback_semaphore);
+}
+
+static inline bool offload_readback(struct obs_core_video_mix *video)
+{
+	return video->readback_thread_initialized &&
+	       !os_atomic_load_bool(&obs->video.readback_inline);
+}
+
 void add_ready_encoder_group(obs_encoder_t *encoder)
 {
 	obs_weak_encoder_t *weak = obs_encoder_get_weak_encoder(encoder);
@@ -1011,9 +1123,13 @@ static inline void output_frame(struct obs_core_video_mix *video)
 				sizeof(vframe_info));
 
 		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
+		if (offload_readback(video)) {
+			queue_readback(video, &frame, vframe_info.count);
+		} else {
+			profile_start(output_frame_output_video_data_name);
+			output_video_data(video, &frame, vframe_info.count);
+			profile_end(output_frame_output_video_data_name);
+		}
 	}
 
 	if (++video->cur_texture == NUM_TEXTURES)
@@ -1038,8 +1154,6 @@ static inline void output_frames(void)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
@@ -1218,6 +1332,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	gs_render_target_pool_next_frame(RENDER_TARGET_IDLE_FRAMES);
 	gs_leave_context();
 
 	profile_start(tick_sources_name);
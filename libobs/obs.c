@@ -722,6 +722,9 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 
 	gs_leave_context();
 
+	if (!init_video_readback(video))
+		return OBS_VIDEO_FAIL;
+
 	return OBS_VIDEO_SUCCESS;
 }
 
@@ -844,6 +847,7 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		free_video_readback(video);
 		video_output_close(video->video);
 		video->video = NULL;
 
@@ -943,6 +947,8 @@ static bool obs_init_audio(struct audio_output_info *ai)
 		return false;
 	if (pthread_mutex_init(&audio->task_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&audio->buffering_mutex, NULL) != 0)
+		return false;
 
 	struct obs_task_info audio_init = {.task = set_audio_thread};
 	deque_push_back(&audio->tasks, &audio_init, sizeof(audio_init));
@@ -977,6 +983,17 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	long ticks = os_atomic_load_long(&audio->render_ticks);
+	if (ticks) {
+		blog(LOG_INFO,
+		     "Audio rendering: %ld ticks, %ld missed deadlines, "
+		     "max %g ms",
+		     ticks,
+		     os_atomic_load_long(&audio->render_deadline_misses),
+		     (double)os_atomic_load_long(&audio->render_max_us) /
+			     1000.0);
+	}
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -986,6 +1003,7 @@ static void obs_free_audio(void)
 	bfree(audio->monitoring_device_id);
 	deque_free(&audio->tasks);
 	pthread_mutex_destroy(&audio->task_mutex);
+	pthread_mutex_destroy(&audio->buffering_mutex);
 	pthread_mutex_destroy(&audio->monitoring_mutex);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
@@ -1020,6 +1038,7 @@ static bool obs_init_data(void)
 
 	data->sources = NULL;
 	data->public_sources = NULL;
+	data->transitions = NULL;
 	data->private_data = obs_data_create();
 	data->valid = true;
 
@@ -1084,6 +1103,15 @@ static void obs_free_data(void)
 	FREE_OBS_HASH_TABLE(hh, &data->public_sources, source);
 	FREE_OBS_HASH_TABLE(hh_uuid, &data->sources, source);
 
+	/* destroying the sources empties it, this only frees the table */
+	struct obs_name_entry *entry, *tmp;
+	HASH_ITER (hh, data->transitions, entry, tmp) {
+		HASH_DEL(data->transitions, entry);
+		da_free(entry->sources);
+		bfree(entry->name);
+		bfree(entry);
+	}
+
 	os_task_queue_wait(obs->destruction_task_thread);
 
 	pthread_mutex_destroy(&data->sources_mutex);
@@ -1169,6 +1197,13 @@ static inline bool obs_init_hotkeys(void)
 	hotkeys->sceneitem_show = bstrdup("Show '%1'");
 	hotkeys->sceneitem_hide = bstrdup("Hide '%1'");
 
+	/* the platform can start pushing key events as soon as it has been
+	 * initialized */
+	if (pthread_mutex_init(&hotkeys->events_mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&hotkeys->events_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
 	if (!obs_hotkeys_platform_init(hotkeys))
 		return false;
 
@@ -1197,6 +1232,7 @@ static inline void stop_hotkeys(void)
 
 	if (hotkeys->hotkey_thread_initialized) {
 		os_event_signal(hotkeys->stop_event);
+		os_event_signal(hotkeys->events_event);
 		pthread_join(hotkeys->hotkey_thread, &thread_ret);
 		hotkeys->hotkey_thread_initialized = false;
 	}
@@ -1218,7 +1254,11 @@ static inline void obs_free_hotkeys(void)
 
 	obs_hotkey_name_map_free();
 
+	/* the platform may push key events until it is freed */
 	obs_hotkeys_platform_free(hotkeys);
+	os_event_destroy(hotkeys->events_event);
+	deque_free(&hotkeys->events);
+	pthread_mutex_destroy(&hotkeys->events_mutex);
 	pthread_mutex_destroy(&hotkeys->mutex);
 }
 
@@ -1248,6 +1288,7 @@ static bool obs_init(const char *locale, const char *module_config_path,
 
 	pthread_mutex_init_value(&obs->audio.monitoring_mutex);
 	pthread_mutex_init_value(&obs->audio.task_mutex);
+	pthread_mutex_init_value(&obs->audio.buffering_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
@@ -1400,6 +1441,7 @@ void obs_shutdown(void)
 	struct obs_module *module;
 
 	obs_wait_for_destroy_queue();
+	bmem_log_stats();
 
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *item = &obs->source_types.array[i];
@@ -1470,6 +1512,10 @@ void obs_shutdown(void)
 	obs = NULL;
 	bfree(cmdline_args.argv);
 
+	/* the shutdown thread usually is the main thread, which never exits
+	 * while libobs could still release its cache */
+	bmem_free_thread_cache();
+
 #ifdef _WIN32
 	if (com_initialized)
 		uninitialize_com();
@@ -1641,7 +1687,7 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	     "\tmax buffering:   %d milliseconds\n"
 	     "\tbuffering type:  %s",
 	     (int)ai.samples_per_sec, (int)ai.speakers, max_buffering_ms,
-	     oai->fixed_buffering ? "fixed" : "dynamically increasing");
+	     oai->fixed_buffering ? "fixed" : "adaptive");
 
 	return obs_init_audio(&ai);
 }
@@ -1677,6 +1723,32 @@ float obs_get_video_hdr_nominal_peak_level(void)
 	return video->graphics ? video->hdr_nominal_peak_level : 1000.f;
 }
 
+void obs_set_video_readback_offload(bool enable)
+{
+	os_atomic_set_bool(&obs->video.readback_inline, !enable);
+}
+
+void obs_set_video_filter_fusion(bool enable)
+{
+	os_atomic_set_bool(&obs->video.filter_fusion_disabled, !enable);
+}
+
+void obs_set_scene_item_culling(bool enable)
+{
+	os_atomic_set_bool(&obs->video.scene_culling_disabled, !enable);
+}
+
+bool obs_get_render_target_pool_info(struct gs_render_target_pool_info *info)
+{
+	if (!info || !obs->video.graphics)
+		return false;
+
+	gs_enter_context(obs->video.graphics);
+	gs_render_target_pool_get_info(info);
+	gs_leave_context();
+	return true;
+}
+
 void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 {
 	struct obs_core_video *video = &obs->video;
@@ -1701,6 +1773,65 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 	return true;
 }
 
+bool obs_get_audio_buffering_info(struct obs_audio_buffering_info *info)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	uint32_t sample_rate;
+
+	if (!info || !audio->audio)
+		return false;
+
+	sample_rate = audio_output_get_sample_rate(audio->audio);
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+	info->total_ms = audio->buffering_ms;
+	pthread_mutex_unlock(&audio->buffering_mutex);
+
+	info->max_ms = (uint32_t)audio->max_buffering_ticks *
+		       AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC / sample_rate;
+	info->fixed_buffering = audio->fixed_buffer;
+	return true;
+}
+
+bool obs_get_audio_render_info(struct obs_audio_render_info *info)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (!info || !audio->audio)
+		return false;
+
+	info->ticks = (uint64_t)os_atomic_load_long(&audio->render_ticks);
+	info->deadline_misses =
+		(uint64_t)os_atomic_load_long(&audio->render_deadline_misses);
+	info->max_render_us =
+		(uint64_t)os_atomic_load_long(&audio->render_max_us);
+	return true;
+}
+
+size_t obs_get_audio_buffering_history(struct obs_audio_buffering_event *events,
+				       size_t count)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	size_t start;
+
+	if (!events || !audio->audio)
+		return 0;
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+
+	if (count > audio->buffering_history_count)
+		count = audio->buffering_history_count;
+
+	start = audio->buffering_history_pos + AUDIO_BUFFERING_HISTORY - count;
+	for (size_t i = 0; i < count; i++) {
+		size_t idx = (start + i) % AUDIO_BUFFERING_HISTORY;
+		events[i] = audio->buffering_history[idx];
+	}
+
+	pthread_mutex_unlock(&audio->buffering_mutex);
+	return count;
+}
+
 bool obs_enum_source_types(size_t idx, const char **id)
 {
 	if (idx >= obs->source_types.num)
@@ -2061,21 +2192,21 @@ obs_source_t *obs_get_source_by_uuid(const char *uuid)
 
 obs_source_t *obs_get_transition_by_name(const char *name)
 {
-	struct obs_source **first = &obs->data.sources;
-	struct obs_source *source;
+	struct obs_name_entry *entry;
+	struct obs_source *source = NULL;
+
+	if (!name)
+		return NULL;
 
 	pthread_mutex_lock(&obs->data.sources_mutex);
 
-	/* Transitions are private but can be found via this method, so we
-	 * can't look them up by name in the public_sources hash table. */
-	source = *first;
-	while (source) {
-		if (source->info.type == OBS_SOURCE_TYPE_TRANSITION &&
-		    strcmp(source->context.name, name) == 0) {
-			source = obs_source_addref_safe_(source);
+	/* Transitions are usually private but can be found via this method,
+	 * so they have a name table of their own */
+	HASH_FIND_STR(obs->data.transitions, name, entry);
+	for (size_t i = 0; entry && i < entry->sources.num; i++) {
+		source = obs_source_addref_safe_(entry->sources.array[i]);
+		if (source)
 			break;
-		}
-		source = (void *)source->context.hh_uuid.next;
 	}
 
 	pthread_mutex_unlock(&obs->data.sources_mutex);
@@ -2846,6 +2977,70 @@ void obs_context_data_remove_uuid(struct obs_context_data *context,
 	pthread_mutex_unlock(context->mutex);
 }
 
+static inline bool indexed_transition(const struct obs_source *source)
+{
+	return source->info.type == OBS_SOURCE_TYPE_TRANSITION &&
+	       source->context.name;
+}
+
+void obs_transition_insert_name(struct obs_source *source)
+{
+	struct obs_name_entry *entry;
+	const char *name = source->context.name;
+	size_t idx;
+
+	if (!indexed_transition(source))
+		return;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+
+	if (!source->transition_order)
+		source->transition_order = ++obs->data.next_transition_order;
+
+	HASH_FIND_STR(obs->data.transitions, name, entry);
+	if (!entry) {
+		entry = bzalloc(sizeof(*entry));
+		entry->name = bstrdup(name);
+		HASH_ADD_STR(obs->data.transitions, name, entry);
+	}
+
+	/* keep the order of creation across renames, that is the order
+	 * lookups used to walk all sources in */
+	for (idx = entry->sources.num; idx > 0; idx--) {
+		struct obs_source *prev = entry->sources.array[idx - 1];
+		if (prev->transition_order < source->transition_order)
+			break;
+	}
+	da_insert(entry->sources, idx, &source);
+
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+}
+
+void obs_transition_remove_name(struct obs_source *source)
+{
+	struct obs_name_entry *entry;
+	const char *name = source->context.name;
+
+	if (!indexed_transition(source))
+		return;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+
+	HASH_FIND_STR(obs->data.transitions, name, entry);
+	if (entry) {
+		da_erase_item(entry->sources, &source);
+
+		if (!entry->sources.num) {
+			HASH_DEL(obs->data.transitions, entry);
+			da_free(entry->sources);
+			bfree(entry->name);
+			bfree(entry);
+		}
+	}
+
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+}
+
 void obs_context_wait(struct obs_context_data *context)
 {
 	pthread_mutex_lock(context->mutex);
@@ -174,6 +174,7 @@ struct obs_video_info {
 #ifndef SWIG
 	/**
 	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11")
+	 * or "libobs-null" to run without a GPU, skipping all draw calls
 	 */
 	const char *graphics_module;
 #endif
@@ -216,6 +217,28 @@ struct obs_audio_info2 {
 	bool fixed_buffering;
 };
 
+struct obs_audio_buffering_info {
+	uint32_t total_ms;
+	uint32_t max_ms;
+	bool fixed_buffering;
+};
+
+/** A change of the total audio buffering, change_ms is negative when
+ * buffering was removed */
+struct obs_audio_buffering_event {
+	uint64_t timestamp;
+	int32_t change_ms;
+	uint32_t total_ms;
+};
+
+/** deadline_misses counts the ticks that took longer to render than the
+ * audio they produced */
+struct obs_audio_render_info {
+	uint64_t ticks;
+	uint64_t deadline_misses;
+	uint64_t max_render_us;
+};
+
 /**
  * Sent to source filters via the filter_audio callback to allow filtering of
  * audio data
@@ -435,6 +458,33 @@ EXPORT float obs_get_video_sdr_white_level(void);
 /** Gets the HDR nominal peak level, returns 1000.f if no video */
 EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 
+/**
+ * Sets whether raw video frames are copied out of the mapped staging
+ * surfaces by a separate thread (the default) or by the graphics thread
+ */
+EXPORT void obs_set_video_readback_offload(bool enable);
+
+/**
+ * Sets whether consecutive filters that provide a per-pixel shader stage are
+ * drawn together in a single pass (the default) or each through its own
+ * render target.  Both should give the same image, up to rounding of the
+ * intermediate render targets.
+ */
+EXPORT void obs_set_video_filter_fusion(bool enable);
+
+/**
+ * Sets whether scenes skip drawing items that are entirely outside of the
+ * scene or covered by opaque items above them (the default)
+ */
+EXPORT void obs_set_scene_item_culling(bool enable);
+
+/**
+ * Gets the statistics of the render target pool shared by the texrenders of
+ * sources, filters and transitions, returns false if no video
+ */
+EXPORT bool
+obs_get_render_target_pool_info(struct gs_render_target_pool_info *info);
+
 /** Sets the video levels */
 EXPORT void obs_set_video_levels(float sdr_white_level,
 				 float hdr_nominal_peak_level);
@@ -442,6 +492,21 @@ EXPORT void obs_set_video_levels(float sdr_white_level,
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+/** Gets the current audio buffering, returns false if no audio */
+EXPORT bool
+obs_get_audio_buffering_info(struct obs_audio_buffering_info *info);
+
+/** Gets the audio render thread statistics, returns false if no audio */
+EXPORT bool obs_get_audio_render_info(struct obs_audio_render_info *info);
+
+/**
+ * Copies up to count of the most recent audio buffering changes, oldest
+ * first, and returns how many were copied.
+ */
+EXPORT size_t
+obs_get_audio_buffering_history(struct obs_audio_buffering_event *events,
+				size_t count);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -1206,6 +1271,15 @@ EXPORT void obs_source_set_sync_offset(obs_source_t *source, int64_t offset);
 /** Gets the audio sync offset (in nanoseconds) for a source */
 EXPORT int64_t obs_source_get_sync_offset(const obs_source_t *source);
 
+/**
+ * Gets the delay (in nanoseconds) added to a chronically late audio source so
+ * that it no longer holds back the audio buffering of the whole mix.  It is
+ * applied gradually, reduced again once the source catches up, and reset
+ * when the sync offset of the source is set.
+ */
+EXPORT int64_t
+obs_source_get_audio_latency_compensation(const obs_source_t *source);
+
 /** Enumerates active child sources used by this source */
 EXPORT void obs_source_enum_active_sources(obs_source_t *source,
 					   obs_source_enum_proc_t enum_callback,
@@ -1535,6 +1609,14 @@ EXPORT void obs_source_process_filter_tech_end(obs_source_t *filter,
 /** Skips the filter if the filter is invalid and cannot be rendered */
 EXPORT void obs_source_skip_video_filter(obs_source_t *filter);
 
+/**
+ * Gets a parameter of a filter stage in the effect it is drawn with, for use
+ * in filter_set_stage_params.  name is the parameter name without the '$'.
+ */
+EXPORT gs_eparam_t *obs_filter_stage_get_param(gs_effect_t *effect,
+					       const char *prefix,
+					       const char *name);
+
 /**
  * Adds an active child source.  Must be called by parent sources on child
  * sources when the child is added and active.  This ensures that the source is
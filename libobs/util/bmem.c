@@ -21,6 +21,10 @@
 #include "platform.h"
 #include "threading.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 /*
  * NOTE: totally jacked the mem alignment trick from ffmpeg, credit to them:
  *   http://www.ffmpeg.org/
@@ -44,62 +48,296 @@
 #define ALIGNMENT_HACK 1
 #endif
 
-static void *a_malloc(size_t size)
+/* Every allocation is preceded by a header so that bfree and brealloc know
+ * how large it is and which tag it is accounted to.  offset is the distance
+ * to the start of the underlying allocation and must stay the last byte. */
+struct bmem_header {
+	size_t size;
+	uint8_t tag;
+	uint8_t pool;
+	uint8_t unused[sizeof(size_t) - 3];
+	uint8_t offset;
+};
+
+static inline struct bmem_header *get_header(void *ptr)
 {
-#ifdef ALIGNED_MALLOC
-	return _aligned_malloc(size, ALIGNMENT);
-#elif ALIGNMENT_HACK
-	void *ptr = NULL;
-	long diff;
+	return (struct bmem_header *)ptr - 1;
+}
 
-	ptr = malloc(size + ALIGNMENT);
-	if (ptr) {
-		diff = ((~(long)ptr) & (ALIGNMENT - 1)) + 1;
-		ptr = (char *)ptr + diff;
-		((char *)ptr)[-1] = (char)diff;
-	}
+#ifdef ALIGNED_MALLOC
+/* the header lives in the ALIGNMENT bytes in front of the memory */
+static void *a_malloc(size_t size)
+{
+	char *ptr = _aligned_malloc(size + ALIGNMENT, ALIGNMENT);
+	if (!ptr)
+		return NULL;
 
+	ptr += ALIGNMENT;
+	get_header(ptr)->offset = ALIGNMENT;
 	return ptr;
-#else
-	return malloc(size);
-#endif
 }
 
 static void *a_realloc(void *ptr, size_t size)
 {
-#ifdef ALIGNED_MALLOC
-	return _aligned_realloc(ptr, size, ALIGNMENT);
+	char *base = _aligned_realloc((char *)ptr - ALIGNMENT,
+				      size + ALIGNMENT, ALIGNMENT);
+	return base ? base + ALIGNMENT : NULL;
+}
+
+static void a_free(void *ptr)
+{
+	_aligned_free((char *)ptr - ALIGNMENT);
+}
 #elif ALIGNMENT_HACK
-	long diff;
+static void *a_malloc(size_t size)
+{
+	char *base = malloc(size + sizeof(struct bmem_header) + ALIGNMENT);
+	char *ptr;
 
-	if (!ptr)
-		return a_malloc(size);
-	diff = ((char *)ptr)[-1];
-	ptr = realloc((char *)ptr - diff, size + diff);
-	if (ptr)
-		ptr = (char *)ptr + diff;
+	if (!base)
+		return NULL;
+
+	ptr = base + sizeof(struct bmem_header);
+	ptr += (ALIGNMENT - ((uintptr_t)ptr & (ALIGNMENT - 1))) &
+	       (ALIGNMENT - 1);
+	get_header(ptr)->offset = (uint8_t)(ptr - base);
 	return ptr;
-#else
-	return realloc(ptr, size);
-#endif
+}
+
+static void *a_realloc(void *ptr, size_t size)
+{
+	uint8_t offset = get_header(ptr)->offset;
+	char *base = realloc((char *)ptr - offset, size + offset);
+	return base ? base + offset : NULL;
 }
 
 static void a_free(void *ptr)
 {
-#ifdef ALIGNED_MALLOC
-	_aligned_free(ptr);
-#elif ALIGNMENT_HACK
-	if (ptr)
-		free((char *)ptr - ((char *)ptr)[-1]);
+	free((char *)ptr - get_header(ptr)->offset);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* per tag accounting */
+
+#ifdef _MSC_VER
+static inline int64_t atomic_add64(volatile int64_t *ptr, int64_t val)
+{
+	return _InterlockedExchangeAdd64((volatile __int64 *)ptr, val) + val;
+}
+
+static inline int64_t atomic_load64(volatile int64_t *ptr)
+{
+	return _InterlockedCompareExchange64((volatile __int64 *)ptr, 0, 0);
+}
+
+static inline bool atomic_cas64(volatile int64_t *ptr, int64_t old_val,
+				int64_t new_val)
+{
+	return _InterlockedCompareExchange64((volatile __int64 *)ptr, new_val,
+					     old_val) == old_val;
+}
 #else
-	free(ptr);
+static inline int64_t atomic_add64(volatile int64_t *ptr, int64_t val)
+{
+	return __atomic_add_fetch(ptr, val, __ATOMIC_RELAXED);
+}
+
+static inline int64_t atomic_load64(volatile int64_t *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline bool atomic_cas64(volatile int64_t *ptr, int64_t old_val,
+				int64_t new_val)
+{
+	return __atomic_compare_exchange_n(ptr, &old_val, new_val, false,
+					   __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
 #endif
+
+struct tag_stats {
+	volatile int64_t live_bytes;
+	volatile int64_t peak_bytes;
+	volatile long live_allocs;
+};
+
+static struct tag_stats tag_stats[BMEM_TAG_COUNT];
+
+static const char *tag_names[BMEM_TAG_COUNT] = {
+	[BMEM_TAG_NONE] = "untagged",
+	[BMEM_TAG_ASYNC_FRAMES] = "async frames",
+	[BMEM_TAG_AUDIO] = "audio buffers",
+	[BMEM_TAG_ENCODER_PACKETS] = "encoder packets",
+	[BMEM_TAG_IMAGES] = "images",
+	[BMEM_TAG_DATA] = "obs_data",
+	[BMEM_TAG_CALLDATA] = "calldata",
+};
+
+static void account(uint8_t tag, int64_t bytes, long allocs)
+{
+	struct tag_stats *stats = &tag_stats[tag];
+	int64_t live = atomic_add64(&stats->live_bytes, bytes);
+
+	if (allocs > 0)
+		os_atomic_inc_long(&stats->live_allocs);
+	else if (allocs < 0)
+		os_atomic_dec_long(&stats->live_allocs);
+
+	if (bytes > 0) {
+		int64_t peak = atomic_load64(&stats->peak_bytes);
+		while (live > peak &&
+		       !atomic_cas64(&stats->peak_bytes, peak, live))
+			peak = atomic_load64(&stats->peak_bytes);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* size class pools
+ *
+ *   Small allocations with a pooled tag are rounded up to a power of two
+ * size class, and freed blocks are kept in a small per thread cache instead
+ * of going back to the system allocator.  A block may be freed on another
+ * thread than the one that allocated it, it simply ends up in that thread's
+ * cache.  The caches are released when their thread exits, or with
+ * bmem_free_thread_cache for a thread that outlives libobs. */
+
+#define POOL_MIN_SIZE 32
+#define POOL_CLASSES 5
+#define POOL_DEPTH 32
+
+static const bool pooled_tags[BMEM_TAG_COUNT] = {
+	[BMEM_TAG_ENCODER_PACKETS] = true,
+	[BMEM_TAG_DATA] = true,
+	[BMEM_TAG_CALLDATA] = true,
+};
+
+struct pool_cache {
+	void *blocks[POOL_CLASSES][POOL_DEPTH];
+	int num[POOL_CLASSES];
+};
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static bool pool_key_valid = false;
+static THREAD_LOCAL struct pool_cache *thread_pool = NULL;
+static THREAD_LOCAL bool thread_pool_destroyed = false;
+static volatile int64_t pool_cached_bytes = 0;
+
+static inline size_t pool_class_size(int pool_class)
+{
+	return (size_t)POOL_MIN_SIZE << pool_class;
 }
 
+static inline int get_pool_class(size_t size)
+{
+	for (int i = 0; i < POOL_CLASSES; i++) {
+		if (size <= pool_class_size(i))
+			return i;
+	}
+	return -1;
+}
+
+static void pool_cache_destroy(void *data)
+{
+	struct pool_cache *cache = data;
+
+	/* other key destructors (or C++ thread_local destructors) may still
+	 * free memory on this thread, that has to bypass the cache now */
+	thread_pool = NULL;
+	thread_pool_destroyed = true;
+	if (pool_key_valid)
+		pthread_setspecific(pool_key, NULL);
+
+	for (int i = 0; i < POOL_CLASSES; i++) {
+		for (int j = 0; j < cache->num[i]; j++)
+			a_free(cache->blocks[i][j]);
+
+		atomic_add64(&pool_cached_bytes,
+			     -(int64_t)(pool_class_size(i) * cache->num[i]));
+	}
+
+	free(cache);
+}
+
+static void pool_init(void)
+{
+	pool_key_valid = pthread_key_create(&pool_key, pool_cache_destroy) ==
+			 0;
+}
+
+static struct pool_cache *get_pool_cache(void)
+{
+	struct pool_cache *cache = thread_pool;
+	if (cache)
+		return cache;
+	if (thread_pool_destroyed)
+		return NULL;
+
+	pthread_once(&pool_once, pool_init);
+	if (!pool_key_valid)
+		return NULL;
+
+	/* not bmalloc'd, it is not accounted to anything */
+	cache = calloc(1, sizeof(struct pool_cache));
+	if (!cache)
+		return NULL;
+
+	if (pthread_setspecific(pool_key, cache) != 0) {
+		free(cache);
+		return NULL;
+	}
+
+	thread_pool = cache;
+	return cache;
+}
+
+static void *pool_pop(int pool_class)
+{
+	struct pool_cache *cache = get_pool_cache();
+
+	if (!cache || !cache->num[pool_class])
+		return NULL;
+
+	atomic_add64(&pool_cached_bytes, -(int64_t)pool_class_size(pool_class));
+	return cache->blocks[pool_class][--cache->num[pool_class]];
+}
+
+static bool pool_push(int pool_class, void *ptr)
+{
+	struct pool_cache *cache = get_pool_cache();
+
+	if (!cache || cache->num[pool_class] == POOL_DEPTH)
+		return false;
+
+	atomic_add64(&pool_cached_bytes, (int64_t)pool_class_size(pool_class));
+	cache->blocks[pool_class][cache->num[pool_class]++] = ptr;
+	return true;
+}
+
+void bmem_free_thread_cache(void)
+{
+	struct pool_cache *cache = thread_pool;
+
+	if (cache)
+		pool_cache_destroy(cache);
+	else
+		thread_pool_destroyed = true;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static long num_allocs = 0;
 
-void *bmalloc(size_t size)
+void *bmalloc_tagged(enum bmem_tag tag, size_t size)
 {
+	struct bmem_header *header;
+	int pool_class = -1;
+	void *ptr = NULL;
+
+	if ((unsigned)tag >= BMEM_TAG_COUNT)
+		tag = BMEM_TAG_NONE;
+
 	if (!size) {
 		blog(LOG_ERROR,
 		     "bmalloc: Allocating 0 bytes is broken behavior, please "
@@ -108,7 +346,16 @@ void *bmalloc(size_t size)
 		size = 1;
 	}
 
-	void *ptr = a_malloc(size);
+	if (pooled_tags[tag])
+		pool_class = get_pool_class(size);
+
+	if (pool_class != -1) {
+		ptr = pool_pop(pool_class);
+		if (!ptr)
+			ptr = a_malloc(pool_class_size(pool_class));
+	} else {
+		ptr = a_malloc(size);
+	}
 
 	if (!ptr) {
 		os_breakpoint();
@@ -116,14 +363,25 @@ void *bmalloc(size_t size)
 		       (unsigned long)size);
 	}
 
+	header = get_header(ptr);
+	header->size = size;
+	header->tag = (uint8_t)tag;
+	header->pool = (uint8_t)(pool_class + 1);
+
+	account(header->tag, (int64_t)size, 1);
 	os_atomic_inc_long(&num_allocs);
 	return ptr;
 }
 
+void *bmalloc(size_t size)
+{
+	return bmalloc_tagged(BMEM_TAG_NONE, size);
+}
+
 void *brealloc(void *ptr, size_t size)
 {
-	if (!ptr)
-		os_atomic_inc_long(&num_allocs);
+	struct bmem_header *header;
+	size_t old_size;
 
 	if (!size) {
 		blog(LOG_ERROR,
@@ -133,6 +391,28 @@ void *brealloc(void *ptr, size_t size)
 		size = 1;
 	}
 
+	if (!ptr)
+		return bmalloc(size);
+
+	header = get_header(ptr);
+	old_size = header->size;
+
+	if (header->pool) {
+		void *new_ptr;
+
+		if (size <= pool_class_size(header->pool - 1)) {
+			header->size = size;
+			account(header->tag, (int64_t)size - (int64_t)old_size,
+				0);
+			return ptr;
+		}
+
+		new_ptr = bmalloc_tagged((enum bmem_tag)header->tag, size);
+		memcpy(new_ptr, ptr, old_size);
+		bfree(ptr);
+		return new_ptr;
+	}
+
 	ptr = a_realloc(ptr, size);
 
 	if (!ptr) {
@@ -141,15 +421,74 @@ void *brealloc(void *ptr, size_t size)
 		       (unsigned long)size);
 	}
 
+	header = get_header(ptr);
+	header->size = size;
+	account(header->tag, (int64_t)size - (int64_t)old_size, 0);
 	return ptr;
 }
 
 void bfree(void *ptr)
 {
-	if (ptr) {
-		os_atomic_dec_long(&num_allocs);
+	struct bmem_header *header;
+
+	if (!ptr)
+		return;
+
+	header = get_header(ptr);
+	account(header->tag, -(int64_t)header->size, -1);
+	os_atomic_dec_long(&num_allocs);
+
+	if (!header->pool || !pool_push(header->pool - 1, ptr))
 		a_free(ptr);
+}
+
+void bmem_set_tag(void *ptr, enum bmem_tag tag)
+{
+	struct bmem_header *header;
+
+	if (!ptr || (unsigned)tag >= BMEM_TAG_COUNT)
+		return;
+
+	header = get_header(ptr);
+	if (header->tag == tag)
+		return;
+
+	account(header->tag, -(int64_t)header->size, -1);
+	account((uint8_t)tag, (int64_t)header->size, 1);
+	header->tag = (uint8_t)tag;
+}
+
+void bmem_get_tag_stats(enum bmem_tag tag, struct bmem_tag_stats *stats)
+{
+	if (!stats)
+		return;
+
+	if ((unsigned)tag >= BMEM_TAG_COUNT) {
+		memset(stats, 0, sizeof(*stats));
+		return;
 	}
+
+	stats->name = tag_names[tag];
+	stats->live_bytes = (uint64_t)atomic_load64(&tag_stats[tag].live_bytes);
+	stats->peak_bytes = (uint64_t)atomic_load64(&tag_stats[tag].peak_bytes);
+	stats->live_allocs = os_atomic_load_long(&tag_stats[tag].live_allocs);
+}
+
+void bmem_log_stats(void)
+{
+	blog(LOG_INFO, "Memory usage by tag (live / peak):");
+
+	for (int i = 0; i < BMEM_TAG_COUNT; i++) {
+		struct bmem_tag_stats stats;
+		bmem_get_tag_stats((enum bmem_tag)i, &stats);
+
+		blog(LOG_INFO, "\t%-16s %10.2f MB / %10.2f MB, %ld allocations",
+		     stats.name, (double)stats.live_bytes / 1048576.0,
+		     (double)stats.peak_bytes / 1048576.0, stats.live_allocs);
+	}
+
+	blog(LOG_INFO, "\tcached in pools  %10.2f MB",
+	     (double)atomic_load64(&pool_cached_bytes) / 1048576.0);
 }
 
 long bnum_allocs(void)
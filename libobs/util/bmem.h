@@ -37,6 +37,40 @@ EXPORT void *bmalloc(size_t size);
 EXPORT void *brealloc(void *ptr, size_t size);
 EXPORT void bfree(void *ptr);
 
+/* Tags account memory to a subsystem.  brealloc keeps the tag of the memory
+ * it is given.  Allocations up to 512 bytes with the encoder packet, obs_data
+ * or calldata tags come from per thread size class pools. */
+enum bmem_tag {
+	BMEM_TAG_NONE,
+	BMEM_TAG_ASYNC_FRAMES,
+	BMEM_TAG_AUDIO,
+	BMEM_TAG_ENCODER_PACKETS,
+	BMEM_TAG_IMAGES,
+	BMEM_TAG_DATA,
+	BMEM_TAG_CALLDATA,
+	BMEM_TAG_COUNT,
+};
+
+struct bmem_tag_stats {
+	const char *name;
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+	long live_allocs;
+};
+
+EXPORT void *bmalloc_tagged(enum bmem_tag tag, size_t size);
+
+/* moves memory from bmalloc/brealloc to another tag */
+EXPORT void bmem_set_tag(void *ptr, enum bmem_tag tag);
+
+EXPORT void bmem_get_tag_stats(enum bmem_tag tag,
+			       struct bmem_tag_stats *stats);
+EXPORT void bmem_log_stats(void);
+
+/* releases the blocks the calling thread keeps for reuse, anything freed on
+ * it afterwards goes straight back to the system */
+EXPORT void bmem_free_thread_cache(void);
+
 EXPORT int base_get_alignment(void);
 
 EXPORT long bnum_allocs(void);
@@ -51,6 +85,14 @@ static inline void *bzalloc(size_t size)
 	return mem;
 }
 
+static inline void *bzalloc_tagged(enum bmem_tag tag, size_t size)
+{
+	void *mem = bmalloc_tagged(tag, size);
+	if (mem)
+		memset(mem, 0, size);
+	return mem;
+}
+
 static inline char *bstrdup_n(const char *str, size_t n)
 {
 	char *dup;
@@ -14,6 +14,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "buffered-file-serializer.h"
 
 #include <inttypes.h>
@@ -23,6 +27,11 @@
 #include "deque.h"
 #include "dstr.h"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static const size_t DEFAULT_BUF_SIZE = 256ULL * 1048576ULL; // 256 MiB
 static const size_t DEFAULT_CHUNK_SIZE = 1048576;           // 1 MiB
 
@@ -34,6 +43,8 @@ struct io_header {
 	uint64_t data_length;
 };
 
+struct direct_writer;
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -43,11 +54,15 @@ struct io_buffer {
 	pthread_t io_thread;
 	pthread_mutex_t data_mutex;
 	FILE *output_file;
+	struct direct_writer *direct;
 	struct deque data;
 	uint64_t next_pos;
 
 	size_t buffer_size;
 	size_t chunk_size;
+
+	/* protected by data_mutex */
+	struct buffered_file_serializer_stats stats;
 };
 
 struct file_output_data {
@@ -55,6 +70,407 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+static void add_written_stats(struct file_output_data *out, size_t written,
+			      uint64_t write_time_ns)
+{
+	struct buffered_file_serializer_stats *stats = &out->io.stats;
+
+	pthread_mutex_lock(&out->io.data_mutex);
+	stats->written_bytes += written;
+	if (write_time_ns > stats->max_write_time_ns)
+		stats->max_write_time_ns = write_time_ns;
+	pthread_mutex_unlock(&out->io.data_mutex);
+}
+
+static void set_in_flight_stats(struct file_output_data *out, size_t in_flight)
+{
+	pthread_mutex_lock(&out->io.data_mutex);
+	out->io.stats.in_flight_bytes = in_flight;
+	pthread_mutex_unlock(&out->io.data_mutex);
+}
+
+/* ========================================================================== */
+/* Direct I/O writer (Linux)                                                  */
+/*                                                                            */
+/* Appends are collected into one of two large aligned buffers and written    */
+/* with O_DIRECT by a separate thread, so that the next buffer can be filled  */
+/* while the previous one is being written. Only whole blocks are written     */
+/* directly; the trailing partial block is carried over into the next buffer. */
+/* Writes that do not continue the append stream (header patches) are rare    */
+/* and go through a second, regular file descriptor.                          */
+
+#ifdef __linux__
+#define DIRECT_IO_ALIGN 4096
+
+struct direct_writer {
+	struct file_output_data *out;
+
+	int fd;
+	int fd_buffered;
+
+	uint8_t *bufs[2];
+	size_t buf_size;
+
+	int fill;
+	uint64_t fill_start;
+	size_t fill_used;
+
+	pthread_t thread;
+	bool thread_active;
+	os_sem_t *submit_sem;
+	os_sem_t *done_sem;
+	bool in_flight;
+	bool stop;
+
+	int submit_idx;
+	uint64_t submit_offset;
+	size_t submit_size;
+};
+
+static inline uint64_t align_down(uint64_t val)
+{
+	return val & ~((uint64_t)DIRECT_IO_ALIGN - 1);
+}
+
+/* returns 0 on success, the errno of the failed write, or -1 if the write
+ * stopped short without an error */
+static int write_all(int fd, const uint8_t *data, size_t size,
+		     uint64_t offset)
+{
+	while (size) {
+		ssize_t ret = pwrite(fd, data, size, (off_t)offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		if (ret == 0)
+			return -1;
+
+		data += ret;
+		size -= (size_t)ret;
+		offset += (uint64_t)ret;
+	}
+
+	return 0;
+}
+
+static void *direct_write_thread(void *opaque)
+{
+	struct direct_writer *w = opaque;
+	struct file_output_data *out = w->out;
+
+	os_set_thread_name("buffered writer direct i/o thread");
+
+	for (;;) {
+		os_sem_wait(w->submit_sem);
+		if (w->stop)
+			break;
+
+		uint64_t start = os_gettime_ns();
+		int error = write_all(w->fd, w->bufs[w->submit_idx],
+				      w->submit_size, w->submit_offset);
+		uint64_t elapsed = os_gettime_ns() - start;
+		bool success = error == 0;
+
+		if (error > 0) {
+			blog(LOG_ERROR,
+			     "Error writing to '%s' at %" PRIu64 ": %s",
+			     out->filename.array, w->submit_offset,
+			     strerror(error));
+		} else if (error < 0) {
+			blog(LOG_ERROR,
+			     "Short write to '%s' at %" PRIu64
+			     ", nothing could be written",
+			     out->filename.array, w->submit_offset);
+		}
+
+		if (!success)
+			os_atomic_set_bool(&out->io.output_error, true);
+
+		add_written_stats(out, success ? w->submit_size : 0, elapsed);
+		os_sem_post(w->done_sem);
+	}
+
+	return NULL;
+}
+
+static inline void direct_writer_wait(struct direct_writer *w)
+{
+	if (w->in_flight) {
+		os_sem_wait(w->done_sem);
+		w->in_flight = false;
+	}
+}
+
+/* Hands all whole blocks of the fill buffer to the write thread and carries
+ * the partial block over to the other buffer. */
+static void direct_writer_submit(struct direct_writer *w)
+{
+	size_t aligned = (size_t)align_down(w->fill_used);
+	if (!aligned)
+		return;
+
+	direct_writer_wait(w);
+
+	w->submit_idx = w->fill;
+	w->submit_offset = w->fill_start;
+	w->submit_size = aligned;
+	w->in_flight = true;
+	os_sem_post(w->submit_sem);
+
+	int next = w->fill ^ 1;
+	memcpy(w->bufs[next], w->bufs[w->fill] + aligned,
+	       w->fill_used - aligned);
+
+	w->fill = next;
+	w->fill_start += aligned;
+	w->fill_used -= aligned;
+}
+
+/* Writes out everything, with the trailing partial block going through the
+ * regular file descriptor.  Returns the result of write_all for that block,
+ * errors of the write thread are reported by the thread itself. */
+static int direct_writer_flush(struct direct_writer *w)
+{
+	direct_writer_submit(w);
+	direct_writer_wait(w);
+
+	if (!w->fill_used)
+		return 0;
+
+	int error = write_all(w->fd_buffered, w->bufs[w->fill], w->fill_used,
+			      w->fill_start);
+	if (error == 0)
+		add_written_stats(w->out, w->fill_used, 0);
+	return error;
+}
+
+/* Restarts the append stream at an arbitrary offset, reading back the start
+ * of the first block so it can be rewritten in full. */
+static bool direct_writer_restart(struct direct_writer *w, uint64_t offset)
+{
+	if (direct_writer_flush(w) != 0)
+		return false;
+
+	w->fill_start = align_down(offset);
+	w->fill_used = (size_t)(offset - w->fill_start);
+
+	if (w->fill_used) {
+		uint8_t *buf = w->bufs[w->fill];
+		ssize_t ret = pread(w->fd_buffered, buf, w->fill_used,
+				    (off_t)w->fill_start);
+		if (ret < 0)
+			return false;
+
+		memset(buf + ret, 0, w->fill_used - (size_t)ret);
+	}
+
+	return true;
+}
+
+static bool direct_writer_append(struct direct_writer *w, const uint8_t *data,
+				 size_t size)
+{
+	while (size) {
+		size_t space = w->buf_size - w->fill_used;
+		size_t n = size < space ? size : space;
+
+		memcpy(w->bufs[w->fill] + w->fill_used, data, n);
+		w->fill_used += n;
+		data += n;
+		size -= n;
+
+		if (w->fill_used == w->buf_size)
+			direct_writer_submit(w);
+	}
+
+	return !os_atomic_load_bool(&w->out->io.output_error);
+}
+
+static bool direct_writer_write(struct direct_writer *w, const uint8_t *data,
+				size_t size, uint64_t offset)
+{
+	uint64_t append_pos = w->fill_start + w->fill_used;
+	uint64_t end = offset + size;
+
+	if (offset > append_pos) {
+		if (!direct_writer_restart(w, offset))
+			return false;
+		return direct_writer_append(w, data, size);
+	}
+
+	if (offset == append_pos)
+		return direct_writer_append(w, data, size);
+
+	/* Part of the patch that has already been handed off to disk */
+	if (offset < w->fill_start) {
+		uint64_t patch_end = end < w->fill_start ? end : w->fill_start;
+		size_t n = (size_t)(patch_end - offset);
+
+		direct_writer_wait(w);
+		if (write_all(w->fd_buffered, data, n, offset) != 0)
+			return false;
+
+		data += n;
+		size -= n;
+		offset += n;
+	}
+
+	/* Part of the patch that is still in the fill buffer */
+	if (size && offset < append_pos) {
+		uint64_t patch_end = end < append_pos ? end : append_pos;
+		size_t n = (size_t)(patch_end - offset);
+
+		memcpy(w->bufs[w->fill] + (offset - w->fill_start), data, n);
+
+		data += n;
+		size -= n;
+	}
+
+	/* Anything past the end extends the append stream */
+	return size ? direct_writer_append(w, data, size) : true;
+}
+
+static void direct_writer_destroy(struct direct_writer *w)
+{
+	if (!w)
+		return;
+
+	if (w->thread_active) {
+		direct_writer_wait(w);
+		w->stop = true;
+		os_sem_post(w->submit_sem);
+		pthread_join(w->thread, NULL);
+	}
+
+	os_sem_destroy(w->submit_sem);
+	os_sem_destroy(w->done_sem);
+
+	if (w->fd != -1)
+		close(w->fd);
+	if (w->fd_buffered != -1)
+		close(w->fd_buffered);
+
+	free(w->bufs[0]);
+	free(w->bufs[1]);
+	bfree(w);
+}
+
+static struct direct_writer *direct_writer_create(struct file_output_data *out,
+						  const char *path,
+						  size_t buf_size)
+{
+	struct direct_writer *w = bzalloc(sizeof(*w));
+	int error = 0;
+	w->out = out;
+	w->fd_buffered = -1;
+	w->buf_size = (size_t)align_down(buf_size);
+	if (w->buf_size < DIRECT_IO_ALIGN * 2)
+		w->buf_size = DIRECT_IO_ALIGN * 2;
+
+	w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT | O_CLOEXEC,
+		     0644);
+	if (w->fd == -1) {
+		error = errno;
+		goto fail;
+	}
+
+	w->fd_buffered = open(path, O_RDWR | O_CLOEXEC);
+	if (w->fd_buffered == -1) {
+		error = errno;
+		goto fail;
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		void *buf = NULL;
+		/* posix_memalign returns the error instead of setting errno */
+		error = posix_memalign(&buf, DIRECT_IO_ALIGN, w->buf_size);
+		if (error != 0)
+			goto fail;
+		w->bufs[i] = buf;
+	}
+
+	if (os_sem_init(&w->submit_sem, 0) != 0 ||
+	    os_sem_init(&w->done_sem, 0) != 0) {
+		error = errno;
+		goto fail;
+	}
+
+	error = pthread_create(&w->thread, NULL, direct_write_thread, w);
+	w->thread_active = error == 0;
+	if (!w->thread_active)
+		goto fail;
+
+	return w;
+
+fail:
+	blog(LOG_WARNING,
+	     "Unable to use direct I/O for '%s' (%s), "
+	     "using buffered writes instead",
+	     path, strerror(error));
+	direct_writer_destroy(w);
+	return NULL;
+}
+#endif
+
+static bool io_write_chunk(struct file_output_data *out, const uint8_t *chunk,
+			   size_t size, uint64_t offset)
+{
+#ifdef __linux__
+	struct direct_writer *w = out->io.direct;
+	if (w) {
+		bool success = direct_writer_write(w, chunk, size, offset);
+		size_t in_flight = w->in_flight ? w->submit_size : 0;
+
+		set_in_flight_stats(out, w->fill_used + in_flight);
+		return success;
+	}
+#endif
+
+	set_in_flight_stats(out, size);
+
+	uint64_t start = os_gettime_ns();
+	size_t bytes_written = fwrite(chunk, 1, size, out->io.output_file);
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	if (bytes_written != size) {
+		blog(LOG_ERROR, "Error writing to '%s': %s (%zu != %zu)\n",
+		     out->filename.array, strerror(errno), bytes_written, size);
+		set_in_flight_stats(out, 0);
+		return false;
+	}
+
+	set_in_flight_stats(out, 0);
+	add_written_stats(out, size, elapsed);
+
+	UNUSED_PARAMETER(offset);
+	return true;
+}
+
+static void io_close(struct file_output_data *out)
+{
+#ifdef __linux__
+	if (out->io.direct) {
+		int error = direct_writer_flush(out->io.direct);
+		if (error > 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s",
+			     out->filename.array, strerror(error));
+		} else if (error < 0) {
+			blog(LOG_ERROR,
+			     "Short write to '%s', nothing could be written",
+			     out->filename.array);
+		}
+		if (error != 0)
+			os_atomic_set_bool(&out->io.output_error, true);
+		direct_writer_destroy(out->io.direct);
+		out->io.direct = NULL;
+		return;
+	}
+#endif
+
+	fclose(out->io.output_file);
+}
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -82,6 +498,9 @@ static void *io_thread(void *opaque)
 	uint64_t current_seek_position = 0;
 	uint64_t next_seek_position;
 
+	// Actual file offset of the next chunk
+	uint64_t write_position = 0;
+
 	for (;;) {
 		// Wait for data to be written to the buffer
 		os_event_wait(out->io.new_data_available_event);
@@ -171,8 +590,11 @@ static void *io_thread(void *opaque)
 
 			// Seek if we need to
 			if (want_seek) {
-				os_fseeki64(out->io.output_file,
-					    next_seek_position, SEEK_SET);
+				if (out->io.output_file)
+					os_fseeki64(out->io.output_file,
+						    next_seek_position,
+						    SEEK_SET);
+				write_position = next_seek_position;
 
 				// Update the next virtual position, making sure to take
 				// into account the size of the chunk we're about to write.
@@ -190,18 +612,14 @@ static void *io_thread(void *opaque)
 			}
 
 			// Write the current chunk to the output file
-			size_t bytes_written = fwrite(chunk, 1, chunk_used,
-						      out->io.output_file);
-			if (bytes_written != chunk_used) {
-				blog(LOG_ERROR,
-				     "Error writing to '%s': %s (%zu != %zu)\n",
-				     out->filename.array, strerror(errno),
-				     bytes_written, chunk_used);
+			if (!io_write_chunk(out, chunk, chunk_used,
+					    write_position)) {
 				os_atomic_set_bool(&out->io.output_error, true);
 
 				goto error;
 			}
 
+			write_position += chunk_used;
 			chunk_used = 0;
 			force_flush_chunk = false;
 		}
@@ -215,7 +633,7 @@ error:
 	if (chunk)
 		bfree(chunk);
 
-	fclose(out->io.output_file);
+	io_close(out);
 	return NULL;
 }
 
@@ -291,7 +709,15 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 			// No space, wait for the I/O thread to make space
 			os_event_reset(out->io.buffer_space_available_event);
 			pthread_mutex_unlock(&out->io.data_mutex);
+
+			uint64_t stall_start = os_gettime_ns();
 			os_event_wait(out->io.buffer_space_available_event);
+			uint64_t stall_time = os_gettime_ns() - stall_start;
+
+			pthread_mutex_lock(&out->io.data_mutex);
+			out->io.stats.stalls++;
+			out->io.stats.stall_time_ns += stall_time;
+			pthread_mutex_unlock(&out->io.data_mutex);
 			continue;
 		}
 
@@ -319,6 +745,9 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 			next_chunk_size = min(remaining, out->io.chunk_size);
 		}
 
+		if (out->io.data.size > out->io.stats.max_queued_bytes)
+			out->io.stats.max_queued_bytes = out->io.data.size;
+
 		// Tell the I/O thread that there's new data to be written
 		os_event_signal(out->io.new_data_available_event);
 
@@ -346,6 +775,14 @@ bool buffered_file_serializer_init_defaults(struct serializer *s,
 
 bool buffered_file_serializer_init(struct serializer *s, const char *path,
 				   size_t max_bufsize, size_t chunk_size)
+{
+	return buffered_file_serializer_init2(s, path, max_bufsize, chunk_size,
+					      0);
+}
+
+bool buffered_file_serializer_init2(struct serializer *s, const char *path,
+				    size_t max_bufsize, size_t chunk_size,
+				    uint32_t flags)
 {
 	struct file_output_data *out;
 
@@ -353,13 +790,27 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path,
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
-	if (!out->io.output_file)
-		return false;
-
 	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
 	out->io.chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
 
+#ifdef __linux__
+	/* Each direct I/O buffer holds several chunks so that writes reaching
+	 * the disk are large even if the I/O thread flushes small chunks. */
+	if (flags & BUFFERED_FILE_SERIALIZER_DIRECT_IO)
+		out->io.direct = direct_writer_create(out, path,
+						      out->io.chunk_size * 8);
+#else
+	UNUSED_PARAMETER(flags);
+#endif
+
+	if (!out->io.direct) {
+		out->io.output_file = os_fopen(path, "wb");
+		if (!out->io.output_file)
+			return false;
+	}
+
+	out->io.stats.direct_io = out->io.direct != NULL;
+
 	// Start at 1MB, this can grow up to max_bufsize depending
 	// on how fast data is going in and out.
 	deque_reserve(&out->io.data, 1048576);
@@ -382,6 +833,22 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path,
 	return true;
 }
 
+bool buffered_file_serializer_get_stats(
+	struct serializer *s, struct buffered_file_serializer_stats *stats)
+{
+	if (!s || s->write != file_output_write)
+		return false;
+
+	struct file_output_data *out = s->data;
+
+	pthread_mutex_lock(&out->io.data_mutex);
+	*stats = out->io.stats;
+	stats->queued_bytes = out->io.data.size;
+	pthread_mutex_unlock(&out->io.data_mutex);
+
+	return true;
+}
+
 void buffered_file_serializer_free(struct serializer *s)
 {
 	struct file_output_data *out = s->data;
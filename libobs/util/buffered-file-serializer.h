@@ -22,13 +22,39 @@
 extern "C" {
 #endif
 
+enum buffered_file_serializer_flags {
+	/* Bypass the page cache with large aligned writes (Linux only,
+	 * falls back to regular buffered writes if unavailable). */
+	BUFFERED_FILE_SERIALIZER_DIRECT_IO = 1 << 0,
+};
+
+struct buffered_file_serializer_stats {
+	/* Bytes queued by the writer but not yet picked up by the I/O thread */
+	uint64_t queued_bytes;
+	uint64_t max_queued_bytes;
+	/* Bytes picked up by the I/O thread but not yet written to disk */
+	uint64_t in_flight_bytes;
+	uint64_t written_bytes;
+	/* Number of times (and for how long) a write had to wait for space */
+	uint64_t stalls;
+	uint64_t stall_time_ns;
+	uint64_t max_write_time_ns;
+	bool direct_io;
+};
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s,
 						   const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s,
 					  const char *path, size_t max_bufsize,
 					  size_t chunk_size);
+EXPORT bool buffered_file_serializer_init2(struct serializer *s,
+					   const char *path, size_t max_bufsize,
+					   size_t chunk_size, uint32_t flags);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
+EXPORT bool buffered_file_serializer_get_stats(
+	struct serializer *s, struct buffered_file_serializer_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
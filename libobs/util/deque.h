@@ -22,12 +22,17 @@
 #include <assert.h>
 
 #include "bmem.h"
+#include "platform.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Double-ended Queue */
+/* Double-ended Queue
+ *
+ *   A mirrored deque maps its memory twice back to back (see
+ * os_mirrored_alloc), so its contents are always contiguous and reads and
+ * writes never have to be split at the end of the buffer. */
 
 struct deque {
 	void *data;
@@ -36,6 +41,14 @@ struct deque {
 	size_t start_pos;
 	size_t end_pos;
 	size_t capacity;
+
+	bool mirrored;
+};
+
+/* a contiguous part of the deque's memory */
+struct deque_span {
+	void *data;
+	size_t size;
 };
 
 static inline void deque_init(struct deque *dq)
@@ -43,10 +56,25 @@ static inline void deque_init(struct deque *dq)
 	memset(dq, 0, sizeof(struct deque));
 }
 
+/** Initializes a deque that uses mirrored memory if the system supports
+ * it, and regular memory otherwise */
+static inline void deque_init_mirrored(struct deque *dq)
+{
+	memset(dq, 0, sizeof(struct deque));
+	dq->mirrored = true;
+}
+
 static inline void deque_free(struct deque *dq)
 {
-	bfree(dq->data);
+	bool mirrored = dq->mirrored;
+
+	if (mirrored)
+		os_mirrored_free(dq->data, dq->capacity);
+	else
+		bfree(dq->data);
+
 	memset(dq, 0, sizeof(struct deque));
+	dq->mirrored = mirrored;
 }
 
 static inline void deque_reorder_data(struct deque *dq, size_t new_capacity)
@@ -63,6 +91,30 @@ static inline void deque_reorder_data(struct deque *dq, size_t new_capacity)
 	dq->start_pos += difference;
 }
 
+static inline void deque_resize_mirrored(struct deque *dq,
+					  size_t new_capacity)
+{
+	size_t mirrored_capacity = new_capacity;
+	void *data = os_mirrored_alloc(&mirrored_capacity);
+
+	/* not supported, fall back to regular memory for good */
+	if (!data) {
+		data = bmalloc(new_capacity);
+		dq->mirrored = false;
+	} else {
+		new_capacity = mirrored_capacity;
+	}
+
+	if (dq->data) {
+		memcpy(data, dq->data, dq->capacity);
+		os_mirrored_free(dq->data, dq->capacity);
+	}
+
+	dq->data = data;
+	deque_reorder_data(dq, new_capacity);
+	dq->capacity = new_capacity;
+}
+
 static inline void deque_ensure_capacity(struct deque *dq)
 {
 	size_t new_capacity;
@@ -73,6 +125,11 @@ static inline void deque_ensure_capacity(struct deque *dq)
 	if (dq->size > new_capacity)
 		new_capacity = dq->size;
 
+	if (dq->mirrored) {
+		deque_resize_mirrored(dq, new_capacity);
+		return;
+	}
+
 	dq->data = brealloc(dq->data, new_capacity);
 	deque_reorder_data(dq, new_capacity);
 	dq->capacity = new_capacity;
@@ -83,6 +140,11 @@ static inline void deque_reserve(struct deque *dq, size_t capacity)
 	if (capacity <= dq->capacity)
 		return;
 
+	if (dq->mirrored) {
+		deque_resize_mirrored(dq, capacity);
+		return;
+	}
+
 	dq->data = brealloc(dq->data, capacity);
 	deque_reorder_data(dq, capacity);
 	dq->capacity = capacity;
@@ -130,7 +192,7 @@ static inline void deque_place(struct deque *dq, size_t position,
 		position -= dq->capacity;
 
 	data_end_pos = position + size;
-	if (data_end_pos > dq->capacity) {
+	if (data_end_pos > dq->capacity && !dq->mirrored) {
 		size_t back_size = data_end_pos - dq->capacity;
 		size_t loop_size = size - back_size;
 
@@ -149,7 +211,7 @@ static inline void deque_push_back(struct deque *dq, const void *data,
 	dq->size += size;
 	deque_ensure_capacity(dq);
 
-	if (new_end_pos > dq->capacity) {
+	if (new_end_pos > dq->capacity && !dq->mirrored) {
 		size_t back_size = dq->capacity - dq->end_pos;
 		size_t loop_size = size - back_size;
 
@@ -157,12 +219,13 @@ static inline void deque_push_back(struct deque *dq, const void *data,
 			memcpy((uint8_t *)dq->data + dq->end_pos, data,
 			       back_size);
 		memcpy(dq->data, (uint8_t *)data + back_size, loop_size);
-
-		new_end_pos -= dq->capacity;
 	} else {
 		memcpy((uint8_t *)dq->data + dq->end_pos, data, size);
 	}
 
+	if (new_end_pos > dq->capacity)
+		new_end_pos -= dq->capacity;
+
 	dq->end_pos = new_end_pos;
 }
 
@@ -246,7 +309,7 @@ static inline void deque_peek_front(struct deque *dq, void *data, size_t size)
 	if (data) {
 		size_t start_size = dq->capacity - dq->start_pos;
 
-		if (start_size < size) {
+		if (start_size < size && !dq->mirrored) {
 			memcpy(data, (uint8_t *)dq->data + dq->start_pos,
 			       start_size);
 			memcpy((uint8_t *)data + start_size, dq->data,
@@ -257,6 +320,40 @@ static inline void deque_peek_front(struct deque *dq, void *data, size_t size)
 	}
 }
 
+/** Gets the front of the deque without copying it.  Returns the number of
+ * spans (up to two) that are needed to cover size bytes, which is never more
+ * than one for mirrored deques.  The spans are valid until the deque is
+ * modified. */
+static inline size_t deque_peek_span(struct deque *dq, size_t size,
+				     struct deque_span spans[2])
+{
+	size_t start_size;
+
+	assert(size <= dq->size);
+
+	spans[1].data = NULL;
+	spans[1].size = 0;
+
+	if (!size) {
+		spans[0].data = NULL;
+		spans[0].size = 0;
+		return 0;
+	}
+
+	start_size = dq->capacity - dq->start_pos;
+	spans[0].data = (uint8_t *)dq->data + dq->start_pos;
+
+	if (start_size >= size || dq->mirrored) {
+		spans[0].size = size;
+		return 1;
+	}
+
+	spans[0].size = start_size;
+	spans[1].data = dq->data;
+	spans[1].size = size - start_size;
+	return 2;
+}
+
 static inline void deque_peek_back(struct deque *dq, void *data, size_t size)
 {
 	assert(size <= dq->size);
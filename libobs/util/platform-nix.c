@@ -35,6 +35,8 @@
 #include <glob.h>
 #include <time.h>
 #include <signal.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <uuid/uuid.h>
 
 #if !defined(__APPLE__)
@@ -1158,3 +1160,69 @@ char *os_generate_uuid(void)
 	uuid_unparse_lower(uuid, out);
 	return out;
 }
+
+#if (defined(__linux__) && defined(MFD_CLOEXEC)) || defined(__FreeBSD__)
+static inline int create_mirror_fd(void)
+{
+#if defined(__linux__)
+	return memfd_create("obs-mirrored", MFD_CLOEXEC);
+#else
+	return shm_open(SHM_ANON, O_RDWR | O_CLOEXEC, 0600);
+#endif
+}
+
+void *os_mirrored_alloc(size_t *size)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t alloc_size = (*size + page_size - 1) & ~(page_size - 1);
+	uint8_t *ptr = MAP_FAILED;
+	int fd;
+
+	if (!alloc_size)
+		alloc_size = page_size;
+
+	fd = create_mirror_fd();
+	if (fd == -1)
+		return NULL;
+	if (ftruncate(fd, (off_t)alloc_size) != 0)
+		goto fail;
+
+	ptr = mmap(NULL, alloc_size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+		   -1, 0);
+	if (ptr == MAP_FAILED)
+		goto fail;
+
+	if (mmap(ptr, alloc_size, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+	    mmap(ptr + alloc_size, alloc_size, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(ptr, alloc_size * 2);
+		ptr = MAP_FAILED;
+		goto fail;
+	}
+
+	*size = alloc_size;
+
+fail:
+	close(fd);
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void os_mirrored_free(void *ptr, size_t size)
+{
+	if (ptr)
+		munmap(ptr, size * 2);
+}
+#else
+void *os_mirrored_alloc(size_t *size)
+{
+	UNUSED_PARAMETER(size);
+	return NULL;
+}
+
+void os_mirrored_free(void *ptr, size_t size)
+{
+	UNUSED_PARAMETER(ptr);
+	UNUSED_PARAMETER(size);
+}
+#endif
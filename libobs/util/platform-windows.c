@@ -1492,3 +1492,107 @@ char *os_generate_uuid(void)
 
 	return uuid_str.array;
 }
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+typedef PVOID(WINAPI *virtual_alloc2_t)(HANDLE, PVOID, SIZE_T, ULONG, ULONG,
+					void *, ULONG);
+typedef PVOID(WINAPI *map_view_of_file3_t)(HANDLE, HANDLE, PVOID, ULONG64,
+					   SIZE_T, ULONG, ULONG, void *, ULONG);
+
+static virtual_alloc2_t virtual_alloc2 = NULL;
+static map_view_of_file3_t map_view_of_file3 = NULL;
+static bool mirrored_funcs_loaded = false;
+
+/* placeholders are only available on Windows 10 1803 and newer */
+static bool load_mirrored_funcs(void)
+{
+	if (!mirrored_funcs_loaded) {
+		HMODULE kernelbase = GetModuleHandleW(L"kernelbase");
+		if (kernelbase) {
+			virtual_alloc2 = (virtual_alloc2_t)GetProcAddress(
+				kernelbase, "VirtualAlloc2");
+			map_view_of_file3 = (map_view_of_file3_t)GetProcAddress(
+				kernelbase, "MapViewOfFile3");
+		}
+		mirrored_funcs_loaded = true;
+	}
+
+	return virtual_alloc2 && map_view_of_file3;
+}
+
+void *os_mirrored_alloc(size_t *size)
+{
+	SYSTEM_INFO info;
+	size_t granularity;
+	size_t alloc_size;
+	uint8_t *placeholder;
+	void *view1 = NULL;
+	void *view2 = NULL;
+	HANDLE section;
+
+	if (!load_mirrored_funcs())
+		return NULL;
+
+	GetSystemInfo(&info);
+	granularity = info.dwAllocationGranularity;
+	alloc_size = (*size + granularity - 1) & ~(granularity - 1);
+	if (!alloc_size)
+		alloc_size = granularity;
+
+	section = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+				     (DWORD)((uint64_t)alloc_size >> 32),
+				     (DWORD)alloc_size, NULL);
+	if (!section)
+		return NULL;
+
+	placeholder = virtual_alloc2(NULL, NULL, alloc_size * 2,
+				     MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+				     PAGE_NOACCESS, NULL, 0);
+	if (!placeholder)
+		goto fail;
+
+	/* split the placeholder in two, one for each view */
+	VirtualFree(placeholder, alloc_size,
+		    MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+
+	view1 = map_view_of_file3(section, GetCurrentProcess(), placeholder, 0,
+				  alloc_size, MEM_REPLACE_PLACEHOLDER,
+				  PAGE_READWRITE, NULL, 0);
+	if (!view1) {
+		VirtualFree(placeholder, 0, MEM_RELEASE);
+		VirtualFree(placeholder + alloc_size, 0, MEM_RELEASE);
+		goto fail;
+	}
+
+	view2 = map_view_of_file3(section, GetCurrentProcess(),
+				  placeholder + alloc_size, 0, alloc_size,
+				  MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, NULL,
+				  0);
+	if (!view2) {
+		UnmapViewOfFile(view1);
+		VirtualFree(placeholder + alloc_size, 0, MEM_RELEASE);
+		view1 = NULL;
+		goto fail;
+	}
+
+	*size = alloc_size;
+
+fail:
+	/* the views keep the section alive */
+	CloseHandle(section);
+	return view1;
+}
+
+void os_mirrored_free(void *ptr, size_t size)
+{
+	if (!ptr)
+		return;
+
+	UnmapViewOfFile(ptr);
+	UnmapViewOfFile((uint8_t *)ptr + size);
+}
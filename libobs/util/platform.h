@@ -205,6 +205,13 @@ EXPORT uint64_t os_get_proc_virtual_size(void);
 
 EXPORT char *os_generate_uuid(void);
 
+/* Allocates memory that is mapped twice back to back, so that accessing past
+ * the end of the memory wraps around to its start.  *size is rounded up to
+ * the granularity of the system, the mapping spans twice that size.  Returns
+ * NULL if the system does not support it. */
+EXPORT void *os_mirrored_alloc(size_t *size);
+EXPORT void os_mirrored_free(void *ptr, size_t size);
+
 /* clang-format off */
 #ifdef __APPLE__
 # define ARCH_BITS 64
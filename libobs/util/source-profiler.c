@@ -69,6 +69,15 @@ struct profiler_entry {
 	struct ucirclebuf async_frame_ts;
 	/* Timestamps of last N async frames rendered */
 	struct ucirclebuf async_rendered_ts;
+	/* Decode times of last N async frames */
+	struct ucirclebuf async_decode;
+	/* Time the last N displayed async frames spent queued */
+	struct ucirclebuf async_queued;
+	/* Times outputting an async frame waited for the graphics thread */
+	volatile long async_contended;
+	/* Times a scene skipped drawing the source */
+	volatile long culled_occluded;
+	volatile long culled_offscreen;
 
 	UT_hash_handle hh;
 };
@@ -174,6 +183,8 @@ static struct profiler_entry *entry_create(const uintptr_t key)
 	ucirclebuf_init(&ent->render_gpu_sum, profiler_samples);
 	ucirclebuf_init(&ent->async_frame_ts, profiler_samples);
 	ucirclebuf_init(&ent->async_rendered_ts, profiler_samples);
+	ucirclebuf_init(&ent->async_decode, profiler_samples);
+	ucirclebuf_init(&ent->async_queued, profiler_samples);
 	return ent;
 }
 
@@ -186,6 +197,8 @@ static void entry_destroy(struct profiler_entry *entry)
 	ucirclebuf_free(&entry->render_gpu_sum);
 	ucirclebuf_free(&entry->async_frame_ts);
 	ucirclebuf_free(&entry->async_rendered_ts);
+	ucirclebuf_free(&entry->async_decode);
+	ucirclebuf_free(&entry->async_queued);
 	bfree(entry);
 }
 
@@ -413,6 +426,71 @@ void source_profiler_async_frame_received(obs_source_t *source)
 	pthread_rwlock_unlock(&hm_rwlock);
 }
 
+void source_profiler_async_frame_decoded(obs_source_t *source,
+					 uint64_t decode_ns)
+{
+	if (!enabled)
+		return;
+
+	pthread_rwlock_wrlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		ucirclebuf_push(&ent->async_decode, decode_ns);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
+void source_profiler_async_frame_dequeued(obs_source_t *source,
+					  uint64_t queued_ts)
+{
+	if (!enabled)
+		return;
+
+	uint64_t delta = os_gettime_ns() - queued_ts;
+
+	pthread_rwlock_wrlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		ucirclebuf_push(&ent->async_queued, delta);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
+void source_profiler_async_lock_contended(obs_source_t *source)
+{
+	if (!enabled)
+		return;
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		os_atomic_inc_long(&ent->async_contended);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
+void source_profiler_source_culled(obs_source_t *source, bool occluded)
+{
+	if (!enabled)
+		return;
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		os_atomic_inc_long(occluded ? &ent->culled_occluded
+					    : &ent->culled_offscreen);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
 uint64_t source_profiler_source_tick_start(void)
 {
 	if (!enabled)
@@ -565,6 +643,24 @@ static inline void calculate_render(struct profiler_entry *ent,
 	}
 }
 
+static inline void calculate_avg_max(const struct ucirclebuf *buf,
+				     uint64_t *avg, uint64_t *max)
+{
+	size_t idx = 0;
+	uint64_t sum = 0;
+
+	for (; idx < buf->num; idx++) {
+		const uint64_t delta = buf->array[idx];
+		if (delta > *max)
+			*max = delta;
+
+		sum += delta;
+	}
+
+	if (idx)
+		*avg = sum / idx;
+}
+
 static inline void calculate_fps(const struct ucirclebuf *frames, double *avg,
 				 uint64_t *best, uint64_t *worst)
 {
@@ -616,6 +712,11 @@ bool source_profiler_fill_result(obs_source_t *source,
 		calculate_tick(ent, result);
 		calculate_render(ent, result);
 
+		result->culled_occluded =
+			(uint64_t)os_atomic_load_long(&ent->culled_occluded);
+		result->culled_offscreen =
+			(uint64_t)os_atomic_load_long(&ent->culled_offscreen);
+
 		if (is_async_video_source(source)) {
 			calculate_fps(&ent->async_frame_ts,
 				      &result->async_input,
@@ -625,6 +726,14 @@ bool source_profiler_fill_result(obs_source_t *source,
 				      &result->async_rendered,
 				      &result->async_rendered_best,
 				      &result->async_rendered_worst);
+			calculate_avg_max(&ent->async_decode,
+					  &result->async_decode_avg,
+					  &result->async_decode_max);
+			calculate_avg_max(&ent->async_queued,
+					  &result->async_queued_avg,
+					  &result->async_queued_max);
+			result->async_contended = (uint64_t)os_atomic_load_long(
+				&ent->async_contended);
 		}
 	}
 
@@ -49,6 +49,24 @@ typedef struct profiler_result {
 	uint64_t async_input_worst;
 	uint64_t async_rendered_best;
 	uint64_t async_rendered_worst;
+
+	/* Average and max time the source spent decoding an async frame in ns
+	 * (only for sources that report it) */
+	uint64_t async_decode_avg;
+	uint64_t async_decode_max;
+
+	/* Average and max time displayed async frames spent queued in ns */
+	uint64_t async_queued_avg;
+	uint64_t async_queued_max;
+	/* Number of times outputting an async frame had to wait for the
+	 * graphics thread since profiling was enabled */
+	uint64_t async_contended;
+
+	/* Number of times a scene skipped drawing the source since profiling
+	 * was enabled, because opaque items above it covered it or because
+	 * it was outside of the scene */
+	uint64_t culled_occluded;
+	uint64_t culled_offscreen;
 } profiler_result_t;
 
 /* Enable/disable profiler (applied on next frame) */
@@ -56,6 +74,10 @@ EXPORT void source_profiler_enable(bool enable);
 /* Enable/disable GPU profiling (applied on next frame) */
 EXPORT void source_profiler_gpu_enable(bool enable);
 
+/* Report how long decoding an async frame took, called by the source */
+EXPORT void source_profiler_async_frame_decoded(obs_source_t *source,
+						uint64_t decode_ns);
+
 /* Get latest profiling results for source (must be freed by user) */
 EXPORT profiler_result_t *source_profiler_get_result(obs_source_t *source);
 /* Update existing profiler results object for source */
@@ -60,6 +60,8 @@ target_sources(
           obs-ffmpeg-source.c
           obs-ffmpeg-compat.h
           obs-ffmpeg-formats.h
+          replay-spill.c
+          replay-spill.h
           ${CMAKE_BINARY_DIR}/config/obs-ffmpeg-config.h)
 
 target_include_directories(obs-ffmpeg PRIVATE ${CMAKE_BINARY_DIR}/config)
@@ -23,6 +23,7 @@
 #endif
 
 #include <libavformat/avformat.h>
+#include <inttypes.h>
 
 #define do_log(level, format, ...)                  \
 	blog(level, "[ffmpeg muxer: '%s'] " format, \
@@ -45,12 +46,31 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 }
 #endif
 
+static inline void replay_packet_release(struct replay_spill *spill,
+					 struct encoder_packet *pkt)
+{
+	/* packets stored in the spill file hold no reference */
+	if (replay_spill_contains(spill, pkt->data))
+		memset(pkt, 0, sizeof(*pkt));
+	else
+		obs_encoder_packet_release(pkt);
+}
+
+static void replay_buffer_pop_front(struct ffmpeg_muxer *stream,
+				    struct encoder_packet *pkt)
+{
+	deque_pop_front(&stream->packets, pkt, sizeof(*pkt));
+
+	if (replay_spill_contains(stream->spill, pkt->data))
+		replay_spill_pop(stream->spill, pkt);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
-		deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
-		obs_encoder_packet_release(&pkt);
+		replay_buffer_pop_front(stream, &pkt);
+		replay_packet_release(stream->spill, &pkt);
 	}
 
 	deque_free(&stream->packets);
@@ -59,6 +79,8 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	stream->max_size = 0;
 	stream->max_time = 0;
 	stream->save_ts = 0;
+	stream->save_start_ts = 0;
+	stream->save_end_ts = 0;
 	stream->keyframes = 0;
 }
 
@@ -70,10 +92,14 @@ static void ffmpeg_mux_destroy(void *data)
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
 	for (size_t i = 0; i < stream->mux_packets.num; i++)
-		obs_encoder_packet_release(&stream->mux_packets.array[i]);
+		replay_packet_release(stream->mux_spill,
+				      &stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
 
+	replay_spill_destroy(stream->spill);
+	replay_spill_destroy(stream->retired_spill);
+
 	os_process_pipe_destroy(stream->pipe);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
@@ -990,6 +1016,8 @@ static void replay_buffer_hotkey(void *data, obs_hotkey_id id,
 			return;
 		}
 
+		stream->save_start_ts = 0;
+		stream->save_end_ts = 0;
 		stream->save_ts = os_gettime_ns() / 1000LL;
 	}
 }
@@ -1000,6 +1028,39 @@ static void save_replay_proc(void *data, calldata_t *cd)
 	UNUSED_PARAMETER(cd);
 }
 
+/* Saves the buffered packets between two system timestamps (microseconds,
+ * same clock as os_gettime_ns).  The saved file starts at the last video
+ * keyframe at or before start_usec.  If end_usec lies in the future, the save
+ * is performed once the buffer reaches it. */
+static void save_replay_range_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	int64_t start_ts = (int64_t)calldata_int(cd, "start_usec");
+	int64_t end_ts = (int64_t)calldata_int(cd, "end_usec");
+	int64_t now = (int64_t)(os_gettime_ns() / 1000LL);
+
+	if (!os_atomic_load_bool(&stream->active))
+		return;
+
+	if (!end_ts || end_ts > now + stream->max_time)
+		end_ts = now;
+	if (start_ts >= end_ts) {
+		warn("Invalid replay range [%" PRId64 ", %" PRId64 "]",
+		     start_ts, end_ts);
+		return;
+	}
+
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	if (obs_encoder_paused(vencoder)) {
+		info("Could not save buffer because encoders paused");
+		return;
+	}
+
+	stream->save_start_ts = start_ts;
+	stream->save_end_ts = end_ts;
+	stream->save_ts = end_ts;
+}
+
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -1020,6 +1081,9 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void save()", save_replay_proc, stream);
+	proc_handler_add(ph,
+			 "void save_range(in int start_usec, in int end_usec)",
+			 save_replay_range_proc, stream);
 	proc_handler_add(ph, "void get_last_replay(out string path)",
 			 get_last_replay, stream);
 
@@ -1037,6 +1101,60 @@ static void replay_buffer_destroy(void *data)
 	ffmpeg_mux_destroy(data);
 }
 
+static void replay_buffer_join_mux_thread(struct ffmpeg_muxer *stream)
+{
+	if (stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
+
+	stream->mux_spill = NULL;
+	replay_spill_destroy(stream->retired_spill);
+	stream->retired_spill = NULL;
+}
+
+static void replay_buffer_open_spill(struct ffmpeg_muxer *stream,
+				     obs_data_t *s)
+{
+	/* a save still in progress may be reading from the previous spill
+	 * file, in which case it is kept until the mux thread is joined */
+	if (stream->spill) {
+		if (stream->mux_thread_joinable &&
+		    stream->spill == stream->mux_spill) {
+			replay_spill_destroy(stream->retired_spill);
+			stream->retired_spill = stream->spill;
+		} else {
+			replay_spill_destroy(stream->spill);
+		}
+		stream->spill = NULL;
+	}
+
+	if (!obs_data_get_bool(s, "spill_to_disk"))
+		return;
+
+	/* the ring needs headroom for the packets that arrive while a save is
+	 * reading from it, so default to twice the buffer size */
+	int64_t size = obs_data_get_int(s, "spill_size_mb") * (1024 * 1024);
+	if (!size)
+		size = stream->max_size * 2;
+	if (!size) {
+		warn("Replay buffer spill file requires a maximum size, "
+		     "keeping packets in memory");
+		return;
+	}
+
+	const char *dir = obs_data_get_string(s, "spill_directory");
+	if (!dir || !*dir)
+		dir = obs_data_get_string(s, "directory");
+
+	stream->spill = replay_spill_create(dir, (size_t)size);
+	if (stream->spill)
+		info("Buffering packets in a %" PRId64 " MB spill file in '%s'",
+		     size / (1024 * 1024), dir);
+	else
+		warn("Failed to create spill file, keeping packets in memory");
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -1049,6 +1167,7 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	replay_buffer_open_spill(stream, s);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1067,7 +1186,7 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 	if (!stream->packets.size)
 		return false;
 
-	deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
+	replay_buffer_pop_front(stream, &pkt);
 
 	keyframe = pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe;
 
@@ -1084,7 +1203,7 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 		stream->cur_size -= (int64_t)pkt.size;
 	}
 
-	obs_encoder_packet_release(&pkt);
+	replay_packet_release(stream->spill, &pkt);
 	return keyframe;
 }
 
@@ -1125,13 +1244,17 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 }
 
 static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
-			  int64_t video_offset, int64_t *audio_offsets,
-			  int64_t video_pts_offset, int64_t *audio_dts_offsets)
+			  struct replay_spill *spill, int64_t video_offset,
+			  int64_t *audio_offsets, int64_t video_pts_offset,
+			  int64_t *audio_dts_offsets)
 {
 	struct encoder_packet pkt;
 	size_t idx;
 
-	obs_encoder_packet_ref(&pkt, packet);
+	if (replay_spill_contains(spill, packet->data))
+		pkt = *packet;
+	else
+		obs_encoder_packet_ref(&pkt, packet);
 
 	if (pkt.type == OBS_ENCODER_VIDEO) {
 		pkt.dts_usec -= video_offset;
@@ -1180,7 +1303,7 @@ static void *replay_buffer_mux_thread(void *data)
 			error = true;
 			goto error;
 		}
-		obs_encoder_packet_release(pkt);
+		replay_packet_release(stream->mux_spill, pkt);
 	}
 
 	info("Wrote replay buffer to '%s'", stream->path.array);
@@ -1190,8 +1313,8 @@ error:
 	stream->pipe = NULL;
 	if (error) {
 		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(
-				&stream->mux_packets.array[i]);
+			replay_packet_release(stream->mux_spill,
+					      &stream->mux_packets.array[i]);
 	}
 	da_free(stream->mux_packets);
 	os_atomic_set_bool(&stream->muxing, false);
@@ -1206,12 +1329,42 @@ error:
 	return NULL;
 }
 
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
+static size_t find_range_start(struct ffmpeg_muxer *stream, size_t num_packets,
+			       int64_t start_ts)
+{
+	const size_t size = sizeof(struct encoder_packet);
+	size_t start = 0;
+
+	for (size_t i = 0; i < num_packets; i++) {
+		struct encoder_packet *pkt;
+		pkt = deque_data(&stream->packets, i * size);
+
+		if (pkt->sys_dts_usec > start_ts)
+			break;
+		if (pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe)
+			start = i;
+	}
+
+	return start;
+}
+
+static void replay_buffer_save(struct ffmpeg_muxer *stream, int64_t start_ts,
+			       int64_t end_ts)
 {
 	const size_t size = sizeof(struct encoder_packet);
 	size_t num_packets = stream->packets.size / size;
+	size_t first = 0;
+
+	if (start_ts)
+		first = find_range_start(stream, num_packets, start_ts);
+
+	da_reserve(stream->mux_packets, num_packets - first);
 
-	da_reserve(stream->mux_packets, num_packets);
+	/* the mux thread reads spilled packets straight from the mapping, so
+	 * keep purged space from being reused until it's done */
+	if (stream->spill)
+		replay_spill_pin(stream->spill);
+	stream->mux_spill = stream->spill;
 
 	/* ---------------------------- */
 	/* reorder packets */
@@ -1223,10 +1376,13 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
 	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
 
-	for (size_t i = 0; i < num_packets; i++) {
+	for (size_t i = first; i < num_packets; i++) {
 		struct encoder_packet *pkt;
 		pkt = deque_data(&stream->packets, i * size);
 
+		if (end_ts && pkt->sys_dts_usec > end_ts)
+			continue;
+
 		if (pkt->type == OBS_ENCODER_VIDEO) {
 			if (!found_video) {
 				video_pts_offset = pkt->pts;
@@ -1242,8 +1398,8 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 			}
 		}
 
-		insert_packet(&stream->mux_packets, pkt, video_offset,
-			      audio_offsets, video_pts_offset,
+		insert_packet(&stream->mux_packets, pkt, stream->spill,
+			      video_offset, audio_offsets, video_pts_offset,
 			      audio_dts_offsets);
 	}
 
@@ -1294,6 +1450,10 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
+	if (stream->spill && replay_spill_pinned(stream->spill) &&
+	    !os_atomic_load_bool(&stream->muxing))
+		replay_spill_unpin(stream->spill);
+
 	obs_encoder_packet_ref(&pkt, packet);
 	replay_buffer_purge(stream, &pkt);
 
@@ -1301,22 +1461,24 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+	/* if the ring is full the packet simply stays in memory */
+	if (stream->spill)
+		replay_spill_push(stream->spill, &pkt);
+
+	deque_push_back(&stream->packets, &pkt, sizeof(pkt));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+	if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
 		stream->keyframes++;
 
-	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
+	if (stream->save_ts && pkt.sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
 			return;
 
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
+		replay_buffer_join_mux_thread(stream);
 
 		stream->save_ts = 0;
-		replay_buffer_save(stream);
+		replay_buffer_save(stream, stream->save_start_ts,
+				   stream->save_end_ts);
 	}
 }
 
@@ -1327,6 +1489,9 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "spill_to_disk", false);
+	obs_data_set_default_int(s, "spill_size_mb", 0);
+	obs_data_set_default_string(s, "spill_directory", "");
 }
 
 struct obs_output_info replay_buffer = {
@@ -9,6 +9,8 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "replay-spill.h"
+
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
 struct ffmpeg_muxer {
@@ -33,11 +35,18 @@ struct ffmpeg_muxer {
 
 	/* replay buffer */
 	int64_t save_ts;
+	int64_t save_start_ts;
+	int64_t save_end_ts;
 	int keyframes;
 	obs_hotkey_id hotkey;
 	volatile bool muxing;
 	mux_packets_t mux_packets;
 
+	/* replay buffer spill file */
+	struct replay_spill *spill;
+	struct replay_spill *mux_spill;
+	struct replay_spill *retired_spill;
+
 	/* split file */
 	bool found_video;
 	bool found_audio[MAX_AUDIO_MIXES];
@@ -18,6 +18,7 @@
 #include <util/threading.h>
 #include <util/platform.h>
 #include <util/dstr.h>
+#include <util/source-profiler.h>
 
 #include "obs-ffmpeg-compat.h"
 #include "obs-ffmpeg-formats.h"
@@ -44,6 +45,10 @@ struct ffmpeg_source {
 	char *ffmpeg_options;
 	int buffering_mb;
 	int speed_percent;
+	enum mp_thread_type thread_type;
+	int decode_threads;
+	int preroll_frames;
+	bool preroll;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
@@ -129,6 +134,8 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "reconnect_delay_sec", 10);
 	obs_data_set_default_int(settings, "buffering_mb", 2);
 	obs_data_set_default_int(settings, "speed_percent", 100);
+	obs_data_set_default_int(settings, "thread_type", MP_THREAD_AUTO);
+	obs_data_set_default_int(settings, "decode_threads", 0);
 	obs_data_set_default_bool(settings, "log_changes", true);
 }
 
@@ -205,6 +212,26 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 	obs_properties_add_bool(props, "hw_decode",
 				obs_module_text("HardwareDecode"));
 
+	prop = obs_properties_add_list(props, "thread_type",
+				       obs_module_text("DecodeThreadType"),
+				       OBS_COMBO_TYPE_LIST,
+				       OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(prop,
+				  obs_module_text("DecodeThreadType.Auto"),
+				  MP_THREAD_AUTO);
+	obs_property_list_add_int(prop,
+				  obs_module_text("DecodeThreadType.Frame"),
+				  MP_THREAD_FRAME);
+	obs_property_list_add_int(prop,
+				  obs_module_text("DecodeThreadType.Slice"),
+				  MP_THREAD_SLICE);
+
+	prop = obs_properties_add_int_slider(props, "decode_threads",
+					     obs_module_text("DecodeThreads"),
+					     0, 16, 1);
+	obs_property_set_long_description(
+		prop, obs_module_text("DecodeThreads.ToolTip"));
+
 	obs_properties_add_bool(props, "clear_on_media_end",
 				obs_module_text("ClearOnMediaEnd"));
 
@@ -262,6 +289,8 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\trestart_on_activate:     %s\n"
 		"\tclose_when_inactive:     %s\n"
 		"\tfull_decode:             %s\n"
+		"\tdecode_threads:          %d\n"
+		"\tpreroll_frames:          %d\n"
 		"\tffmpeg_options:          %s",
 		input ? input : "(null)",
 		input_format ? input_format : "(null)", s->speed_percent,
@@ -270,7 +299,8 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		s->is_clear_on_media_end ? "yes" : "no",
 		s->restart_on_activate ? "yes" : "no",
 		s->close_when_inactive ? "yes" : "no",
-		s->full_decode ? "yes" : "no", s->ffmpeg_options);
+		s->full_decode ? "yes" : "no", s->decode_threads,
+		s->preroll_frames, s->ffmpeg_options);
 }
 
 static void get_frame(void *opaque, struct obs_source_frame *f)
@@ -279,6 +309,12 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void frame_decoded(void *opaque, uint64_t decode_ns)
+{
+	struct ffmpeg_source *s = opaque;
+	source_profiler_async_frame_decoded(s->source, decode_ns);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -333,6 +369,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.v_seek_cb = seek_frame,
 			.a_cb = get_audio,
 			.stop_cb = media_stopped,
+			.decode_time_cb = frame_decoded,
 			.path = s->input,
 			.format = s->input_format,
 			.buffering = s->buffering_mb * 1024 * 1024,
@@ -345,9 +382,14 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.reconnecting = s->reconnecting,
 			.request_preload = s->is_stinger,
 			.full_decode = s->full_decode,
+			.thread_type = s->thread_type,
+			.decode_threads = s->decode_threads,
+			.preroll_frames = s->preroll_frames,
 		};
 
 		s->media = media_playback_create(&info);
+		if (s->media && s->preroll)
+			media_playback_set_preroll(s->media, true);
 	}
 }
 
@@ -446,6 +488,9 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	enum video_range_type range;
 	bool is_linear_alpha;
 	int speed_percent;
+	enum mp_thread_type thread_type;
+	int decode_threads;
+	int preroll_frames;
 	bool is_looping;
 
 	bfree(s->input_format);
@@ -477,10 +522,17 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	if (speed_percent < 1 || speed_percent > 200)
 		speed_percent = 100;
 	ffmpeg_options = obs_data_get_string(settings, "ffmpeg_options");
+	thread_type = (enum mp_thread_type)obs_data_get_int(settings,
+							    "thread_type");
+	decode_threads = (int)obs_data_get_int(settings, "decode_threads");
+	preroll_frames = (int)obs_data_get_int(settings, "preroll_frames");
 
 	/* Restart media source if these properties are changed */
 	if (s->is_hw_decoding != is_hw_decoding || s->range != range ||
 	    s->speed_percent != speed_percent ||
+	    s->thread_type != thread_type ||
+	    s->decode_threads != decode_threads ||
+	    s->preroll_frames != preroll_frames ||
 	    (s->ffmpeg_options &&
 	     strcmp(s->ffmpeg_options, ffmpeg_options) != 0))
 		should_restart_media = true;
@@ -514,6 +566,9 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	s->is_linear_alpha = is_linear_alpha;
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
 	s->speed_percent = speed_percent;
+	s->thread_type = thread_type;
+	s->decode_threads = decode_threads;
+	s->preroll_frames = preroll_frames;
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
 	s->ffmpeg_options = ffmpeg_options ? bstrdup(ffmpeg_options) : NULL;
@@ -577,6 +632,20 @@ static void preload_first_frame_proc(void *data, calldata_t *cd)
 	UNUSED_PARAMETER(cd);
 }
 
+static void set_preroll_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_source *s = data;
+	s->preroll = calldata_bool(cd, "enabled");
+	media_playback_set_preroll(s->media, s->preroll);
+}
+
+static void get_preroll_ready(void *data, calldata_t *cd)
+{
+	struct ffmpeg_source *s = data;
+	bool ready = media_playback_preroll_ready(s->media);
+	calldata_set_bool(cd, "ready", ready);
+}
+
 static void get_duration(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
@@ -684,6 +753,10 @@ static void *ffmpeg_source_create(obs_data_t *settings, obs_source_t *source)
 	proc_handler_add(ph, "void restart()", restart_proc, s);
 	proc_handler_add(ph, "void preload_first_frame()",
 			 preload_first_frame_proc, s);
+	proc_handler_add(ph, "void set_preroll(in bool enabled)",
+			 set_preroll_proc, s);
+	proc_handler_add(ph, "void get_preroll_ready(out bool ready)",
+			 get_preroll_ready, s);
 	proc_handler_add(ph, "void get_duration(out int duration)",
 			 get_duration, s);
 	proc_handler_add(ph, "void get_nb_frames(out int num_frames)",
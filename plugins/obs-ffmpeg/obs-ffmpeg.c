@@ -3,6 +3,7 @@
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <media-playback/clip-cache.h>
 
 #ifdef _WIN32
 #define INITGUID
@@ -425,6 +426,9 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+	/* every media source is gone by now */
+	mp_clip_cache_free();
+
 #if ENABLE_FFMPEG_LOGGING
 	obs_ffmpeg_unload_logging();
 #endif
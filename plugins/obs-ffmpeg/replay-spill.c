@@ -0,0 +1,237 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "replay-spill.h"
+
+#include <util/dstr.h>
+#include <util/platform.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct replay_spill {
+	uint8_t *data;
+	size_t size;
+
+	size_t head;
+	size_t tail;
+	size_t used;
+
+	bool pinned;
+	size_t pinned_freed;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+static void make_spill_path(struct dstr *path, const char *dir)
+{
+	char *uuid = os_generate_uuid();
+
+	dstr_copy(path, dir && *dir ? dir : ".");
+	dstr_replace(path, "\\", "/");
+	if (dstr_end(path) != '/')
+		dstr_cat_ch(path, '/');
+	os_mkdirs(path->array);
+
+	dstr_catf(path, ".obs-replay-%s.spill", uuid);
+	bfree(uuid);
+}
+
+#ifdef _WIN32
+static bool map_spill_file(struct replay_spill *spill, const char *path)
+{
+	wchar_t *wpath = NULL;
+	LARGE_INTEGER size;
+
+	os_utf8_to_wcs_ptr(path, 0, &wpath);
+	if (!wpath)
+		return false;
+
+	spill->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				  CREATE_NEW, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	bfree(wpath);
+	if (spill->file == INVALID_HANDLE_VALUE) {
+		spill->file = NULL;
+		return false;
+	}
+
+	size.QuadPart = (LONGLONG)spill->size;
+	spill->mapping = CreateFileMappingW(spill->file, NULL, PAGE_READWRITE,
+					    size.HighPart, size.LowPart, NULL);
+	if (!spill->mapping)
+		return false;
+
+	spill->data = MapViewOfFile(spill->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				    spill->size);
+	return spill->data != NULL;
+}
+
+static void unmap_spill_file(struct replay_spill *spill)
+{
+	if (spill->data)
+		UnmapViewOfFile(spill->data);
+	if (spill->mapping)
+		CloseHandle(spill->mapping);
+	if (spill->file)
+		CloseHandle(spill->file);
+}
+#else
+static bool map_spill_file(struct replay_spill *spill, const char *path)
+{
+	void *data;
+	int ret;
+
+	spill->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (spill->fd == -1)
+		return false;
+
+	/* the file only needs to live as long as the mapping */
+	unlink(path);
+
+#ifdef __linux__
+	ret = posix_fallocate(spill->fd, 0, (off_t)spill->size);
+	if (ret != 0)
+		ret = ftruncate(spill->fd, (off_t)spill->size);
+#else
+	ret = ftruncate(spill->fd, (off_t)spill->size);
+#endif
+	if (ret != 0)
+		return false;
+
+	data = mmap(NULL, spill->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    spill->fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	spill->data = data;
+	return true;
+}
+
+static void unmap_spill_file(struct replay_spill *spill)
+{
+	if (spill->data)
+		munmap(spill->data, spill->size);
+	if (spill->fd != -1)
+		close(spill->fd);
+}
+#endif
+
+struct replay_spill *replay_spill_create(const char *dir, size_t size)
+{
+	struct replay_spill *spill = bzalloc(sizeof(*spill));
+	struct dstr path = {0};
+
+#ifndef _WIN32
+	spill->fd = -1;
+#endif
+	spill->size = size;
+
+	make_spill_path(&path, dir);
+
+	if (!map_spill_file(spill, path.array)) {
+		blog(LOG_WARNING, "[replay spill] Failed to map spill file '%s'",
+		     path.array);
+		dstr_free(&path);
+		replay_spill_destroy(spill);
+		return NULL;
+	}
+
+	dstr_free(&path);
+	return spill;
+}
+
+void replay_spill_destroy(struct replay_spill *spill)
+{
+	if (!spill)
+		return;
+
+	unmap_spill_file(spill);
+	bfree(spill);
+}
+
+bool replay_spill_push(struct replay_spill *spill, struct encoder_packet *pkt)
+{
+	size_t offset = spill->head;
+	size_t pad = 0;
+
+	if (pkt->size > spill->size - offset) {
+		pad = spill->size - offset;
+		offset = 0;
+	}
+
+	/* strictly less than, so a full ring never looks empty */
+	if (spill->used + pad + pkt->size >= spill->size)
+		return false;
+
+	struct encoder_packet mapped = *pkt;
+	mapped.data = spill->data + offset;
+	memcpy(mapped.data, pkt->data, pkt->size);
+
+	obs_encoder_packet_release(pkt);
+	*pkt = mapped;
+
+	spill->used += pad + pkt->size;
+	spill->head = (offset + pkt->size) % spill->size;
+	return true;
+}
+
+void replay_spill_pop(struct replay_spill *spill,
+		      const struct encoder_packet *pkt)
+{
+	size_t end = (size_t)(pkt->data - spill->data) + pkt->size;
+	size_t freed = (end + spill->size - spill->tail) % spill->size;
+
+	spill->tail = end % spill->size;
+
+	if (spill->pinned)
+		spill->pinned_freed += freed;
+	else
+		spill->used -= freed;
+}
+
+void replay_spill_pin(struct replay_spill *spill)
+{
+	spill->pinned = true;
+}
+
+void replay_spill_unpin(struct replay_spill *spill)
+{
+	spill->pinned = false;
+	spill->used -= spill->pinned_freed;
+	spill->pinned_freed = 0;
+}
+
+bool replay_spill_pinned(const struct replay_spill *spill)
+{
+	return spill->pinned;
+}
+
+bool replay_spill_contains(const struct replay_spill *spill, const void *data)
+{
+	const uint8_t *ptr = data;
+	return spill && ptr >= spill->data && ptr < spill->data + spill->size;
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Replay buffer spill file
+ *
+ *   A preallocated file on disk that is mapped into memory and used as a
+ * circular buffer for encoded packet data.  Packets are always stored
+ * contiguously (the remainder at the end of the file is skipped when a packet
+ * would wrap), so the packet data pointer can be handed to the muxer as-is.
+ *
+ *   The packet headers themselves stay in the replay buffer deque, which acts
+ * as the DTS/keyframe index of the ring.  Purging the front of the buffer only
+ * advances the tail of the ring.  While a save is in progress the ring is
+ * pinned: space released by purging is not reused until the save completes,
+ * so the mux thread can read straight from the mapping without a copy.
+ *
+ *   All functions except replay_spill_contains must be called from the
+ * thread that owns the replay buffer (the output's packet thread).
+ */
+
+struct replay_spill;
+
+/* Creates a spill file of the given size in the given directory.  The file is
+ * removed automatically once the spill is destroyed. */
+struct replay_spill *replay_spill_create(const char *dir, size_t size);
+void replay_spill_destroy(struct replay_spill *spill);
+
+/* Copies the packet data into the ring and points the packet at the mapped
+ * copy.  Returns false if the ring has no room, in which case the packet is
+ * left untouched and should be kept in memory instead. */
+bool replay_spill_push(struct replay_spill *spill, struct encoder_packet *pkt);
+
+/* Releases the oldest mapped packet.  Must be called in push order. */
+void replay_spill_pop(struct replay_spill *spill,
+		      const struct encoder_packet *pkt);
+
+void replay_spill_pin(struct replay_spill *spill);
+void replay_spill_unpin(struct replay_spill *spill);
+bool replay_spill_pinned(const struct replay_spill *spill);
+
+bool replay_spill_contains(const struct replay_spill *spill, const void *data);
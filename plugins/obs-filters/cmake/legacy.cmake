@@ -55,6 +55,8 @@ else()
         rnnoise/src/rnn_reader.c
         rnnoise/src/rnn.c
         rnnoise/src/rnn.h
+        rnnoise/src/rnn_simd.c
+        rnnoise/src/rnn_simd.h
         rnnoise/src/tansig_table.h
         rnnoise/src/_kiss_fft_guts.h
         rnnoise/include/rnnoise.h)
@@ -115,6 +117,8 @@ target_sources(
           gpu-delay.c
           hdr-tonemap-filter.c
           crop-filter.c
+          dynamics.c
+          dynamics.h
           scale-filter.c
           scroll-filter.c
           chroma-key-filter.c
@@ -29,6 +29,8 @@ if(ENABLE_RNNOISE)
           rnnoise/src/rnn_data.c
           rnnoise/src/rnn_data.h
           rnnoise/src/rnn_reader.c
+          rnnoise/src/rnn_simd.c
+          rnnoise/src/rnn_simd.h
           rnnoise/src/tansig_table.h
         PUBLIC rnnoise/include/rnnoise.h
       )
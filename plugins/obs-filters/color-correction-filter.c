@@ -638,6 +638,47 @@ static void color_correction_filter_render_v2(void *data, gs_effect_t *effect)
 	}
 }
 
+/*
+ * The same math as PSColorFilterRGBA in color_correction_filter.effect, as a
+ * stage that libobs can draw in one pass with the filters next to this one.
+ */
+static const char *color_correction_stage = "\
+uniform float $gamma;\n\
+uniform float4x4 $color_matrix;\n\
+\n\
+float4 $apply(float4 rgba)\n\
+{\n\
+	rgba.rgb *= (rgba.a > 0.) ? (1. / rgba.a) : 0.;\n\
+	rgba.rgb = pow(rgba.rgb, float3($gamma, $gamma, $gamma));\n\
+	rgba = mul($color_matrix, rgba);\n\
+	rgba.rgb *= rgba.a;\n\
+	return rgba;\n\
+}\n";
+
+static bool color_correction_filter_get_stage(void *data,
+					      struct obs_filter_stage *stage)
+{
+	UNUSED_PARAMETER(data);
+
+	stage->shader = color_correction_stage;
+	stage->premultiplied = true;
+	return true;
+}
+
+static void color_correction_filter_set_stage_params(void *data,
+						     gs_effect_t *effect,
+						     const char *prefix)
+{
+	struct color_correction_filter_data_v2 *filter = data;
+
+	gs_effect_set_float(obs_filter_stage_get_param(effect, prefix,
+						       SETTING_GAMMA),
+			    filter->gamma);
+	gs_effect_set_matrix4(obs_filter_stage_get_param(effect, prefix,
+							 "color_matrix"),
+			      &filter->final_matrix);
+}
+
 /*
  * This function sets the interface. the types (add_*_Slider), the type of
  * data collected (int), the internal name, user-facing name, minimum,
@@ -783,4 +824,6 @@ struct obs_source_info color_filter_v2 = {
 	.get_properties = color_correction_filter_properties_v2,
 	.get_defaults = color_correction_filter_defaults_v2,
 	.video_get_color_space = color_correction_filter_get_color_space,
+	.filter_get_stage = color_correction_filter_get_stage,
+	.filter_set_stage_params = color_correction_filter_set_stage_params,
 };
@@ -507,6 +507,136 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 	}
 }
 
+/*
+ * The 3D LUT techniques of color_grade_filter.effect as stages that libobs
+ * can draw in one pass with the filters next to this one.  1D LUTs are
+ * always drawn by the filter itself.
+ */
+#define CLUT_STAGE_COMMON \
+	"\
+uniform texture3d $clut_3d;\n\
+uniform float $clut_amount;\n\
+uniform float3 $clut_scale;\n\
+uniform float3 $clut_offset;\n\
+uniform float3 $domain_min;\n\
+uniform float3 $domain_max;\n\
+\n\
+sampler_state $sampler {\n\
+	Filter    = Linear;\n\
+	AddressU  = Clamp;\n\
+	AddressV  = Clamp;\n\
+	AddressW  = Clamp;\n\
+};\n\
+\n\
+float $to_nonlinear_channel(float u)\n\
+{\n\
+	return (u <= 0.0031308) ? (12.92 * u)\n\
+				: ((1.055 * pow(u, 1.0 / 2.4)) - 0.055);\n\
+}\n\
+\n\
+float3 $to_nonlinear(float3 v)\n\
+{\n\
+	return float3($to_nonlinear_channel(v.r),\n\
+		      $to_nonlinear_channel(v.g),\n\
+		      $to_nonlinear_channel(v.b));\n\
+}\n\
+\n\
+float3 $lookup(float3 rgb)\n\
+{\n\
+	float3 nonlinear = $to_nonlinear(rgb);\n\
+	float3 clut_uvw = nonlinear * $clut_scale + $clut_offset;\n\
+	return $clut_3d.Sample($sampler, clut_uvw).rgb;\n\
+}\n\
+\n"
+
+static const char *clut_stage_3d = CLUT_STAGE_COMMON "\
+float4 $apply(float4 rgba)\n\
+{\n\
+	rgba.rgb = $lookup(rgba.rgb);\n\
+	return rgba;\n\
+}\n";
+
+static const char *clut_stage_alpha_3d = CLUT_STAGE_COMMON "\
+float4 $apply(float4 rgba)\n\
+{\n\
+	rgba.rgb *= (rgba.a > 0.) ? (1. / rgba.a) : 0.;\n\
+	rgba.rgb = $lookup(rgba.rgb);\n\
+	rgba.rgb *= rgba.a;\n\
+	return rgba;\n\
+}\n";
+
+static const char *clut_stage_amount_3d = CLUT_STAGE_COMMON "\
+float4 $apply(float4 rgba)\n\
+{\n\
+	rgba.rgb *= (rgba.a > 0.) ? (1. / rgba.a) : 0.;\n\
+	rgba.rgb = lerp(rgba.rgb, $lookup(rgba.rgb), $clut_amount);\n\
+	rgba.rgb *= rgba.a;\n\
+	return rgba;\n\
+}\n";
+
+static const char *clut_stage_domain_3d = CLUT_STAGE_COMMON "\
+float4 $apply(float4 rgba)\n\
+{\n\
+	rgba.rgb *= (rgba.a > 0.) ? (1. / rgba.a) : 0.;\n\
+	float3 nl = $to_nonlinear(rgba.rgb);\n\
+	if (nl.r >= $domain_min.r && nl.r <= $domain_max.r &&\n\
+	    nl.g >= $domain_min.g && nl.g <= $domain_max.g &&\n\
+	    nl.b >= $domain_min.b && nl.b <= $domain_max.b)\n\
+		rgba.rgb = lerp(rgba.rgb, $lookup(rgba.rgb), $clut_amount);\n\
+	rgba.rgb *= rgba.a;\n\
+	return rgba;\n\
+}\n";
+
+static bool color_grade_filter_get_stage(void *data,
+					 struct obs_filter_stage *stage)
+{
+	struct lut_filter_data *filter = data;
+	const char *tech_name = filter->tech_name;
+
+	if (!filter->target || !filter->effect)
+		return false;
+
+	if (strcmp(tech_name, "Draw3D") == 0)
+		stage->shader = clut_stage_3d;
+	else if (strcmp(tech_name, "DrawAlpha3D") == 0)
+		stage->shader = clut_stage_alpha_3d;
+	else if (strcmp(tech_name, "DrawAmount3D") == 0)
+		stage->shader = clut_stage_amount_3d;
+	else if (strcmp(tech_name, "DrawDomain3D") == 0)
+		stage->shader = clut_stage_domain_3d;
+	else
+		return false;
+
+	stage->premultiplied = true;
+	return true;
+}
+
+static void color_grade_filter_set_stage_params(void *data,
+						gs_effect_t *effect,
+						const char *prefix)
+{
+	struct lut_filter_data *filter = data;
+	gs_eparam_t *param;
+
+	param = obs_filter_stage_get_param(effect, prefix, "clut_3d");
+	gs_effect_set_texture_srgb(param, filter->target);
+
+	param = obs_filter_stage_get_param(effect, prefix, "clut_amount");
+	gs_effect_set_float(param, filter->clut_amount);
+
+	param = obs_filter_stage_get_param(effect, prefix, "clut_scale");
+	gs_effect_set_vec3(param, &filter->clut_scale);
+
+	param = obs_filter_stage_get_param(effect, prefix, "clut_offset");
+	gs_effect_set_vec3(param, &filter->clut_offset);
+
+	param = obs_filter_stage_get_param(effect, prefix, "domain_min");
+	gs_effect_set_vec3(param, &filter->domain_min);
+
+	param = obs_filter_stage_get_param(effect, prefix, "domain_max");
+	gs_effect_set_vec3(param, &filter->domain_max);
+}
+
 static enum gs_color_space
 color_grade_filter_get_color_space(void *data, size_t count,
 				   const enum gs_color_space *preferred_spaces)
@@ -540,4 +670,6 @@ struct obs_source_info color_grade_filter = {
 	.get_properties = color_grade_filter_properties,
 	.video_render = color_grade_filter_render,
 	.video_get_color_space = color_grade_filter_get_color_space,
+	.filter_get_stage = color_grade_filter_get_stage,
+	.filter_set_stage_params = color_grade_filter_set_stage_params,
 };
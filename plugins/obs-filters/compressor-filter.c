@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...)                \
@@ -63,6 +65,7 @@
 struct compressor_data {
 	obs_source_t *context;
 	float *envelope_buf;
+	float *gain_buf;
 	size_t envelope_buf_len;
 
 	float ratio;
@@ -96,38 +99,11 @@ static inline obs_source_t *get_sidechain(struct compressor_data *cd)
 	return NULL;
 }
 
-static inline void get_sidechain_data(struct compressor_data *cd,
-				      const uint32_t num_samples)
-{
-	size_t data_size = cd->envelope_buf_len * sizeof(float);
-	if (!data_size)
-		return;
-
-	pthread_mutex_lock(&cd->sidechain_mutex);
-	if (cd->max_sidechain_frames < num_samples)
-		cd->max_sidechain_frames = num_samples;
-
-	if (cd->sidechain_data[0].size < data_size) {
-		pthread_mutex_unlock(&cd->sidechain_mutex);
-		goto clear;
-	}
-
-	for (size_t i = 0; i < cd->num_channels; i++)
-		deque_pop_front(&cd->sidechain_data[i], cd->sidechain_buf[i],
-				data_size);
-
-	pthread_mutex_unlock(&cd->sidechain_mutex);
-	return;
-
-clear:
-	for (size_t i = 0; i < cd->num_channels; i++)
-		memset(cd->sidechain_buf[i], 0, data_size);
-}
-
 static void resize_env_buffer(struct compressor_data *cd, size_t len)
 {
 	cd->envelope_buf_len = len;
 	cd->envelope_buf = brealloc(cd->envelope_buf, len * sizeof(float));
+	cd->gain_buf = brealloc(cd->gain_buf, len * sizeof(float));
 
 	for (size_t i = 0; i < cd->num_channels; i++)
 		cd->sidechain_buf[i] =
@@ -266,6 +242,10 @@ static void *compressor_create(obs_data_t *settings, obs_source_t *filter)
 	struct compressor_data *cd = bzalloc(sizeof(struct compressor_data));
 	cd->context = filter;
 
+	/* mirrored so that sidechain audio can be analyzed in place */
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		deque_init_mirrored(&cd->sidechain_data[i]);
+
 	if (pthread_mutex_init(&cd->sidechain_mutex, NULL) != 0) {
 		blog(LOG_ERROR, "Failed to create mutex");
 		bfree(cd);
@@ -307,6 +287,7 @@ static void compressor_destroy(void *data)
 
 	bfree(cd->sidechain_name);
 	bfree(cd->envelope_buf);
+	bfree(cd->gain_buf);
 	bfree(cd);
 }
 
@@ -317,27 +298,24 @@ static void analyze_envelope(struct compressor_data *cd, float **samples,
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+	dyn_peak_envelope(cd->envelope_buf, samples, cd->num_channels,
+			  num_samples, &cd->envelope, cd->attack_gain,
+			  cd->release_gain);
+}
+
+/* Returns the sidechain audio of a channel, pointing into the deque unless
+ * it wraps around the end of the buffer */
+static inline float *peek_sidechain(struct compressor_data *cd, size_t channel,
+				    size_t size)
+{
+	struct deque *buf = &cd->sidechain_data[channel];
+	struct deque_span spans[2];
+
+	if (deque_peek_span(buf, size, spans) == 1)
+		return spans[0].data;
+
+	deque_peek_front(buf, cd->sidechain_buf[channel], size);
+	return cd->sidechain_buf[channel];
 }
 
 static void analyze_sidechain(struct compressor_data *cd,
@@ -347,47 +325,44 @@ static void analyze_sidechain(struct compressor_data *cd,
 		resize_env_buffer(cd, num_samples);
 	}
 
-	get_sidechain_data(cd, num_samples);
+	size_t data_size = cd->envelope_buf_len * sizeof(float);
+
+	pthread_mutex_lock(&cd->sidechain_mutex);
+	if (cd->max_sidechain_frames < num_samples)
+		cd->max_sidechain_frames = num_samples;
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-	float **sidechain_buf = cd->sidechain_buf;
+	/* the sidechain audio is analyzed while the lock is held, the capture
+	 * callback could otherwise move it */
+	if (cd->sidechain_data[0].size >= data_size) {
+		float *sidechain[MAX_AUDIO_CHANNELS];
 
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!sidechain_buf[chan])
-			continue;
+		for (size_t i = 0; i < cd->num_channels; i++)
+			sidechain[i] = peek_sidechain(cd, i, data_size);
 
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(sidechain_buf[chan][i]);
+		analyze_envelope(cd, sidechain, num_samples);
 
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
+		for (size_t i = 0; i < cd->num_channels; i++)
+			deque_pop_front(&cd->sidechain_data[i], NULL,
+					data_size);
+
+		pthread_mutex_unlock(&cd->sidechain_mutex);
+		return;
 	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+
+	pthread_mutex_unlock(&cd->sidechain_mutex);
+
+	for (size_t i = 0; i < cd->num_channels; i++)
+		memset(cd->sidechain_buf[i], 0, data_size);
+
+	analyze_envelope(cd, cd->sidechain_buf, num_samples);
 }
 
 static inline void process_compression(const struct compressor_data *cd,
 				       float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
-	}
+	dyn_compressor_gain(cd->gain_buf, cd->envelope_buf, num_samples,
+			    cd->threshold, cd->slope, cd->output_gain);
+	dyn_apply_gain(samples, cd->num_channels, cd->gain_buf, num_samples);
 }
 
 static void compressor_tick(void *data, float seconds)
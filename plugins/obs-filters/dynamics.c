@@ -0,0 +1,449 @@
+#include <math.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+#include <util/sse-intrin.h>
+#include <media-io/audio-io.h>
+
+#include "dynamics.h"
+
+/* -------------------------------------------------------- */
+
+#define DB_PER_LOG2 6.0205999f   /* 20 * log10(2) */
+#define LOG2_PER_DB 0.16609640f  /* log2(10) / 20 */
+#define MIN_LEVEL 1e-30f         /* about -600 dB */
+#define MAX_EXP2 126.0f
+
+#define abs_ps(v) _mm_andnot_ps(_mm_set1_ps(-0.f), v)
+
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then
+ * log2(m) = 2 / ln(2) * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172 */
+static inline __m128 log2_ps(__m128 x)
+{
+	const __m128i mant_mask = _mm_set1_epi32(0x007fffff);
+	const __m128i one_bits = _mm_set1_epi32(0x3f800000);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	x = _mm_max_ps(x, _mm_set1_ps(MIN_LEVEL));
+
+	__m128i bits = _mm_castps_si128(x);
+	__m128i exp_i = _mm_sub_epi32(_mm_srli_epi32(bits, 23),
+				      _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(
+		_mm_or_si128(_mm_and_si128(bits, mant_mask), one_bits));
+	__m128 e = _mm_cvtepi32_ps(exp_i);
+
+	__m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = select_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+	e = _mm_add_ps(e, _mm_and_ps(big, one));
+
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_set1_ps(2.0f / 7.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.0f / 5.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.0f / 3.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.0f));
+	p = _mm_mul_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.44269504f));
+
+	return _mm_add_ps(e, p);
+}
+
+/* 2^x = 2^n * 2^f with n = round(x) and f in [-0.5, 0.5] */
+static inline __m128 exp2_ps(__m128 x)
+{
+	x = _mm_min_ps(x, _mm_set1_ps(MAX_EXP2));
+	x = _mm_max_ps(x, _mm_set1_ps(-MAX_EXP2));
+
+	__m128i n = _mm_cvtps_epi32(x);
+	__m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+
+	/* Taylor series of e^(f * ln(2)) */
+	__m128 p = _mm_set1_ps(1.5403530e-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.3333558e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	__m128i scale = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)),
+				       23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 mul_to_db_ps(__m128 x)
+{
+	return _mm_mul_ps(log2_ps(x), _mm_set1_ps(DB_PER_LOG2));
+}
+
+static inline __m128 db_to_mul_ps(__m128 x)
+{
+	return exp2_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2_PER_DB)));
+}
+
+/* Loads the last n % 4 values padded with the last value, so that the tail
+ * goes through the same math as the rest of the block */
+static inline __m128 load_tail(const float *src, size_t count)
+{
+	float tmp[4];
+
+	for (size_t i = 0; i < 4; i++)
+		tmp[i] = src[i < count ? i : count - 1];
+
+	return _mm_loadu_ps(tmp);
+}
+
+static inline void store_tail(float *dst, __m128 v, size_t count)
+{
+	float tmp[4];
+
+	_mm_storeu_ps(tmp, v);
+	memcpy(dst, tmp, count * sizeof(float));
+}
+
+#define BLOCK_LOOP(dst, src, n, expr)                                   \
+	do {                                                            \
+		size_t i_ = 0;                                          \
+		for (; i_ + 4 <= (n); i_ += 4) {                        \
+			__m128 v = _mm_loadu_ps((src) + i_);            \
+			_mm_storeu_ps((dst) + i_, expr);                \
+		}                                                       \
+		if (i_ < (n)) {                                         \
+			__m128 v = load_tail((src) + i_, (n) - i_);     \
+			store_tail((dst) + i_, expr, (n) - i_);         \
+		}                                                       \
+	} while (false)
+
+void dyn_mul_to_db(float *dst, const float *src, size_t n)
+{
+	BLOCK_LOOP(dst, src, n, mul_to_db_ps(v));
+}
+
+void dyn_db_to_mul(float *dst, const float *src, size_t n)
+{
+	BLOCK_LOOP(dst, src, n, db_to_mul_ps(v));
+}
+
+static inline __m128 compressor_gain_ps(__m128 env, __m128 thr, __m128 slp,
+					__m128 out)
+{
+	__m128 gain = _mm_mul_ps(slp, _mm_sub_ps(thr, mul_to_db_ps(env)));
+	gain = _mm_min_ps(_mm_setzero_ps(), gain);
+	return _mm_mul_ps(db_to_mul_ps(gain), out);
+}
+
+void dyn_compressor_gain(float *dst, const float *env, size_t n,
+			 float threshold, float slope, float output_gain)
+{
+	const __m128 thr = _mm_set1_ps(threshold);
+	const __m128 slp = _mm_set1_ps(slope);
+	const __m128 out = _mm_set1_ps(output_gain);
+
+	BLOCK_LOOP(dst, env, n, compressor_gain_ps(v, thr, slp, out));
+}
+
+static inline __m128 expander_gain_db_ps(__m128 env, __m128 thr, __m128 slp)
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 diff = _mm_sub_ps(thr, mul_to_db_ps(env));
+	__m128 gain = _mm_max_ps(_mm_mul_ps(slp, diff), _mm_set1_ps(-60.0f));
+
+	return _mm_and_ps(_mm_cmpgt_ps(diff, zero), gain);
+}
+
+void dyn_expander_gain_db(float *dst, const float *env, size_t n,
+			  float threshold, float slope)
+{
+	const __m128 thr = _mm_set1_ps(threshold);
+	const __m128 slp = _mm_set1_ps(slope);
+
+	BLOCK_LOOP(dst, env, n, expander_gain_db_ps(v, thr, slp));
+}
+
+/* The later conditions take precedence, as in the scalar version the
+ * upward compressor was written as */
+static inline __m128 upward_gain_db_ps(__m128 env, __m128 thr, __m128 slp,
+				       __m128 knee)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 floor_db = _mm_set1_ps(60.0f);
+	__m128 env_db = mul_to_db_ps(env);
+	__m128 diff = _mm_sub_ps(thr, env_db);
+	__m128 half_knee = _mm_mul_ps(knee, half);
+	__m128 knee_lo = _mm_sub_ps(thr, half_knee);
+	__m128 knee_hi = _mm_add_ps(thr, half_knee);
+
+	__m128 quiet = _mm_cmple_ps(
+		env_db, _mm_mul_ps(_mm_sub_ps(thr, floor_db), half));
+	diff = select_ps(quiet, _mm_max_ps(_mm_add_ps(env_db, floor_db), zero),
+			 diff);
+
+	__m128 below = _mm_cmple_ps(env_db, knee_lo);
+	__m128 in_knee = _mm_and_ps(_mm_cmpgt_ps(env_db, knee_lo),
+				    _mm_cmplt_ps(env_db, knee_hi));
+
+	__m128 knee_diff = _mm_add_ps(diff, half_knee);
+	__m128 knee_gain = _mm_div_ps(
+		_mm_mul_ps(slp, _mm_mul_ps(knee_diff, knee_diff)),
+		_mm_add_ps(knee, knee));
+
+	__m128 gain = _mm_and_ps(below, _mm_mul_ps(slp, diff));
+	return select_ps(in_knee, knee_gain, gain);
+}
+
+void dyn_upward_gain_db(float *dst, const float *env, size_t n,
+			float threshold, float slope, float knee)
+{
+	const __m128 thr = _mm_set1_ps(threshold);
+	const __m128 slp = _mm_set1_ps(slope);
+	const __m128 knee_v = _mm_set1_ps(knee);
+
+	BLOCK_LOOP(dst, env, n, upward_gain_db_ps(v, thr, slp, knee_v));
+}
+
+/* -------------------------------------------------------- */
+
+static size_t get_channels(const float **dst, float *const *samples,
+			   size_t channels)
+{
+	size_t count = 0;
+
+	for (size_t c = 0; c < channels; c++) {
+		if (samples[c])
+			dst[count++] = samples[c];
+	}
+
+	return count;
+}
+
+void dyn_peak_level(float *dst, float *const *samples, size_t channels,
+		    size_t n)
+{
+	const float *ch[MAX_AUDIO_CHANNELS];
+	size_t count = get_channels(ch, samples, channels);
+
+	if (!count) {
+		memset(dst, 0, n * sizeof(float));
+		return;
+	}
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 peak = abs_ps(_mm_loadu_ps(ch[0] + i));
+		for (size_t c = 1; c < count; c++)
+			peak = _mm_max_ps(peak,
+					  abs_ps(_mm_loadu_ps(ch[c] + i)));
+		_mm_storeu_ps(dst + i, peak);
+	}
+	for (; i < n; i++) {
+		float peak = fabsf(ch[0][i]);
+		for (size_t c = 1; c < count; c++)
+			peak = fmaxf(peak, fabsf(ch[c][i]));
+		dst[i] = peak;
+	}
+}
+
+void dyn_apply_gain(float *const *samples, size_t channels, const float *gain,
+		    size_t n)
+{
+	for (size_t c = 0; c < channels; c++) {
+		float *data = samples[c];
+		size_t i = 0;
+
+		if (!data)
+			continue;
+
+		for (; i + 4 <= n; i += 4) {
+			__m128 v = _mm_loadu_ps(data + i);
+			v = _mm_mul_ps(v, _mm_loadu_ps(gain + i));
+			_mm_storeu_ps(data + i, v);
+		}
+		for (; i < n; i++)
+			data[i] *= gain[i];
+	}
+}
+
+/* -------------------------------------------------------- */
+
+/* Loads four samples of four channels so that each vector holds one sample
+ * of every channel */
+static inline void load_transposed(__m128 v[4], const float *const ch[4],
+				   size_t i)
+{
+	v[0] = _mm_loadu_ps(ch[0] + i);
+	v[1] = _mm_loadu_ps(ch[1] + i);
+	v[2] = _mm_loadu_ps(ch[2] + i);
+	v[3] = _mm_loadu_ps(ch[3] + i);
+	_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+}
+
+/* Fills unused lanes with the first channel of the group, duplicated
+ * channels do not change the maximum */
+static inline size_t get_group(const float *group[4], const float **ch,
+			       size_t count, size_t first)
+{
+	size_t lanes = count - first < 4 ? count - first : 4;
+
+	for (size_t l = 0; l < 4; l++)
+		group[l] = ch[first + (l < lanes ? l : 0)];
+	return lanes;
+}
+
+static inline float follow(float env, float in, float attack_gain,
+			   float release_gain)
+{
+	float coef = env < in ? attack_gain : release_gain;
+	return in + coef * (env - in);
+}
+
+static void peak_envelope_group(float *dst, const float *const ch[4],
+				size_t n, float env0, bool first_group,
+				float attack_gain, float release_gain)
+{
+	const __m128 atk = _mm_set1_ps(attack_gain);
+	const __m128 rls = _mm_set1_ps(release_gain);
+	__m128 env = _mm_set1_ps(env0);
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4) {
+		__m128 v[4];
+		load_transposed(v, ch, i);
+
+		for (size_t k = 0; k < 4; k++) {
+			__m128 in = abs_ps(v[k]);
+			__m128 coef =
+				select_ps(_mm_cmplt_ps(env, in), atk, rls);
+			env = _mm_add_ps(in, _mm_mul_ps(coef,
+							_mm_sub_ps(env, in)));
+			v[k] = env;
+		}
+
+		/* back to one vector per channel, then the max of all of
+		 * them is the max per sample */
+		_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+		__m128 peak = _mm_max_ps(_mm_max_ps(v[0], v[1]),
+					 _mm_max_ps(v[2], v[3]));
+		if (!first_group)
+			peak = _mm_max_ps(peak, _mm_loadu_ps(dst + i));
+		_mm_storeu_ps(dst + i, peak);
+	}
+
+	if (i < n) {
+		float lane_env[4];
+		_mm_storeu_ps(lane_env, env);
+
+		for (; i < n; i++) {
+			float peak = first_group ? 0.0f : dst[i];
+
+			for (size_t l = 0; l < 4; l++) {
+				lane_env[l] = follow(lane_env[l],
+						     fabsf(ch[l][i]),
+						     attack_gain, release_gain);
+				peak = fmaxf(peak, lane_env[l]);
+			}
+			dst[i] = peak;
+		}
+	}
+}
+
+void dyn_peak_envelope(float *dst, float *const *samples, size_t channels,
+		       size_t n, float *env, float attack_gain,
+		       float release_gain)
+{
+	const float *ch[MAX_AUDIO_CHANNELS];
+	size_t count = get_channels(ch, samples, channels);
+
+	if (!n)
+		return;
+
+	if (!count) {
+		memset(dst, 0, n * sizeof(float));
+		*env = 0.0f;
+		return;
+	}
+
+	for (size_t first = 0; first < count; first += 4) {
+		const float *group[4];
+		get_group(group, ch, count, first);
+		peak_envelope_group(dst, group, n, *env, first == 0,
+				    attack_gain, release_gain);
+	}
+
+	*env = dst[n - 1];
+}
+
+void dyn_rms_envelope(float *const *dst, float *const *samples,
+		      size_t channels, size_t n, float *runave, float coef)
+{
+	const __m128 c = _mm_set1_ps(coef);
+	const __m128 inv_c = _mm_set1_ps(1.0f - coef);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t first = 0; first < channels; first += 4) {
+		size_t lanes = channels - first < 4 ? channels - first : 4;
+		const float *fallback = NULL;
+		const float *group[4];
+		float *out[4];
+		float state[4] = {0};
+		size_t i = 0;
+
+		for (size_t l = 0; l < lanes && !fallback; l++)
+			fallback = samples[first + l];
+		if (!fallback)
+			continue;
+
+		/* unused lanes and missing channels process another channel
+		 * of the group into a lane that is never stored */
+		for (size_t l = 0; l < 4; l++) {
+			size_t ch = first + (l < lanes ? l : 0);
+			const float *src = l < lanes ? samples[ch] : NULL;
+
+			group[l] = src ? src : fallback;
+			out[l] = src ? dst[ch] : NULL;
+			state[l] = runave[ch];
+		}
+
+		__m128 ave = _mm_loadu_ps(state);
+
+		for (; i + 4 <= n; i += 4) {
+			__m128 v[4];
+			load_transposed(v, group, i);
+
+			for (size_t k = 0; k < 4; k++) {
+				__m128 sq = _mm_mul_ps(v[k], v[k]);
+				ave = _mm_add_ps(_mm_mul_ps(c, ave),
+						 _mm_mul_ps(inv_c, sq));
+				v[k] = _mm_sqrt_ps(_mm_max_ps(ave, zero));
+			}
+
+			_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+			for (size_t l = 0; l < 4; l++) {
+				if (out[l])
+					_mm_storeu_ps(out[l] + i, v[l]);
+			}
+		}
+
+		_mm_storeu_ps(state, ave);
+
+		for (; i < n; i++) {
+			for (size_t l = 0; l < 4; l++) {
+				float x = group[l][i];
+				state[l] = coef * state[l] +
+					   (1.0f - coef) * x * x;
+				if (out[l])
+					out[l][i] = sqrtf(fmaxf(state[l], 0));
+			}
+		}
+
+		for (size_t l = 0; l < lanes; l++) {
+			if (out[l])
+				runave[first + l] = state[l];
+		}
+	}
+}
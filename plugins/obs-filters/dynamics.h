@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Block-wise kernels shared by the compressor, expander, limiter and noise
+ * gate filters.
+ *
+ *   The dB conversions use fast log2/exp2 approximations that are accurate
+ * to well under 0.001 dB over the range the filters use, and process four
+ * values at a time.  Envelope followers run up to four channels side by
+ * side, one channel per vector lane, since the envelope of each channel
+ * depends on its previous sample.
+ *
+ *   Sample pointers may be NULL for channels that are not present, those
+ * channels are skipped.
+ */
+
+/* 20 * log10(src), silence converts to about -600 dB instead of -inf */
+extern void dyn_mul_to_db(float *dst, const float *src, size_t n);
+
+/* 10 ^ (src / 20) */
+extern void dyn_db_to_mul(float *dst, const float *src, size_t n);
+
+/* dst[i] = max over all channels of |samples[c][i]| */
+extern void dyn_peak_level(float *dst, float *const *samples, size_t channels,
+			   size_t n);
+
+/* Peak envelope follower.  Every channel starts from *env and dst receives
+ * the largest envelope of all channels, the last value of which is stored
+ * back to *env. */
+extern void dyn_peak_envelope(float *dst, float *const *samples,
+			      size_t channels, size_t n, float *env,
+			      float attack_gain, float release_gain);
+
+/* Running RMS level of each channel, runave holds the running mean square
+ * of each channel between calls. */
+extern void dyn_rms_envelope(float *const *dst, float *const *samples,
+			     size_t channels, size_t n, float *runave,
+			     float coef);
+
+/* Gain multiplier of a downward compressor for each envelope value:
+ * 10 ^ (min(0, slope * (threshold - env_db)) / 20) * output_gain */
+extern void dyn_compressor_gain(float *dst, const float *env, size_t n,
+				float threshold, float slope,
+				float output_gain);
+
+/* Gain in dB of a downward expander for each envelope value */
+extern void dyn_expander_gain_db(float *dst, const float *env, size_t n,
+				 float threshold, float slope);
+
+/* Gain in dB of an upward compressor with a soft knee for each envelope
+ * value */
+extern void dyn_upward_gain_db(float *dst, const float *env, size_t n,
+			       float threshold, float slope, float knee);
+
+/* samples[c][i] *= gain[i] for every channel */
+extern void dyn_apply_gain(float *const *samples, size_t channels,
+			   const float *gain, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...)                                     \
@@ -88,13 +90,11 @@ struct expander_data {
 	int detector;
 	float runave[MAX_AUDIO_CHANNELS];
 	bool is_gate;
-	float *runaverage[MAX_AUDIO_CHANNELS];
-	size_t runaverage_len;
 	float *gain_db[MAX_AUDIO_CHANNELS];
 	size_t gain_db_len;
 	float gain_db_buf[MAX_AUDIO_CHANNELS];
-	float *env_in;
-	size_t env_in_len;
+	float *gain_buf;
+	size_t gain_buf_len;
 	bool is_upwcomp;
 	float knee;
 };
@@ -116,18 +116,10 @@ static void resize_env_buffer(struct expander_data *cd, size_t len)
 				 cd->envelope_buf_len * sizeof(float));
 }
 
-static void resize_runaverage_buffer(struct expander_data *cd, size_t len)
-{
-	cd->runaverage_len = len;
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
-		cd->runaverage[i] = brealloc(
-			cd->runaverage[i], cd->runaverage_len * sizeof(float));
-}
-
-static void resize_env_in_buffer(struct expander_data *cd, size_t len)
+static void resize_gain_buffer(struct expander_data *cd, size_t len)
 {
-	cd->env_in_len = len;
-	cd->env_in = brealloc(cd->env_in, cd->env_in_len * sizeof(float));
+	cd->gain_buf_len = len;
+	cd->gain_buf = brealloc(cd->gain_buf, cd->gain_buf_len * sizeof(float));
 }
 
 static void resize_gain_db_buffer(struct expander_data *cd, size_t len)
@@ -236,10 +228,8 @@ static void expander_update(void *data, obs_data_t *s)
 	size_t sample_len = sample_rate * DEFAULT_AUDIO_BUF_MS / MS_IN_S;
 	if (cd->envelope_buf_len == 0)
 		resize_env_buffer(cd, sample_len);
-	if (cd->runaverage_len == 0)
-		resize_runaverage_buffer(cd, sample_len);
-	if (cd->env_in_len == 0)
-		resize_env_in_buffer(cd, sample_len);
+	if (cd->gain_buf_len == 0)
+		resize_gain_buffer(cd, sample_len);
 	if (cd->gain_db_len == 0)
 		resize_gain_db_buffer(cd, sample_len);
 }
@@ -281,10 +271,9 @@ static void expander_destroy(void *data)
 
 	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		bfree(cd->envelope_buf[i]);
-		bfree(cd->runaverage[i]);
 		bfree(cd->gain_db[i]);
 	}
-	bfree(cd->env_in);
+	bfree(cd->gain_buf);
 	bfree(cd);
 }
 
@@ -294,114 +283,38 @@ static void analyze_envelope(struct expander_data *cd, float **samples,
 {
 	if (cd->envelope_buf_len < num_samples)
 		resize_env_buffer(cd, num_samples);
-	if (cd->runaverage_len < num_samples)
-		resize_runaverage_buffer(cd, num_samples);
-	if (cd->env_in_len < num_samples)
-		resize_env_in_buffer(cd, num_samples);
 
 	// 10 ms RMS window
 	const float rmscoef = exp2f(-100.0f / cd->sample_rate);
 
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		memset(cd->envelope_buf[i], 0,
-		       num_samples * sizeof(cd->envelope_buf[i][0]));
-		memset(cd->runaverage[i], 0,
-		       num_samples * sizeof(cd->runaverage[i][0]));
+	if (cd->detector == RMS_DETECT) {
+		dyn_rms_envelope(cd->envelope_buf, samples, cd->num_channels,
+				 num_samples, cd->runave, rmscoef);
 	}
-	memset(cd->env_in, 0, num_samples * sizeof(cd->env_in[0]));
 
 	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
 		float *envelope_buf = cd->envelope_buf[chan];
-		float *runave = cd->runaverage[chan];
-		float *env_in = cd->env_in;
-
-		if (cd->detector == RMS_DETECT) {
-			runave[0] =
-				rmscoef * cd->runave[chan] +
-				(1 - rmscoef) * powf(samples[chan][0], 2.0f);
-			env_in[0] = sqrtf(fmaxf(runave[0], 0));
-			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] =
-					rmscoef * runave[i - 1] +
-					(1 - rmscoef) *
-						powf(samples[chan][i], 2.0f);
-				env_in[i] = sqrtf(runave[i]);
-			}
-		} else if (cd->detector == PEAK_DETECT) {
-			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
-				env_in[i] = fabsf(samples[chan][i]);
-			}
-		}
-
-		cd->runave[chan] = runave[num_samples - 1];
-		for (uint32_t i = 0; i < num_samples; ++i)
-			envelope_buf[i] = fmaxf(envelope_buf[i], env_in[i]);
-		cd->envelope[chan] = cd->envelope_buf[chan][num_samples - 1];
-	}
-}
-
-static inline void process_sample(size_t idx, float *samples, float *env_buf,
-				  float *gain_db, bool is_upwcomp,
-				  float channel_gain, float threshold,
-				  float slope, float attack_gain,
-				  float inv_attack_gain, float release_gain,
-				  float inv_release_gain, float output_gain,
-				  float knee)
-{
-	/* --------------------------------- */
-	/* gain stage of expansion           */
-
-	float env_db = mul_to_db(env_buf[idx]);
-	float diff = threshold - env_db;
-
-	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
-		diff = env_db + 60.0f > 0 ? env_db + 60.0f : 0.0f;
-
-	float gain = 0.0f;
-	float prev_gain = 0.0f;
-	// Note that the gain is always >= 0 for the upward compressor
-	// but is always <=0 for the expander.
-	if (is_upwcomp) {
-		prev_gain = idx > 0 ? fmaxf(gain_db[idx - 1], 0)
-				    : fmaxf(channel_gain, 0);
-		// gain above knee (included for clarity):
-		if (env_db >= threshold + knee / 2)
-			gain = 0.0f;
-		// gain below knee:
-		if (threshold - knee / 2 >= env_db)
-			gain = slope * diff;
-		// gain in knee:
-		if (env_db > threshold - knee / 2 &&
-		    threshold + knee / 2 > env_db)
-			gain = slope * powf(diff + knee / 2, 2) / (2.0f * knee);
-	} else {
-		prev_gain = idx > 0 ? gain_db[idx - 1] : channel_gain;
-		gain = diff > 0.0f ? fmaxf(slope * diff, -60.0f) : 0.0f;
-	}
 
-	/* --------------------------------- */
-	/* ballistics (attack/release)       */
+		if (!samples[chan]) {
+			memset(envelope_buf, 0,
+			       num_samples * sizeof(envelope_buf[0]));
+			continue;
+		}
 
-	if (gain > prev_gain)
-		gain_db[idx] = attack_gain * prev_gain + inv_attack_gain * gain;
-	else
-		gain_db[idx] =
-			release_gain * prev_gain + inv_release_gain * gain;
+		if (cd->detector == PEAK_DETECT) {
+			const float last = samples[chan][num_samples - 1];
 
-	/* --------------------------------- */
-	/* output                            */
+			dyn_peak_level(envelope_buf, &samples[chan], 1,
+				       num_samples);
+			cd->runave[chan] = last * last;
+		} else if (cd->detector != RMS_DETECT) {
+			memset(envelope_buf, 0,
+			       num_samples * sizeof(envelope_buf[0]));
+			cd->runave[chan] = 0.0f;
+		}
 
-	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
-	} else {
-		gain = db_to_mul(gain_db[idx]);
+		cd->envelope[chan] = envelope_buf[num_samples - 1];
 	}
-
-	samples[idx] *= gain * output_gain;
 }
 
 // gain stage and ballistics in dB domain
@@ -412,33 +325,65 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 	const float release_gain = cd->release_gain;
 	const float inv_attack_gain = 1.0f - attack_gain;
 	const float inv_release_gain = 1.0f - release_gain;
-	const float threshold = cd->threshold;
-	const float slope = cd->slope;
-	const float output_gain = cd->output_gain;
+	const float output_gain_db = mul_to_db(cd->output_gain);
 	const bool is_upwcomp = cd->is_upwcomp;
-	const float knee = cd->knee;
 
 	if (cd->gain_db_len < num_samples)
 		resize_gain_db_buffer(cd, num_samples);
-
-	for (size_t i = 0; i < cd->num_channels; i++)
-		memset(cd->gain_db[i], 0,
-		       num_samples * sizeof(cd->gain_db[i][0]));
+	if (cd->gain_buf_len < num_samples)
+		resize_gain_buffer(cd, num_samples);
 
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
 		float *channel_samples = samples[chan];
 		float *env_buf = cd->envelope_buf[chan];
 		float *gain_db = cd->gain_db[chan];
-		float channel_gain = cd->gain_db_buf[chan];
+		float *gain_buf = cd->gain_buf;
+		float prev_gain = cd->gain_db_buf[chan];
 
+		if (!channel_samples)
+			continue;
+
+		/* --------------------------------- */
+		/* gain stage of expansion           */
+
+		if (is_upwcomp)
+			dyn_upward_gain_db(gain_db, env_buf, num_samples,
+					   cd->threshold, cd->slope, cd->knee);
+		else
+			dyn_expander_gain_db(gain_db, env_buf, num_samples,
+					     cd->threshold, cd->slope);
+
+		/* --------------------------------- */
+		/* ballistics (attack/release)       */
+
+		// Note that the gain is always >= 0 for the upward compressor
+		// but is always <=0 for the expander.
 		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db,
-				       is_upwcomp, channel_gain, threshold,
-				       slope, attack_gain, inv_attack_gain,
-				       release_gain, inv_release_gain,
-				       output_gain, knee);
+			const float gain = gain_db[i];
+
+			if (is_upwcomp)
+				prev_gain = fmaxf(prev_gain, 0);
+
+			if (gain > prev_gain)
+				prev_gain = attack_gain * prev_gain +
+					    inv_attack_gain * gain;
+			else
+				prev_gain = release_gain * prev_gain +
+					    inv_release_gain * gain;
+
+			gain_db[i] = prev_gain;
+			gain_buf[i] = (is_upwcomp ? prev_gain
+						  : fminf(0, prev_gain)) +
+				      output_gain_db;
 		}
-		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
+
+		cd->gain_db_buf[chan] = prev_gain;
+
+		/* --------------------------------- */
+		/* output                            */
+
+		dyn_db_to_mul(gain_buf, gain_buf, num_samples);
+		dyn_apply_gain(&channel_samples, 1, gain_buf, num_samples);
 	}
 }
 
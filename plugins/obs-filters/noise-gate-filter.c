@@ -2,6 +2,8 @@
 #include <obs-module.h>
 #include <math.h>
 
+#include "dynamics.h"
+
 #define do_log(level, format, ...)                \
 	blog(level, "[noise gate: '%s'] " format, \
 	     obs_source_get_name(ng->context), ##__VA_ARGS__)
@@ -43,6 +45,9 @@ struct noise_gate_data {
 	float attenuation;
 	float level;
 	float held_time;
+
+	float *gain_buf;
+	size_t gain_buf_len;
 };
 
 #define VOL_MIN -96.0
@@ -57,6 +62,7 @@ static const char *noise_gate_name(void *unused)
 static void noise_gate_destroy(void *data)
 {
 	struct noise_gate_data *ng = data;
+	bfree(ng->gain_buf);
 	bfree(ng);
 }
 
@@ -123,11 +129,19 @@ noise_gate_filter_audio(void *data, struct obs_audio_data *audio)
 	const float hold_time = ng->hold_time;
 	const size_t channels = ng->channels;
 
-	for (size_t i = 0; i < audio->frames; i++) {
-		float cur_level = fabsf(adata[0][i]);
-		for (size_t j = 0; j < channels; j++) {
-			cur_level = fmaxf(cur_level, fabsf(adata[j][i]));
-		}
+	const size_t frames = audio->frames;
+
+	if (ng->gain_buf_len < frames) {
+		ng->gain_buf_len = frames;
+		ng->gain_buf = brealloc(ng->gain_buf, frames * sizeof(float));
+	}
+
+	/* the peak level of all channels is replaced in place by the gain */
+	float *gain = ng->gain_buf;
+	dyn_peak_level(gain, adata, channels, frames);
+
+	for (size_t i = 0; i < frames; i++) {
+		const float cur_level = gain[i];
 
 		if (cur_level > open_threshold && !ng->is_open) {
 			ng->is_open = true;
@@ -150,10 +164,11 @@ noise_gate_filter_audio(void *data, struct obs_audio_data *audio)
 			}
 		}
 
-		for (size_t c = 0; c < channels; c++)
-			adata[c][i] *= ng->attenuation;
+		gain[i] = ng->attenuation;
 	}
 
+	dyn_apply_gain(adata, channels, gain, frames);
+
 	return audio;
 }
 
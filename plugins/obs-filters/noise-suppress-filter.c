@@ -126,6 +126,7 @@ struct noise_suppress_data {
 	/* output data */
 	struct obs_audio_data output_audio;
 	DARRAY(float) output_data;
+	size_t output_pending;
 };
 
 /* -------------------------------------------------------- */
@@ -298,6 +299,13 @@ static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
 	ng->context = filter;
 	ng->nvafx_enabled = false;
 	ng->nvafx_migrated = false;
+
+	/* mirrored so that segments can be read and returned in place */
+	for (size_t i = 0; i < MAX_PREPROC_CHANNELS; i++) {
+		deque_init_mirrored(&ng->input_buffers[i]);
+		deque_init_mirrored(&ng->output_buffers[i]);
+	}
+
 #ifdef LIBNVAFX_ENABLED
 	ng->migrated_filter = NULL;
 	// If a NVAFX entry is detected, create a new instance of NVAFX filter.
@@ -327,6 +335,29 @@ static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
 	return ng;
 }
 
+/* Returns the next input segment of a channel without copying it out of the
+ * deque when it is contiguous, which it always is for mirrored deques. */
+static inline const float *get_input_segment(struct noise_suppress_data *ng,
+					     size_t channel)
+{
+	struct deque *buf = &ng->input_buffers[channel];
+	size_t size = ng->frames * sizeof(float);
+	struct deque_span spans[2];
+
+	if (deque_peek_span(buf, size, spans) == 1)
+		return spans[0].data;
+
+	deque_peek_front(buf, ng->copy_buffers[channel], size);
+	return ng->copy_buffers[channel];
+}
+
+static inline void push_output_segment(struct noise_suppress_data *ng,
+				       size_t channel, const float *data)
+{
+	deque_push_back(&ng->output_buffers[channel], data,
+			ng->frames * sizeof(float));
+}
+
 static inline void process_speexdsp(struct noise_suppress_data *ng)
 {
 #ifdef LIBSPEEXDSP_ENABLED
@@ -337,9 +368,11 @@ static inline void process_speexdsp(struct noise_suppress_data *ng)
 				     &ng->suppress_level);
 
 	/* Convert to 16bit */
-	for (size_t i = 0; i < ng->channels; i++)
+	for (size_t i = 0; i < ng->channels; i++) {
+		const float *in = get_input_segment(ng, i);
+
 		for (size_t j = 0; j < ng->frames; j++) {
-			float s = ng->copy_buffers[i][j];
+			float s = in[j];
 			if (s > 1.0f)
 				s = 1.0f;
 			else if (s < -1.0f)
@@ -347,6 +380,7 @@ static inline void process_speexdsp(struct noise_suppress_data *ng)
 			ng->spx_segment_buffers[i][j] =
 				(spx_int16_t)(s * c_32_to_16);
 		}
+	}
 
 	/* Execute */
 	for (size_t i = 0; i < ng->channels; i++)
@@ -354,11 +388,14 @@ static inline void process_speexdsp(struct noise_suppress_data *ng)
 				     ng->spx_segment_buffers[i]);
 
 	/* Convert back to 32bit */
-	for (size_t i = 0; i < ng->channels; i++)
+	for (size_t i = 0; i < ng->channels; i++) {
 		for (size_t j = 0; j < ng->frames; j++)
 			ng->copy_buffers[i][j] =
 				(float)ng->spx_segment_buffers[i][j] /
 				c_16_to_32;
+
+		push_output_segment(ng, i, ng->copy_buffers[i]);
+	}
 #else
 	UNUSED_PARAMETER(ng);
 #endif
@@ -368,13 +405,18 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 {
 #ifdef LIBRNNOISE_ENABLED
 	/* Adjust signal level to what RNNoise expects, resample if necessary */
+	const float *input[MAX_PREPROC_CHANNELS];
+
+	for (size_t i = 0; i < ng->channels; i++)
+		input[i] = get_input_segment(ng, i);
+
 	if (ng->rnn_resampler) {
 		float *output[MAX_PREPROC_CHANNELS];
 		uint32_t out_frames;
 		uint64_t ts_offset;
 		audio_resampler_resample(ng->rnn_resampler, (uint8_t **)output,
 					 &out_frames, &ts_offset,
-					 (const uint8_t **)ng->copy_buffers,
+					 (const uint8_t **)input,
 					 (uint32_t)ng->frames);
 
 		for (size_t i = 0; i < ng->channels; i++) {
@@ -393,17 +435,23 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 		for (size_t i = 0; i < ng->channels; i++) {
 			for (size_t j = 0; j < RNNOISE_FRAME_SIZE; ++j) {
 				ng->rnn_segment_buffers[i][j] =
-					ng->copy_buffers[i][j] * 32768.0f;
+					input[i][j] * 32768.0f;
 			}
 		}
 	}
 
 	/* Execute */
+#ifdef RNNOISE_HAVE_PROCESS_FRAMES
+	rnnoise_process_frames(ng->rnn_states, ng->rnn_segment_buffers,
+			       (const float **)ng->rnn_segment_buffers, NULL,
+			       (int)ng->channels);
+#else
 	for (size_t i = 0; i < ng->channels; i++) {
 		rnnoise_process_frame(ng->rnn_states[i],
 				      ng->rnn_segment_buffers[i],
 				      ng->rnn_segment_buffers[i]);
 	}
+#endif
 
 	/* Revert signal level adjustment, resample back if necessary */
 	if (ng->rnn_resampler) {
@@ -426,14 +474,18 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 					ng->copy_buffers[i][j] = 0;
 				}
 			}
+
+			push_output_segment(ng, i, ng->copy_buffers[i]);
 		}
 	} else {
+		/* the segment buffers are scaled back in place */
 		for (size_t i = 0; i < ng->channels; i++) {
-			for (size_t j = 0; j < RNNOISE_FRAME_SIZE; ++j) {
-				ng->copy_buffers[i][j] =
-					ng->rnn_segment_buffers[i][j] /
-					32768.0f;
-			}
+			float *segment = ng->rnn_segment_buffers[i];
+
+			for (size_t j = 0; j < RNNOISE_FRAME_SIZE; ++j)
+				segment[j] /= 32768.0f;
+
+			push_output_segment(ng, i, segment);
 		}
 	}
 #else
@@ -445,20 +497,17 @@ static inline void process(struct noise_suppress_data *ng)
 {
 	if (ng->nvafx_enabled)
 		return;
-	/* Pop from input deque */
-	for (size_t i = 0; i < ng->channels; i++)
-		deque_pop_front(&ng->input_buffers[i], ng->copy_buffers[i],
-				ng->frames * sizeof(float));
 
+	/* Reads from the input deques and pushes to the output deques */
 	if (ng->use_rnnoise) {
 		process_rnnoise(ng);
 	} else {
 		process_speexdsp(ng);
 	}
 
-	/* Push to output deque */
+	/* Pop from input deque */
 	for (size_t i = 0; i < ng->channels; i++)
-		deque_push_back(&ng->output_buffers[i], ng->copy_buffers[i],
+		deque_pop_front(&ng->input_buffers[i], NULL,
 				ng->frames * sizeof(float));
 }
 
@@ -472,6 +521,19 @@ static inline void clear_deque(struct deque *buf)
 	deque_pop_front(buf, NULL, buf->size);
 }
 
+/* The packet returned last time points into the output deques, so it is
+ * only popped once the caller is done with it. */
+static inline void pop_pending_output(struct noise_suppress_data *ng)
+{
+	if (!ng->output_pending)
+		return;
+
+	for (size_t i = 0; i < ng->channels; i++)
+		deque_pop_front(&ng->output_buffers[i], NULL,
+				ng->output_pending);
+	ng->output_pending = 0;
+}
+
 static void reset_data(struct noise_suppress_data *ng)
 {
 	for (size_t i = 0; i < ng->channels; i++) {
@@ -482,6 +544,20 @@ static void reset_data(struct noise_suppress_data *ng)
 	clear_deque(&ng->info_buffer);
 }
 
+static bool output_in_place(struct noise_suppress_data *ng, size_t size)
+{
+	struct deque_span spans[2];
+
+	for (size_t i = 0; i < ng->channels; i++) {
+		if (deque_peek_span(&ng->output_buffers[i], size, spans) != 1)
+			return false;
+
+		ng->output_audio.data[i] = spans[0].data;
+	}
+
+	return true;
+}
+
 static struct obs_audio_data *
 noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 {
@@ -513,6 +589,8 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 		return audio;
 #endif
 
+	pop_pending_output(ng);
+
 	/* -----------------------------------------------
 	 * if timestamp has dramatically changed, consider it a new stream of
 	 * audio data.  clear all circular buffers to prevent old audio data
@@ -556,16 +634,22 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 
 	/* -----------------------------------------------
 	 * if there's enough audio data buffered in the output deque,
-	 * pop and return a packet */
+	 * return a packet, in place if the data is contiguous */
 	deque_pop_front(&ng->info_buffer, NULL, sizeof(info));
-	da_resize(ng->output_data, out_size * ng->channels);
 
-	for (size_t i = 0; i < ng->channels; i++) {
-		ng->output_audio.data[i] =
-			(uint8_t *)&ng->output_data.array[i * out_size];
+	if (output_in_place(ng, out_size)) {
+		ng->output_pending = out_size;
+	} else {
+		da_resize(ng->output_data, out_size * ng->channels);
 
-		deque_pop_front(&ng->output_buffers[i],
-				ng->output_audio.data[i], out_size);
+		for (size_t i = 0; i < ng->channels; i++) {
+			ng->output_audio.data[i] =
+				(uint8_t *)&ng->output_data
+					.array[i * out_size];
+
+			deque_pop_front(&ng->output_buffers[i],
+					ng->output_audio.data[i], out_size);
+		}
 	}
 
 	ng->output_audio.frames = info.frames;
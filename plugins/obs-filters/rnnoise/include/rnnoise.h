@@ -61,6 +61,13 @@ RNNOISE_EXPORT void rnnoise_destroy(DenoiseState *st);
 
 RNNOISE_EXPORT float rnnoise_process_frame(DenoiseState *st, float *out, const float *in);
 
+/* Processes one frame for each of count states, e.g. one per channel.
+ * States that share a model run the network together, which is cheaper
+ * than calling rnnoise_process_frame() for each of them.  vad may be NULL,
+ * otherwise it receives count voice probabilities. */
+#define RNNOISE_HAVE_PROCESS_FRAMES 1
+RNNOISE_EXPORT void rnnoise_process_frames(DenoiseState **st, float **out, const float **in, float *vad, int count);
+
 RNNOISE_EXPORT RNNModel *rnnoise_model_from_file(FILE *f);
 
 RNNOISE_EXPORT void rnnoise_model_free(RNNModel *model);
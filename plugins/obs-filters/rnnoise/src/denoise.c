@@ -42,6 +42,7 @@
 #include "arch.h"
 #include "rnn.h"
 #include "rnn_data.h"
+#include "rnn_simd.h"
 
 #define FRAME_SIZE_SHIFT 2
 #define FRAME_SIZE (120<<FRAME_SIZE_SHIFT)
@@ -85,7 +86,22 @@ typedef struct {
   float dct_table[NB_BANDS*NB_BANDS];
 } CommonState;
 
+/* Results of analysing the current frame.  They are kept in the state so
+   that rnnoise_process_frames() can run the network for all of its states
+   between the analysis and synthesis steps. */
+typedef struct {
+  kiss_fft_cpx X[FREQ_SIZE];
+  kiss_fft_cpx P[WINDOW_SIZE];
+  float Ex[NB_BANDS], Ep[NB_BANDS];
+  float Exp[NB_BANDS];
+  float features[NB_FEATURES];
+  float g[NB_BANDS];
+  float vad_prob;
+  int silence;
+} FrameState;
+
 struct DenoiseState {
+  FrameState frame;
   float analysis_mem[FRAME_SIZE];
   float cepstral_mem[CEPS_MEM][NB_BANDS];
   int memid;
@@ -453,42 +469,92 @@ void pitch_filter(kiss_fft_cpx *X, const kiss_fft_cpx *P, const float *Ex, const
   }
 }
 
-float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
-  int i;
-  kiss_fft_cpx X[FREQ_SIZE];
-  kiss_fft_cpx P[WINDOW_SIZE];
+static void frame_analysis_step(DenoiseState *st, const float *in) {
+  FrameState *f = &st->frame;
   float x[FRAME_SIZE];
-  float Ex[NB_BANDS], Ep[NB_BANDS];
-  float Exp[NB_BANDS];
-  float features[NB_FEATURES];
-  float g[NB_BANDS];
-  float gf[FREQ_SIZE]={1};
-  float vad_prob = 0;
-  int silence;
   static const float a_hp[2] = {-1.99599f, 0.99600f};
   static const float b_hp[2] = {-2, 1};
   biquad(x, st->mem_hp_x, in, b_hp, a_hp, FRAME_SIZE);
-  silence = compute_frame_features(st, X, P, Ex, Ep, Exp, features, x);
+  f->vad_prob = 0;
+  f->silence = compute_frame_features(st, f->X, f->P, f->Ex, f->Ep, f->Exp, f->features, x);
+}
 
-  if (!silence) {
-    compute_rnn(&st->rnn, g, &vad_prob, features);
-    pitch_filter(X, P, Ex, Ep, Exp, g);
+static void frame_synthesis_step(DenoiseState *st, float *out) {
+  int i;
+  FrameState *f = &st->frame;
+  float gf[FREQ_SIZE]={1};
+
+  if (!f->silence) {
+    pitch_filter(f->X, f->P, f->Ex, f->Ep, f->Exp, f->g);
     for (i=0;i<NB_BANDS;i++) {
       float alpha = .6f;
-      g[i] = MAX16(g[i], alpha*st->lastg[i]);
-      st->lastg[i] = g[i];
+      f->g[i] = MAX16(f->g[i], alpha*st->lastg[i]);
+      st->lastg[i] = f->g[i];
     }
-    interp_band_gain(gf, g);
+    interp_band_gain(gf, f->g);
 #if 1
     for (i=0;i<FREQ_SIZE;i++) {
-      X[i].r *= gf[i];
-      X[i].i *= gf[i];
+      f->X[i].r *= gf[i];
+      f->X[i].i *= gf[i];
     }
 #endif
   }
 
-  frame_synthesis(st, out, X);
-  return vad_prob;
+  frame_synthesis(st, out, f->X);
+}
+
+float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
+  FrameState *f = &st->frame;
+  frame_analysis_step(st, in);
+  if (!f->silence)
+    compute_rnn(&st->rnn, f->g, &f->vad_prob, f->features);
+  frame_synthesis_step(st, out);
+  return f->vad_prob;
+}
+
+static void run_rnn_batch(DenoiseState **batch, int count) {
+  int k;
+  RNNState *rnn[RNN_MAX_BATCH];
+  float *gains[RNN_MAX_BATCH];
+  float *vad[RNN_MAX_BATCH];
+  const float *features[RNN_MAX_BATCH];
+  for (k=0;k<count;k++) {
+    rnn[k] = &batch[k]->rnn;
+    gains[k] = batch[k]->frame.g;
+    vad[k] = &batch[k]->frame.vad_prob;
+    features[k] = batch[k]->frame.features;
+  }
+  compute_rnn_batch(rnn, gains, vad, features, count);
+}
+
+void rnnoise_process_frames(DenoiseState **st, float **out, const float **in, float *vad, int count) {
+  int i;
+  int batch_count = 0;
+  DenoiseState *batch[RNN_MAX_BATCH];
+
+  for (i=0;i<count;i++)
+    frame_analysis_step(st[i], in[i]);
+
+  /* Silent frames skip the network, states are batched as long as they
+     share a model. */
+  for (i=0;i<count;i++) {
+    if (st[i]->frame.silence)
+      continue;
+    if (batch_count == RNN_MAX_BATCH ||
+        (batch_count && batch[0]->rnn.model != st[i]->rnn.model)) {
+      run_rnn_batch(batch, batch_count);
+      batch_count = 0;
+    }
+    batch[batch_count++] = st[i];
+  }
+  if (batch_count)
+    run_rnn_batch(batch, batch_count);
+
+  for (i=0;i<count;i++) {
+    frame_synthesis_step(st[i], out[i]);
+    if (vad)
+      vad[i] = st[i]->frame.vad_prob;
+  }
 }
 
 #if TRAINING
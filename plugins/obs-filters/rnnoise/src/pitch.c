@@ -42,6 +42,7 @@
 //#include "mathops.h"
 #include "celt_lpc.h"
 #include "math.h"
+#include "rnn_simd.h"
 
 static void find_best_pitch(opus_val32 *xcorr, opus_val16 *y, int len,
                             int max_pitch, int *best_pitch
@@ -249,6 +250,13 @@ void celt_pitch_xcorr(const opus_val16 *_x, const opus_val16 *_y,
 #endif
    celt_assert(max_pitch>0);
    celt_assert((((unsigned char *)_x-(unsigned char *)NULL)&3)==0);
+#ifndef FIXED_POINT
+   if (rnn_simd_enabled())
+   {
+      rnn_pitch_xcorr(_x, _y, xcorr, len, max_pitch);
+      return;
+   }
+#endif
    for (i=0;i<max_pitch-3;i+=4)
    {
       opus_val32 sum[4]={0,0,0,0};
@@ -36,6 +36,7 @@
 #include "tansig_table.h"
 #include "rnn.h"
 #include "rnn_data.h"
+#include "rnn_simd.h"
 #include <stdio.h>
 
 static OPUS_INLINE float tansig_approx(float x)
@@ -76,103 +77,152 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+static void activate(float *x, int n, int activation)
 {
-   int i, j;
+   int i;
+   if (activation == ACTIVATION_SIGMOID) {
+      for (i=0;i<n;i++)
+         x[i] = sigmoid_approx(x[i]);
+   } else if (activation == ACTIVATION_TANH) {
+      for (i=0;i<n;i++)
+         x[i] = tansig_approx(x[i]);
+   } else if (activation == ACTIVATION_RELU) {
+      for (i=0;i<n;i++)
+         x[i] = relu(x[i]);
+   } else {
+     *(int*)0=0;
+   }
+}
+
+static void init_bias(float *x, const rnn_weight *bias, int n)
+{
+   int i;
+   for (i=0;i<n;i++)
+      x[i] = bias[i];
+}
+
+static void scale_weights(float *x, int n)
+{
+   int i;
+   for (i=0;i<n;i++)
+      x[i] *= WEIGHTS_SCALE;
+}
+
+/* The batched layers run the same layer for several states at once, so the
+   weights are only read once per batch instead of once per channel. */
+static void compute_dense_batch(const DenseLayer *layer, float **output,
+      const float *const *input, int count)
+{
+   int k;
    int N, M;
-   int stride;
    M = layer->nb_inputs;
    N = layer->nb_neurons;
-   stride = N;
-   for (i=0;i<N;i++)
+   for (k=0;k<count;k++)
+      init_bias(output[k], layer->bias, N);
+   rnn_gemv_accum(output, layer->input_weights, N, input, M, N, count);
+   for (k=0;k<count;k++)
    {
-      /* Compute update gate. */
-      float sum = layer->bias[i];
-      for (j=0;j<M;j++)
-         sum += layer->input_weights[j*stride + i]*input[j];
-      output[i] = WEIGHTS_SCALE*sum;
-   }
-   if (layer->activation == ACTIVATION_SIGMOID) {
-      for (i=0;i<N;i++)
-         output[i] = sigmoid_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_TANH) {
-      for (i=0;i<N;i++)
-         output[i] = tansig_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_RELU) {
-      for (i=0;i<N;i++)
-         output[i] = relu(output[i]);
-   } else {
-     *(int*)0=0;
+      scale_weights(output[k], N);
+      activate(output[k], N, layer->activation);
    }
 }
 
-static void compute_gru(const GRULayer *gru, float *state, const float *input)
+static void compute_gru_batch(const GRULayer *gru, float **state,
+      const float *const *input, int count)
 {
-   int i, j;
+   int i, k;
    int N, M;
    int stride;
-   float z[MAX_NEURONS];
-   float r[MAX_NEURONS];
-   float h[MAX_NEURONS];
+   float z[RNN_MAX_BATCH][MAX_NEURONS];
+   float r[RNN_MAX_BATCH][MAX_NEURONS];
+   float h[RNN_MAX_BATCH][MAX_NEURONS];
+   float *zp[RNN_MAX_BATCH], *rp[RNN_MAX_BATCH], *hp[RNN_MAX_BATCH];
+   const float *sp[RNN_MAX_BATCH];
    M = gru->nb_inputs;
    N = gru->nb_neurons;
    stride = 3*N;
-   for (i=0;i<N;i++)
+   for (k=0;k<count;k++)
    {
-      /* Compute update gate. */
-      float sum = gru->bias[i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[j*stride + i]*state[j];
-      z[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      zp[k] = z[k];
+      rp[k] = r[k];
+      hp[k] = h[k];
+      sp[k] = state[k];
+      init_bias(z[k], gru->bias, N);
+      init_bias(r[k], gru->bias + N, N);
+      init_bias(h[k], gru->bias + 2*N, N);
    }
-   for (i=0;i<N;i++)
+   /* Compute update gate. */
+   rnn_gemv_accum(zp, gru->input_weights, stride, input, M, N, count);
+   rnn_gemv_accum(zp, gru->recurrent_weights, stride, sp, N, N, count);
+   /* Compute reset gate. */
+   rnn_gemv_accum(rp, gru->input_weights + N, stride, input, M, N, count);
+   rnn_gemv_accum(rp, gru->recurrent_weights + N, stride, sp, N, N, count);
+   for (k=0;k<count;k++)
    {
-      /* Compute reset gate. */
-      float sum = gru->bias[N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[N + j*stride + i]*state[j];
-      r[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      for (i=0;i<N;i++)
+      {
+         z[k][i] = sigmoid_approx(WEIGHTS_SCALE*z[k][i]);
+         r[k][i] = sigmoid_approx(WEIGHTS_SCALE*r[k][i]);
+         /* The reset gate is applied to the state before the recurrent
+            weights, so it can be folded into the input vector. */
+         r[k][i] *= state[k][i];
+      }
    }
-   for (i=0;i<N;i++)
+   /* Compute output. */
+   rnn_gemv_accum(hp, gru->input_weights + 2*N, stride, input, M, N, count);
+   rnn_gemv_accum(hp, gru->recurrent_weights + 2*N, stride,
+         (const float *const *)rp, N, N, count);
+   for (k=0;k<count;k++)
    {
-      /* Compute output. */
-      float sum = gru->bias[2*N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[2*N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[2*N + j*stride + i]*state[j]*r[j];
-      if (gru->activation == ACTIVATION_SIGMOID) sum = sigmoid_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_TANH) sum = tansig_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_RELU) sum = relu(WEIGHTS_SCALE*sum);
-      else *(int*)0=0;
-      h[i] = z[i]*state[i] + (1-z[i])*sum;
+      scale_weights(h[k], N);
+      activate(h[k], N, gru->activation);
+      for (i=0;i<N;i++)
+         state[k][i] = z[k][i]*state[k][i] + (1-z[k][i])*h[k][i];
    }
-   for (i=0;i<N;i++)
-      state[i] = h[i];
 }
 
 #define INPUT_SIZE 42
 
+void compute_rnn_batch(RNNState **rnn, float **gains, float **vad,
+      const float *const *input, int count) {
+  int i, k;
+  const RNNModel *model = rnn[0]->model;
+  float dense_out[RNN_MAX_BATCH][MAX_NEURONS];
+  float noise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float denoise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float *dense_p[RNN_MAX_BATCH], *noise_p[RNN_MAX_BATCH];
+  float *denoise_p[RNN_MAX_BATCH];
+  float *vad_state[RNN_MAX_BATCH], *noise_state[RNN_MAX_BATCH];
+  float *denoise_state[RNN_MAX_BATCH];
+  celt_assert(count > 0 && count <= RNN_MAX_BATCH);
+  for (k=0;k<count;k++) {
+    celt_assert(rnn[k]->model == model);
+    dense_p[k] = dense_out[k];
+    noise_p[k] = noise_input[k];
+    denoise_p[k] = denoise_input[k];
+    vad_state[k] = rnn[k]->vad_gru_state;
+    noise_state[k] = rnn[k]->noise_gru_state;
+    denoise_state[k] = rnn[k]->denoise_gru_state;
+  }
+  compute_dense_batch(model->input_dense, dense_p, input, count);
+  compute_gru_batch(model->vad_gru, vad_state, (const float *const *)dense_p, count);
+  compute_dense_batch(model->vad_output, vad, (const float *const *)vad_state, count);
+  for (k=0;k<count;k++) {
+    for (i=0;i<model->input_dense_size;i++) noise_input[k][i] = dense_out[k][i];
+    for (i=0;i<model->vad_gru_size;i++) noise_input[k][i+model->input_dense_size] = vad_state[k][i];
+    for (i=0;i<INPUT_SIZE;i++) noise_input[k][i+model->input_dense_size+model->vad_gru_size] = input[k][i];
+  }
+  compute_gru_batch(model->noise_gru, noise_state, (const float *const *)noise_p, count);
+
+  for (k=0;k<count;k++) {
+    for (i=0;i<model->vad_gru_size;i++) denoise_input[k][i] = vad_state[k][i];
+    for (i=0;i<model->noise_gru_size;i++) denoise_input[k][i+model->vad_gru_size] = noise_state[k][i];
+    for (i=0;i<INPUT_SIZE;i++) denoise_input[k][i+model->vad_gru_size+model->noise_gru_size] = input[k][i];
+  }
+  compute_gru_batch(model->denoise_gru, denoise_state, (const float *const *)denoise_p, count);
+  compute_dense_batch(model->denoise_output, gains, (const float *const *)denoise_state, count);
+}
+
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input) {
-  int i;
-  float dense_out[MAX_NEURONS];
-  float noise_input[MAX_NEURONS*3];
-  float denoise_input[MAX_NEURONS*3];
-  compute_dense(rnn->model->input_dense, dense_out, input);
-  compute_gru(rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-  compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
-  for (i=0;i<rnn->model->input_dense_size;i++) noise_input[i] = dense_out[i];
-  for (i=0;i<rnn->model->vad_gru_size;i++) noise_input[i+rnn->model->input_dense_size] = rnn->vad_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) noise_input[i+rnn->model->input_dense_size+rnn->model->vad_gru_size] = input[i];
-  compute_gru(rnn->model->noise_gru, rnn->noise_gru_state, noise_input);
-
-  for (i=0;i<rnn->model->vad_gru_size;i++) denoise_input[i] = rnn->vad_gru_state[i];
-  for (i=0;i<rnn->model->noise_gru_size;i++) denoise_input[i+rnn->model->vad_gru_size] = rnn->noise_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) denoise_input[i+rnn->model->vad_gru_size+rnn->model->noise_gru_size] = input[i];
-  compute_gru(rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-  compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+  compute_rnn_batch(&rnn, &gains, &vad, &input, 1);
 }
@@ -62,4 +62,8 @@ typedef struct RNNState RNNState;
 
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input);
 
+/* Runs compute_rnn() for count states that share the same model. */
+void compute_rnn_batch(RNNState **rnn, float **gains, float **vad,
+      const float *const *input, int count);
+
 #endif /* _MLP_H_ */
@@ -0,0 +1,201 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rnn_simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RNN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+static void gemv_accum_c(float **out, const rnn_weight *weights, int stride,
+      const float *const *in, int m, int n, int count)
+{
+   int i, j, k;
+   for (k=0;k<count;k++)
+   {
+      for (j=0;j<m;j++)
+      {
+         const rnn_weight *w = weights + j*stride;
+         float x = in[k][j];
+         for (i=0;i<n;i++)
+            out[k][i] += w[i]*x;
+      }
+   }
+}
+
+static void pitch_xcorr_c(const float *x, const float *y, float *xcorr,
+      int len, int max_pitch)
+{
+   int i, j;
+   for (i=0;i<max_pitch;i++)
+   {
+      float sum = 0;
+      for (j=0;j<len;j++)
+         sum += x[j]*y[i+j];
+      xcorr[i] = sum;
+   }
+}
+
+#ifdef RNN_X86
+
+static int cpu_has_avx2_fma(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+   int regs[4];
+   __cpuid(regs, 0);
+   if (regs[0] < 7)
+      return 0;
+   __cpuid(regs, 1);
+   /* FMA, OSXSAVE and AVX */
+   if ((regs[2] & 0x18001000) != 0x18001000)
+      return 0;
+   /* The OS has to save the YMM registers */
+   if ((_xgetbv(0) & 6) != 6)
+      return 0;
+   __cpuidex(regs, 7, 0);
+   return (regs[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+/* Eight neurons at a time: each row of weights is loaded and converted once
+   and applied to every state in the batch. */
+AVX2_TARGET static void gemv_accum_avx2(float **out, const rnn_weight *weights,
+      int stride, const float *const *in, int m, int n, int count)
+{
+   int i, j, k;
+   for (i=0;i+8<=n;i+=8)
+   {
+      __m256 sum[RNN_MAX_BATCH];
+      for (k=0;k<count;k++)
+         sum[k] = _mm256_loadu_ps(out[k] + i);
+      for (j=0;j<m;j++)
+      {
+         __m128i w8 = _mm_loadl_epi64((const __m128i *)(weights + j*stride + i));
+         __m256 w = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(w8));
+         for (k=0;k<count;k++)
+            sum[k] = _mm256_fmadd_ps(w, _mm256_set1_ps(in[k][j]), sum[k]);
+      }
+      for (k=0;k<count;k++)
+         _mm256_storeu_ps(out[k] + i, sum[k]);
+   }
+   for (;i<n;i++)
+   {
+      for (k=0;k<count;k++)
+      {
+         float sum = out[k][i];
+         for (j=0;j<m;j++)
+            sum += weights[j*stride + i]*in[k][j];
+         out[k][i] = sum;
+      }
+   }
+}
+
+AVX2_TARGET static float hsum_avx2(__m256 v)
+{
+   __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+   s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+   s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+   return _mm_cvtss_f32(s);
+}
+
+/* Four lags at a time so that each load of x is used four times. */
+AVX2_TARGET static void pitch_xcorr_avx2(const float *x, const float *y,
+      float *xcorr, int len, int max_pitch)
+{
+   int i, j;
+   for (i=0;i+4<=max_pitch;i+=4)
+   {
+      __m256 sum0 = _mm256_setzero_ps();
+      __m256 sum1 = _mm256_setzero_ps();
+      __m256 sum2 = _mm256_setzero_ps();
+      __m256 sum3 = _mm256_setzero_ps();
+      float tail[4] = {0, 0, 0, 0};
+      for (j=0;j+8<=len;j+=8)
+      {
+         __m256 xj = _mm256_loadu_ps(x + j);
+         sum0 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(y + i + j), sum0);
+         sum1 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(y + i + j + 1), sum1);
+         sum2 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(y + i + j + 2), sum2);
+         sum3 = _mm256_fmadd_ps(xj, _mm256_loadu_ps(y + i + j + 3), sum3);
+      }
+      for (;j<len;j++)
+      {
+         tail[0] += x[j]*y[i+j];
+         tail[1] += x[j]*y[i+j+1];
+         tail[2] += x[j]*y[i+j+2];
+         tail[3] += x[j]*y[i+j+3];
+      }
+      xcorr[i] = hsum_avx2(sum0) + tail[0];
+      xcorr[i+1] = hsum_avx2(sum1) + tail[1];
+      xcorr[i+2] = hsum_avx2(sum2) + tail[2];
+      xcorr[i+3] = hsum_avx2(sum3) + tail[3];
+   }
+   if (i < max_pitch)
+      pitch_xcorr_c(x, y + i, xcorr + i, len, max_pitch - i);
+}
+
+#endif
+
+/* -1: not checked yet, 0: C kernels, 1: AVX2/FMA kernels.  Racing threads
+   all store the same value, so no locking is needed. */
+static volatile int simd_state = -1;
+static volatile int simd_disabled = 0;
+
+int rnn_simd_enabled(void)
+{
+   int state = simd_state;
+   if (state < 0)
+   {
+#ifdef RNN_X86
+      state = cpu_has_avx2_fma();
+#else
+      state = 0;
+#endif
+      simd_state = state;
+   }
+   return state && !simd_disabled;
+}
+
+void rnn_simd_set_enabled(int enabled)
+{
+   simd_disabled = !enabled;
+}
+
+void rnn_gemv_accum(float **out, const rnn_weight *weights, int stride,
+      const float *const *in, int m, int n, int count)
+{
+#ifdef RNN_X86
+   if (rnn_simd_enabled())
+   {
+      gemv_accum_avx2(out, weights, stride, in, m, n, count);
+      return;
+   }
+#endif
+   gemv_accum_c(out, weights, stride, in, m, n, count);
+}
+
+void rnn_pitch_xcorr(const float *x, const float *y, float *xcorr,
+      int len, int max_pitch)
+{
+#ifdef RNN_X86
+   if (rnn_simd_enabled())
+   {
+      pitch_xcorr_avx2(x, y, xcorr, len, max_pitch);
+      return;
+   }
+#endif
+   pitch_xcorr_c(x, y, xcorr, len, max_pitch);
+}
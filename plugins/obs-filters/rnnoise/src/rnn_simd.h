@@ -0,0 +1,28 @@
+#ifndef RNN_SIMD_H
+#define RNN_SIMD_H
+
+#include "rnn.h"
+
+/* Largest number of states compute_rnn_batch() runs in one pass. */
+#define RNN_MAX_BATCH 8
+
+/* Runtime dispatched kernels.  The AVX2/FMA versions are used when the CPU
+   supports them, the portable C versions otherwise. */
+
+/* out[k][i] += sum_j weights[j*stride + i]*in[k][j]
+   for 0 <= i < n, 0 <= j < m and 0 <= k < count. */
+void rnn_gemv_accum(float **out, const rnn_weight *weights, int stride,
+      const float *const *in, int m, int n, int count);
+
+/* xcorr[i] = sum_j x[j]*y[i + j] for 0 <= i < max_pitch, 0 <= j < len. */
+void rnn_pitch_xcorr(const float *x, const float *y, float *xcorr,
+      int len, int max_pitch);
+
+/* Returns non-zero if the AVX2/FMA kernels are in use. */
+int rnn_simd_enabled(void);
+
+/* Allows the AVX2/FMA kernels to be turned off, mainly for benchmarks.
+   Has no effect if the CPU does not support them. */
+void rnn_simd_set_enabled(int enabled);
+
+#endif
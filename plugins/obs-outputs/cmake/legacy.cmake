@@ -41,6 +41,8 @@ target_sources(
           rtmp-windows.c
           rtmp-av1.c
           rtmp-av1.h
+          rtmp-congestion.c
+          rtmp-congestion.h
           utils.h
           librtmp/amf.c
           librtmp/amf.h
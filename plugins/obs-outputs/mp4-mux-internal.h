@@ -110,18 +110,26 @@ struct mp4_track {
 
 	/* Sample sizes (fixed for PCM) */
 	uint32_t sample_size;
-	DARRAY(uint32_t) sample_sizes;
 	/* Data chunks in file containing samples for this track */
 	DARRAY(struct chunk) chunks;
 	/* Time delta between samples */
 	DARRAY(struct sample_delta) deltas;
 
-	/* Sample CT-DT offset, i.e. DTS-PTS offset (Video only) */
+	/* Sample CT-DT offset, i.e. DTS-PTS offset of first sample (Video) */
 	bool needs_ctts;
 	int32_t dts_offset;
-	DARRAY(struct sample_offset) offsets;
-	/* Sync samples, i.e. keyframes (Video only) */
-	DARRAY(uint32_t) sync_samples;
+
+	/* Sample table entries are serialised (big-endian, in track timescale)
+	 * as fragments are flushed, so that writing the full moov only needs to
+	 * copy them rather than convert millions of entries at once. */
+	/* stsz entry_size per sample (if sample sizes are not fixed) */
+	DARRAY(uint8_t) stsz_entries;
+	/* stss sample_number per sync sample, i.e. keyframes (Video only) */
+	DARRAY(uint8_t) stss_entries;
+	/* ctts sample_count + sample_offset per completed run (Video only) */
+	DARRAY(uint8_t) ctts_entries;
+	/* Run of identical offsets that is still being extended */
+	struct sample_offset ctts_run;
 
 	/* Temporary array with information about the samples to be included
 	 * in the next fragment. */
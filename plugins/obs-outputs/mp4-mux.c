@@ -1129,6 +1129,35 @@ static size_t mp4_write_stsd(struct mp4_mux *mux, struct mp4_track *track)
 	return write_box_size(s, start);
 }
 
+/* Helpers for sample table entries that are serialised ahead of time */
+static inline void table_push_u32(struct darray *table, uint32_t val)
+{
+	uint8_t be[4] = {(uint8_t)(val >> 24), (uint8_t)(val >> 16),
+			 (uint8_t)(val >> 8), (uint8_t)val};
+
+	darray_push_back_array(1, table, be, sizeof(be));
+}
+
+static inline uint32_t ctts_sample_offset(struct mp4_track *track,
+					  int32_t offset)
+{
+	return (uint32_t)((int64_t)offset * (int64_t)track->timescale /
+			  (int64_t)track->timebase_den);
+}
+
+static void close_ctts_run(struct mp4_track *track)
+{
+	struct sample_offset *run = &track->ctts_run;
+
+	if (!run->count)
+		return;
+
+	table_push_u32(&track->ctts_entries.da, run->count);
+	table_push_u32(&track->ctts_entries.da,
+		       ctts_sample_offset(track, run->offset));
+	run->count = 0;
+}
+
 /// 8.6.1.2 Decoding Time to Sample Box
 static size_t mp4_write_stts(struct mp4_mux *mux, struct mp4_track *track,
 			     bool fragmented)
@@ -1166,7 +1195,7 @@ static size_t mp4_write_stts(struct mp4_mux *mux, struct mp4_track *track,
 static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 {
 	struct serializer *s = mux->serializer;
-	uint32_t num = (uint32_t)track->sync_samples.num;
+	uint32_t num = (uint32_t)(track->stss_entries.num / 4);
 
 	if (!num)
 		return 0;
@@ -1177,8 +1206,8 @@ static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 	write_fullbox(s, size, "stss", 0, 0);
 	s_wb32(s, num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++)
-		s_wb32(s, track->sync_samples.array[idx]); // sample_number
+	// sample_number(s)
+	s_write(s, track->stss_entries.array, track->stss_entries.num);
 
 	return size;
 }
@@ -1187,7 +1216,12 @@ static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 static size_t mp4_write_ctts(struct mp4_mux *mux, struct mp4_track *track)
 {
 	struct serializer *s = mux->serializer;
-	uint32_t num = (uint32_t)track->offsets.num;
+	struct sample_offset *run = &track->ctts_run;
+	uint32_t num = (uint32_t)(track->ctts_entries.num / 8);
+
+	/* The last run is only closed once a different offset comes along */
+	if (run->count)
+		num++;
 
 	uint8_t version = mux->flags & MP4_USE_NEGATIVE_CTS ? 1 : 0;
 
@@ -1197,13 +1231,14 @@ static size_t mp4_write_ctts(struct mp4_mux *mux, struct mp4_track *track)
 
 	s_wb32(s, num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++) {
-		int64_t offset = (int64_t)track->offsets.array[idx].offset *
-				 (int64_t)track->timescale /
-				 (int64_t)track->timebase_den;
+	// sample_count + sample_offset pairs
+	s_write(s, track->ctts_entries.array, track->ctts_entries.num);
+
+	if (run->count) {
+		uint32_t offset = ctts_sample_offset(track, run->offset);
 
-		s_wb32(s, track->offsets.array[idx].count); // sample_count
-		s_wb32(s, (uint32_t)offset);                // sample_offset
+		s_wb32(s, run->count); // sample_count
+		s_wb32(s, offset);     // sample_offset
 	}
 
 	return size;
@@ -1296,12 +1331,13 @@ static size_t mp4_write_stsz(struct mp4_mux *mux, struct mp4_track *track,
 		s_wb32(s, track->sample_size);       // sample_size
 		s_wb32(s, (uint32_t)track->samples); // sample_count
 	} else {
-		s_wb32(s, 0);                                 // sample_size
-		s_wb32(s, (uint32_t)track->sample_sizes.num); // sample_count
+		uint32_t num = (uint32_t)(track->stsz_entries.num / 4);
 
-		for (size_t idx = 0; idx < track->sample_sizes.num; idx++) {
-			s_wb32(s, track->sample_sizes.array[idx]); // entry_size
-		}
+		s_wb32(s, 0);   // sample_size
+		s_wb32(s, num); // sample_count
+
+		// entry_size(s)
+		s_write(s, track->stsz_entries.array, track->stsz_entries.num);
 	}
 
 	return write_box_size(s, start);
@@ -1643,9 +1679,8 @@ static size_t mp4_write_elst(struct mp4_mux *mux, struct mp4_track *track)
 		 * using b-frames). */
 		int64_t dts_offset = 0;
 
-		if (track->offsets.num) {
-			struct sample_offset sample = track->offsets.array[0];
-			dts_offset = sample.offset;
+		if (track->samples) {
+			dts_offset = track->dts_offset;
 		} else if (track->packets.size) {
 			/* If no offset data exists yet (i.e. when writing the
 			 * incomplete moov in a fragmented file) use the raw
@@ -2333,14 +2368,13 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track,
 		uint32_t size = (uint32_t)pkt->size;
 		int32_t offset = (int32_t)(pkt->pts - pkt->dts);
 
+		if (track->type == TRACK_VIDEO && !track->samples)
+			track->dts_offset = offset;
+
 		/* When using negative CTS, subtract DTS-PTS offset. */
 		if (track->type == TRACK_VIDEO &&
-		    mux->flags & MP4_USE_NEGATIVE_CTS) {
-			if (!track->offsets.num)
-				track->dts_offset = offset;
-
+		    mux->flags & MP4_USE_NEGATIVE_CTS)
 			offset -= track->dts_offset;
-		}
 
 		/* Create temporary sample information for moof */
 		struct fragment_sample *smp =
@@ -2380,30 +2414,26 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track,
 		}
 
 		if (!track->sample_size)
-			da_push_back(track->sample_sizes, &size);
+			table_push_u32(&track->stsz_entries.da, size);
 
 		if (track->type != TRACK_VIDEO)
 			continue;
 
 		if (pkt->keyframe)
-			da_push_back(track->sync_samples, &track->samples);
+			table_push_u32(&track->stss_entries.da,
+				       (uint32_t)track->samples);
 
 		/* Only require ctts box if offet is non-zero */
 		if (offset && !track->needs_ctts)
 			track->needs_ctts = true;
 
-		/* If dts-pts offset matche sprevious, increment counter,
-		 * otherwise create a new entry. */
-		if (track->offsets.num == 0 ||
-		    track->offsets.array[track->offsets.num - 1].offset !=
-			    offset) {
-			struct sample_offset *new =
-				da_push_back_new(track->offsets);
-			new->offset = offset;
-			new->count = 1;
-		} else {
-			track->offsets.array[track->offsets.num - 1].count += 1;
-		}
+		/* If dts-pts offset matches previous, increment counter,
+		 * otherwise serialise the finished run and start a new one. */
+		if (track->ctts_run.count && track->ctts_run.offset != offset)
+			close_ctts_run(track);
+
+		track->ctts_run.offset = offset;
+		track->ctts_run.count++;
 	}
 }
 
@@ -2657,11 +2687,11 @@ static inline void free_track(struct mp4_track *track)
 	free_packets(&track->packets);
 	deque_free(&track->packets);
 
-	da_free(track->sample_sizes);
 	da_free(track->chunks);
 	da_free(track->deltas);
-	da_free(track->offsets);
-	da_free(track->sync_samples);
+	da_free(track->stsz_entries);
+	da_free(track->stss_entries);
+	da_free(track->ctts_entries);
 	da_free(track->fragment_samples);
 }
 
@@ -23,6 +23,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/buffered-file-serializer.h>
 
 #include <opts-parser.h>
@@ -43,7 +44,7 @@ struct mp4_output {
 	obs_output_t *output;
 	struct dstr path;
 
-	struct serializer serializer;
+	struct serializer *serializer;
 
 	volatile bool active;
 	volatile bool stopping;
@@ -56,6 +57,7 @@ struct mp4_output {
 
 	struct mp4_mux *muxer;
 	int flags;
+	uint32_t io_flags;
 
 	int64_t last_dts_usec;
 	DARRAY(struct chapter) chapters;
@@ -78,6 +80,17 @@ struct mp4_output {
 
 	/* Buffer for packets while we reinitialise the muxer after splitting */
 	DARRAY(struct encoder_packet) split_buffer;
+
+	/* Finalises split files in the background so that writing the next
+	 * file does not have to wait for the previous file's moov. */
+	os_task_queue_t *finalise_queue;
+};
+
+struct finalise_job {
+	struct mp4_output *out;
+	struct mp4_mux *muxer;
+	struct serializer *serializer;
+	char *path;
 };
 
 static inline bool stopping(struct mp4_output *out)
@@ -142,6 +155,9 @@ static void mp4_output_destory(void *data)
 {
 	struct mp4_output *out = data;
 
+	/* Waits for any split files that are still being finalised */
+	os_task_queue_destroy(out->finalise_queue);
+
 	for (size_t i = 0; i < out->chapters.num; i++)
 		bfree(out->chapters.array[i].name);
 	da_free(out->chapters);
@@ -192,11 +208,36 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&out->manual_split, true);
 }
 
+static void get_io_stats_proc(void *data, calldata_t *cd)
+{
+	struct mp4_output *out = data;
+	struct buffered_file_serializer_stats stats = {0};
+
+	pthread_mutex_lock(&out->mutex);
+	if (active(out))
+		buffered_file_serializer_get_stats(out->serializer, &stats);
+	pthread_mutex_unlock(&out->mutex);
+
+	calldata_set_int(cd, "queued_bytes", (long long)stats.queued_bytes);
+	calldata_set_int(cd, "max_queued_bytes",
+			 (long long)stats.max_queued_bytes);
+	calldata_set_int(cd, "in_flight_bytes",
+			 (long long)stats.in_flight_bytes);
+	calldata_set_int(cd, "written_bytes", (long long)stats.written_bytes);
+	calldata_set_int(cd, "stalls", (long long)stats.stalls);
+	calldata_set_int(cd, "stall_time_ms",
+			 (long long)(stats.stall_time_ns / 1000000));
+	calldata_set_int(cd, "max_write_time_ms",
+			 (long long)(stats.max_write_time_ns / 1000000));
+	calldata_set_bool(cd, "direct_io", stats.direct_io);
+}
+
 static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct mp4_output *out = bzalloc(sizeof(struct mp4_output));
 	out->output = output;
 	pthread_mutex_init(&out->mutex, NULL);
+	out->finalise_queue = os_task_queue_create();
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void file_changed(string next_file)");
@@ -206,6 +247,13 @@ static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 			 split_file_proc, out);
 	proc_handler_add(ph, "void add_chapter(string chapter_name)",
 			 mp4_add_chapter_proc, out);
+	proc_handler_add(ph,
+			 "void get_io_stats(out int queued_bytes, "
+			 "out int max_queued_bytes, out int in_flight_bytes, "
+			 "out int written_bytes, out int stalls, "
+			 "out int stall_time_ms, out int max_write_time_ms, "
+			 "out bool direct_io)",
+			 get_io_stats_proc, out);
 
 	UNUSED_PARAMETER(settings);
 	return out;
@@ -219,9 +267,10 @@ static inline void apply_flag(int *flags, const char *value, int flag_value)
 		*flags &= ~flag_value;
 }
 
-static int parse_custom_options(const char *opts_str)
+static int parse_custom_options(const char *opts_str, uint32_t *io_flags)
 {
 	int flags = MP4_USE_NEGATIVE_CTS;
+	*io_flags = 0;
 
 	struct obs_options opts = obs_parse_options(opts_str);
 
@@ -236,6 +285,11 @@ static int parse_custom_options(const char *opts_str)
 			apply_flag(&flags, opt.value, MP4_USE_MDTA_KEY_VALUE);
 		} else if (strcmp(opt.name, "use_negative_cts") == 0) {
 			apply_flag(&flags, opt.value, MP4_USE_NEGATIVE_CTS);
+		} else if (strcmp(opt.name, "direct_io") == 0) {
+			int io = (int)*io_flags;
+			apply_flag(&io, opt.value,
+				   BUFFERED_FILE_SERIALIZER_DIRECT_IO);
+			*io_flags = (uint32_t)io;
 		} else {
 			blog(LOG_WARNING, "Unknown muxer option: %s = %s",
 			     opt.name, opt.value);
@@ -247,6 +301,22 @@ static int parse_custom_options(const char *opts_str)
 	return flags;
 }
 
+static bool open_file(struct mp4_output *out)
+{
+	struct serializer *s = bzalloc(sizeof(struct serializer));
+
+	if (!buffered_file_serializer_init2(s, out->path.array, 0, 0,
+					    out->io_flags)) {
+		warn("Unable to open MP4 file '%s'", out->path.array);
+		bfree(s);
+		return false;
+	}
+
+	out->serializer = s;
+	out->muxer = mp4_mux_create(out->output, s, out->flags);
+	return true;
+}
+
 static bool mp4_output_start(void *data)
 {
 	struct mp4_output *out = data;
@@ -272,18 +342,14 @@ static bool mp4_output_start(void *data)
 	/* Allow skipping the remux step for debugging purposes. */
 	const char *muxer_settings =
 		obs_data_get_string(settings, "muxer_settings");
-	out->flags = parse_custom_options(muxer_settings);
+	out->flags = parse_custom_options(muxer_settings, &out->io_flags);
 
 	obs_data_release(settings);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer,
-						    out->path.array)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+	/* Initialise muxer and start capture */
+	if (!open_file(out))
 		return false;
-	}
 
-	/* Initialise muxer and start capture */
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
 	os_atomic_set_bool(&out->active, true);
 	obs_output_begin_data_capture(out->output, 0);
 
@@ -376,43 +442,89 @@ static void generate_filename(struct mp4_output *out, struct dstr *dst,
 	obs_data_release(settings);
 }
 
-static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+static void log_io_stats(struct mp4_output *out, struct serializer *s)
 {
-	uint64_t start_time = os_gettime_ns();
+	struct buffered_file_serializer_stats stats;
+
+	if (!buffered_file_serializer_get_stats(s, &stats))
+		return;
+
+	info("File writer%s: peak queue %" PRIu64 " KiB, %" PRIu64
+	     " stall(s) totalling %" PRIu64 " ms, slowest write %" PRIu64
+	     " ms",
+	     stats.direct_io ? " (direct I/O)" : "",
+	     stats.max_queued_bytes / 1024, stats.stalls,
+	     stats.stall_time_ns / 1000000, stats.max_write_time_ns / 1000000);
+}
+
+static void mp4_mux_destroy_task(void *ptr)
+{
+	struct mp4_mux *muxer = ptr;
+	mp4_mux_destroy(muxer);
+}
 
-	/* finalise file */
+static void add_chapters(struct mp4_output *out)
+{
 	for (size_t i = 0; i < out->chapters.num; i++) {
 		struct chapter *chap = &out->chapters.array[i];
 		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
+		bfree(chap->name);
 	}
 
-	mp4_mux_finalise(out->muxer);
+	da_clear(out->chapters);
+}
 
-	info("Waiting for file writer to finish...");
+static void finalise_file_task(void *param)
+{
+	struct finalise_job *job = param;
+	struct mp4_output *out = job->out;
+	uint64_t start_time = os_gettime_ns();
 
-	/* flush/close file and destroy old muxer */
-	buffered_file_serializer_free(&out->serializer);
-	mp4_mux_destroy(out->muxer);
+	mp4_mux_finalise(job->muxer);
 
-	for (size_t i = 0; i < out->chapters.num; i++)
-		bfree(out->chapters.array[i].name);
+	log_io_stats(out, job->serializer);
 
-	da_clear(out->chapters);
+	/* Flush/close output file and destroy muxer */
+	buffered_file_serializer_free(job->serializer);
+	bfree(job->serializer);
+	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, job->muxer,
+		       false);
+
+	info("MP4 file '%s' finalized in the background, took %" PRIu64
+	     " ms.",
+	     job->path, (os_gettime_ns() - start_time) / 1000000);
+
+	bfree(job->path);
+	bfree(job);
+}
+
+static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+{
+	uint64_t start_time = os_gettime_ns();
+
+	add_chapters(out);
+
+	/* Hand the finished file over to the finalisation thread, writing the
+	 * moov of a long recording can take a while. */
+	struct finalise_job *job = bzalloc(sizeof(struct finalise_job));
+	job->out = out;
+	job->muxer = out->muxer;
+	job->serializer = out->serializer;
+	job->path = bstrdup(out->path.array);
+	os_task_queue_queue_task(out->finalise_queue, finalise_file_task, job);
+
+	out->muxer = NULL;
+	out->serializer = NULL;
 
-	info("MP4 file split complete. Finalization took %" PRIu64 " ms.",
+	info("MP4 file split complete. Handing over took %" PRIu64 " ms.",
 	     (os_gettime_ns() - start_time) / 1000000);
 
 	/* open new file */
 	generate_filename(out, &out->path, out->allow_overwrite);
 	info("Changing output file to '%s'", out->path.array);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer,
-						    out->path.array)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+	if (!open_file(out))
 		return false;
-	}
-
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
 
 	calldata_t cd = {0};
 	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
@@ -434,23 +546,22 @@ static void mp4_output_stop(void *data, uint64_t ts)
 	os_atomic_set_bool(&out->stopping, true);
 }
 
-static void mp4_mux_destroy_task(void *ptr)
-{
-	struct mp4_mux *muxer = ptr;
-	mp4_mux_destroy(muxer);
-}
-
 static void mp4_output_actual_stop(struct mp4_output *out, int code)
 {
 	os_atomic_set_bool(&out->active, false);
 
 	uint64_t start_time = os_gettime_ns();
 
-	for (size_t i = 0; i < out->chapters.num; i++) {
-		struct chapter *chap = &out->chapters.array[i];
-		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
+	/* Previous split files must be complete before signalling the stop */
+	os_task_queue_wait(out->finalise_queue);
+
+	/* Opening the file after a split may have failed */
+	if (!out->muxer) {
+		obs_output_signal_stop(out->output, code);
+		return;
 	}
 
+	add_chapters(out);
 	mp4_mux_finalise(out->muxer);
 
 	if (code) {
@@ -460,18 +571,15 @@ static void mp4_output_actual_stop(struct mp4_output *out, int code)
 	}
 
 	info("Waiting for file writer to finish...");
+	log_io_stats(out, out->serializer);
 
 	/* Flush/close output file and destroy muxer */
-	buffered_file_serializer_free(&out->serializer);
+	buffered_file_serializer_free(out->serializer);
+	bfree(out->serializer);
 	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, out->muxer,
 		       false);
 	out->muxer = NULL;
-
-	/* Clear chapter data */
-	for (size_t i = 0; i < out->chapters.num; i++)
-		bfree(out->chapters.array[i].name);
-
-	da_clear(out->chapters);
+	out->serializer = NULL;
 
 	info("MP4 file output complete. Finalization took %" PRIu64 " ms.",
 	     (os_gettime_ns() - start_time) / 1000000);
@@ -579,7 +687,7 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 
 	submit_packet(out, packet);
 
-	if (serializer_get_pos(&out->serializer) == -1)
+	if (serializer_get_pos(out->serializer) == -1)
 		mp4_output_actual_stop(out, OBS_OUTPUT_ERROR);
 
 unlock:
@@ -0,0 +1,503 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "rtmp-congestion.h"
+
+#include <inttypes.h>
+#include <obs-nal.h>
+
+#ifndef SEC_TO_NSEC
+#define SEC_TO_NSEC 1000000000ULL
+#endif
+
+#ifndef MSEC_TO_NSEC
+#define MSEC_TO_NSEC 1000000ULL
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* BBR style controller
+ *
+ *   The bottleneck bandwidth is estimated as the windowed maximum of the
+ * delivery rate measured over short intervals of the send thread.  Intervals
+ * in which the send queue ran empty are "app limited": they only prove that
+ * the link can do at least that much, so they may raise the estimate but are
+ * never the reason it drops (it only drops by older samples expiring).
+ *
+ *   The estimated time needed to drain the send queue at that bandwidth is the
+ * congestion signal.  When a queue builds up the encoder is moved to just
+ * below the estimated bandwidth to drain it (a decrease is applied right
+ * away); when the queue stays empty the bitrate is probed upwards in small
+ * steps.  Probing backs off exponentially each time a probe ends in
+ * congestion, which is what keeps lossy links from oscillating.  Frames are
+ * only dropped once the queue would take longer than the drop threshold to
+ * drain. */
+
+#define BBR_SAMPLE_INTERVAL_NS (250ULL * MSEC_TO_NSEC)
+#define BBR_BW_WINDOW 16 /* samples, 4 seconds */
+#define BBR_DRAIN_GAIN 0.85
+#define BBR_PROBE_CEILING 1.1
+#define BBR_PROBE_STEP 0.05
+#define BBR_PROBE_MAX_ROUNDS 3
+#define BBR_CONGESTED_USEC 200000
+#define BBR_EMPTY_USEC 50000
+#define BBR_STANDING_NS (2ULL * SEC_TO_NSEC)
+#define BBR_PROBE_WAIT_MIN_NS (2ULL * SEC_TO_NSEC)
+#define BBR_PROBE_WAIT_MAX_NS (64ULL * SEC_TO_NSEC)
+#define BBR_MIN_UPDATE_NS (1ULL * SEC_TO_NSEC)
+#define BBR_MIN_CHANGE_PCT 5
+#define BBR_BITRATE_STEP 50
+
+enum bbr_state {
+	BBR_STEADY,
+	BBR_DRAIN,
+	BBR_PROBE,
+};
+
+struct bbr_sample {
+	uint64_t time;
+	uint64_t bps;
+	bool app_limited;
+};
+
+struct bbr_cc {
+	struct rtmp_cc_config config;
+	enum bbr_state state;
+
+	/* current delivery rate interval */
+	uint64_t interval_start;
+	uint64_t interval_end;
+	uint64_t interval_bytes;
+	bool interval_app_limited;
+
+	struct bbr_sample samples[BBR_BW_WINDOW];
+	size_t sample_idx;
+	uint64_t bw_bps;
+	bool bw_app_limited;
+
+	long target;
+	long applied;
+	uint64_t last_applied;
+	uint64_t last_change;
+	uint64_t queue_empty_since;
+	uint64_t queue_busy_since;
+	uint64_t probe_wait;
+	int probe_rounds;
+	int64_t queue_usec;
+};
+
+static inline long round_bitrate(long bitrate)
+{
+	return bitrate / BBR_BITRATE_STEP * BBR_BITRATE_STEP;
+}
+
+static void *bbr_create(const struct rtmp_cc_config *config)
+{
+	struct bbr_cc *cc = bzalloc(sizeof(*cc));
+
+	cc->config = *config;
+	if (cc->config.min_bitrate <= 0)
+		cc->config.min_bitrate = 50;
+	if (cc->config.min_bitrate > cc->config.max_bitrate)
+		cc->config.min_bitrate = cc->config.max_bitrate;
+
+	cc->target = config->max_bitrate;
+	cc->applied = config->max_bitrate;
+	cc->probe_wait = BBR_PROBE_WAIT_MIN_NS;
+	cc->interval_app_limited = false;
+	return cc;
+}
+
+static void bbr_destroy(void *data)
+{
+	bfree(data);
+}
+
+static void bbr_update_bw(struct bbr_cc *cc, uint64_t now)
+{
+	uint64_t bw = 0;
+	bool app_limited = true;
+
+	for (size_t i = 0; i < BBR_BW_WINDOW; i++) {
+		const struct bbr_sample *s = &cc->samples[i];
+
+		if (!s->time || now - s->time > BBR_BW_WINDOW *
+							BBR_SAMPLE_INTERVAL_NS)
+			continue;
+
+		if (s->bps > bw) {
+			bw = s->bps;
+			app_limited = s->app_limited;
+		} else if (s->bps == bw && !s->app_limited) {
+			app_limited = false;
+		}
+	}
+
+	cc->bw_bps = bw;
+	cc->bw_app_limited = app_limited;
+}
+
+static void bbr_packet_sent(void *data, const struct rtmp_cc_sample *sample)
+{
+	struct bbr_cc *cc = data;
+
+	if (!cc->interval_start)
+		cc->interval_start = sample->send_beg;
+
+	cc->interval_bytes += sample->size;
+	cc->interval_end = sample->send_end;
+	if (!sample->queued_bytes)
+		cc->interval_app_limited = true;
+
+	uint64_t elapsed = cc->interval_end - cc->interval_start;
+	if (elapsed < BBR_SAMPLE_INTERVAL_NS)
+		return;
+
+	struct bbr_sample *s = &cc->samples[cc->sample_idx];
+	s->time = cc->interval_end;
+	s->bps = cc->interval_bytes * 8 * SEC_TO_NSEC / elapsed;
+	s->app_limited = cc->interval_app_limited;
+	cc->sample_idx = (cc->sample_idx + 1) % BBR_BW_WINDOW;
+
+	cc->interval_start = cc->interval_end;
+	cc->interval_bytes = 0;
+	cc->interval_app_limited = false;
+
+	bbr_update_bw(cc, cc->interval_end);
+}
+
+static inline long bbr_video_bw(uint64_t bw_bps, double gain,
+				long audio_bitrate)
+{
+	return (long)((double)bw_bps * gain / 1000.0) - audio_bitrate;
+}
+
+static long bbr_clamp(struct bbr_cc *cc, long bitrate)
+{
+	if (bitrate > cc->config.max_bitrate)
+		return cc->config.max_bitrate;
+	if (bitrate < cc->config.min_bitrate)
+		return cc->config.min_bitrate;
+	return bitrate;
+}
+
+/* the delivery rate of the most recent interval, if the send queue never ran
+ * empty during it, which is the best measure of the link as it is right now */
+static uint64_t bbr_recent_bw(struct bbr_cc *cc)
+{
+	size_t idx = (cc->sample_idx + BBR_BW_WINDOW - 1) % BBR_BW_WINDOW;
+	const struct bbr_sample *s = &cc->samples[idx];
+
+	return s->app_limited ? 0 : s->bps;
+}
+
+static void bbr_adapt(struct bbr_cc *cc, uint64_t now)
+{
+	if (cc->queue_usec <= BBR_EMPTY_USEC) {
+		cc->queue_busy_since = 0;
+		if (!cc->queue_empty_since)
+			cc->queue_empty_since = now;
+	} else {
+		cc->queue_empty_since = 0;
+		if (!cc->queue_busy_since)
+			cc->queue_busy_since = now;
+	}
+
+	/* a queue that never drains means the bandwidth was overestimated,
+	 * even if it stays short */
+	bool standing_queue = cc->queue_busy_since &&
+			      now - cc->queue_busy_since >= BBR_STANDING_NS;
+
+	if ((cc->queue_usec >= BBR_CONGESTED_USEC || standing_queue) &&
+	    cc->bw_bps) {
+		uint64_t bw = cc->bw_bps;
+		uint64_t recent = bbr_recent_bw(cc);
+		if (recent && recent < bw)
+			bw = recent;
+
+		long drain = bbr_video_bw(bw, BBR_DRAIN_GAIN,
+					  cc->config.audio_bitrate);
+		drain = bbr_clamp(cc, round_bitrate(drain));
+
+		if (drain < cc->target) {
+			/* a probe that ended in congestion: wait longer before
+			 * the next one */
+			if (cc->state == BBR_PROBE) {
+				cc->probe_wait *= 2;
+				if (cc->probe_wait > BBR_PROBE_WAIT_MAX_NS)
+					cc->probe_wait = BBR_PROBE_WAIT_MAX_NS;
+			}
+
+			cc->target = drain;
+			cc->state = BBR_DRAIN;
+			cc->probe_rounds = 0;
+			cc->last_change = now;
+			cc->queue_busy_since = now;
+		}
+		return;
+	}
+
+	if (!cc->queue_empty_since)
+		return;
+
+	if (cc->target >= cc->config.max_bitrate) {
+		cc->state = BBR_STEADY;
+		return;
+	}
+
+	if (now - cc->queue_empty_since < cc->probe_wait ||
+	    now - cc->last_change < cc->probe_wait)
+		return;
+
+	/* the previous probe held up, so probe again sooner and harder */
+	if (cc->state == BBR_PROBE) {
+		cc->probe_wait /= 2;
+		if (cc->probe_wait < BBR_PROBE_WAIT_MIN_NS)
+			cc->probe_wait = BBR_PROBE_WAIT_MIN_NS;
+		if (cc->probe_rounds < BBR_PROBE_MAX_ROUNDS)
+			cc->probe_rounds++;
+	}
+
+	double gain = 1.0 + BBR_PROBE_STEP * (double)(1 << cc->probe_rounds);
+	long next = round_bitrate((long)((double)cc->target * gain));
+	if (next <= cc->target)
+		next = cc->target + BBR_BITRATE_STEP;
+
+	if (!cc->bw_app_limited) {
+		/* the link has shown how much it can take: go there directly,
+		 * but don't probe past it */
+		uint64_t bw = cc->bw_bps;
+		long known = bbr_video_bw(bw, BBR_DRAIN_GAIN,
+					  cc->config.audio_bitrate);
+		long ceiling = bbr_video_bw(bw, BBR_PROBE_CEILING,
+					    cc->config.audio_bitrate);
+
+		if (next < known)
+			next = round_bitrate(known);
+		if (next > ceiling)
+			next = ceiling > cc->target ? round_bitrate(ceiling)
+						    : cc->target;
+	}
+
+	next = bbr_clamp(cc, next);
+	if (next <= cc->target)
+		return;
+
+	cc->target = next;
+	cc->state = BBR_PROBE;
+	cc->last_change = now;
+}
+
+/* Avoids feeding the encoder a stream of tiny changes: decreases are applied
+ * right away, increases at most once per second, and only changes of a few
+ * percent are worth reconfiguring the encoder for. */
+static void bbr_smooth(struct bbr_cc *cc, uint64_t now)
+{
+	long diff = cc->target - cc->applied;
+	long min_change = cc->applied * BBR_MIN_CHANGE_PCT / 100;
+
+	if (!diff)
+		return;
+
+	bool at_limit = cc->target == cc->config.max_bitrate ||
+			cc->target == cc->config.min_bitrate;
+
+	if (diff > 0 && now - cc->last_applied < BBR_MIN_UPDATE_NS)
+		return;
+	if (labs(diff) < min_change && !at_limit)
+		return;
+
+	cc->applied = cc->target;
+	cc->last_applied = now;
+}
+
+static void bbr_update(void *data, uint64_t now, size_t queued_bytes,
+		       struct rtmp_cc_decision *decision)
+{
+	struct bbr_cc *cc = data;
+
+	/* until there is an estimate, assume the link keeps up with the
+	 * configured bitrate */
+	uint64_t bw = cc->bw_bps;
+	if (!bw)
+		bw = (uint64_t)(cc->applied + cc->config.audio_bitrate) * 1000;
+
+	cc->queue_usec = (int64_t)(queued_bytes * 8 * 1000000 / bw);
+
+	if (cc->config.adapt_bitrate) {
+		bbr_adapt(cc, now);
+		bbr_smooth(cc, now);
+	}
+
+	decision->bitrate = cc->applied;
+	decision->drop_bytes = 0;
+
+	int64_t threshold = cc->config.drop_threshold_usec;
+	if (threshold > 0 && cc->queue_usec > threshold) {
+		/* drain down to half the threshold */
+		size_t keep = (size_t)(bw * (uint64_t)threshold / 2 / 8 /
+				       1000000);
+		decision->drop_bytes = queued_bytes - keep;
+	}
+
+	decision->congestion =
+		threshold > 0 ? (float)cc->queue_usec / (float)threshold : 0.0f;
+	if (decision->congestion > 1.0f)
+		decision->congestion = 1.0f;
+}
+
+static void bbr_get_status(void *data, struct dstr *status)
+{
+	static const char *states[] = {"steady", "drain", "probe"};
+	struct bbr_cc *cc = data;
+
+	dstr_printf(status,
+		    "bw %" PRIu64 " kbps%s, queue %" PRId64 " ms, "
+		    "bitrate %ld kbps (target %ld), %s",
+		    cc->bw_bps / 1000,
+		    cc->bw_app_limited ? " (app limited)" : "",
+		    cc->queue_usec / 1000, cc->applied, cc->target,
+		    states[cc->state]);
+}
+
+static const struct rtmp_cc_ops bbr_ops = {
+	.id = "bbr",
+	.create = bbr_create,
+	.destroy = bbr_destroy,
+	.packet_sent = bbr_packet_sent,
+	.update = bbr_update,
+	.get_status = bbr_get_status,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const struct rtmp_cc_ops *controllers[] = {
+	&bbr_ops,
+};
+
+const struct rtmp_cc_ops *rtmp_cc_find(const char *id)
+{
+	if (!id || !*id)
+		return NULL;
+
+	for (size_t i = 0; i < sizeof(controllers) / sizeof(controllers[0]);
+	     i++) {
+		if (strcmp(controllers[i]->id, id) == 0)
+			return controllers[i];
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Selective frame dropping */
+
+static inline struct encoder_packet *packet_at(struct deque *packets,
+					       size_t idx)
+{
+	return deque_data(packets, idx * sizeof(struct encoder_packet));
+}
+
+static inline bool can_drop(const struct encoder_packet *pkt)
+{
+	return pkt->type == OBS_ENCODER_VIDEO && !pkt->keyframe;
+}
+
+/* Drops frames of one track from the end of each group of pictures, oldest
+ * group first.  In decode order nothing refers to a later frame, so dropping
+ * the tail of a group never leaves a frame without its references. */
+static void drop_gop_tails(struct deque *packets, bool *drop, size_t count,
+			   size_t track, size_t bytes, size_t *freed,
+			   uint32_t *open_gop_cut)
+{
+	size_t start = 0;
+
+	while (*freed < bytes && start < count) {
+		size_t end = start + 1;
+		bool open = true;
+
+		for (; end < count; end++) {
+			struct encoder_packet *pkt = packet_at(packets, end);
+			if (pkt->type == OBS_ENCODER_VIDEO &&
+			    pkt->track_idx == track && pkt->keyframe) {
+				open = false;
+				break;
+			}
+		}
+
+		for (size_t i = end; i > start && *freed < bytes; i--) {
+			struct encoder_packet *pkt = packet_at(packets, i - 1);
+			if (drop[i - 1] || !can_drop(pkt) ||
+			    pkt->track_idx != track)
+				continue;
+
+			drop[i - 1] = true;
+			*freed += pkt->size;
+			if (open)
+				*open_gop_cut |= 1U << track;
+		}
+
+		start = end;
+	}
+}
+
+int rtmp_cc_drop_packets(struct deque *packets, size_t bytes, size_t *freed,
+			 uint32_t *open_gop_cut)
+{
+	size_t count = packets->size / sizeof(struct encoder_packet);
+	struct deque new_buf = {0};
+	int dropped = 0;
+
+	*freed = 0;
+	*open_gop_cut = 0;
+	if (!count || !bytes)
+		return 0;
+
+	bool *drop = bzalloc(count * sizeof(bool));
+
+	/* non-reference frames can go on their own */
+	for (size_t i = 0; i < count && *freed < bytes; i++) {
+		struct encoder_packet *pkt = packet_at(packets, i);
+		if (can_drop(pkt) &&
+		    pkt->drop_priority == OBS_NAL_PRIORITY_DISPOSABLE) {
+			drop[i] = true;
+			*freed += pkt->size;
+		}
+	}
+
+	for (size_t track = 0;
+	     track < MAX_OUTPUT_VIDEO_ENCODERS && *freed < bytes; track++)
+		drop_gop_tails(packets, drop, count, track, bytes, freed,
+			       open_gop_cut);
+
+	deque_reserve(&new_buf, packets->size);
+
+	for (size_t i = 0; i < count; i++) {
+		struct encoder_packet packet;
+		deque_pop_front(packets, &packet, sizeof(packet));
+
+		if (drop[i]) {
+			obs_encoder_packet_release(&packet);
+			dropped++;
+		} else {
+			deque_push_back(&new_buf, &packet, sizeof(packet));
+		}
+	}
+
+	deque_free(packets);
+	*packets = new_buf;
+
+	bfree(drop);
+	return dropped;
+}
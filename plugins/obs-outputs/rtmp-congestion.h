@@ -0,0 +1,88 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <util/deque.h>
+#include <util/dstr.h>
+
+/*
+ * Stream congestion control
+ *
+ *   A congestion controller is fed a sample for every packet written to the
+ * socket and is periodically asked what the stream should do: which video
+ * bitrate the encoder should run at and how many queued bytes should be
+ * dropped.  Controllers never read the clock themselves, all timestamps are
+ * passed in (in nanoseconds), so they can be driven by a simulated link as
+ * well as by the real send thread.
+ *
+ *   Controllers are not thread safe, the caller serializes access.
+ */
+
+struct rtmp_cc_config {
+	long max_bitrate;   /* video bitrate configured by the user, kbps */
+	long min_bitrate;   /* kbps */
+	long audio_bitrate; /* total audio bitrate, kbps */
+
+	/* estimated time to drain the send queue before frames are dropped */
+	int64_t drop_threshold_usec;
+
+	/* whether the encoder bitrate may be changed */
+	bool adapt_bitrate;
+};
+
+struct rtmp_cc_sample {
+	uint64_t send_beg;
+	uint64_t send_end;
+	size_t size;
+
+	/* bytes still waiting in the send queue after this packet */
+	size_t queued_bytes;
+};
+
+struct rtmp_cc_decision {
+	long bitrate;      /* video bitrate the encoder should use, kbps */
+	size_t drop_bytes; /* queued bytes to drop, 0 for none */
+	float congestion;  /* 0.0 - 1.0, for obs_output_get_congestion */
+};
+
+struct rtmp_cc_ops {
+	const char *id;
+
+	void *(*create)(const struct rtmp_cc_config *config);
+	void (*destroy)(void *data);
+
+	void (*packet_sent)(void *data, const struct rtmp_cc_sample *sample);
+	void (*update)(void *data, uint64_t now, size_t queued_bytes,
+		       struct rtmp_cc_decision *decision);
+
+	/* optional, writes a one line summary of the current state */
+	void (*get_status)(void *data, struct dstr *status);
+};
+
+const struct rtmp_cc_ops *rtmp_cc_find(const char *id);
+
+/* Drops roughly the given number of bytes of video from a queue of encoder
+ * packets without breaking references: non-reference frames first, then the
+ * tails of the oldest groups of pictures.  Audio and keyframes are never
+ * dropped.  Returns the number of dropped packets, the number of bytes they
+ * took up is written to *freed.
+ *
+ * If the newest group of pictures of a video track had to be cut, the bit for
+ * that track is set in *open_gop_cut, and the caller must also drop every
+ * following packet of that track up to its next keyframe. */
+int rtmp_cc_drop_packets(struct deque *packets, size_t bytes, size_t *freed,
+			 uint32_t *open_gop_cut);
@@ -44,6 +44,8 @@
 #define MIN_ESTIMATE_DURATION_MS 1000
 #define MAX_ESTIMATE_DURATION_MS 2000
 
+#define CC_STATUS_INTERVAL (10ULL * SEC_TO_NSEC)
+
 static const char *rtmp_stream_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -75,6 +77,7 @@ static inline void free_packets(struct rtmp_stream *stream)
 		deque_pop_front(&stream->packets, &packet, sizeof(packet));
 		obs_encoder_packet_release(&packet);
 	}
+	stream->queued_bytes = 0;
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -135,6 +138,8 @@ static void rtmp_stream_destroy(void *data)
 	deque_free(&stream->droptest_info);
 #endif
 	deque_free(&stream->dbr_frames);
+	if (stream->cc)
+		stream->cc_ops->destroy(stream->cc);
 	pthread_mutex_destroy(&stream->dbr_mutex);
 
 	os_event_destroy(stream->buffer_space_available_event);
@@ -235,7 +240,8 @@ static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
 }
 
 static inline bool get_next_packet(struct rtmp_stream *stream,
-				   struct encoder_packet *packet)
+				   struct encoder_packet *packet,
+				   size_t *queued_bytes)
 {
 	bool new_packet = false;
 
@@ -243,8 +249,10 @@ static inline bool get_next_packet(struct rtmp_stream *stream,
 	if (stream->packets.size) {
 		deque_pop_front(&stream->packets, packet,
 				sizeof(struct encoder_packet));
+		stream->queued_bytes -= packet->size;
 		new_packet = true;
 	}
+	*queued_bytes = stream->queued_bytes;
 	pthread_mutex_unlock(&stream->packets_mutex);
 
 	return new_packet;
@@ -667,12 +675,13 @@ static void *send_thread(void *data)
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
 		struct dbr_frame dbr_frame;
+		size_t queued_bytes;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
 		}
 
-		if (!get_next_packet(stream, &packet))
+		if (!get_next_packet(stream, &packet, &queued_bytes))
 			continue;
 
 		if (stopping(stream)) {
@@ -689,7 +698,7 @@ static void *send_thread(void *data)
 			}
 		}
 
-		if (stream->dbr_enabled) {
+		if (stream->dbr_enabled || stream->cc) {
 			dbr_frame.send_beg = os_gettime_ns();
 			dbr_frame.size = packet.size;
 		}
@@ -714,7 +723,19 @@ static void *send_thread(void *data)
 			break;
 		}
 
-		if (stream->dbr_enabled) {
+		if (stream->cc) {
+			struct rtmp_cc_sample sample = {
+				.send_beg = dbr_frame.send_beg,
+				.send_end = os_gettime_ns(),
+				.size = dbr_frame.size,
+				.queued_bytes = queued_bytes,
+			};
+
+			pthread_mutex_lock(&stream->dbr_mutex);
+			stream->cc_ops->packet_sent(stream->cc, &sample);
+			pthread_mutex_unlock(&stream->dbr_mutex);
+
+		} else if (stream->dbr_enabled) {
 			dbr_frame.send_end = os_gettime_ns();
 
 			pthread_mutex_lock(&stream->dbr_mutex);
@@ -1395,6 +1416,35 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->drop_threshold_usec = 1000 * drop_b;
 	stream->pframe_drop_threshold_usec = 1000 * drop_p;
 
+	pthread_mutex_lock(&stream->dbr_mutex);
+	if (stream->cc) {
+		stream->cc_ops->destroy(stream->cc);
+		stream->cc = NULL;
+	}
+
+	const char *cc_id =
+		obs_data_get_string(settings, OPT_CONGESTION_CONTROL);
+	stream->cc_ops = rtmp_cc_find(cc_id);
+	stream->cc_wait_keyframe = 0;
+	stream->cc_last_status_ts = 0;
+
+	if (stream->cc_ops) {
+		struct rtmp_cc_config config = {
+			.max_bitrate = stream->dbr_orig_bitrate,
+			.audio_bitrate = stream->audio_bitrate,
+			.drop_threshold_usec =
+				stream->pframe_drop_threshold_usec,
+			.adapt_bitrate = stream->dbr_enabled,
+		};
+
+		stream->cc = stream->cc_ops->create(&config);
+		info("Using congestion control: %s", cc_id);
+	} else if (cc_id && *cc_id) {
+		warn("Unknown congestion control '%s', using the default",
+		     cc_id);
+	}
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
 	bind_ip = obs_data_get_string(settings, OPT_BIND_IP);
 	dstr_copy(&stream->bind_ip, bind_ip);
 
@@ -1494,6 +1544,7 @@ static inline bool add_packet(struct rtmp_stream *stream,
 {
 	deque_push_back(&stream->packets, packet,
 			sizeof(struct encoder_packet));
+	stream->queued_bytes += packet->size;
 	return true;
 }
 
@@ -1529,6 +1580,7 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 
 		} else {
 			num_frames_dropped++;
+			stream->queued_bytes -= packet.size;
 			obs_encoder_packet_release(&packet);
 		}
 	}
@@ -1727,19 +1779,80 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	}
 }
 
+static void cc_update(struct rtmp_stream *stream)
+{
+	struct rtmp_cc_decision decision;
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	stream->cc_ops->update(stream->cc, now, stream->queued_bytes,
+			       &decision);
+
+	if (stream->cc_ops->get_status &&
+	    now - stream->cc_last_status_ts >= CC_STATUS_INTERVAL) {
+		struct dstr status = {0};
+		stream->cc_ops->get_status(stream->cc, &status);
+		debug("congestion control: %s", status.array);
+		dstr_free(&status);
+		stream->cc_last_status_ts = now;
+	}
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	stream->congestion = decision.congestion;
+
+	if (decision.drop_bytes) {
+		uint32_t open_gop_cut;
+		size_t freed;
+		int dropped = rtmp_cc_drop_packets(&stream->packets,
+						   decision.drop_bytes, &freed,
+						   &open_gop_cut);
+
+		stream->queued_bytes -= freed;
+		stream->dropped_frames += dropped;
+		stream->cc_wait_keyframe |= open_gop_cut;
+		debug("Dropped %d frames (%zu bytes)", dropped, freed);
+	}
+
+	if (stream->dbr_enabled &&
+	    decision.bitrate != stream->dbr_cur_bitrate) {
+		info("bitrate %s to: %ld",
+		     decision.bitrate < stream->dbr_cur_bitrate ? "decreased"
+								: "increased",
+		     decision.bitrate);
+		stream->dbr_cur_bitrate = decision.bitrate;
+		dbr_set_bitrate(stream);
+	}
+}
+
 static bool add_video_packet(struct rtmp_stream *stream,
 			     struct encoder_packet *packet)
 {
-	check_to_drop_frames(stream, false);
-	check_to_drop_frames(stream, true);
+	if (stream->cc) {
+		uint32_t track = 1U << packet->track_idx;
 
-	/* if currently dropping frames, drop packets until it reaches the
-	 * desired priority */
-	if (packet->drop_priority < stream->min_priority) {
-		stream->dropped_frames++;
-		return false;
+		cc_update(stream);
+
+		/* the rest of a group of pictures that was cut short has
+		 * nothing left to reference */
+		if (stream->cc_wait_keyframe & track) {
+			if (!packet->keyframe) {
+				stream->dropped_frames++;
+				return false;
+			}
+			stream->cc_wait_keyframe &= ~track;
+		}
 	} else {
-		stream->min_priority = 0;
+		check_to_drop_frames(stream, false);
+		check_to_drop_frames(stream, true);
+
+		/* if currently dropping frames, drop packets until it reaches
+		 * the desired priority */
+		if (packet->drop_priority < stream->min_priority) {
+			stream->dropped_frames++;
+			return false;
+		} else {
+			stream->min_priority = 0;
+		}
 	}
 
 	stream->last_dts_usec = packet->dts_usec;
@@ -1821,6 +1934,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+	obs_data_set_default_string(defaults, OPT_CONGESTION_CONTROL, "");
 #ifdef _WIN32
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
@@ -1840,6 +1954,14 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 				   200, 10000, 100);
 	obs_property_int_set_suffix(p, " ms");
 
+	p = obs_properties_add_list(
+		props, OPT_CONGESTION_CONTROL,
+		obs_module_text("RTMPStream.CongestionControl"),
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p, obs_module_text("Default"), "");
+	obs_property_list_add_string(
+		p, obs_module_text("RTMPStream.CongestionControl.BBR"), "bbr");
+
 	p = obs_properties_add_list(props, OPT_IP_FAMILY,
 				    obs_module_text("IPFamily"),
 				    OBS_COMBO_TYPE_LIST,
@@ -1896,7 +2018,9 @@ static float rtmp_stream_congestion(void *data)
 		return (float)stream->write_buf_len /
 		       (float)stream->write_buf_size;
 	else
-		return stream->min_priority > 0 ? 1.0f : stream->congestion;
+		return stream->min_priority > 0 || stream->cc_wait_keyframe
+			       ? 1.0f
+			       : stream->congestion;
 }
 
 static int rtmp_stream_connect_time(void *data)
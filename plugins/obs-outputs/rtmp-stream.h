@@ -8,6 +8,7 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "rtmp-congestion.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -32,6 +33,7 @@
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
 #define OPT_METADATA_MULTITRACK "metadata_multitrack"
+#define OPT_CONGESTION_CONTROL "congestion_control"
 
 //#define TEST_FRAMEDROPS
 //#define TEST_FRAMEDROPS_WITH_BITRATE_SHORTCUTS
@@ -114,6 +116,14 @@ struct rtmp_stream {
 	long dbr_inc_bitrate;
 	bool dbr_enabled;
 
+	/* congestion controller, replaces the drop thresholds and the dbr
+	 * logic above when one is selected */
+	const struct rtmp_cc_ops *cc_ops;
+	void *cc;
+	size_t queued_bytes;
+	uint32_t cc_wait_keyframe;
+	uint64_t cc_last_status_ts;
+
 	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
@@ -1,5 +1,6 @@
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/threading.h>
 #include "util/platform.h"
 
 #define TIMING_TIME 0
@@ -32,6 +33,10 @@ struct stinger_info {
 	int monitoring_type;
 	enum fade_style fade_style;
 
+	bool preroll;
+	uint32_t preroll_max_wait_ms;
+	volatile bool active;
+
 	bool track_matte_enabled;
 	int matte_layout;
 	float matte_width_factor;
@@ -64,12 +69,49 @@ static float mix_b_fade_in_out(void *data, float t);
 static float mix_a_cross_fade(void *data, float t);
 static float mix_b_cross_fade(void *data, float t);
 
+static void set_preroll(obs_source_t *media_source, bool enabled)
+{
+	if (!media_source)
+		return;
+
+	proc_handler_t *ph = obs_source_get_proc_handler(media_source);
+	calldata_t cd = {0};
+
+	calldata_set_bool(&cd, "enabled", enabled);
+	proc_handler_call(ph, "set_preroll", &cd);
+	calldata_free(&cd);
+}
+
+static bool preroll_ready(obs_source_t *media_source)
+{
+	if (!media_source)
+		return true;
+
+	proc_handler_t *ph = obs_source_get_proc_handler(media_source);
+	calldata_t cd = {0};
+	bool ready = true;
+
+	/* sources that can't pre-roll never become more ready */
+	if (proc_handler_call(ph, "get_preroll_ready", &cd))
+		ready = calldata_bool(&cd, "ready");
+	calldata_free(&cd);
+	return ready;
+}
+
 static void stinger_update(void *data, obs_data_t *settings)
 {
 	struct stinger_info *s = data;
 	const char *path = obs_data_get_string(settings, "path");
 	bool hw_decode = obs_data_get_bool(settings, "hw_decode");
 	bool preload = obs_data_get_bool(settings, "preload");
+	int preroll_frames = 0;
+
+	s->preroll = obs_data_get_bool(settings, "preroll");
+	s->preroll_max_wait_ms =
+		(uint32_t)obs_data_get_int(settings, "preroll_max_wait");
+	if (s->preroll)
+		preroll_frames =
+			(int)obs_data_get_int(settings, "preroll_frames");
 
 	obs_data_t *media_settings = obs_data_create();
 	obs_data_set_string(media_settings, "local_file", path);
@@ -79,8 +121,12 @@ static void stinger_update(void *data, obs_data_t *settings)
 	obs_data_set_bool(media_settings, "is_stinger", true);
 	obs_data_set_bool(media_settings, "is_track_matte",
 			  s->track_matte_enabled);
+	obs_data_set_int(media_settings, "preroll_frames", preroll_frames);
 
-	obs_source_release(s->media_source);
+	/* create the new media source before releasing the old one, so that
+	 * when preloading, a clip that did not change is still in the shared
+	 * decode cache and does not have to be decoded again */
+	obs_source_t *old_media_source = s->media_source;
 	struct dstr name;
 	dstr_init_copy(&name, obs_source_get_name(s->source));
 	dstr_cat(&name, " (Stinger)");
@@ -88,6 +134,7 @@ static void stinger_update(void *data, obs_data_t *settings)
 						    media_settings);
 	dstr_free(&name);
 	obs_data_release(media_settings);
+	obs_source_release(old_media_source);
 
 	int64_t point = obs_data_get_int(settings, "transition_point");
 
@@ -126,6 +173,8 @@ static void stinger_update(void *data, obs_data_t *settings)
 		obs_data_t *tm_media_settings = obs_data_create();
 		obs_data_set_string(tm_media_settings, "local_file", tm_path);
 		obs_data_set_bool(tm_media_settings, "looping", false);
+		obs_data_set_int(tm_media_settings, "preroll_frames",
+				 preroll_frames);
 
 		s->matte_source = obs_source_create_private(
 			"ffmpeg_source", NULL, tm_media_settings);
@@ -135,6 +184,12 @@ static void stinger_update(void *data, obs_data_t *settings)
 		obs_source_set_muted(s->matte_source, true);
 	}
 
+	/* the media sources may have been recreated */
+	if (s->preroll && os_atomic_load_bool(&s->active)) {
+		set_preroll(s->media_source, true);
+		set_preroll(s->matte_source, true);
+	}
+
 	s->monitoring_type =
 		(int)obs_data_get_int(settings, "audio_monitoring");
 	obs_source_set_monitoring_type(s->media_source, s->monitoring_type);
@@ -163,9 +218,10 @@ static void stinger_update(void *data, obs_data_t *settings)
 		s->stinger_tex = NULL;
 
 		if (s->track_matte_enabled) {
-			s->matte_tex = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-			s->stinger_tex =
-				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+			s->matte_tex = gs_texrender_create_transient(
+				GS_RGBA, GS_ZS_NONE);
+			s->stinger_tex = gs_texrender_create_transient(
+				GS_RGBA, GS_ZS_NONE);
 		}
 
 		obs_leave_graphics();
@@ -230,6 +286,52 @@ static void stinger_destroy(void *data)
 static void stinger_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "hw_decode", true);
+	obs_data_set_default_bool(settings, "preroll", true);
+	obs_data_set_default_int(settings, "preroll_frames", 30);
+	obs_data_set_default_int(settings, "preroll_max_wait", 100);
+}
+
+/* The media is pre-rolled for as long as the stinger is the active
+ * transition, so that starting it does not wait on opening the file and
+ * warming up the decoder. */
+static void stinger_activate(void *data)
+{
+	struct stinger_info *s = data;
+
+	os_atomic_set_bool(&s->active, true);
+	if (s->preroll) {
+		set_preroll(s->media_source, true);
+		set_preroll(s->matte_source, true);
+	}
+}
+
+static void stinger_deactivate(void *data)
+{
+	struct stinger_info *s = data;
+
+	os_atomic_set_bool(&s->active, false);
+	set_preroll(s->media_source, false);
+	set_preroll(s->matte_source, false);
+}
+
+/* defers the start of the transition by at most preroll_max_wait_ms if the
+ * first frames are not decoded yet, the start time is only taken after
+ * transition_start returns */
+static void wait_for_preroll(struct stinger_info *s)
+{
+	uint64_t end_ns = os_gettime_ns() +
+			  (uint64_t)s->preroll_max_wait_ms * 1000000ULL;
+
+	while (!preroll_ready(s->media_source) ||
+	       !preroll_ready(s->matte_source)) {
+		if (os_gettime_ns() >= end_ns) {
+			blog(LOG_DEBUG, "Stinger '%s': pre-roll not ready",
+			     obs_source_get_name(s->source));
+			break;
+		}
+
+		os_sleep_ms(2);
+	}
 }
 
 static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b,
@@ -266,7 +368,8 @@ static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b,
 		enum gs_color_format format = gs_get_format_from_space(space);
 		if (gs_texrender_get_format(s->matte_tex) != format) {
 			gs_texrender_destroy(s->matte_tex);
-			s->matte_tex = gs_texrender_create(format, GS_ZS_NONE);
+			s->matte_tex = gs_texrender_create_transient(
+				format, GS_ZS_NONE);
 		}
 
 		if (gs_texrender_begin_with_color_space(s->matte_tex, cx, cy,
@@ -318,7 +421,8 @@ static void stinger_texrender(struct stinger_info *s, uint32_t source_cx,
 	enum gs_color_format format = gs_get_format_from_space(space);
 	if (gs_texrender_get_format(s->stinger_tex) != format) {
 		gs_texrender_destroy(s->stinger_tex);
-		s->stinger_tex = gs_texrender_create(format, GS_ZS_NONE);
+		s->stinger_tex =
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(s->stinger_tex, source_cx,
@@ -584,6 +688,9 @@ static void stinger_transition_start(void *data)
 
 		s->matte_rendered = false;
 
+		if (s->preroll)
+			wait_for_preroll(s);
+
 		proc_handler_call(ph, "get_duration", &cd);
 		proc_handler_call(ph, "get_nb_frames", &cd);
 		s->duration_ns =
@@ -768,6 +875,27 @@ static obs_properties_t *stinger_properties(void *data)
 			       obs_module_text("TransitionPoint"), 0, 120000,
 			       1);
 
+	// pre-roll properties
+	{
+		obs_properties_t *preroll_group = obs_properties_create();
+
+		obs_properties_add_int(preroll_group, "preroll_frames",
+				       obs_module_text("PrerollFrames"), 1,
+				       120, 1);
+
+		p = obs_properties_add_int(preroll_group, "preroll_max_wait",
+					   obs_module_text("PrerollMaxWait"),
+					   0, 1000, 1);
+		obs_property_int_set_suffix(p, " ms");
+
+		p = obs_properties_add_group(ppts, "preroll",
+					     obs_module_text("Preroll"),
+					     OBS_GROUP_CHECKABLE,
+					     preroll_group);
+		obs_property_set_long_description(
+			p, obs_module_text("Preroll.Description"));
+	}
+
 	// track matte properties
 	{
 		obs_properties_t *track_matte_group = obs_properties_create();
@@ -925,6 +1053,8 @@ struct obs_source_info stinger_transition = {
 	.get_properties = stinger_properties,
 	.enum_active_sources = stinger_enum_active_sources,
 	.enum_all_sources = stinger_enum_all_sources,
+	.activate = stinger_activate,
+	.deactivate = stinger_deactivate,
 	.transition_start = stinger_transition_start,
 	.transition_stop = stinger_transition_stop,
 	.video_get_color_space = stinger_get_color_space,
@@ -258,6 +258,11 @@ static void ft2_source_destroy(void *data)
 	if (srcdata->text_file != NULL)
 		bfree(srcdata->text_file);
 
+	unwatch_text_file(srcdata);
+	dstr_free(&srcdata->log_tail);
+	bfree(srcdata->layout_text);
+	da_free(srcdata->layout);
+
 	obs_enter_graphics();
 
 	if (srcdata->tex != NULL) {
@@ -296,11 +301,44 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 		draw_drop_shadow(srcdata);
 
 	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6, true);
+			srcdata->vbuf_glyphs * 6, true);
 
 	UNUSED_PARAMETER(effect);
 }
 
+static void reload_text_file(struct ft2_source *srcdata, bool appended)
+{
+	if (!srcdata->log_mode)
+		load_text_from_file(srcdata, srcdata->text_file);
+	else if (!appended || !read_appended(srcdata, srcdata->text_file))
+		read_from_end(srcdata, srcdata->text_file);
+
+	cache_glyphs(srcdata, srcdata->text);
+	set_up_vertex_buffer(srcdata);
+	srcdata->update_file = false;
+}
+
+/* Chat logs are read as soon as something is appended to them and other
+ * files as soon as their writer closes them.  Anything else is still picked
+ * up by checking the modification time. */
+static void check_text_file_events(struct ft2_source *srcdata)
+{
+	uint32_t events = get_text_file_events(srcdata);
+
+	if (events & TEXT_FILE_REPLACED) {
+		watch_text_file(srcdata);
+		reload_text_file(srcdata, false);
+	} else if ((events & TEXT_FILE_WRITTEN) ||
+		   ((events & TEXT_FILE_MODIFIED) && srcdata->log_mode)) {
+		reload_text_file(srcdata, true);
+	} else {
+		return;
+	}
+
+	/* already up to date, keep the timer from reading it again */
+	srcdata->m_timestamp = get_modified_timestamp(srcdata->text_file);
+}
+
 static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
@@ -309,19 +347,17 @@ static void ft2_video_tick(void *data, float seconds)
 	if (!srcdata->from_file || !srcdata->text_file)
 		return;
 
+	if (text_file_watched(srcdata))
+		check_text_file_events(srcdata);
+
 	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
 		time_t t = get_modified_timestamp(srcdata->text_file);
 		srcdata->last_checked = os_gettime_ns();
 
 		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
+			reload_text_file(srcdata, true);
+			if (!text_file_watched(srcdata))
+				watch_text_file(srcdata);
 		}
 
 		if (srcdata->m_timestamp != t) {
@@ -500,6 +536,8 @@ skip_font_load:
 		const char *tmp = obs_data_get_string(settings, "text_file");
 
 		if (!tmp || !*tmp || !os_file_exists(tmp)) {
+			unwatch_text_file(srcdata);
+
 			const char *emptystr = " ";
 
 			bfree(srcdata->text);
@@ -525,12 +563,15 @@ skip_font_load:
 			else
 				load_text_from_file(srcdata, tmp);
 			srcdata->last_checked = os_gettime_ns();
+			watch_text_file(srcdata);
 		}
 	} else {
 		const char *tmp = obs_data_get_string(settings, "text");
 		if (!tmp)
 			goto error;
 
+		unwatch_text_file(srcdata);
+
 		if (srcdata->text != NULL) {
 			bfree(srcdata->text);
 			srcdata->text = NULL;
@@ -560,6 +601,8 @@ static void *ft2_source_create(obs_data_t *settings, obs_source_t *source)
 {
 	struct ft2_source *srcdata = bzalloc(sizeof(struct ft2_source));
 	srcdata->src = source;
+	srcdata->watch_fd = -1;
+	srcdata->watch_wd = -1;
 
 	init_plugin();
 
@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
 #include <ft2build.h>
 
 #define num_cache_slots 65535
@@ -29,6 +31,18 @@ struct glyph_info {
 	FT_Pos xadv;
 };
 
+/* pen position before a character was laid out */
+struct layout_pos {
+	uint32_t dx, dy;
+	uint32_t glyph;
+};
+
+enum text_file_event {
+	TEXT_FILE_MODIFIED = 1 << 0,
+	TEXT_FILE_WRITTEN = 1 << 1,
+	TEXT_FILE_REPLACED = 1 << 2,
+};
+
 struct ft2_source {
 	char *font_name;
 	char *font_style;
@@ -44,6 +58,16 @@ struct ft2_source {
 	bool update_file;
 	uint64_t last_checked;
 
+	/* chat log mode keeps the raw tail of the file so that only bytes
+	 * appended to it have to be read */
+	struct dstr log_tail;
+	int64_t log_offset;
+	uint64_t log_ino;
+	bool log_tail_valid;
+
+	int watch_fd;
+	int watch_wd;
+
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
 	uint32_t texbuf_x, texbuf_y;
@@ -59,6 +83,17 @@ struct ft2_source {
 
 	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_glyphs;
+	uint32_t vbuf_capacity;
+
+	/* text the vertex buffer was laid out for, and what it was laid out
+	 * with, so that changed text only lays out the glyphs that moved */
+	wchar_t *layout_text;
+	DARRAY(struct layout_pos) layout;
+	uint32_t layout_max_h;
+	uint32_t layout_offset;
+	uint32_t layout_custom_width;
+	uint32_t layout_color[2];
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -78,9 +113,20 @@ uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 time_t get_modified_timestamp(char *filename);
 void load_text_from_file(struct ft2_source *srcdata, const char *filename);
 void read_from_end(struct ft2_source *srcdata, const char *filename);
+bool read_appended(struct ft2_source *srcdata, const char *filename);
+
+void watch_text_file(struct ft2_source *srcdata);
+void unwatch_text_file(struct ft2_source *srcdata);
+uint32_t get_text_file_events(struct ft2_source *srcdata);
+
+static inline bool text_file_watched(const struct ft2_source *srcdata)
+{
+	return srcdata->watch_wd != -1;
+}
 
 void cache_standard_glyphs(struct ft2_source *srcdata);
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
 void fill_vertex_buffer(struct ft2_source *srcdata);
+void reset_text_layout(struct ft2_source *srcdata);
@@ -23,6 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 float offsets[16] = {-2.0f, 0.0f, 0.0f, -2.0f, 2.0f,  0.0f, 2.0f,  0.0f,
 		     0.0f,  2.0f, 0.0f, 2.0f,  -2.0f, 0.0f, -2.0f, 0.0f};
 
@@ -38,8 +43,8 @@ void draw_outlines(struct ft2_source *srcdata)
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
 		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-				srcdata->draw_effect,
-				(uint32_t)wcslen(srcdata->text) * 6, false);
+				srcdata->draw_effect, srcdata->vbuf_glyphs * 6,
+				false);
 	}
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -53,7 +58,7 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
 	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6, false);
+			srcdata->vbuf_glyphs * 6, false);
 	gs_matrix_identity();
 	gs_matrix_pop();
 }
@@ -74,27 +79,40 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 	srcdata->cy = srcdata->max_h;
 
 	obs_enter_graphics();
-	if (srcdata->vbuf != NULL) {
+
+	len = wcslen(srcdata->text);
+
+	/* the vertex buffer is kept as long as the text fits, so that only
+	 * the glyphs that changed have to be laid out again */
+	if (srcdata->vbuf != NULL &&
+	    (len == 0 || len > srcdata->vbuf_capacity)) {
 		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
 		srcdata->vbuf = NULL;
+		srcdata->vbuf_glyphs = 0;
+		srcdata->vbuf_capacity = 0;
 		gs_vertexbuffer_destroy(tmpvbuf);
+		reset_text_layout(srcdata);
 	}
 
-	if (*srcdata->text == 0) {
+	if (len == 0) {
 		obs_leave_graphics();
 		return;
 	}
 
-	srcdata->vbuf =
-		create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
+	if (srcdata->vbuf == NULL) {
+		uint32_t capacity = srcdata->vbuf_capacity * 2;
+		if (capacity < len)
+			capacity = (uint32_t)len;
+
+		srcdata->vbuf = create_uv_vbuffer(capacity * 6, true);
+		srcdata->vbuf_capacity = capacity;
+	}
 
 	if (srcdata->custom_width <= 100)
 		goto skip_word_wrap;
 	if (!srcdata->word_wrap)
 		goto skip_word_wrap;
 
-	len = wcslen(srcdata->text);
-
 	for (uint32_t i = 0; i <= len; i++) {
 		if (i == wcslen(srcdata->text))
 			goto eos_check;
@@ -131,6 +149,101 @@ skip_word_wrap:;
 	obs_leave_graphics();
 }
 
+void reset_text_layout(struct ft2_source *srcdata)
+{
+	bfree(srcdata->layout_text);
+	srcdata->layout_text = NULL;
+	da_resize(srcdata->layout, 0);
+}
+
+static inline bool layout_changed(struct ft2_source *srcdata, uint32_t offset)
+{
+	return srcdata->layout_max_h != srcdata->max_h ||
+	       srcdata->layout_offset != offset ||
+	       srcdata->layout_custom_width != srcdata->custom_width ||
+	       srcdata->layout_color[0] != srcdata->color[0] ||
+	       srcdata->layout_color[1] != srcdata->color[1];
+}
+
+/* Moves the glyphs laid out for old_text[start:] to the top, for text that
+ * dropped its first lines, e.g. a chat log that scrolled. */
+static void shift_layout(struct ft2_source *srcdata, struct gs_vb_data *vdata,
+			 size_t start, size_t old_len)
+{
+	struct layout_pos *pos = srcdata->layout.array;
+	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
+	uint32_t first = pos[start].glyph;
+	uint32_t dy = pos[start].dy - srcdata->max_h;
+	size_t verts = (size_t)(pos[old_len].glyph - first) * 6;
+
+	memmove(vdata->points, vdata->points + first * 6,
+		verts * sizeof(struct vec3));
+	memmove(tvarray, tvarray + first * 6, verts * sizeof(struct vec2));
+	memmove(vdata->colors, vdata->colors + first * 6,
+		verts * sizeof(uint32_t));
+
+	for (size_t i = 0; i < verts; i++)
+		vdata->points[i].y -= (float)dy;
+
+	memmove(pos, pos + start, (old_len - start + 1) * sizeof(*pos));
+	for (size_t i = 0; i <= old_len - start; i++) {
+		pos[i].dy -= dy;
+		pos[i].glyph -= first;
+	}
+}
+
+/* Returns how many characters of the new text are already laid out. */
+static size_t reuse_layout(struct ft2_source *srcdata,
+			   struct gs_vb_data *vdata, uint32_t offset,
+			   size_t len)
+{
+	const wchar_t *old_text = srcdata->layout_text;
+	const wchar_t *text = srcdata->text;
+
+	if (!old_text || layout_changed(srcdata, offset))
+		return 0;
+
+	size_t old_len = wcslen(old_text);
+	size_t same = 0;
+
+	while (same < old_len && same < len && old_text[same] == text[same])
+		same++;
+
+	if (same == old_len)
+		return same;
+
+	/* lines starting after a line break do not depend on the lines
+	 * before them, so if whole lines were removed from the top the rest
+	 * only has to move up */
+	for (size_t i = 1; old_len - i > same; i++) {
+		size_t keep = old_len - i;
+
+		if (old_text[i - 1] != L'\n' || keep > len)
+			continue;
+		if (wmemcmp(old_text + i, text, keep) == 0) {
+			shift_layout(srcdata, vdata, i, old_len);
+			return keep;
+		}
+	}
+
+	return same;
+}
+
+static uint32_t get_layout_height(struct ft2_source *srcdata,
+				  struct gs_vb_data *vdata)
+{
+	float max_y = (float)srcdata->max_h;
+
+	/* the third vertex of each glyph is its bottom left corner */
+	for (uint32_t i = 0; i < srcdata->vbuf_glyphs; i++) {
+		float y = vdata->points[i * 6 + 2].y;
+		if (y > max_y)
+			max_y = y;
+	}
+
+	return (uint32_t)max_y;
+}
+
 void fill_vertex_buffer(struct ft2_source *srcdata)
 {
 	struct gs_vb_data *vdata = gs_vertexbuffer_get_data(srcdata->vbuf);
@@ -142,63 +255,64 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 
 	FT_UInt glyph_index = 0;
 
-	uint32_t dx = 0, dy = srcdata->max_h, max_y = dy;
-	uint32_t cur_glyph = 0;
-	uint32_t offset = 0;
+	uint32_t offset = srcdata->outline_text ? 2 : 0;
 	size_t len = wcslen(srcdata->text);
+	size_t start = reuse_layout(srcdata, vdata, offset, len);
+	struct layout_pos pos = {offset, srcdata->max_h, 0};
 
-	if (srcdata->outline_text) {
-		offset = 2;
-		dx = offset;
-	}
+	da_resize(srcdata->layout, len + 1);
+	if (start > 0)
+		pos = srcdata->layout.array[start];
+
+	for (size_t i = start; i < len; i++) {
+		const wchar_t c = srcdata->text[i];
+
+		srcdata->layout.array[i] = pos;
+
+		if (c == L'\n') {
+			pos.dx = offset;
+			pos.dy += srcdata->max_h + 4;
+			continue;
+		}
 
-	for (size_t i = 0; i < len; i++) {
-	add_linebreak:;
-		if (srcdata->text[i] != L'\n')
-			goto draw_glyph;
-		dx = offset;
-		i++;
-		dy += srcdata->max_h + 4;
-		if (i == wcslen(srcdata->text))
-			goto skip_glyph;
-		if (srcdata->text[i] == L'\n')
-			goto add_linebreak;
-	draw_glyph:;
 		// Skip filthy dual byte Windows line breaks
-		if (srcdata->text[i] == L'\r')
-			goto skip_glyph;
+		if (c == L'\r')
+			continue;
 
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
+		glyph_index = FT_Get_Char_Index(srcdata->font_face, c);
 		if (src_glyph == NULL)
-			goto skip_glyph;
-
-		if (srcdata->custom_width < 100)
-			goto skip_custom_width;
+			continue;
 
-		if (dx + src_glyph->xadv > srcdata->custom_width) {
-			dx = offset;
-			dy += srcdata->max_h + 4;
+		if (srcdata->custom_width >= 100 &&
+		    pos.dx + src_glyph->xadv > srcdata->custom_width) {
+			pos.dx = offset;
+			pos.dy += srcdata->max_h + 4;
 		}
 
-	skip_custom_width:;
-
-		set_v3_rect(vdata->points + (cur_glyph * 6),
-			    (float)dx + (float)src_glyph->xoff,
-			    (float)dy - (float)src_glyph->yoff,
+		set_v3_rect(vdata->points + (pos.glyph * 6),
+			    (float)pos.dx + (float)src_glyph->xoff,
+			    (float)pos.dy - (float)src_glyph->yoff,
 			    (float)src_glyph->w, (float)src_glyph->h);
-		set_v2_uv(tvarray + (cur_glyph * 6), src_glyph->u, src_glyph->v,
-			  src_glyph->u2, src_glyph->v2);
-		set_rect_colors2(col + (cur_glyph * 6), srcdata->color[0],
+		set_v2_uv(tvarray + (pos.glyph * 6), src_glyph->u,
+			  src_glyph->v, src_glyph->u2, src_glyph->v2);
+		set_rect_colors2(col + (pos.glyph * 6), srcdata->color[0],
 				 srcdata->color[1]);
-		dx += src_glyph->xadv;
-		if (dy - (float)src_glyph->yoff + src_glyph->h > max_y)
-			max_y = dy - src_glyph->yoff + src_glyph->h;
-		cur_glyph++;
-	skip_glyph:;
+		pos.dx += src_glyph->xadv;
+		pos.glyph++;
 	}
 
-	srcdata->cy = max_y;
+	srcdata->layout.array[len] = pos;
+	srcdata->vbuf_glyphs = pos.glyph;
+	srcdata->cy = get_layout_height(srcdata, vdata);
+
+	bfree(srcdata->layout_text);
+	srcdata->layout_text = bmemdup(srcdata->text,
+				       (len + 1) * sizeof(wchar_t));
+	srcdata->layout_max_h = srcdata->max_h;
+	srcdata->layout_offset = offset;
+	srcdata->layout_custom_width = srcdata->custom_width;
+	srcdata->layout_color[0] = srcdata->color[0];
+	srcdata->layout_color[1] = srcdata->color[1];
 }
 
 void cache_standard_glyphs(struct ft2_source *srcdata)
@@ -212,6 +326,7 @@ void cache_standard_glyphs(struct ft2_source *srcdata)
 
 	srcdata->texbuf_x = 0;
 	srcdata->texbuf_y = 0;
+	reset_text_layout(srcdata);
 
 	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
 			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
@@ -455,6 +570,8 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 
 	bool utf16 = false;
 
+	srcdata->log_tail_valid = false;
+
 	tmp_file = fopen(filename, "rb");
 	if (tmp_file == NULL) {
 		if (!srcdata->file_load_failed) {
@@ -516,6 +633,14 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 	bytes_read = fread(tmp_read, filesize - cur_pos, 1, tmp_file);
 	fclose(tmp_file);
 
+	struct stat stats;
+	if (os_stat(filename, &stats) == 0) {
+		dstr_copy(&srcdata->log_tail, tmp_read);
+		srcdata->log_offset = filesize;
+		srcdata->log_ino = (uint64_t)stats.st_ino;
+		srcdata->log_tail_valid = true;
+	}
+
 	if (srcdata->text != NULL) {
 		bfree(srcdata->text);
 		srcdata->text = NULL;
@@ -528,6 +653,159 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 	bfree(tmp_read);
 }
 
+/* same as the search for the first line to show in read_from_end() */
+static size_t get_log_start(const char *str, size_t size, uint32_t log_lines)
+{
+	size_t pos = size;
+	uint32_t line_breaks = 0;
+
+	while (line_breaks <= log_lines && pos != 0) {
+		if (str[--pos] == '\n')
+			line_breaks++;
+	}
+
+	return pos != 0 ? pos + 1 : 0;
+}
+
+/* Reads only what was appended to a chat log since the last read.  Returns
+ * false if the file was truncated, replaced, rewritten or is UTF-16, in which
+ * case it has to be read with read_from_end() again. */
+bool read_appended(struct ft2_source *srcdata, const char *filename)
+{
+	struct dstr *tail = &srcdata->log_tail;
+	struct stat stats;
+
+	if (!srcdata->log_tail_valid || os_stat(filename, &stats) != 0)
+		return false;
+	if ((uint64_t)stats.st_ino != srcdata->log_ino ||
+	    (int64_t)stats.st_size < srcdata->log_offset ||
+	    (int64_t)tail->len > srcdata->log_offset)
+		return false;
+
+	FILE *tmp_file = os_fopen(filename, "rb");
+	if (tmp_file == NULL)
+		return false;
+
+	/* the inode and size do not tell a file that was rewritten in place
+	 * (and st_ino is 0 on Windows), so the bytes the tail was read from
+	 * have to be unchanged as well */
+	const size_t prev_len = tail->len;
+	const size_t size =
+		(size_t)((int64_t)stats.st_size - srcdata->log_offset);
+	char *buf = bmalloc(prev_len + size + 1);
+	size_t bytes_read = 0;
+
+	if (os_fseeki64(tmp_file, srcdata->log_offset - (int64_t)prev_len,
+			SEEK_SET) == 0)
+		bytes_read = fread(buf, 1, prev_len + size, tmp_file);
+	fclose(tmp_file);
+
+	if (bytes_read < prev_len ||
+	    (prev_len && memcmp(buf, tail->array, prev_len) != 0)) {
+		bfree(buf);
+		return false;
+	}
+
+	bytes_read -= prev_len;
+	if (bytes_read == 0) {
+		bfree(buf);
+		return true;
+	}
+
+	dstr_ncat(tail, buf + prev_len, bytes_read);
+	srcdata->log_offset += bytes_read;
+	bfree(buf);
+
+	size_t start = get_log_start(tail->array, tail->len,
+				     srcdata->log_lines);
+	if (start)
+		dstr_remove(tail, 0, start);
+
+	const char *str = tail->array ? tail->array : "";
+
+	bfree(srcdata->text);
+	srcdata->text = bzalloc((strlen(str) + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(str, strlen(str), srcdata->text, strlen(str) + 1);
+
+	remove_cr(srcdata->text);
+	return true;
+}
+
+void watch_text_file(struct ft2_source *srcdata)
+{
+#ifdef __linux__
+	if (srcdata->watch_fd == -1)
+		srcdata->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (srcdata->watch_fd == -1)
+		return;
+
+	int wd = -1;
+	if (srcdata->text_file)
+		wd = inotify_add_watch(srcdata->watch_fd, srcdata->text_file,
+				       IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+					       IN_MOVE_SELF | IN_DELETE_SELF);
+
+	/* the same file keeps its watch descriptor.  Removing a watch queues
+	 * IN_IGNORED for it, which get_text_file_events() skips because the
+	 * descriptor is no longer the current one */
+	if (srcdata->watch_wd != -1 && srcdata->watch_wd != wd)
+		inotify_rm_watch(srcdata->watch_fd, srcdata->watch_wd);
+
+	srcdata->watch_wd = wd;
+#else
+	UNUSED_PARAMETER(srcdata);
+#endif
+}
+
+void unwatch_text_file(struct ft2_source *srcdata)
+{
+#ifdef __linux__
+	if (srcdata->watch_fd != -1)
+		close(srcdata->watch_fd);
+#endif
+	srcdata->watch_fd = -1;
+	srcdata->watch_wd = -1;
+}
+
+/* Returns the text_file_event flags for everything that happened to the
+ * watched file since the last call. */
+uint32_t get_text_file_events(struct ft2_source *srcdata)
+{
+	uint32_t events = 0;
+
+#ifdef __linux__
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t size;
+
+	if (srcdata->watch_fd == -1)
+		return 0;
+
+	while ((size = read(srcdata->watch_fd, buf, sizeof(buf))) > 0) {
+		for (char *ptr = buf; ptr < buf + size;) {
+			const struct inotify_event *event = (void *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			/* left over from a watch that was replaced */
+			if (event->wd != srcdata->watch_wd)
+				continue;
+
+			if (event->mask & (IN_MODIFY | IN_ATTRIB))
+				events |= TEXT_FILE_MODIFIED;
+			if (event->mask & IN_CLOSE_WRITE)
+				events |= TEXT_FILE_WRITTEN;
+			if (event->mask &
+			    (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+				events |= TEXT_FILE_REPLACED;
+		}
+	}
+#else
+	UNUSED_PARAMETER(srcdata);
+#endif
+
+	return events;
+}
+
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
 {
 	if (!text) {
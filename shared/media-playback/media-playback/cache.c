@@ -14,8 +14,11 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/stat.h>
+
 #include <media-io/audio-io.h>
 #include <util/platform.h>
+#include <util/dstr.h>
 
 #include "media-playback.h"
 #include "cache.h"
@@ -32,8 +35,8 @@ static bool mp_cache_reset(mp_cache_t *c);
 
 static int64_t base_sys_ts = 0;
 
-#define v_eof(c) (c->cur_v_idx == c->video_frames.num)
-#define a_eof(c) (c->cur_a_idx == c->audio_segments.num)
+#define v_eof(c) (c->cur_v_idx == c->clip->video_frames.num)
+#define a_eof(c) (c->cur_a_idx == c->clip->audio_segments.num)
 
 static inline int64_t mp_cache_get_next_min_pts(mp_cache_t *c)
 {
@@ -111,6 +114,16 @@ static bool mp_cache_eof(mp_cache_t *c)
 	return true;
 }
 
+static inline bool mp_cache_killed(mp_cache_t *c)
+{
+	bool kill;
+
+	pthread_mutex_lock(&c->mutex);
+	kill = c->kill;
+	pthread_mutex_unlock(&c->mutex);
+	return kill;
+}
+
 bool mp_cache_decode(mp_cache_t *c)
 {
 	mp_media_t *m = &c->m;
@@ -121,6 +134,10 @@ bool mp_cache_decode(mp_cache_t *c)
 	mp_media_reset(m);
 
 	while (!mp_media_eof(m)) {
+		/* don't keep the source that is being destroyed waiting */
+		if (mp_cache_killed(c))
+			goto fail;
+
 		if (m->has_video)
 			mp_media_next_video(m, false);
 		if (m->has_audio)
@@ -132,15 +149,73 @@ bool mp_cache_decode(mp_cache_t *c)
 
 	success = true;
 
-	c->start_time = c->m.fmt->start_time;
-	if (c->start_time == AV_NOPTS_VALUE)
-		c->start_time = 0;
+	c->clip->start_time = c->m.fmt->start_time;
+	if (c->clip->start_time == AV_NOPTS_VALUE)
+		c->clip->start_time = 0;
 
 fail:
 	mp_media_free(m);
 	return success;
 }
 
+/* another source is decoding the same clip.  The media opened in
+ * mp_cache_init is kept until it is done, in case that source goes away
+ * and this one has to decode the clip after all. */
+static bool mp_cache_wait_clip(mp_cache_t *c, bool *kill)
+{
+	while (!mp_clip_wait(c->clip, 100)) {
+		*kill = mp_cache_killed(c);
+		if (*kill)
+			return false;
+	}
+
+	return !c->clip->failed;
+}
+
+static void mp_cache_reacquire_clip(mp_cache_t *c)
+{
+	char *key = bstrdup(c->clip->key);
+
+	mp_clip_release(c->clip);
+	c->clip = mp_clip_acquire(key, &c->decode_clip);
+	bfree(key);
+}
+
+static bool mp_cache_load(mp_cache_t *c, bool *kill)
+{
+	for (;;) {
+		if (c->decode_clip) {
+			bool success = mp_cache_decode(c);
+
+			c->decode_clip = false;
+
+			*kill = mp_cache_killed(c);
+			if (*kill) {
+				mp_clip_abandon(c->clip);
+				return false;
+			}
+
+			mp_clip_finish(c->clip, success);
+			if (!success)
+				return false;
+			break;
+		}
+
+		if (!mp_cache_wait_clip(c, kill))
+			return false;
+		if (!c->clip->abandoned) {
+			mp_media_free(&c->m);
+			break;
+		}
+
+		/* the source decoding it was destroyed first */
+		mp_cache_reacquire_clip(c);
+	}
+
+	c->start_time = c->clip->start_time;
+	return true;
+}
+
 static void seek_to(mp_cache_t *c, int64_t pos)
 {
 	size_t new_v_idx = 0;
@@ -154,8 +229,8 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 	if (c->has_video) {
 		struct obs_source_frame *v;
 
-		for (size_t i = 0; i < c->video_frames.num; i++) {
-			v = &c->video_frames.array[i];
+		for (size_t i = 0; i < c->clip->video_frames.num; i++) {
+			v = &c->clip->video_frames.array[i];
 			new_v_idx = i;
 			if ((int64_t)v->timestamp >= pos) {
 				break;
@@ -163,19 +238,19 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_v_idx + 1;
-		if (next_idx == c->video_frames.num) {
-			c->next_v_ts =
-				(int64_t)v->timestamp + c->final_v_duration;
+		if (next_idx == c->clip->video_frames.num) {
+			c->next_v_ts = (int64_t)v->timestamp +
+				       c->clip->final_v_duration;
 		} else {
 			struct obs_source_frame *next =
-				&c->video_frames.array[next_idx];
+				&c->clip->video_frames.array[next_idx];
 			c->next_v_ts = (int64_t)next->timestamp;
 		}
 	}
 	if (c->has_audio) {
 		struct obs_source_audio *a;
-		for (size_t i = 0; i < c->audio_segments.num; i++) {
-			a = &c->audio_segments.array[i];
+		for (size_t i = 0; i < c->clip->audio_segments.num; i++) {
+			a = &c->clip->audio_segments.array[i];
 			new_a_idx = i;
 			if ((int64_t)a->timestamp >= pos) {
 				break;
@@ -183,12 +258,12 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_a_idx + 1;
-		if (next_idx == c->audio_segments.num) {
-			c->next_a_ts =
-				(int64_t)a->timestamp + c->final_a_duration;
+		if (next_idx == c->clip->audio_segments.num) {
+			c->next_a_ts = (int64_t)a->timestamp +
+				       c->clip->final_a_duration;
 		} else {
 			struct obs_source_audio *next =
-				&c->audio_segments.array[next_idx];
+				&c->clip->audio_segments.array[next_idx];
 			c->next_a_ts = (int64_t)next->timestamp;
 		}
 	}
@@ -215,12 +290,12 @@ static inline bool mp_media_can_play_audio(mp_cache_t *c)
 static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 {
 	int64_t offset;
-	if (c->next_v_idx < c->video_frames.num) {
+	if (c->next_v_idx < c->clip->video_frames.num) {
 		struct obs_source_frame *next =
-			&c->video_frames.array[c->next_v_idx];
+			&c->clip->video_frames.array[c->next_v_idx];
 		offset = (int64_t)(next->timestamp - frame->timestamp);
 	} else {
-		offset = c->final_v_duration;
+		offset = c->clip->final_v_duration;
 	}
 
 	c->next_v_ts += offset;
@@ -229,12 +304,12 @@ static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 {
 	int64_t offset;
-	if (c->next_a_idx < c->audio_segments.num) {
+	if (c->next_a_idx < c->clip->audio_segments.num) {
 		struct obs_source_audio *next =
-			&c->audio_segments.array[c->next_a_idx];
+			&c->clip->audio_segments.array[c->next_a_idx];
 		offset = (int64_t)(next->timestamp - audio->timestamp);
 	} else {
-		offset = c->final_a_duration;
+		offset = c->clip->final_a_duration;
 	}
 
 	c->next_a_ts += offset;
@@ -243,13 +318,14 @@ static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 static void mp_cache_next_video(mp_cache_t *c, bool preload)
 {
 	/* eof check */
-	if (c->next_v_idx == c->video_frames.num) {
+	if (c->next_v_idx == c->clip->video_frames.num) {
 		if (mp_media_can_play_video(c))
 			c->cur_v_idx = c->next_v_idx;
 		return;
 	}
 
-	struct obs_source_frame *frame = &c->video_frames.array[c->next_v_idx];
+	struct obs_source_frame *frame =
+		&c->clip->video_frames.array[c->next_v_idx];
 	struct obs_source_frame dup = *frame;
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts +
@@ -278,7 +354,7 @@ static void mp_cache_next_video(mp_cache_t *c, bool preload)
 static void mp_cache_next_audio(mp_cache_t *c)
 {
 	/* eof check */
-	if (c->next_a_idx == c->audio_segments.num) {
+	if (c->next_a_idx == c->clip->audio_segments.num) {
 		if (mp_media_can_play_audio(c))
 			c->cur_a_idx = c->next_a_idx;
 		return;
@@ -288,7 +364,7 @@ static void mp_cache_next_audio(mp_cache_t *c)
 		return;
 
 	struct obs_source_audio *audio =
-		&c->audio_segments.array[c->next_a_idx];
+		&c->clip->audio_segments.array[c->next_a_idx];
 	struct obs_source_audio dup = *audio;
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts +
@@ -324,14 +400,15 @@ static bool mp_cache_reset(mp_cache_t *c)
 	pthread_mutex_unlock(&c->mutex);
 
 	if (c->has_video) {
-		size_t next_idx = c->video_frames.num > 1 ? 1 : 0;
+		size_t next_idx = c->clip->video_frames.num > 1 ? 1 : 0;
 		c->cur_v_idx = c->next_v_idx = 0;
-		c->next_v_ts = c->video_frames.array[next_idx].timestamp;
+		c->next_v_ts = c->clip->video_frames.array[next_idx].timestamp;
 	}
 	if (c->has_audio) {
-		size_t next_idx = c->audio_segments.num > 1 ? 1 : 0;
+		size_t next_idx = c->clip->audio_segments.num > 1 ? 1 : 0;
 		c->cur_a_idx = c->next_a_idx = 0;
-		c->next_a_ts = c->audio_segments.array[next_idx].timestamp;
+		c->next_a_ts =
+			c->clip->audio_segments.array[next_idx].timestamp;
 	}
 
 	if (active) {
@@ -379,12 +456,16 @@ static void mp_cache_calc_next_ns(mp_cache_t *c)
 
 static inline bool mp_cache_thread(mp_cache_t *c)
 {
+	bool killed = false;
+
 	os_set_thread_name("mp_cache_thread");
 
-	if (!mp_cache_decode(c)) {
-		return false;
+	if (!mp_cache_load(c, &killed)) {
+		return killed;
 	}
 
+	os_atomic_set_bool(&c->loaded, true);
+
 	for (;;) {
 		bool reset, kill, is_active, seek, pause, reset_time,
 			preload_frame;
@@ -446,7 +527,8 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 			continue;
 
 		if (preload_frame)
-			c->v_preload_cb(c->opaque, &c->video_frames.array[0]);
+			c->v_preload_cb(c->opaque,
+					&c->clip->video_frames.array[0]);
 
 		/* frames are ready */
 		if (is_active && !timeout) {
@@ -488,9 +570,9 @@ static void fill_video(void *data, struct obs_source_frame *frame)
 
 	dup.timestamp = frame->timestamp;
 
-	c->final_v_duration = c->m.v.last_duration;
+	c->clip->final_v_duration = c->m.v.last_duration;
 
-	da_push_back(c->video_frames, &dup);
+	da_push_back(c->clip->video_frames, &dup);
 }
 
 static void fill_audio(void *data, struct obs_source_audio *audio)
@@ -518,9 +600,26 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 		memcpy((uint8_t *)dup.data[0], audio->data[0], size);
 	}
 
-	c->final_a_duration = c->m.a.last_duration;
+	c->clip->final_a_duration = c->m.a.last_duration;
 
-	da_push_back(c->audio_segments, &dup);
+	da_push_back(c->clip->audio_segments, &dup);
+}
+
+/* anything that changes the decoded frames has to be part of the key */
+static char *get_clip_key(const mp_media_t *m, const char *ffmpeg_options)
+{
+	struct stat st = {0};
+	struct dstr key = {0};
+
+	if (os_stat(m->path, &st) != 0)
+		blog(LOG_WARNING, "MP: Failed to stat '%s'", m->path);
+
+	dstr_printf(&key, "%s|%lld|%lld|%s|%s|%d|%d|%d|%d", m->path,
+		    (long long)st.st_mtime, (long long)st.st_size,
+		    m->format_name ? m->format_name : "",
+		    ffmpeg_options ? ffmpeg_options : "", m->speed,
+		    (int)m->force_range, m->is_linear_alpha, m->hw);
+	return key.array;
 }
 
 static inline bool mp_cache_init_internal(mp_cache_t *c,
@@ -557,7 +656,9 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	info2.v_preload_cb = NULL;
 	info2.v_seek_cb = NULL;
 	info2.stop_cb = NULL;
+	info2.decode_time_cb = NULL;
 	info2.full_decode = true;
+	info2.preroll_frames = 0;
 
 	mp_media_t *m = &c->m;
 
@@ -589,6 +690,10 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	if (!base_sys_ts)
 		base_sys_ts = (int64_t)os_gettime_ns();
 
+	char *key = get_clip_key(m, info->ffmpeg_options);
+	c->clip = mp_clip_acquire(key, &c->decode_clip);
+	bfree(key);
+
 	if (!mp_cache_init_internal(c, info)) {
 		mp_cache_free(c);
 		return false;
@@ -620,16 +725,10 @@ void mp_cache_free(mp_cache_t *c)
 	if (c->m.fmt)
 		mp_media_free(&c->m);
 
-	for (size_t i = 0; i < c->video_frames.num; i++) {
-		struct obs_source_frame *f = &c->video_frames.array[i];
-		obs_source_frame_free(f);
-	}
-	for (size_t i = 0; i < c->audio_segments.num; i++) {
-		struct obs_source_audio *a = &c->audio_segments.array[i];
-		bfree((void *)a->data[0]);
-	}
-	da_free(c->video_frames);
-	da_free(c->audio_segments);
+	/* the thread never got to decode the clip */
+	if (c->decode_clip)
+		mp_clip_abandon(c->clip);
+	mp_clip_release(c->clip);
 
 	bfree(c->path);
 	bfree(c->format_name);
@@ -688,6 +787,13 @@ void mp_cache_preload_frame(mp_cache_t *c)
 	}
 }
 
+/* the whole clip is already decoded, so there is nothing to pre-roll once
+ * it has been loaded */
+bool mp_cache_preroll_ready(mp_cache_t *c)
+{
+	return os_atomic_load_bool(&c->loaded);
+}
+
 int64_t mp_cache_get_current_time(mp_cache_t *c)
 {
 	return mp_cache_get_base_pts(c) * (int64_t)c->speed / 100000000LL;
@@ -707,7 +813,7 @@ void mp_cache_seek(mp_cache_t *c, int64_t pos)
 
 int64_t mp_cache_get_frames(mp_cache_t *c)
 {
-	return c->video_frames.num;
+	return c->clip->video_frames.num;
 }
 
 int64_t mp_cache_get_duration(mp_cache_t *c)
@@ -21,6 +21,7 @@
 #include <obs.h>
 
 #include "media.h"
+#include "clip-cache.h"
 
 struct mp_cache {
 	mp_video_cb v_preload_cb;
@@ -51,8 +52,9 @@ struct mp_cache {
 	bool thread_valid;
 	pthread_t thread;
 
-	DARRAY(struct obs_source_frame) video_frames;
-	DARRAY(struct obs_source_audio) audio_segments;
+	mp_clip_t *clip;
+	bool decode_clip;
+	volatile bool loaded;
 
 	size_t cur_v_idx;
 	size_t cur_a_idx;
@@ -61,9 +63,6 @@ struct mp_cache {
 	int64_t next_v_ts;
 	int64_t next_a_ts;
 
-	int64_t final_v_duration;
-	int64_t final_a_duration;
-
 	int64_t play_sys_ts;
 	int64_t next_pts_ns;
 	uint64_t next_ns;
@@ -91,6 +90,7 @@ extern void mp_cache_play(mp_cache_t *c, bool loop);
 extern void mp_cache_play_pause(mp_cache_t *c, bool pause);
 extern void mp_cache_stop(mp_cache_t *c);
 extern void mp_cache_preload_frame(mp_cache_t *c);
+extern bool mp_cache_preroll_ready(mp_cache_t *c);
 extern int64_t mp_cache_get_current_time(mp_cache_t *c);
 extern void mp_cache_seek(mp_cache_t *c, int64_t pos);
 extern int64_t mp_cache_get_frames(mp_cache_t *c);
@@ -0,0 +1,273 @@
+/*
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <media-io/audio-io.h>
+#include <util/bmem.h>
+
+#include "clip-cache.h"
+
+/* Memory that clips nobody is playing may keep using.  Clips in use are
+ * never evicted, so this only bounds what is retained for reuse. */
+#define MP_CLIP_CACHE_BUDGET (1024ULL * 1024ULL * 1024ULL)
+
+static pthread_mutex_t clips_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_clip *clips_first = NULL;
+static struct mp_clip *clips_last = NULL;
+static size_t clips_size = 0;
+
+static void clip_unlink(struct mp_clip *clip)
+{
+	if (clip->prev)
+		clip->prev->next = clip->next;
+	else
+		clips_first = clip->next;
+
+	if (clip->next)
+		clip->next->prev = clip->prev;
+	else
+		clips_last = clip->prev;
+
+	clip->prev = NULL;
+	clip->next = NULL;
+}
+
+static void clip_link_first(struct mp_clip *clip)
+{
+	clip->prev = NULL;
+	clip->next = clips_first;
+
+	if (clips_first)
+		clips_first->prev = clip;
+	else
+		clips_last = clip;
+
+	clips_first = clip;
+}
+
+static void clip_free(struct mp_clip *clip)
+{
+	for (size_t i = 0; i < clip->video_frames.num; i++)
+		obs_source_frame_free(&clip->video_frames.array[i]);
+	for (size_t i = 0; i < clip->audio_segments.num; i++)
+		bfree((void *)clip->audio_segments.array[i].data[0]);
+
+	da_free(clip->video_frames);
+	da_free(clip->audio_segments);
+	os_event_destroy(clip->ready_event);
+	bfree(clip->key);
+	bfree(clip);
+}
+
+/* every plane is counted at full height, which overestimates subsampled
+ * chroma planes but is good enough to enforce a budget */
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++)
+		size += (size_t)frame->linesize[i] * frame->height;
+
+	return size;
+}
+
+static size_t get_clip_size(const struct mp_clip *clip)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < clip->video_frames.num; i++)
+		size += get_frame_size(&clip->video_frames.array[i]);
+
+	for (size_t i = 0; i < clip->audio_segments.num; i++) {
+		const struct obs_source_audio *a =
+			&clip->audio_segments.array[i];
+		size += get_total_audio_size(a->format, a->speakers, a->frames);
+	}
+
+	return size;
+}
+
+/* must be called with clips_mutex held, returns the clips to free so that
+ * the frames are not freed inside the lock */
+static struct mp_clip *evict_clips(void)
+{
+	struct mp_clip *evicted = NULL;
+	struct mp_clip *clip = clips_last;
+
+	while (clip && clips_size > MP_CLIP_CACHE_BUDGET) {
+		struct mp_clip *prev = clip->prev;
+
+		if (!clip->refs && clip->ready) {
+			clips_size -= clip->size;
+			clip_unlink(clip);
+
+			clip->next = evicted;
+			evicted = clip;
+		}
+
+		clip = prev;
+	}
+
+	return evicted;
+}
+
+static void free_evicted(struct mp_clip *evicted)
+{
+	while (evicted) {
+		struct mp_clip *next = evicted->next;
+
+		blog(LOG_DEBUG, "MP: Evicted decoded clip '%s' (%zu bytes)",
+		     evicted->key, evicted->size);
+		clip_free(evicted);
+		evicted = next;
+	}
+}
+
+mp_clip_t *mp_clip_acquire(const char *key, bool *decode)
+{
+	struct mp_clip *clip;
+
+	pthread_mutex_lock(&clips_mutex);
+
+	for (clip = clips_first; clip; clip = clip->next) {
+		if (strcmp(clip->key, key) == 0)
+			break;
+	}
+
+	if (clip) {
+		clip_unlink(clip);
+		clip_link_first(clip);
+		clip->refs++;
+		*decode = false;
+	} else {
+		clip = bzalloc(sizeof(struct mp_clip));
+		clip->key = bstrdup(key);
+		clip->refs = 1;
+		os_event_init(&clip->ready_event, OS_EVENT_TYPE_MANUAL);
+		clip_link_first(clip);
+		*decode = true;
+	}
+
+	pthread_mutex_unlock(&clips_mutex);
+	return clip;
+}
+
+void mp_clip_finish(mp_clip_t *clip, bool success)
+{
+	struct mp_clip *evicted = NULL;
+	size_t size = success ? get_clip_size(clip) : 0;
+
+	pthread_mutex_lock(&clips_mutex);
+
+	clip->ready = true;
+	clip->failed = !success;
+
+	if (success) {
+		clip->size = size;
+		clips_size += size;
+		evicted = evict_clips();
+	} else {
+		/* let the next user try again */
+		clip_unlink(clip);
+	}
+
+	pthread_mutex_unlock(&clips_mutex);
+
+	os_event_signal(clip->ready_event);
+	free_evicted(evicted);
+}
+
+void mp_clip_abandon(mp_clip_t *clip)
+{
+	pthread_mutex_lock(&clips_mutex);
+
+	clip->ready = true;
+	clip->abandoned = true;
+
+	/* the users still waiting acquire a new clip and decode it */
+	clip_unlink(clip);
+
+	pthread_mutex_unlock(&clips_mutex);
+
+	os_event_signal(clip->ready_event);
+}
+
+bool mp_clip_wait(mp_clip_t *clip, unsigned long milliseconds)
+{
+	return os_event_timedwait(clip->ready_event, milliseconds) == 0;
+}
+
+void mp_clip_release(mp_clip_t *clip)
+{
+	struct mp_clip *evicted = NULL;
+	bool free_clip = false;
+
+	if (!clip)
+		return;
+
+	pthread_mutex_lock(&clips_mutex);
+
+	if (--clip->refs == 0) {
+		/* failed and abandoned clips are no longer in the cache */
+		if (clip->failed || clip->abandoned)
+			free_clip = true;
+		else
+			evicted = evict_clips();
+	}
+
+	pthread_mutex_unlock(&clips_mutex);
+
+	if (free_clip)
+		clip_free(clip);
+	free_evicted(evicted);
+}
+
+void mp_clip_cache_free(void)
+{
+	struct mp_clip *unused = NULL;
+	struct mp_clip *clip;
+	size_t in_use = 0;
+
+	pthread_mutex_lock(&clips_mutex);
+
+	clip = clips_first;
+	while (clip) {
+		struct mp_clip *next = clip->next;
+
+		if (!clip->refs) {
+			clips_size -= clip->size;
+			clip_unlink(clip);
+
+			clip->next = unused;
+			unused = clip;
+		} else {
+			in_use++;
+		}
+
+		clip = next;
+	}
+
+	pthread_mutex_unlock(&clips_mutex);
+
+	while (unused) {
+		struct mp_clip *next = unused->next;
+		clip_free(unused);
+		unused = next;
+	}
+
+	if (in_use)
+		blog(LOG_WARNING, "MP: %zu decoded clips are still in use",
+		     in_use);
+
+	pthread_mutex_destroy(&clips_mutex);
+}
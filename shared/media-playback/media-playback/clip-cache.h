@@ -0,0 +1,71 @@
+/*
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <util/threading.h>
+#include <util/darray.h>
+#include <obs.h>
+
+/*
+ * Process-wide cache of fully decoded clips.
+ *
+ *   Every fully decoded local file is stored once, keyed by its path,
+ * modification time and decode options, and shared by all media sources
+ * (including the ones stinger transitions create) that play it.  Clips are
+ * reference counted: a clip stays cached after its last user releases it
+ * and is only evicted, least recently used first, once the unreferenced
+ * clips push the cache over its memory budget.
+ *
+ *   The first user of a key decodes the clip and calls mp_clip_finish();
+ * everyone else waits with mp_clip_wait() before touching the frames.  Once
+ * finished, a clip is immutable and can be read from any thread.
+ */
+
+struct mp_clip {
+	char *key;
+	long refs;
+	bool ready;
+	bool failed;
+	bool abandoned;
+	os_event_t *ready_event;
+
+	DARRAY(struct obs_source_frame) video_frames;
+	DARRAY(struct obs_source_audio) audio_segments;
+	int64_t final_v_duration;
+	int64_t final_a_duration;
+	int64_t start_time;
+	size_t size;
+
+	/* LRU list, most recently used first */
+	struct mp_clip *prev;
+	struct mp_clip *next;
+};
+
+typedef struct mp_clip mp_clip_t;
+
+/* Returns a referenced clip for key.  If it was not cached yet, *decode is
+ * set and the caller is responsible for filling it in. */
+extern mp_clip_t *mp_clip_acquire(const char *key, bool *decode);
+extern void mp_clip_finish(mp_clip_t *clip, bool success);
+/* The decoding user went away before finishing, the users waiting for the
+ * clip have to acquire it again (and one of them decodes it) */
+extern void mp_clip_abandon(mp_clip_t *clip);
+/* Returns true once the clip has finished decoding, check clip->failed and
+ * clip->abandoned */
+extern bool mp_clip_wait(mp_clip_t *clip, unsigned long milliseconds);
+extern void mp_clip_release(mp_clip_t *clip);
+/* Frees every cached clip that is no longer used, call once when the
+ * module using the cache is unloaded */
+extern void mp_clip_cache_free(void);
@@ -14,6 +14,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <util/platform.h>
+
 #include "decode.h"
 
 #include "media-playback.h"
@@ -70,6 +72,93 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 	}
 }
 
+/* Decoder threads are handed out from a budget shared by all media sources.
+ * Left to FFmpeg, every decoder sizes its thread pool to the core count, so
+ * a handful of sources is enough to oversubscribe the CPU and starve the
+ * encoders. */
+#define MP_DEFAULT_DECODE_THREADS 4
+
+static pthread_mutex_t decode_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int decode_threads_budget = 0;
+static int decode_threads_used = 0;
+
+static int acquire_decode_threads(int requested)
+{
+	int granted;
+
+	pthread_mutex_lock(&decode_threads_mutex);
+
+	if (!decode_threads_budget) {
+		/* leave the rest to encoders and rendering */
+		int cores = os_get_logical_cores();
+		decode_threads_budget = cores > 4 ? cores / 2 : 2;
+	}
+
+	if (requested <= 0)
+		requested = MP_DEFAULT_DECODE_THREADS;
+
+	granted = decode_threads_budget - decode_threads_used;
+	if (granted > requested)
+		granted = requested;
+	/* a decoder always gets at least the thread it is called from */
+	if (granted < 1)
+		granted = 1;
+
+	decode_threads_used += granted;
+
+	pthread_mutex_unlock(&decode_threads_mutex);
+	return granted;
+}
+
+static void release_decode_threads(int threads)
+{
+	pthread_mutex_lock(&decode_threads_mutex);
+	decode_threads_used -= threads;
+	pthread_mutex_unlock(&decode_threads_mutex);
+}
+
+static int get_thread_type(enum mp_thread_type type)
+{
+	switch (type) {
+	case MP_THREAD_FRAME:
+		return FF_THREAD_FRAME;
+	case MP_THREAD_SLICE:
+		return FF_THREAD_SLICE;
+	case MP_THREAD_AUTO:
+		break;
+	}
+
+	return FF_THREAD_FRAME | FF_THREAD_SLICE;
+}
+
+static inline bool codec_can_thread(const AVCodecContext *c)
+{
+	return c->codec_id != AV_CODEC_ID_PNG &&
+	       c->codec_id != AV_CODEC_ID_TIFF &&
+	       c->codec_id != AV_CODEC_ID_JPEG2000 &&
+	       c->codec_id != AV_CODEC_ID_MPEG4 &&
+	       c->codec_id != AV_CODEC_ID_WEBP;
+}
+
+static void init_decode_threads(struct mp_decode *d, AVCodecContext *c)
+{
+	if (c->thread_count != 1 || !codec_can_thread(c))
+		return;
+
+	if (d->audio) {
+		c->thread_count = 0;
+		return;
+	}
+
+	/* hardware decoders do not benefit from extra threads */
+	d->threads = acquire_decode_threads(d->hw ? 1 : d->m->decode_threads);
+	c->thread_count = d->threads;
+	c->thread_type = get_thread_type(d->m->thread_type);
+
+	blog(LOG_DEBUG, "MP: Using %d decoder thread(s) for '%s'", d->threads,
+	     d->m->path ? d->m->path : "");
+}
+
 static int mp_open_codec(struct mp_decode *d, bool hw)
 {
 	AVCodecContext *c;
@@ -90,11 +179,7 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 	if (hw)
 		init_hw_decoder(d, c);
 
-	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
-	    c->codec_id != AV_CODEC_ID_TIFF &&
-	    c->codec_id != AV_CODEC_ID_JPEG2000 &&
-	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
-		c->thread_count = 0;
+	init_decode_threads(d, c);
 
 	ret = avcodec_open2(c, d->codec, NULL);
 	if (ret < 0)
@@ -104,6 +189,11 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 	return ret;
 
 fail:
+	if (d->threads) {
+		release_decode_threads(d->threads);
+		d->threads = 0;
+	}
+
 	avcodec_free_context(&c);
 	avcodec_free_context(&d->decoder);
 
@@ -269,6 +359,9 @@ void mp_decode_free(struct mp_decode *d)
 		av_buffer_unref(&d->hw_ctx);
 	}
 
+	if (d->threads)
+		release_decode_threads(d->threads);
+
 	memset(d, 0, sizeof(*d));
 }
 
@@ -356,6 +449,7 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 bool mp_decode_next(struct mp_decode *d)
 {
 	bool eof = d->m->eof;
+	uint64_t start_ns;
 	int got_frame;
 	int ret;
 
@@ -364,6 +458,8 @@ bool mp_decode_next(struct mp_decode *d)
 	if (!eof && !d->packets.size)
 		return true;
 
+	start_ns = os_gettime_ns();
+
 	while (!d->frame_ready) {
 		if (!d->packet_pending) {
 			if (!d->packets.size) {
@@ -450,6 +546,10 @@ bool mp_decode_next(struct mp_decode *d)
 
 		d->last_duration = duration;
 		d->next_pts = d->frame_pts + duration;
+
+		if (!d->audio && d->m->decode_time_cb)
+			d->m->decode_time_cb(d->m->opaque,
+					     os_gettime_ns() - start_ns);
 	}
 
 	return true;
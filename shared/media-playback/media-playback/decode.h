@@ -64,6 +64,7 @@ struct mp_decode {
 	bool frame_ready;
 	bool eof;
 	bool hw;
+	int threads;
 	uint16_t max_luminance;
 
 	AVPacket *orig_pkt;
@@ -113,6 +113,26 @@ void media_playback_preload_frame(media_playback_t *mp)
 		mp_media_preload_frame(&mp->media);
 }
 
+void media_playback_set_preroll(media_playback_t *mp, bool enabled)
+{
+	if (!mp)
+		return;
+
+	if (!mp->is_cached)
+		mp_media_set_preroll(&mp->media, enabled);
+}
+
+bool media_playback_preroll_ready(media_playback_t *mp)
+{
+	if (!mp)
+		return true;
+
+	if (mp->is_cached)
+		return mp_cache_preroll_ready(&mp->cache);
+	else
+		return mp_media_preroll_ready(&mp->media);
+}
+
 int64_t media_playback_get_current_time(media_playback_t *mp)
 {
 	if (!mp)
@@ -24,6 +24,13 @@ typedef struct media_playback media_playback_t;
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
+typedef void (*mp_decode_time_cb)(void *opaque, uint64_t decode_ns);
+
+enum mp_thread_type {
+	MP_THREAD_AUTO,
+	MP_THREAD_FRAME,
+	MP_THREAD_SLICE,
+};
 
 struct mp_media_info {
 	void *opaque;
@@ -33,6 +40,7 @@ struct mp_media_info {
 	mp_video_cb v_seek_cb;
 	mp_audio_cb a_cb;
 	mp_stop_cb stop_cb;
+	mp_decode_time_cb decode_time_cb;
 
 	const char *path;
 	const char *format;
@@ -46,6 +54,15 @@ struct mp_media_info {
 	bool reconnecting;
 	bool request_preload;
 	bool full_decode;
+
+	/* decoder threads are taken from a budget shared by all sources,
+	 * 0 threads picks a default share */
+	enum mp_thread_type thread_type;
+	int decode_threads;
+
+	/* number of video frames (plus the audio between them) decoded ahead
+	 * of time while pre-roll is enabled and the media is not playing */
+	int preroll_frames;
 };
 
 extern media_playback_t *
@@ -60,6 +77,8 @@ extern void media_playback_set_looping(media_playback_t *mp, bool looping);
 extern void media_playback_set_is_linear_alpha(media_playback_t *mp,
 					       bool is_linear_alpha);
 extern void media_playback_preload_frame(media_playback_t *mp);
+extern void media_playback_set_preroll(media_playback_t *mp, bool enabled);
+extern bool media_playback_preroll_ready(media_playback_t *mp);
 extern int64_t media_playback_get_current_time(media_playback_t *mp);
 extern void media_playback_seek(media_playback_t *mp, int64_t pos);
 extern int64_t media_playback_get_frames(media_playback_t *mp);
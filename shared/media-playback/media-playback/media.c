@@ -357,45 +357,58 @@ static inline bool mp_media_can_play_frame(mp_media_t *m, struct mp_decode *d)
 				  (d->frame_pts - m->next_pts_ns > MAX_TS_VAR));
 }
 
-void mp_media_next_audio(mp_media_t *m)
+static inline int64_t mp_media_get_ts(mp_media_t *m, int64_t pts)
+{
+	return m->full_decode ? pts
+			      : m->base_ts + pts - m->start_ts +
+					m->play_sys_ts - base_sys_ts;
+}
+
+static bool mp_media_fill_audio(mp_media_t *m, struct obs_source_audio *audio)
 {
 	struct mp_decode *d = &m->a;
-	struct obs_source_audio audio = {0};
 	AVFrame *f = d->frame;
 	int channels;
 
-	if (!mp_media_can_play_frame(m, d))
-		return;
-
 #if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(59, 19, 100)
 	channels = f->channels;
 #else
 	channels = f->ch_layout.nb_channels;
 #endif
 
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		audio->data[i] = f->data[i];
+
+	audio->samples_per_sec = f->sample_rate * m->speed / 100;
+	audio->speakers = convert_speaker_layout(channels);
+	audio->format = convert_sample_format(f->format);
+	audio->frames = f->nb_samples;
+	audio->timestamp = mp_media_get_ts(m, d->frame_pts);
+
+	return audio->format != AUDIO_FORMAT_UNKNOWN;
+}
+
+void mp_media_next_audio(mp_media_t *m)
+{
+	struct mp_decode *d = &m->a;
+	struct obs_source_audio audio = {0};
+
+	if (!mp_media_can_play_frame(m, d))
+		return;
+
 	d->frame_ready = false;
 	if (!m->a_cb)
 		return;
 
-	for (size_t i = 0; i < MAX_AV_PLANES; i++)
-		audio.data[i] = f->data[i];
-
-	audio.samples_per_sec = f->sample_rate * m->speed / 100;
-	audio.speakers = convert_speaker_layout(channels);
-	audio.format = convert_sample_format(f->format);
-	audio.frames = f->nb_samples;
-	audio.timestamp = m->full_decode
-				  ? d->frame_pts
-				  : m->base_ts + d->frame_pts - m->start_ts +
-					    m->play_sys_ts - base_sys_ts;
-
-	if (audio.format == AUDIO_FORMAT_UNKNOWN)
+	if (!mp_media_fill_audio(m, &audio))
 		return;
 
 	m->a_cb(m->opaque, &audio);
 }
 
-void mp_media_next_video(mp_media_t *m, bool preload)
+/* converts the decoded video frame into obsframe, returns false if the frame
+ * cannot be output */
+static bool mp_media_fill_video(mp_media_t *m)
 {
 	struct mp_decode *d = &m->v;
 	struct obs_source_frame *frame = &m->obsframe;
@@ -404,25 +417,13 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 	enum video_range_type new_range;
 	AVFrame *f = d->frame;
 
-	if (!preload) {
-		if (!mp_media_can_play_frame(m, d))
-			return;
-
-		d->frame_ready = false;
-
-		if (!m->v_cb)
-			return;
-	} else if (!d->frame_ready) {
-		return;
-	}
-
 	bool flip = false;
 	if (m->swscale) {
 		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data,
 				    f->linesize, 0, f->height, m->scale_pic,
 				    m->scale_linesizes);
 		if (ret < 0)
-			return;
+			return false;
 
 		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
 		for (size_t i = 0; i < 4; i++) {
@@ -466,17 +467,14 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 
 		if (!success) {
 			frame->format = VIDEO_FORMAT_NONE;
-			return;
+			return false;
 		}
 	}
 
 	if (frame->format == VIDEO_FORMAT_NONE)
-		return;
+		return false;
 
-	frame->timestamp = m->full_decode
-				   ? d->frame_pts
-				   : (m->base_ts + d->frame_pts - m->start_ts +
-				      m->play_sys_ts - base_sys_ts);
+	frame->timestamp = mp_media_get_ts(m, d->frame_pts);
 
 	frame->width = f->width;
 	frame->height = f->height;
@@ -509,11 +507,34 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 #else
 		if (!(f->flags & AV_FRAME_FLAG_KEY))
 #endif
-			return;
+			return false;
 
 		d->got_first_keyframe = true;
 	}
 
+	return true;
+}
+
+void mp_media_next_video(mp_media_t *m, bool preload)
+{
+	struct mp_decode *d = &m->v;
+	struct obs_source_frame *frame = &m->obsframe;
+
+	if (!preload) {
+		if (!mp_media_can_play_frame(m, d))
+			return;
+
+		d->frame_ready = false;
+
+		if (!m->v_cb)
+			return;
+	} else if (!d->frame_ready) {
+		return;
+	}
+
+	if (!mp_media_fill_video(m))
+		return;
+
 	if (preload) {
 		if (m->seek_next_ts && m->v_seek_cb) {
 			m->v_seek_cb(m->opaque, frame);
@@ -525,9 +546,8 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 	}
 }
 
-static void mp_media_calc_next_ns(mp_media_t *m)
+static void mp_media_advance_next_ns(mp_media_t *m, int64_t min_next_ns)
 {
-	int64_t min_next_ns = mp_media_get_next_min_pts(m);
 	int64_t delta = min_next_ns - m->next_pts_ns;
 
 	if (m->seek_next_ts) {
@@ -547,6 +567,166 @@ static void mp_media_calc_next_ns(mp_media_t *m)
 	m->next_pts_ns = min_next_ns;
 }
 
+static inline void mp_media_calc_next_ns(mp_media_t *m)
+{
+	mp_media_advance_next_ns(m, mp_media_get_next_min_pts(m));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Pre-roll
+ *
+ *   While the media is stopped and pre-roll is enabled, the media thread
+ * decodes and converts the first preroll_frames video frames (and the audio
+ * interleaved with them) ahead of time.  When playback starts those frames
+ * are output on schedule from memory while the decoder carries on after
+ * them, so the start of playback does not have to wait on the decoder. */
+
+static void preroll_entry_free(struct mp_preroll_entry *entry)
+{
+	if (entry->is_video)
+		obs_source_frame_free(&entry->video);
+	else
+		bfree((void *)entry->audio.data[0]);
+}
+
+static void mp_media_free_preroll(mp_media_t *m)
+{
+	for (size_t i = m->preroll_pos; i < m->preroll_entries.num; i++)
+		preroll_entry_free(m->preroll_entries.array + i);
+
+	da_free(m->preroll_entries);
+	m->preroll_pos = 0;
+	os_atomic_set_bool(&m->preroll_ready, false);
+}
+
+static void mp_media_preroll_video(mp_media_t *m)
+{
+	struct obs_source_frame *frame = &m->obsframe;
+	struct mp_preroll_entry entry = {0};
+	bool success = mp_media_fill_video(m);
+
+	m->v.frame_ready = false;
+	if (!success)
+		return;
+
+	entry.pts = m->v.frame_pts;
+	entry.is_video = true;
+	obs_source_frame_init(&entry.video, frame->format, frame->width,
+			      frame->height);
+	obs_source_frame_copy(&entry.video, frame);
+
+	da_push_back(m->preroll_entries, &entry);
+}
+
+static void mp_media_preroll_audio(mp_media_t *m)
+{
+	struct mp_preroll_entry entry = {0};
+	struct obs_source_audio audio = {0};
+	bool success = mp_media_fill_audio(m, &audio);
+
+	m->a.frame_ready = false;
+	if (!success)
+		return;
+
+	entry.pts = m->a.frame_pts;
+	entry.audio = audio;
+	memset(entry.audio.data, 0, sizeof(entry.audio.data));
+
+	size_t size = get_total_audio_size(audio.format, audio.speakers,
+					   audio.frames);
+	uint8_t *out = bmalloc(size);
+	entry.audio.data[0] = out;
+
+	size_t planes = get_audio_planes(audio.format, audio.speakers);
+	if (planes > 1) {
+		size = get_audio_bytes_per_channel(audio.format) * audio.frames;
+
+		for (size_t i = 0; i < planes; i++) {
+			entry.audio.data[i] = out;
+			memcpy(out, audio.data[i], size);
+			out += size;
+		}
+	} else {
+		memcpy(out, audio.data[0], size);
+	}
+
+	da_push_back(m->preroll_entries, &entry);
+}
+
+static void mp_media_fill_preroll(mp_media_t *m)
+{
+	int video_frames = 0;
+
+	/* with nothing to pre-roll playback can start right away */
+	if (!m->is_local_file || !m->has_video || m->preroll_frames <= 0) {
+		os_atomic_set_bool(&m->preroll_ready, true);
+		return;
+	}
+
+	while (video_frames < m->preroll_frames) {
+		bool v_ready = m->has_video && m->v.frame_ready;
+		bool a_ready = m->has_audio && m->a.frame_ready;
+
+		if (!v_ready && !a_ready)
+			break;
+
+		if (v_ready && (!a_ready || m->v.frame_pts <= m->a.frame_pts)) {
+			mp_media_preroll_video(m);
+			video_frames++;
+		} else {
+			mp_media_preroll_audio(m);
+		}
+
+		if (!mp_media_prepare_frames(m))
+			break;
+	}
+
+	os_atomic_set_bool(&m->preroll_ready, true);
+}
+
+/* the pre-rolled video frames come after obsframe has been reused, so the
+ * frame to preload has to be taken from them */
+static struct obs_source_frame *mp_media_get_preload_frame(mp_media_t *m)
+{
+	for (size_t i = m->preroll_pos; i < m->preroll_entries.num; i++) {
+		struct mp_preroll_entry *entry = m->preroll_entries.array + i;
+		if (entry->is_video)
+			return &entry->video;
+	}
+
+	/* see note in mp_media_prepare_frames() for context on the pointer
+	 * check */
+	return m->obsframe.data[0] ? &m->obsframe : NULL;
+}
+
+static inline bool mp_media_has_preroll(mp_media_t *m)
+{
+	return m->preroll_pos < m->preroll_entries.num;
+}
+
+static void mp_media_next_preroll(mp_media_t *m)
+{
+	while (mp_media_has_preroll(m)) {
+		struct mp_preroll_entry *entry =
+			m->preroll_entries.array + m->preroll_pos;
+		int64_t pts = entry->pts;
+
+		if (pts > m->next_pts_ns && pts - m->next_pts_ns <= MAX_TS_VAR)
+			break;
+
+		if (entry->is_video && m->v_cb) {
+			entry->video.timestamp = mp_media_get_ts(m, pts);
+			m->v_cb(m->opaque, &entry->video);
+		} else if (!entry->is_video && m->a_cb) {
+			entry->audio.timestamp = mp_media_get_ts(m, pts);
+			m->a_cb(m->opaque, &entry->audio);
+		}
+
+		preroll_entry_free(entry);
+		m->preroll_pos++;
+	}
+}
+
 static void seek_to(mp_media_t *m, int64_t pos)
 {
 	AVStream *stream = m->fmt->streams[0];
@@ -585,6 +765,7 @@ bool mp_media_reset(mp_media_t *m)
 {
 	bool stopping;
 	bool active;
+	bool preroll;
 
 	int64_t next_ts = mp_media_get_base_pts(m);
 	int64_t offset = next_ts - m->next_pts_ns;
@@ -596,11 +777,13 @@ bool mp_media_reset(mp_media_t *m)
 	m->base_ts += next_ts;
 	m->seek_next_ts = false;
 
+	mp_media_free_preroll(m);
 	seek_to(m, start_time);
 
 	pthread_mutex_lock(&m->mutex);
 	stopping = m->stopping;
 	active = m->active;
+	preroll = m->preroll;
 	m->stopping = false;
 	pthread_mutex_unlock(&m->mutex);
 
@@ -625,6 +808,8 @@ bool mp_media_reset(mp_media_t *m)
 		mp_media_next_video(m, true);
 	if (stopping && m->stop_cb)
 		m->stop_cb(m->opaque);
+	if (!active && preroll)
+		mp_media_fill_preroll(m);
 	return true;
 }
 
@@ -794,7 +979,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 
 	for (;;) {
 		bool reset, kill, is_active, seek, pause, reset_time,
-			preload_frame;
+			preload_frame, preroll;
 		int64_t seek_pos;
 		bool timeout = false;
 
@@ -820,6 +1005,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 		m->kill = false;
 
 		preload_frame = m->preload_frame;
+		preroll = m->preroll;
 		pause = m->pause;
 		seek_pos = m->seek_pos;
 		seek = m->seek;
@@ -839,6 +1025,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 		}
 
 		if (seek) {
+			mp_media_free_preroll(m);
 			m->seek_next_ts = true;
 			seek_to(m, seek_pos);
 			continue;
@@ -852,10 +1039,44 @@ static inline bool mp_media_thread(mp_media_t *m)
 		if (pause)
 			continue;
 
-		/* see note in mp_media_prepare_frames() for context on the
-		 * pointer check */
-		if (preload_frame && m->obsframe.data[0] && !is_active) {
-			m->v_preload_cb(m->opaque, &m->obsframe);
+		if (!is_active) {
+			bool ready = os_atomic_load_bool(&m->preroll_ready);
+
+			/* the decoder has moved past the pre-rolled frames,
+			 * so dropping them means starting over */
+			if (preroll && !ready)
+				mp_media_fill_preroll(m);
+			else if (!preroll && ready && !m->preroll_entries.num)
+				mp_media_free_preroll(m);
+			else if (!preroll && ready)
+				mp_media_reset(m);
+		}
+
+		if (preload_frame && !is_active) {
+			struct obs_source_frame *frame =
+				mp_media_get_preload_frame(m);
+			if (frame)
+				m->v_preload_cb(m->opaque, frame);
+		}
+
+		/* pre-rolled frames are played before the decoded ones */
+		if (is_active && !timeout && mp_media_has_preroll(m)) {
+			mp_media_next_preroll(m);
+
+			if (mp_media_has_preroll(m)) {
+				struct mp_preroll_entry *entry =
+					m->preroll_entries.array +
+					m->preroll_pos;
+				mp_media_advance_next_ns(m, entry->pts);
+				continue;
+			}
+
+			mp_media_free_preroll(m);
+			if (mp_media_eof(m))
+				continue;
+
+			mp_media_calc_next_ns(m);
+			continue;
 		}
 
 		/* frames are ready */
@@ -882,6 +1103,8 @@ static void *mp_media_thread_start(void *opaque)
 	mp_media_t *m = opaque;
 
 	if (!mp_media_thread(m)) {
+		/* nothing will be pre-rolled, don't keep anyone waiting */
+		os_atomic_set_bool(&m->preroll_ready, true);
 		if (m->stop_cb) {
 			m->stop_cb(m->opaque);
 		}
@@ -926,16 +1149,21 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->v_cb = info->v_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
+	media->decode_time_cb = info->decode_time_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
 	media->v_seek_cb = info->v_seek_cb;
 	media->v_preload_cb = info->v_preload_cb;
 	media->force_range = info->force_range;
 	media->is_linear_alpha = info->is_linear_alpha;
+	media->thread_type = info->thread_type;
+	media->decode_threads = info->decode_threads;
 	media->buffering = info->buffering;
 	media->speed = info->speed;
 	media->request_preload = info->request_preload;
 	media->is_local_file = info->is_local_file;
+	media->preroll_frames = info->preroll_frames;
 	da_init(media->packet_pool);
+	da_init(media->preroll_entries);
 
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
@@ -977,6 +1205,7 @@ void mp_media_free(mp_media_t *media)
 
 	mp_media_stop(media);
 	mp_kill_thread(media);
+	mp_media_free_preroll(media);
 	mp_decode_free(&media->v);
 	mp_decode_free(&media->a);
 	for (size_t i = 0; i < media->packet_pool.num; i++)
@@ -1031,6 +1260,23 @@ void mp_media_preload_frame(mp_media_t *m)
 	}
 }
 
+void mp_media_set_preroll(mp_media_t *m, bool enabled)
+{
+	if (!m->thread_valid)
+		return;
+
+	pthread_mutex_lock(&m->mutex);
+	m->preroll = enabled;
+	pthread_mutex_unlock(&m->mutex);
+
+	os_sem_post(m->sem);
+}
+
+bool mp_media_preroll_ready(mp_media_t *m)
+{
+	return !m->thread_valid || os_atomic_load_bool(&m->preroll_ready);
+}
+
 void mp_media_stop(mp_media_t *m)
 {
 	pthread_mutex_lock(&m->mutex);
@@ -38,6 +38,15 @@ extern "C" {
 #pragma warning(pop)
 #endif
 
+struct mp_preroll_entry {
+	int64_t pts;
+	bool is_video;
+	union {
+		struct obs_source_frame video;
+		struct obs_source_audio audio;
+	};
+};
+
 struct mp_media {
 	AVFormatContext *fmt;
 
@@ -46,6 +55,7 @@ struct mp_media {
 	mp_stop_cb stop_cb;
 	mp_video_cb v_cb;
 	mp_audio_cb a_cb;
+	mp_decode_time_cb decode_time_cb;
 	void *opaque;
 
 	char *path;
@@ -76,6 +86,8 @@ struct mp_media {
 	enum video_range_type cur_range;
 	enum video_range_type force_range;
 	bool is_linear_alpha;
+	enum mp_thread_type thread_type;
+	int decode_threads;
 
 	int64_t play_sys_ts;
 	int64_t next_pts_ns;
@@ -98,6 +110,13 @@ struct mp_media {
 	bool thread_valid;
 	pthread_t thread;
 
+	/* frames decoded ahead of playback, in presentation order */
+	int preroll_frames;
+	bool preroll;
+	DARRAY(struct mp_preroll_entry) preroll_entries;
+	size_t preroll_pos;
+	volatile bool preroll_ready;
+
 	bool pause;
 	bool reset_ts;
 	bool seek;
@@ -114,6 +133,8 @@ extern void mp_media_play(mp_media_t *media, bool loop, bool reconnecting);
 extern void mp_media_stop(mp_media_t *media);
 extern void mp_media_play_pause(mp_media_t *media, bool pause);
 extern void mp_media_preload_frame(mp_media_t *media);
+extern void mp_media_set_preroll(mp_media_t *media, bool enabled);
+extern bool mp_media_preroll_ready(mp_media_t *media);
 extern int64_t mp_media_get_current_time(mp_media_t *m);
 extern int64_t mp_media_get_frames(mp_media_t *m);
 extern int64_t mp_media_get_duration(mp_media_t *m);
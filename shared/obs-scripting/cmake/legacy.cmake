@@ -129,8 +129,10 @@ if(TARGET Python::Python)
 
   set_source_files_properties(swig/swigpyrun.h PROPERTIES GENERATED ON)
 
-  target_sources(obs-scripting PRIVATE obs-scripting-python.c obs-scripting-python.h obs-scripting-python-import.h
-                                       ${CMAKE_CURRENT_BINARY_DIR}/swig/swigpyrun.h)
+  target_sources(
+    obs-scripting
+    PRIVATE obs-scripting-event-queue.c obs-scripting-event-queue.h obs-scripting-python.c obs-scripting-python.h
+            obs-scripting-python-import.h ${CMAKE_CURRENT_BINARY_DIR}/swig/swigpyrun.h)
 
   target_compile_definitions(
     obs-scripting
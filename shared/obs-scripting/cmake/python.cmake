@@ -29,6 +29,8 @@ if(ENABLE_SCRIPTING_PYTHON)
   target_sources(
     obs-scripting
     PRIVATE
+      obs-scripting-event-queue.c
+      obs-scripting-event-queue.h
       $<$<BOOL:${ENABLE_UI}>:obs-scripting-python-frontend.c>
       $<$<PLATFORM_ID:Windows,Darwin>:obs-scripting-python-import.c>
       obs-scripting-python-import.h
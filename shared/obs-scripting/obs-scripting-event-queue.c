@@ -0,0 +1,128 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+
+#include "obs-scripting-event-queue.h"
+
+#define SCRIPT_EVENT_QUEUE_MASK (SCRIPT_EVENT_QUEUE_SIZE - 1)
+
+bool script_event_queue_init(struct script_event_queue *q)
+{
+	memset(q, 0, sizeof(*q));
+
+	if (pthread_mutex_init(&q->overflow_mutex, NULL) != 0)
+		return false;
+
+	for (long i = 0; i < SCRIPT_EVENT_QUEUE_SIZE; i++)
+		q->cells[i].seq = i;
+	return true;
+}
+
+void script_event_queue_free(struct script_event_queue *q)
+{
+	deque_free(&q->overflow);
+	pthread_mutex_destroy(&q->overflow_mutex);
+}
+
+/* positions wrap around, compare them like serial numbers */
+static inline long seq_diff(long a, long b)
+{
+	return (long)((unsigned long)a - (unsigned long)b);
+}
+
+static bool push_ring(struct script_event_queue *q, void *event)
+{
+	long pos = os_atomic_load_long(&q->tail);
+	struct script_event_cell *cell;
+
+	for (;;) {
+		cell = &q->cells[pos & SCRIPT_EVENT_QUEUE_MASK];
+		long dif = seq_diff(os_atomic_load_long(&cell->seq), pos);
+
+		if (dif == 0) {
+			if (os_atomic_compare_exchange_long(&q->tail, &pos,
+							    pos + 1))
+				break;
+		} else if (dif < 0) {
+			return false;
+		} else {
+			pos = os_atomic_load_long(&q->tail);
+		}
+	}
+
+	cell->event = event;
+	os_atomic_store_long(&cell->seq, pos + 1);
+	return true;
+}
+
+static void *pop_ring(struct script_event_queue *q)
+{
+	long pos = os_atomic_load_long(&q->head);
+	struct script_event_cell *cell =
+		&q->cells[pos & SCRIPT_EVENT_QUEUE_MASK];
+
+	if (seq_diff(os_atomic_load_long(&cell->seq), pos + 1) < 0)
+		return NULL;
+
+	void *event = cell->event;
+	cell->event = NULL;
+	os_atomic_store_long(&cell->seq, pos + SCRIPT_EVENT_QUEUE_SIZE);
+	os_atomic_store_long(&q->head, pos + 1);
+	return event;
+}
+
+void script_event_queue_push(struct script_event_queue *q, void *event)
+{
+	if (!os_atomic_load_bool(&q->overflowing) && push_ring(q, event))
+		return;
+
+	pthread_mutex_lock(&q->overflow_mutex);
+	os_atomic_set_bool(&q->overflowing, true);
+	deque_push_back(&q->overflow, &event, sizeof(event));
+	os_atomic_inc_long(&q->overflow_size);
+	os_atomic_inc_long(&q->overflowed);
+	pthread_mutex_unlock(&q->overflow_mutex);
+}
+
+/* everything in the ring was pushed before the events that are still in the
+ * overflow queue, or by a thread that had not seen the overflow yet */
+void *script_event_queue_pop(struct script_event_queue *q)
+{
+	void *event = pop_ring(q);
+	if (event || !os_atomic_load_bool(&q->overflowing))
+		return event;
+
+	pthread_mutex_lock(&q->overflow_mutex);
+
+	/* events pushed to the ring after the check above, but before the
+	 * overflow started, come first */
+	event = pop_ring(q);
+	if (!event && q->overflow.size) {
+		deque_pop_front(&q->overflow, &event, sizeof(event));
+		os_atomic_dec_long(&q->overflow_size);
+	}
+	if (!q->overflow.size)
+		os_atomic_set_bool(&q->overflowing, false);
+
+	pthread_mutex_unlock(&q->overflow_mutex);
+	return event;
+}
+
+long script_event_queue_size(struct script_event_queue *q)
+{
+	return os_atomic_load_long(&q->tail) - os_atomic_load_long(&q->head) +
+	       os_atomic_load_long(&q->overflow_size);
+}
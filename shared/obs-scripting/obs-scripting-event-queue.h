@@ -0,0 +1,70 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+#include <util/deque.h>
+#include <util/threading.h>
+
+/*
+ *   Queue of script events with any number of producers and a single
+ * consumer.  Events are pushed onto a bounded lock-free ring (Vyukov's MPMC
+ * ring, used with a single consumer).  If the ring is full, events are kept
+ * in a locked overflow queue instead, and every event pushed after that goes
+ * to the overflow queue as well until the consumer has emptied it, so events
+ * are never dropped and the events pushed by one thread are always popped in
+ * the order they were pushed.
+ */
+
+#define SCRIPT_EVENT_QUEUE_SIZE 4096
+
+struct script_event_cell {
+	volatile long seq;
+	void *event;
+};
+
+struct script_event_queue {
+	struct script_event_cell cells[SCRIPT_EVENT_QUEUE_SIZE];
+	volatile long tail;
+	volatile long head;
+
+	pthread_mutex_t overflow_mutex;
+	struct deque overflow;
+	volatile bool overflowing;
+	volatile long overflow_size;
+	volatile long overflowed;
+};
+
+extern bool script_event_queue_init(struct script_event_queue *q);
+
+/* the queue has to be emptied first */
+extern void script_event_queue_free(struct script_event_queue *q);
+
+/* can be called from any thread */
+extern void script_event_queue_push(struct script_event_queue *q,
+				    void *event);
+
+/* only called by the consumer, returns NULL if the queue is empty */
+extern void *script_event_queue_pop(struct script_event_queue *q);
+
+extern long script_event_queue_size(struct script_event_queue *q);
+
+/* number of events that went to the overflow queue */
+static inline long
+script_event_queue_overflowed(struct script_event_queue *q)
+{
+	return os_atomic_load_long(&q->overflowed);
+}
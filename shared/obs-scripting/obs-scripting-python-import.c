@@ -152,6 +152,8 @@ bool import_python(const char *python_path, python_version_t *python_version)
 	}
 
 	IMPORT_FUNC(PyEval_ReleaseThread);
+	IMPORT_FUNC(PyEval_SaveThread);
+	IMPORT_FUNC(PyEval_RestoreThread);
 	IMPORT_FUNC(PySys_SetArgv);
 	IMPORT_FUNC(PyImport_ImportModule);
 	IMPORT_FUNC(PyObject_CallFunctionObjArgs);
@@ -90,6 +90,8 @@ PY_EXTERN int (*Import_Py_IsInitialized)(void);
 PY_EXTERN void (*Import_PyEval_InitThreads)(void);
 PY_EXTERN int (*Import_PyEval_ThreadsInitialized)(void);
 PY_EXTERN void (*Import_PyEval_ReleaseThread)(PyThreadState *tstate);
+PY_EXTERN PyThreadState *(*Import_PyEval_SaveThread)(void);
+PY_EXTERN void (*Import_PyEval_RestoreThread)(PyThreadState *tstate);
 PY_EXTERN void (*Import_PySys_SetArgv)(int, wchar_t **);
 PY_EXTERN PyObject *(*Import_PyImport_ImportModule)(const char *name);
 PY_EXTERN PyObject *(*Import_PyObject_CallFunctionObjArgs)(PyObject *callable,
@@ -188,6 +190,8 @@ extern bool import_python(const char *python_path,
 #define PyEval_InitThreads Import_PyEval_InitThreads
 #define PyEval_ThreadsInitialized Import_PyEval_ThreadsInitialized
 #define PyEval_ReleaseThread Import_PyEval_ReleaseThread
+#define PyEval_SaveThread Import_PyEval_SaveThread
+#define PyEval_RestoreThread Import_PyEval_RestoreThread
 #define PySys_SetArgv Import_PySys_SetArgv
 #define PyImport_ImportModule Import_PyImport_ImportModule
 #define PyObject_CallFunctionObjArgs Import_PyObject_CallFunctionObjArgs
@@ -17,6 +17,7 @@
 ******************************************************************************/
 
 #include "obs-scripting-python.h"
+#include "obs-scripting-event-queue.h"
 #include <util/base.h>
 #include <util/platform.h>
 #include <util/darray.h>
@@ -124,6 +125,24 @@ bool libobs_to_py_(const char *type, void *libobs_in, bool ownership,
 	cur_python_script = __last_script; \
 	unlock_python()
 
+/* must be called with python locked */
+static void call_python_obs_callback(struct python_obs_callback *cb,
+				     PyObject *args)
+{
+	struct obs_python_script *last_script = cur_python_script;
+	struct python_obs_callback *last_cb = cur_python_cb;
+
+	cur_python_script = python_obs_callback_script(cb);
+	cur_python_cb = cb;
+
+	PyObject *py_ret = PyObject_CallObject(cb->func, args);
+	py_error();
+	Py_XDECREF(py_ret);
+
+	cur_python_cb = last_cb;
+	cur_python_script = last_script;
+}
+
 /* ========================================================================= */
 
 void add_functions_to_py_module(PyObject *module, PyMethodDef *method_list)
@@ -371,12 +390,15 @@ fail:
 
 /* -------------------------------------------- */
 
+/* tick callbacks are timers that fire every frame and are passed the
+ * frame time, so that all of them run under a single GIL acquisition */
 struct python_obs_timer {
 	struct python_obs_timer *next;
 	struct python_obs_timer **p_prev_next;
 
 	uint64_t last_ts;
 	uint64_t interval;
+	bool tick;
 };
 
 static pthread_mutex_t timer_mutex;
@@ -427,18 +449,15 @@ static PyObject *timer_remove(PyObject *self, PyObject *args)
 	return python_none();
 }
 
-static void timer_call(struct script_callback *p_cb)
+/* must be called with python locked */
+static void timer_call(struct python_obs_timer *timer, PyObject *tick_args)
 {
-	struct python_obs_callback *cb = (struct python_obs_callback *)p_cb;
+	struct python_obs_callback *cb = python_obs_timer_cb(timer);
 
-	if (script_callback_removed(p_cb))
+	if (script_callback_removed(&cb->base))
 		return;
 
-	lock_callback(cb);
-	PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
-	py_error();
-	Py_XDECREF(py_ret);
-	unlock_callback();
+	call_python_obs_callback(cb, timer->tick ? tick_args : NULL);
 }
 
 static void defer_timer_init(void *p_cb)
@@ -472,26 +491,6 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
-static void obs_python_tick_callback(void *priv, float seconds)
-{
-	struct python_obs_callback *cb = priv;
-
-	if (script_callback_removed(&cb->base)) {
-		obs_remove_tick_callback(obs_python_tick_callback, cb);
-		return;
-	}
-
-	lock_callback(cb);
-
-	PyObject *args = Py_BuildValue("(f)", seconds);
-	PyObject *py_ret = PyObject_CallObject(cb->func, args);
-	py_error();
-	Py_XDECREF(py_ret);
-	Py_XDECREF(args);
-
-	unlock_callback();
-}
-
 static PyObject *obs_python_remove_tick_callback(PyObject *self, PyObject *args)
 {
 	struct obs_python_script *script = cur_python_script;
@@ -535,8 +534,13 @@ static PyObject *obs_python_add_tick_callback(PyObject *self, PyObject *args)
 	if (!py_cb || !PyFunction_Check(py_cb))
 		return python_none();
 
-	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
-	obs_add_tick_callback(obs_python_tick_callback, cb);
+	struct python_obs_callback *cb = add_python_obs_callback_extra(
+		script, py_cb, sizeof(struct python_obs_timer));
+	struct python_obs_timer *timer = python_obs_callback_extra_data(cb);
+
+	timer->tick = true;
+
+	defer_call_post(defer_timer_init, cb);
 	return python_none();
 }
 
@@ -567,6 +571,37 @@ static void calldata_signal_callback(void *priv, calldata_t *cd)
 	unlock_callback();
 }
 
+static void calldata_signal_callback_global(void *priv, const char *signal,
+					    calldata_t *cd);
+static void batched_signal_callback(void *priv, calldata_t *cd);
+static void batched_signal_callback_global(void *priv, const char *signal,
+					   calldata_t *cd);
+
+/* must be called with python locked.  The GIL is released while
+ * disconnecting, the signal may be firing on another thread with a callback
+ * waiting for it. */
+static void disconnect_python_signal(struct python_obs_callback *cb,
+				     signal_handler_t *handler,
+				     const char *signal)
+{
+	const bool batched = calldata_bool(&cb->base.extra, "batched");
+	PyThreadState *state = PyEval_SaveThread();
+
+	if (signal)
+		signal_handler_disconnect(handler, signal,
+					  batched ? batched_signal_callback
+						  : calldata_signal_callback,
+					  cb);
+	else
+		signal_handler_disconnect_global(
+			handler,
+			batched ? batched_signal_callback_global
+				: calldata_signal_callback_global,
+			cb);
+
+	PyEval_RestoreThread(state);
+}
+
 static PyObject *obs_python_signal_handler_disconnect(PyObject *self,
 						      PyObject *args)
 {
@@ -608,13 +643,14 @@ static PyObject *obs_python_signal_handler_disconnect(PyObject *self,
 		cb = find_next_python_obs_callback(script, cb, py_cb);
 	}
 
-	if (cb)
+	if (cb) {
 		remove_python_obs_callback(cb);
+		disconnect_python_signal(cb, handler, signal);
+	}
 	return python_none();
 }
 
-static PyObject *obs_python_signal_handler_connect(PyObject *self,
-						   PyObject *args)
+static PyObject *connect_signal(PyObject *args, signal_callback_t callback)
 {
 	struct obs_python_script *script = cur_python_script;
 	PyObject *py_sh = NULL;
@@ -627,8 +663,6 @@ static PyObject *obs_python_signal_handler_connect(PyObject *self,
 		return NULL;
 	}
 
-	UNUSED_PARAMETER(self);
-
 	signal_handler_t *handler;
 
 	if (!parse_args(args, "OsO", &py_sh, &signal, &py_cb))
@@ -641,10 +675,19 @@ static PyObject *obs_python_signal_handler_connect(PyObject *self,
 	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
 	calldata_set_ptr(&cb->base.extra, "handler", handler);
 	calldata_set_string(&cb->base.extra, "signal", signal);
-	signal_handler_connect(handler, signal, calldata_signal_callback, cb);
+	calldata_set_bool(&cb->base.extra, "batched",
+			  callback == batched_signal_callback);
+	signal_handler_connect(handler, signal, callback, cb);
 	return python_none();
 }
 
+static PyObject *obs_python_signal_handler_connect(PyObject *self,
+						   PyObject *args)
+{
+	UNUSED_PARAMETER(self);
+	return connect_signal(args, calldata_signal_callback);
+}
+
 /* -------------------------------------------- */
 
 static void calldata_signal_callback_global(void *priv, const char *signal,
@@ -710,13 +753,15 @@ static PyObject *obs_python_signal_handler_disconnect_global(PyObject *self,
 		cb = find_next_python_obs_callback(script, cb, py_cb);
 	}
 
-	if (cb)
+	if (cb) {
 		remove_python_obs_callback(cb);
+		disconnect_python_signal(cb, handler, NULL);
+	}
 	return python_none();
 }
 
-static PyObject *obs_python_signal_handler_connect_global(PyObject *self,
-							  PyObject *args)
+static PyObject *connect_signal_global(PyObject *args,
+				       global_signal_callback_t callback)
 {
 	struct obs_python_script *script = cur_python_script;
 	PyObject *py_sh = NULL;
@@ -728,8 +773,6 @@ static PyObject *obs_python_signal_handler_connect_global(PyObject *self,
 		return NULL;
 	}
 
-	UNUSED_PARAMETER(self);
-
 	signal_handler_t *handler;
 
 	if (!parse_args(args, "OO", &py_sh, &py_cb))
@@ -742,11 +785,363 @@ static PyObject *obs_python_signal_handler_connect_global(PyObject *self,
 
 	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
 	calldata_set_ptr(&cb->base.extra, "handler", handler);
-	signal_handler_connect_global(handler, calldata_signal_callback_global,
-				      cb);
+	calldata_set_bool(&cb->base.extra, "batched",
+			  callback == batched_signal_callback_global);
+	signal_handler_connect_global(handler, callback, cb);
 	return python_none();
 }
 
+static PyObject *obs_python_signal_handler_connect_global(PyObject *self,
+							  PyObject *args)
+{
+	UNUSED_PARAMETER(self);
+	return connect_signal_global(args, calldata_signal_callback_global);
+}
+
+/* -------------------------------------------- */
+/* Batched signals                              */
+
+/*
+ *   Signals connected with the *_batched variants are not called from the
+ * thread that fires them.  The firing thread copies the calldata into an
+ * event and pushes it onto the event queue, and a dedicated thread delivers
+ * the queued events in batches with one GIL acquisition per batch.  The
+ * firing thread never waits for python, it may hold locks the callbacks
+ * need.
+ *
+ *   Sources, scenes, scene items and outputs in the usual calldata params
+ * are referenced until the callback returns.  Sources that are already
+ * being destroyed can't be referenced anymore and are passed as None.
+ */
+
+#define BATCH_MAX_EVENTS 256
+
+static const char *event_source_params[] = {"source", "filter"};
+#define NUM_EVENT_SOURCE_PARAMS \
+	(sizeof(event_source_params) / sizeof(event_source_params[0]))
+
+struct python_obs_event {
+	struct python_obs_callback *cb;
+	char *signal;
+	calldata_t cd;
+	uint64_t queued_ts;
+
+	obs_source_t *sources[NUM_EVENT_SOURCE_PARAMS];
+	obs_scene_t *scene;
+	obs_sceneitem_t *item;
+	obs_output_t *output;
+};
+
+struct python_batch_stats {
+	uint64_t dispatched;
+	uint64_t batches;
+	uint64_t total_latency;
+	uint64_t max_latency;
+	long max_queued;
+};
+
+static struct script_event_queue batch_queue;
+
+static pthread_t batch_thread;
+static bool batch_thread_active = false;
+static os_sem_t *batch_semaphore = NULL;
+static volatile bool batch_wake_pending = false;
+static volatile bool batch_exit = false;
+
+static pthread_mutex_t batch_stats_mutex;
+static struct python_batch_stats batch_stats = {0};
+
+static void ref_event_params(struct python_obs_event *event)
+{
+	calldata_t *cd = &event->cd;
+
+	for (size_t i = 0; i < NUM_EVENT_SOURCE_PARAMS; i++) {
+		const char *name = event_source_params[i];
+		obs_source_t *source = calldata_ptr(cd, name);
+
+		event->sources[i] = obs_source_get_ref(source);
+		if (source && !event->sources[i])
+			calldata_set_ptr(cd, name, NULL);
+	}
+
+	obs_scene_t *scene = calldata_ptr(cd, "scene");
+	event->scene = obs_scene_get_ref(scene);
+	if (scene && !event->scene)
+		calldata_set_ptr(cd, "scene", NULL);
+
+	obs_output_t *output = calldata_ptr(cd, "output");
+	event->output = obs_output_get_ref(output);
+	if (output && !event->output)
+		calldata_set_ptr(cd, "output", NULL);
+
+	event->item = calldata_ptr(cd, "item");
+	obs_sceneitem_addref(event->item);
+}
+
+static struct python_obs_event *
+python_obs_event_create(struct python_obs_callback *cb, const char *signal,
+			const calldata_t *cd)
+{
+	struct python_obs_event *event = bzalloc(sizeof(*event));
+	event->cb = cb;
+	event->signal = signal ? bstrdup(signal) : NULL;
+	event->queued_ts = os_gettime_ns();
+
+	if (cd->stack && cd->size) {
+		event->cd.stack = bmemdup(cd->stack, cd->size);
+		event->cd.size = cd->size;
+		event->cd.capacity = cd->size;
+	}
+
+	ref_event_params(event);
+	return event;
+}
+
+static void python_obs_event_free(struct python_obs_event *event)
+{
+	for (size_t i = 0; i < NUM_EVENT_SOURCE_PARAMS; i++)
+		obs_source_release(event->sources[i]);
+	obs_scene_release(event->scene);
+	obs_sceneitem_release(event->item);
+	obs_output_release(event->output);
+
+	calldata_free(&event->cd);
+	bfree(event->signal);
+	bfree(event);
+}
+
+static inline struct python_obs_event *pop_python_event(void)
+{
+	return script_event_queue_pop(&batch_queue);
+}
+
+static inline long get_batch_queued(void)
+{
+	return script_event_queue_size(&batch_queue);
+}
+
+/* must be called with python locked */
+static void call_python_event(struct python_obs_event *event)
+{
+	struct python_obs_callback *cb = event->cb;
+	PyObject *py_cd;
+
+	if (script_callback_removed(&cb->base))
+		return;
+
+	if (libobs_to_py(calldata_t, &event->cd, false, &py_cd)) {
+		PyObject *args;
+
+		if (event->signal)
+			args = Py_BuildValue("(sO)", event->signal, py_cd);
+		else
+			args = Py_BuildValue("(O)", py_cd);
+
+		call_python_obs_callback(cb, args);
+		Py_XDECREF(args);
+		Py_XDECREF(py_cd);
+	}
+}
+
+static void dispatch_python_events(void)
+{
+	struct python_obs_event *events[BATCH_MAX_EVENTS];
+	uint64_t total_latency = 0;
+	uint64_t max_latency = 0;
+	long queued = get_batch_queued();
+	size_t num = 0;
+
+	while (num < BATCH_MAX_EVENTS) {
+		struct python_obs_event *event = pop_python_event();
+		if (!event)
+			break;
+		events[num++] = event;
+	}
+
+	if (!num)
+		return;
+
+	lock_python();
+
+	for (size_t i = 0; i < num; i++) {
+		uint64_t latency = os_gettime_ns() - events[i]->queued_ts;
+		total_latency += latency;
+		if (latency > max_latency)
+			max_latency = latency;
+
+		call_python_event(events[i]);
+	}
+
+	unlock_python();
+
+	/* releasing the last reference of a source can fire more signals,
+	 * so the events are freed outside of the GIL */
+	for (size_t i = 0; i < num; i++)
+		python_obs_event_free(events[i]);
+
+	pthread_mutex_lock(&batch_stats_mutex);
+	batch_stats.dispatched += num;
+	batch_stats.batches++;
+	batch_stats.total_latency += total_latency;
+	if (max_latency > batch_stats.max_latency)
+		batch_stats.max_latency = max_latency;
+	if (queued > batch_stats.max_queued)
+		batch_stats.max_queued = queued;
+	pthread_mutex_unlock(&batch_stats_mutex);
+}
+
+static void *python_batch_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	os_set_thread_name("scripting: python batch");
+
+	while (os_sem_wait(batch_semaphore) == 0) {
+		if (os_atomic_load_bool(&batch_exit))
+			break;
+
+		/* cleared before draining so that events pushed during the
+		 * dispatch post the semaphore again */
+		os_atomic_set_bool(&batch_wake_pending, false);
+
+		while (get_batch_queued() > 0)
+			dispatch_python_events();
+	}
+
+	return NULL;
+}
+
+/* must be called with python locked */
+static bool start_python_batch_thread(void)
+{
+	if (batch_thread_active)
+		return true;
+
+	if (pthread_create(&batch_thread, NULL, python_batch_thread, NULL) !=
+	    0) {
+		warn("Failed to create python batch thread");
+		return false;
+	}
+
+	batch_thread_active = true;
+	return true;
+}
+
+static void stop_python_batch_thread(void)
+{
+	struct python_obs_event *event;
+
+	if (!batch_thread_active)
+		return;
+
+	os_atomic_set_bool(&batch_exit, true);
+	os_sem_post(batch_semaphore);
+	pthread_join(batch_thread, NULL);
+	batch_thread_active = false;
+
+	while ((event = pop_python_event()) != NULL)
+		python_obs_event_free(event);
+
+	double avg_latency =
+		batch_stats.dispatched
+			? (double)batch_stats.total_latency /
+				  (double)batch_stats.dispatched / 1000.0
+			: 0.0;
+
+	blog(LOG_INFO,
+	     "[obs-scripting]: Batched python signals: %" PRIu64
+	     " dispatched in %" PRIu64 " batches, latency avg %.1f us, "
+	     "max %.1f us, %ld did not fit in the queue",
+	     batch_stats.dispatched, batch_stats.batches, avg_latency,
+	     (double)batch_stats.max_latency / 1000.0,
+	     script_event_queue_overflowed(&batch_queue));
+}
+
+static void queue_python_event(struct python_obs_callback *cb,
+			       const char *signal, calldata_t *cd)
+{
+	struct python_obs_event *event =
+		python_obs_event_create(cb, signal, cd);
+
+	script_event_queue_push(&batch_queue, event);
+
+	if (!os_atomic_exchange_bool(&batch_wake_pending, true))
+		os_sem_post(batch_semaphore);
+}
+
+static void batched_signal_callback(void *priv, calldata_t *cd)
+{
+	struct python_obs_callback *cb = priv;
+
+	if (script_callback_removed(&cb->base)) {
+		signal_handler_remove_current();
+		return;
+	}
+
+	queue_python_event(cb, NULL, cd);
+}
+
+static void batched_signal_callback_global(void *priv, const char *signal,
+					   calldata_t *cd)
+{
+	struct python_obs_callback *cb = priv;
+
+	if (script_callback_removed(&cb->base)) {
+		signal_handler_remove_current();
+		return;
+	}
+
+	queue_python_event(cb, signal, cd);
+}
+
+static PyObject *obs_python_signal_handler_connect_batched(PyObject *self,
+							   PyObject *args)
+{
+	UNUSED_PARAMETER(self);
+
+	if (!start_python_batch_thread())
+		return connect_signal(args, calldata_signal_callback);
+	return connect_signal(args, batched_signal_callback);
+}
+
+static PyObject *
+obs_python_signal_handler_connect_global_batched(PyObject *self,
+						 PyObject *args)
+{
+	UNUSED_PARAMETER(self);
+
+	if (!start_python_batch_thread())
+		return connect_signal_global(args,
+					     calldata_signal_callback_global);
+	return connect_signal_global(args, batched_signal_callback_global);
+}
+
+static PyObject *signal_handler_get_batch_stats(PyObject *self,
+						PyObject *args)
+{
+	struct python_batch_stats stats;
+
+	UNUSED_PARAMETER(self);
+	UNUSED_PARAMETER(args);
+
+	pthread_mutex_lock(&batch_stats_mutex);
+	stats = batch_stats;
+	pthread_mutex_unlock(&batch_stats_mutex);
+
+	double avg_latency = stats.dispatched
+				     ? (double)stats.total_latency /
+					       (double)stats.dispatched / 1000.0
+				     : 0.0;
+
+	return Py_BuildValue("{s:l,s:l,s:K,s:K,s:d,s:d,s:l}", "queued",
+			     get_batch_queued(), "max_queued",
+			     stats.max_queued, "dispatched",
+			     (unsigned long long)stats.dispatched, "batches",
+			     (unsigned long long)stats.batches,
+			     "avg_latency_us", avg_latency, "max_latency_us",
+			     (double)stats.max_latency / 1000.0, "overflowed",
+			     script_event_queue_overflowed(&batch_queue));
+}
+
 /* -------------------------------------------- */
 
 static void defer_hotkey_unregister(void *p_cb)
@@ -1264,6 +1659,12 @@ static void add_hook_functions(PyObject *module)
 			 obs_python_signal_handler_disconnect_global),
 		DEF_FUNC("signal_handler_connect_global",
 			 obs_python_signal_handler_connect_global),
+		DEF_FUNC("signal_handler_connect_batched",
+			 obs_python_signal_handler_connect_batched),
+		DEF_FUNC("signal_handler_connect_global_batched",
+			 obs_python_signal_handler_connect_global_batched),
+		DEF_FUNC("signal_handler_get_batch_stats",
+			 signal_handler_get_batch_stats),
 		DEF_FUNC("obs_hotkey_unregister", hotkey_unregister),
 		DEF_FUNC("obs_hotkey_register_frontend",
 			 hotkey_register_frontend),
@@ -1529,7 +1930,8 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
-static void python_tick(void *param, float seconds)
+/* must be called with python locked */
+static void process_script_ticks(PyObject *args)
 {
 	struct obs_python_script *data;
 	/* When loading a new Python script, the GIL might be released while
@@ -1538,76 +1940,100 @@ static void python_tick(void *param, float seconds)
 	 * to save and restore the value if not null.
 	 */
 	struct obs_python_script *busy_script = NULL;
-	bool valid;
-	uint64_t ts = obs_get_video_frame_time();
 
 	pthread_mutex_lock(&tick_mutex);
-	valid = !!first_tick_script;
-	pthread_mutex_unlock(&tick_mutex);
-
-	/* --------------------------------- */
-	/* process script_tick calls         */
+	data = first_tick_script;
 
-	if (valid) {
-		lock_python();
+	if (cur_python_script)
+		busy_script = cur_python_script;
 
-		PyObject *args = Py_BuildValue("(f)", seconds);
+	while (data) {
+		cur_python_script = data;
 
-		pthread_mutex_lock(&tick_mutex);
-		data = first_tick_script;
+		PyObject *py_ret = PyObject_CallObject(data->tick, args);
+		Py_XDECREF(py_ret);
+		py_error();
 
-		if (cur_python_script)
-			busy_script = cur_python_script;
+		data = data->next_tick;
+	}
 
-		while (data) {
-			cur_python_script = data;
+	cur_python_script = NULL;
+	if (busy_script) {
+		cur_python_script = busy_script;
+		busy_script = NULL;
+	}
 
-			PyObject *py_ret =
-				PyObject_CallObject(data->tick, args);
-			Py_XDECREF(py_ret);
-			py_error();
+	pthread_mutex_unlock(&tick_mutex);
+}
 
-			data = data->next_tick;
-		}
+static inline bool timer_due(struct python_obs_timer *timer, uint64_t ts)
+{
+	return timer->tick || ts - timer->last_ts >= timer->interval;
+}
 
-		cur_python_script = NULL;
-		if (busy_script) {
-			cur_python_script = busy_script;
-			busy_script = NULL;
-		}
+/* unlinks removed timers and returns whether any of the others are due,
+ * must be called with timer_mutex held */
+static bool prune_timers(uint64_t ts)
+{
+	struct python_obs_timer *timer = first_timer;
+	bool due = false;
 
-		pthread_mutex_unlock(&tick_mutex);
+	while (timer) {
+		struct python_obs_timer *next = timer->next;
+		struct python_obs_callback *cb = python_obs_timer_cb(timer);
 
-		Py_XDECREF(args);
+		if (script_callback_removed(&cb->base))
+			python_obs_timer_remove(timer);
+		else if (timer_due(timer, ts))
+			due = true;
 
-		unlock_python();
+		timer = next;
 	}
 
-	/* --------------------------------- */
-	/* process timers                    */
+	return due;
+}
+
+static void python_tick(void *param, float seconds)
+{
+	bool valid;
+	uint64_t ts = obs_get_video_frame_time();
+
+	pthread_mutex_lock(&tick_mutex);
+	valid = !!first_tick_script;
+	pthread_mutex_unlock(&tick_mutex);
 
 	pthread_mutex_lock(&timer_mutex);
-	struct python_obs_timer *timer = first_timer;
-	while (timer) {
-		struct python_obs_timer *next = timer->next;
-		struct python_obs_callback *cb = python_obs_timer_cb(timer);
+	bool timers_due = prune_timers(ts);
 
-		if (script_callback_removed(&cb->base)) {
-			python_obs_timer_remove(timer);
-		} else {
-			uint64_t elapsed = ts - timer->last_ts;
+	/* script_tick calls, timers and tick callbacks all share one GIL
+	 * acquisition per frame */
+	if (valid || timers_due) {
+		lock_python();
+
+		PyObject *args = Py_BuildValue("(f)", seconds);
+
+		if (valid)
+			process_script_ticks(args);
 
-			if (elapsed >= timer->interval) {
-				lock_python();
-				timer_call(&cb->base);
-				unlock_python();
+		struct python_obs_timer *timer = first_timer;
+		while (timers_due && timer) {
+			struct python_obs_timer *next = timer->next;
 
-				timer->last_ts += timer->interval;
+			if (timer_due(timer, ts)) {
+				timer_call(timer, args);
+
+				if (!timer->tick)
+					timer->last_ts += timer->interval;
 			}
+
+			timer = next;
 		}
 
-		timer = next;
+		Py_XDECREF(args);
+
+		unlock_python();
 	}
+
 	pthread_mutex_unlock(&timer_mutex);
 
 	UNUSED_PARAMETER(param);
@@ -1644,6 +2070,9 @@ void obs_python_load(void)
 
 	pthread_mutex_init(&tick_mutex, NULL);
 	pthread_mutex_init_recursive(&timer_mutex);
+	pthread_mutex_init(&batch_stats_mutex, NULL);
+	os_sem_init(&batch_semaphore, 0);
+	script_event_queue_init(&batch_queue);
 
 	mutexes_loaded = true;
 }
@@ -1799,9 +2228,15 @@ out:
 
 void obs_python_unload(void)
 {
+	stop_python_batch_thread();
+
 	if (mutexes_loaded) {
 		pthread_mutex_destroy(&tick_mutex);
 		pthread_mutex_destroy(&timer_mutex);
+		pthread_mutex_destroy(&batch_stats_mutex);
+		os_sem_destroy(batch_semaphore);
+		batch_semaphore = NULL;
+		script_event_queue_free(&batch_queue);
 	}
 
 	if (!python_loaded_at_all)
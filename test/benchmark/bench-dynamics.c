@@ -0,0 +1,252 @@
+/*
+ * Dynamics kernel benchmark for the compressor, expander, limiter and noise
+ * gate filters.
+ *
+ * Runs the envelope detection and gain stage of the compressor (peak
+ * detection) and the expander (RMS detection) on synthetic input, one
+ * 1024 frame block at a time the way the filters receive audio.  Every
+ * channel count is timed with the per-sample scalar code the filters used to
+ * have and with the block-wise kernels from dynamics.c.
+ *
+ * usage: bench-dynamics [-b blocks] [-c max_channels]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-math.h>
+
+#include "dynamics.h"
+
+#define FRAMES 1024
+#define MAX_CHANNELS 8
+
+static const float attack_gain = 0.99f;
+static const float release_gain = 0.9995f;
+static const float threshold = -18.0f;
+static const float comp_slope = 1.0f - 1.0f / 10.0f;
+static const float exp_slope = 1.0f - 4.0f;
+static const float output_gain = 1.5f;
+static const float rms_coef = 0.998f;
+
+enum bench_mode {
+	MODE_COMP_SCALAR,
+	MODE_COMP_KERNELS,
+	MODE_EXP_SCALAR,
+	MODE_EXP_KERNELS,
+};
+
+static const char *mode_names[] = {
+	"compressor, scalar",
+	"compressor, kernels",
+	"expander rms, scalar",
+	"expander rms, kernels",
+};
+
+struct bench_state {
+	float *samples[MAX_CHANNELS];
+	float *env[MAX_CHANNELS];
+	float *gain;
+	float runave[MAX_CHANNELS];
+	float gain_db[MAX_CHANNELS];
+	float envelope;
+};
+
+static void fill_block(float *data, int channel, int block, uint32_t *seed)
+{
+	for (int i = 0; i < FRAMES; i++) {
+		float t = (float)(block * FRAMES + i);
+		float swell = sinf(t * 0.0005f + (float)channel);
+
+		*seed = *seed * 1664525 + 1013904223;
+		data[i] = ((float)(*seed >> 8) / (float)(1 << 23) - 1.0f) *
+			  swell * swell;
+	}
+}
+
+static void compressor_scalar(struct bench_state *st, size_t channels)
+{
+	float *env_buf = st->env[0];
+
+	memset(env_buf, 0, FRAMES * sizeof(float));
+	for (size_t c = 0; c < channels; c++) {
+		float env = st->envelope;
+
+		for (size_t i = 0; i < FRAMES; i++) {
+			const float env_in = fabsf(st->samples[c][i]);
+			const float coef = env < env_in ? attack_gain
+							: release_gain;
+			env = env_in + coef * (env - env_in);
+			env_buf[i] = fmaxf(env_buf[i], env);
+		}
+	}
+	st->envelope = env_buf[FRAMES - 1];
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		const float env_db = mul_to_db(env_buf[i]);
+		float gain = comp_slope * (threshold - env_db);
+		gain = db_to_mul(fminf(0, gain));
+
+		for (size_t c = 0; c < channels; c++)
+			st->samples[c][i] *= gain * output_gain;
+	}
+}
+
+static void compressor_kernels(struct bench_state *st, size_t channels)
+{
+	dyn_peak_envelope(st->env[0], st->samples, channels, FRAMES,
+			  &st->envelope, attack_gain, release_gain);
+	dyn_compressor_gain(st->gain, st->env[0], FRAMES, threshold,
+			    comp_slope, output_gain);
+	dyn_apply_gain(st->samples, channels, st->gain, FRAMES);
+}
+
+static inline float expander_ballistics(float prev, float gain)
+{
+	if (gain > prev)
+		return attack_gain * prev + (1.0f - attack_gain) * gain;
+	return release_gain * prev + (1.0f - release_gain) * gain;
+}
+
+static void expander_scalar(struct bench_state *st, size_t channels)
+{
+	for (size_t c = 0; c < channels; c++) {
+		float *samples = st->samples[c];
+		float ave = st->runave[c];
+		float prev = st->gain_db[c];
+
+		for (size_t i = 0; i < FRAMES; i++) {
+			ave = rms_coef * ave +
+			      (1.0f - rms_coef) * samples[i] * samples[i];
+
+			const float env_db = mul_to_db(sqrtf(ave));
+			const float diff = threshold - env_db;
+			const float gain =
+				diff > 0.0f ? fmaxf(exp_slope * diff, -60.0f)
+					    : 0.0f;
+
+			prev = expander_ballistics(prev, gain);
+			samples[i] *= db_to_mul(fminf(0, prev)) * output_gain;
+		}
+
+		st->runave[c] = ave;
+		st->gain_db[c] = prev;
+	}
+}
+
+static void expander_kernels(struct bench_state *st, size_t channels)
+{
+	const float output_gain_db = mul_to_db(output_gain);
+
+	dyn_rms_envelope(st->env, st->samples, channels, FRAMES, st->runave,
+			 rms_coef);
+
+	for (size_t c = 0; c < channels; c++) {
+		float prev = st->gain_db[c];
+
+		dyn_expander_gain_db(st->gain, st->env[c], FRAMES, threshold,
+				     exp_slope);
+		for (size_t i = 0; i < FRAMES; i++) {
+			prev = expander_ballistics(prev, st->gain[i]);
+			st->gain[i] = fminf(0, prev) + output_gain_db;
+		}
+		st->gain_db[c] = prev;
+
+		dyn_db_to_mul(st->gain, st->gain, FRAMES);
+		dyn_apply_gain(&st->samples[c], 1, st->gain, FRAMES);
+	}
+}
+
+static double run_bench(enum bench_mode mode, int channels, int blocks)
+{
+	struct bench_state st = {0};
+	uint32_t seed = 1;
+	uint64_t total = 0;
+
+	for (int c = 0; c < channels; c++) {
+		st.samples[c] = bmalloc(FRAMES * sizeof(float));
+		st.env[c] = bmalloc(FRAMES * sizeof(float));
+	}
+	st.gain = bmalloc(FRAMES * sizeof(float));
+
+	for (int b = 0; b < blocks; b++) {
+		for (int c = 0; c < channels; c++)
+			fill_block(st.samples[c], c, b, &seed);
+
+		uint64_t start = os_gettime_ns();
+
+		switch (mode) {
+		case MODE_COMP_SCALAR:
+			compressor_scalar(&st, channels);
+			break;
+		case MODE_COMP_KERNELS:
+			compressor_kernels(&st, channels);
+			break;
+		case MODE_EXP_SCALAR:
+			expander_scalar(&st, channels);
+			break;
+		case MODE_EXP_KERNELS:
+			expander_kernels(&st, channels);
+			break;
+		}
+
+		total += os_gettime_ns() - start;
+	}
+
+	for (int c = 0; c < channels; c++) {
+		bfree(st.samples[c]);
+		bfree(st.env[c]);
+	}
+	bfree(st.gain);
+
+	/* microseconds per block */
+	return (double)total / 1000.0 / (double)blocks;
+}
+
+int main(int argc, char *argv[])
+{
+	int blocks = 20000;
+	int max_channels = 8;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		const char *val = argv[++i];
+
+		if (strcmp(arg, "-b") == 0)
+			blocks = atoi(val);
+		else if (strcmp(arg, "-c") == 0)
+			max_channels = atoi(val);
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+	}
+
+	if (blocks <= 0 || max_channels <= 0 || max_channels > MAX_CHANNELS) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	printf("%d blocks of %d frames\n", blocks, FRAMES);
+	printf("%-8s %-24s %12s\n", "channels", "mode", "us/block");
+
+	for (int channels = 1; channels <= max_channels; channels *= 2) {
+		for (int mode = 0; mode <= MODE_EXP_KERNELS; mode++) {
+			double us = run_bench(mode, channels, blocks);
+			printf("%-8d %-24s %12.2f\n", channels,
+			       mode_names[mode], us);
+		}
+	}
+
+	return 0;
+}
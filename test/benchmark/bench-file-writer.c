@@ -0,0 +1,184 @@
+/*
+ * Synthetic write throughput benchmark for the buffered file serializer.
+ *
+ * Simulates one or more recordings writing to the same disk, with the
+ * occasional backwards seek to patch a box header like the MP4 muxer does,
+ * and reports throughput and writer stalls for each I/O backend.
+ *
+ * usage: bench-file-writer [-d directory] [-s size_mb] [-w write_kb]
+ *                          [-j num_writers] [-b buffered|direct|both]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/buffered-file-serializer.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+struct bench_params {
+	const char *dir;
+	uint64_t size;
+	size_t write_size;
+	int writers;
+};
+
+struct bench_writer {
+	const struct bench_params *params;
+	uint32_t flags;
+	int idx;
+	pthread_t thread;
+
+	uint64_t max_write_call_ns;
+	struct buffered_file_serializer_stats stats;
+	bool success;
+};
+
+static void *writer_thread(void *data)
+{
+	struct bench_writer *w = data;
+	const struct bench_params *params = w->params;
+	struct serializer s;
+	struct dstr path = {0};
+	uint8_t *buf = bmalloc(params->write_size);
+	uint64_t written = 0;
+	uint64_t box_start = 0;
+
+	for (size_t i = 0; i < params->write_size; i++)
+		buf[i] = (uint8_t)(i * 31 + w->idx);
+
+	dstr_printf(&path, "%s/bench-file-writer-%d.bin", params->dir, w->idx);
+
+	if (!buffered_file_serializer_init2(&s, path.array, 0, 0, w->flags)) {
+		fprintf(stderr, "Failed to open '%s'\n", path.array);
+		goto fail;
+	}
+
+	while (written < params->size) {
+		uint64_t start = os_gettime_ns();
+		s_write(&s, buf, params->write_size);
+		uint64_t elapsed = os_gettime_ns() - start;
+
+		if (elapsed > w->max_write_call_ns)
+			w->max_write_call_ns = elapsed;
+
+		written += params->write_size;
+
+		/* patch the size of the previous "box" every 16 MiB */
+		if (written - box_start >= 16 * 1048576) {
+			serializer_seek(&s, (int64_t)box_start,
+					SERIALIZE_SEEK_START);
+			s_wb32(&s, (uint32_t)(written - box_start));
+			serializer_seek(&s, (int64_t)written,
+					SERIALIZE_SEEK_START);
+			box_start = written;
+		}
+	}
+
+	w->success = serializer_get_pos(&s) != -1;
+	buffered_file_serializer_get_stats(&s, &w->stats);
+	buffered_file_serializer_free(&s);
+
+	os_unlink(path.array);
+
+fail:
+	dstr_free(&path);
+	bfree(buf);
+	return NULL;
+}
+
+static void run_bench(const struct bench_params *params, uint32_t flags)
+{
+	struct bench_writer *writers =
+		bzalloc(sizeof(struct bench_writer) * params->writers);
+	uint64_t max_write_call_ns = 0;
+	uint64_t stalls = 0;
+	uint64_t stall_time_ns = 0;
+	uint64_t max_queued = 0;
+	bool direct = false;
+	bool success = true;
+
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < params->writers; i++) {
+		writers[i].params = params;
+		writers[i].flags = flags;
+		writers[i].idx = i;
+		pthread_create(&writers[i].thread, NULL, writer_thread,
+			       &writers[i]);
+	}
+
+	for (int i = 0; i < params->writers; i++) {
+		struct bench_writer *w = &writers[i];
+		pthread_join(w->thread, NULL);
+
+		if (w->max_write_call_ns > max_write_call_ns)
+			max_write_call_ns = w->max_write_call_ns;
+		if (w->stats.max_queued_bytes > max_queued)
+			max_queued = w->stats.max_queued_bytes;
+		stalls += w->stats.stalls;
+		stall_time_ns += w->stats.stall_time_ns;
+		direct = direct || w->stats.direct_io;
+		success = success && w->success;
+	}
+
+	double seconds = (double)(os_gettime_ns() - start) / 1e9;
+	double total_mb =
+		(double)params->size * params->writers / (1024.0 * 1024.0);
+
+	printf("%-8s %s: %8.1f MiB/s, %" PRIu64 " stall(s) (%" PRIu64
+	       " ms), peak queue %" PRIu64 " KiB, slowest write() %.3f ms\n",
+	       direct ? "direct" : "buffered", success ? "ok" : "FAILED",
+	       total_mb / seconds, stalls, stall_time_ns / 1000000,
+	       max_queued / 1024, (double)max_write_call_ns / 1e6);
+
+	bfree(writers);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_params params = {
+		.dir = ".",
+		.size = 1024ULL * 1048576ULL,
+		.write_size = 64 * 1024,
+		.writers = 1,
+	};
+	const char *backend = "both";
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char *arg = argv[i];
+		const char *val = argv[i + 1];
+
+		if (strcmp(arg, "-d") == 0)
+			params.dir = val;
+		else if (strcmp(arg, "-s") == 0)
+			params.size = strtoull(val, NULL, 10) * 1048576ULL;
+		else if (strcmp(arg, "-w") == 0)
+			params.write_size = strtoul(val, NULL, 10) * 1024;
+		else if (strcmp(arg, "-j") == 0)
+			params.writers = atoi(val);
+		else if (strcmp(arg, "-b") == 0)
+			backend = val;
+	}
+
+	if (!params.size || !params.write_size || params.writers < 1) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	printf("Writing %" PRIu64 " MiB in %zu KiB writes with %d writer(s) "
+	       "to '%s'\n",
+	       params.size / 1048576, params.write_size / 1024, params.writers,
+	       params.dir);
+
+	if (strcmp(backend, "direct") != 0)
+		run_bench(&params, 0);
+	if (strcmp(backend, "buffered") != 0)
+		run_bench(&params, BUFFERED_FILE_SERIALIZER_DIRECT_IO);
+
+	return 0;
+}
@@ -0,0 +1,431 @@
+/*
+ * Name lookup benchmark for large scene collections.
+ *
+ * Creates a collection with many sources, each with a few filters, plus
+ * private transitions and a scene holding every source (some of them in
+ * groups), then times the by-name lookups the frontend and scripts use
+ * while loading and switching scenes.
+ *
+ * usage: bench-name-lookup [-n num_sources] [-f filters_per_source]
+ *                          [-t num_transitions] [-G num_groups]
+ *                          [-l lookups] [-g graphics_module]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <obs-nix-platform.h>
+#include <X11/Xlib.h>
+#endif
+
+struct bench_params {
+	int num_sources;
+	int num_filters;
+	int num_transitions;
+	int num_groups;
+	int lookups;
+	const char *graphics_module;
+};
+
+struct bench_collection {
+	DARRAY(obs_source_t *) sources;
+	DARRAY(obs_source_t *) transitions;
+	obs_scene_t *scene;
+};
+
+#if defined(__linux__) || defined(__FreeBSD__)
+static Display *display = NULL;
+#endif
+
+static void log_handler(int lvl, const char *msg, va_list args, void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	if (lvl > LOG_WARNING)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Source types                                                              */
+
+static const char *bench_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Benchmark";
+}
+
+static void *bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void bench_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static uint32_t bench_get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 16;
+}
+
+static struct obs_source_info bench_source = {
+	.id = "bench_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+	.get_width = bench_get_size,
+	.get_height = bench_get_size,
+};
+
+static struct obs_source_info bench_filter = {
+	.id = "bench_filter",
+	.type = OBS_SOURCE_TYPE_FILTER,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+};
+
+static struct obs_source_info bench_transition = {
+	.id = "bench_transition",
+	.type = OBS_SOURCE_TYPE_TRANSITION,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+};
+
+/* ------------------------------------------------------------------------- */
+/* Setup                                                                     */
+
+static bool startup(const struct bench_params *params)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		fprintf(stderr, "Failed to open X display, set DISPLAY (for "
+				"example to an Xvfb server)\n");
+		return false;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+#endif
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to start libobs\n");
+		return false;
+	}
+
+	struct obs_video_info ovi = {
+		.graphics_module = params->graphics_module,
+		.fps_num = 30,
+		.fps_den = 1,
+		.base_width = 640,
+		.base_height = 360,
+		.output_width = 640,
+		.output_height = 360,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.gpu_conversion = true,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Failed to initialize video\n");
+		return false;
+	}
+
+	struct obs_audio_info oai = {
+		.samples_per_sec = 48000,
+		.speakers = SPEAKERS_STEREO,
+	};
+
+	if (!obs_reset_audio(&oai)) {
+		fprintf(stderr, "Failed to initialize audio\n");
+		return false;
+	}
+
+	obs_register_source(&bench_source);
+	obs_register_source(&bench_filter);
+	obs_register_source(&bench_transition);
+	return true;
+}
+
+static void create_collection(const struct bench_params *params,
+			      struct bench_collection *col)
+{
+	DARRAY(obs_sceneitem_t *) group_items;
+	char name[64];
+
+	da_init(group_items);
+	col->scene = obs_scene_create("bench scene");
+
+	for (int i = 0; i < params->num_groups; i++) {
+		snprintf(name, sizeof(name), "group %d", i);
+		obs_sceneitem_t *group =
+			obs_scene_add_group2(col->scene, name, false);
+		da_push_back(group_items, &group);
+	}
+
+	for (int i = 0; i < params->num_sources; i++) {
+		snprintf(name, sizeof(name), "source %d", i);
+		obs_source_t *source =
+			obs_source_create("bench_source", name, NULL, NULL);
+
+		for (int j = 0; j < params->num_filters; j++) {
+			snprintf(name, sizeof(name), "filter %d", j);
+			obs_source_t *filter = obs_source_create_private(
+				"bench_filter", name, NULL);
+			obs_source_filter_add(source, filter);
+			obs_source_release(filter);
+		}
+
+		/* every fourth source goes into a group to exercise the
+		 * recursive lookup */
+		obs_sceneitem_t *item = obs_scene_add(col->scene, source);
+		if (group_items.num && i % 4 == 0) {
+			size_t group = (size_t)(i / 4) % group_items.num;
+			obs_sceneitem_group_add_item(group_items.array[group],
+						     item);
+		}
+
+		da_push_back(col->sources, &source);
+	}
+
+	for (int i = 0; i < params->num_transitions; i++) {
+		snprintf(name, sizeof(name), "transition %d", i);
+		obs_source_t *transition = obs_source_create_private(
+			"bench_transition", name, NULL);
+		da_push_back(col->transitions, &transition);
+	}
+
+	da_free(group_items);
+}
+
+static void free_collection(struct bench_collection *col)
+{
+	obs_scene_release(col->scene);
+
+	for (size_t i = 0; i < col->sources.num; i++)
+		obs_source_release(col->sources.array[i]);
+	for (size_t i = 0; i < col->transitions.num; i++)
+		obs_source_release(col->transitions.array[i]);
+
+	da_free(col->sources);
+	da_free(col->transitions);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Lookups                                                                   */
+
+enum lookup_type {
+	LOOKUP_SOURCE,
+	LOOKUP_TRANSITION,
+	LOOKUP_FILTER,
+	LOOKUP_SCENE_ITEM,
+	LOOKUP_SCENE_ITEM_RECURSIVE,
+};
+
+/* deterministic so that runs of different builds do the same lookups */
+static inline uint32_t next_random(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static bool do_lookup(const struct bench_params *params,
+		      struct bench_collection *col, enum lookup_type type,
+		      uint32_t *state)
+{
+	char name[64];
+	bool found = false;
+
+	switch (type) {
+	case LOOKUP_SOURCE: {
+		uint32_t idx = next_random(state) % col->sources.num;
+		snprintf(name, sizeof(name), "source %" PRIu32, idx);
+
+		obs_source_t *source = obs_get_source_by_name(name);
+		found = !!source;
+		obs_source_release(source);
+		break;
+	}
+	case LOOKUP_TRANSITION: {
+		uint32_t idx = next_random(state) % col->transitions.num;
+		snprintf(name, sizeof(name), "transition %" PRIu32, idx);
+
+		obs_source_t *transition = obs_get_transition_by_name(name);
+		found = !!transition;
+		obs_source_release(transition);
+		break;
+	}
+	case LOOKUP_FILTER: {
+		uint32_t idx = next_random(state) % col->sources.num;
+		uint32_t filter = next_random(state) % params->num_filters;
+		snprintf(name, sizeof(name), "filter %" PRIu32, filter);
+
+		obs_source_t *source = col->sources.array[idx];
+		obs_source_t *result =
+			obs_source_get_filter_by_name(source, name);
+		found = !!result;
+		obs_source_release(result);
+		break;
+	}
+	case LOOKUP_SCENE_ITEM:
+	case LOOKUP_SCENE_ITEM_RECURSIVE: {
+		uint32_t idx = next_random(state) % col->sources.num;
+		snprintf(name, sizeof(name), "source %" PRIu32, idx);
+
+		/* grouped sources are only found by the recursive lookup */
+		if (type == LOOKUP_SCENE_ITEM_RECURSIVE)
+			found = !!obs_scene_find_source_recursive(col->scene,
+								  name);
+		else
+			found = !!obs_scene_find_source(col->scene, name) ||
+				(params->num_groups && idx % 4 == 0);
+		break;
+	}
+	}
+
+	return found;
+}
+
+static void time_lookups(const struct bench_params *params,
+			 struct bench_collection *col, enum lookup_type type,
+			 const char *label)
+{
+	uint32_t state = 0x9e3779b9;
+	int misses = 0;
+
+	uint64_t start = os_gettime_ns();
+	for (int i = 0; i < params->lookups; i++) {
+		if (!do_lookup(params, col, type, &state))
+			misses++;
+	}
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	printf("%-32s %10.1f ns/lookup", label,
+	       (double)elapsed / (double)params->lookups);
+	if (misses)
+		printf("  (%d lookups failed)", misses);
+	printf("\n");
+}
+
+static bool run_bench(const struct bench_params *params)
+{
+	struct bench_collection col = {0};
+
+	uint64_t start = os_gettime_ns();
+	create_collection(params, &col);
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	printf("%d sources, %d filters each, %d transitions, %d groups\n",
+	       params->num_sources, params->num_filters,
+	       params->num_transitions, params->num_groups);
+	printf("%-32s %10.1f ms\n", "create collection",
+	       (double)elapsed / 1000000.0);
+
+	if (params->num_sources)
+		time_lookups(params, &col, LOOKUP_SOURCE,
+			     "obs_get_source_by_name");
+	if (params->num_transitions)
+		time_lookups(params, &col, LOOKUP_TRANSITION,
+			     "obs_get_transition_by_name");
+	if (params->num_sources && params->num_filters)
+		time_lookups(params, &col, LOOKUP_FILTER,
+			     "obs_source_get_filter_by_name");
+	if (params->num_sources) {
+		time_lookups(params, &col, LOOKUP_SCENE_ITEM,
+			     "obs_scene_find_source");
+		time_lookups(params, &col, LOOKUP_SCENE_ITEM_RECURSIVE,
+			     "obs_scene_find_source_recursive");
+	}
+
+	start = os_gettime_ns();
+	free_collection(&col);
+	elapsed = os_gettime_ns() - start;
+
+	printf("%-32s %10.1f ms\n", "free collection",
+	       (double)elapsed / 1000000.0);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_params params = {
+		.num_sources = 10000,
+		.num_filters = 2,
+		.num_transitions = 64,
+		.num_groups = 16,
+		.lookups = 100000,
+		.graphics_module = "libobs-null",
+	};
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		const char *val = argv[++i];
+
+		if (strcmp(arg, "-n") == 0)
+			params.num_sources = atoi(val);
+		else if (strcmp(arg, "-f") == 0)
+			params.num_filters = atoi(val);
+		else if (strcmp(arg, "-t") == 0)
+			params.num_transitions = atoi(val);
+		else if (strcmp(arg, "-G") == 0)
+			params.num_groups = atoi(val);
+		else if (strcmp(arg, "-l") == 0)
+			params.lookups = atoi(val);
+		else if (strcmp(arg, "-g") == 0)
+			params.graphics_module = val;
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+	}
+
+	if (params.num_sources < 0 || params.num_filters < 0 ||
+	    params.num_transitions < 0 || params.num_groups < 0 ||
+	    params.lookups <= 0) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	base_set_log_handler(log_handler, NULL);
+
+	bool success = startup(&params) && run_bench(&params);
+
+	obs_shutdown();
+
+#if defined(__linux__) || defined(__FreeBSD__)
+	if (display)
+		XCloseDisplay(display);
+#endif
+
+	return success ? 0 : 1;
+}
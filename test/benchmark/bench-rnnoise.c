@@ -0,0 +1,145 @@
+/*
+ * RNNoise benchmark for the noise suppression filter.
+ *
+ * Runs the bundled RNNoise on synthetic noisy speech-like input, one
+ * 10 ms (480 sample) block at a time, the way the noise suppression filter
+ * does.  Every channel count is timed with the portable C kernels one
+ * channel at a time, with the SIMD kernels one channel at a time and with
+ * the SIMD kernels batching all channels through rnnoise_process_frames().
+ *
+ * usage: bench-rnnoise [-b blocks] [-c max_channels]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#include <rnnoise.h>
+#include "rnn_simd.h"
+
+#define FRAME_SIZE 480
+#define MAX_CHANNELS 8
+
+enum bench_mode {
+	MODE_SCALAR,
+	MODE_SIMD,
+	MODE_SIMD_BATCH,
+};
+
+static const char *mode_names[] = {
+	"scalar, per channel",
+	"simd, per channel",
+	"simd, batched",
+};
+
+static void fill_block(float *data, int channel, int block, uint32_t *seed)
+{
+	for (int i = 0; i < FRAME_SIZE; i++) {
+		float t = (float)(block * FRAME_SIZE + i);
+
+		*seed = *seed * 1664525 + 1013904223;
+		float noise = (float)(*seed >> 16) / 65536.0f - 0.5f;
+
+		/* RNNoise expects samples in 16 bit range */
+		data[i] = 8000.0f * sinf(t * 0.03f * (float)(channel + 1)) +
+			  4000.0f * noise;
+	}
+}
+
+static double run_bench(enum bench_mode mode, int channels, int blocks)
+{
+	DenoiseState *states[MAX_CHANNELS];
+	float *in[MAX_CHANNELS];
+	float *out[MAX_CHANNELS];
+	uint32_t seed = 1;
+	uint64_t total = 0;
+
+	rnn_simd_set_enabled(mode != MODE_SCALAR);
+
+	for (int c = 0; c < channels; c++) {
+		states[c] = rnnoise_create(NULL);
+		in[c] = bmalloc(FRAME_SIZE * sizeof(float));
+		out[c] = bmalloc(FRAME_SIZE * sizeof(float));
+	}
+
+	for (int b = 0; b < blocks; b++) {
+		for (int c = 0; c < channels; c++)
+			fill_block(in[c], c, b, &seed);
+
+		uint64_t start = os_gettime_ns();
+
+		if (mode == MODE_SIMD_BATCH) {
+			rnnoise_process_frames(states, out,
+					       (const float **)in, NULL,
+					       channels);
+		} else {
+			for (int c = 0; c < channels; c++)
+				rnnoise_process_frame(states[c], out[c],
+						      in[c]);
+		}
+
+		total += os_gettime_ns() - start;
+	}
+
+	for (int c = 0; c < channels; c++) {
+		rnnoise_destroy(states[c]);
+		bfree(in[c]);
+		bfree(out[c]);
+	}
+
+	/* microseconds per 10 ms block per channel */
+	return (double)total / 1000.0 / (double)blocks / (double)channels;
+}
+
+int main(int argc, char *argv[])
+{
+	int blocks = 2000;
+	int max_channels = 8;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		const char *val = argv[++i];
+
+		if (strcmp(arg, "-b") == 0)
+			blocks = atoi(val);
+		else if (strcmp(arg, "-c") == 0)
+			max_channels = atoi(val);
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+	}
+
+	if (blocks <= 0 || max_channels <= 0 || max_channels > MAX_CHANNELS) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	if (!rnn_simd_enabled())
+		printf("SIMD kernels are not supported on this CPU, the simd "
+		       "rows use the C kernels\n");
+
+	printf("%d blocks of %d samples\n", blocks, FRAME_SIZE);
+	printf("%-8s %-24s %16s\n", "channels", "mode", "us/block/channel");
+
+	for (int channels = 1; channels <= max_channels; channels *= 2) {
+		for (int mode = 0; mode <= MODE_SIMD_BATCH; mode++) {
+			double us = run_bench(mode, channels, blocks);
+			printf("%-8d %-24s %16.2f\n", channels,
+			       mode_names[mode], us);
+		}
+	}
+
+	rnn_simd_set_enabled(1);
+	return 0;
+}
@@ -0,0 +1,530 @@
+/*
+ * Pixel comparison and timing of fused video filter chains.
+ *
+ * Starts libobs without a frontend, applies a few chains of filters to a
+ * generated test pattern with transparency, and renders every chain with
+ * filter fusion enabled and disabled.  The two images are read back and
+ * compared, and the average render time of both is printed.  The fused
+ * image skips the 8 bit intermediate render targets, so small differences
+ * are expected, anything above the tolerance fails the check.
+ *
+ * Runs on a software renderer as well, for example with Xvfb and
+ * LIBGL_ALWAYS_SOFTWARE=1.
+ *
+ * usage: filter-fusion-check [-l lut.cube] [-n iterations] [-t tolerance]
+ *                            [-r WxH] [-g graphics_module] [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <obs-nix-platform.h>
+#include <X11/Xlib.h>
+#endif
+
+#ifdef _WIN32
+#define DEFAULT_GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define DEFAULT_GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+#define PATTERN_ID "fusion_check_pattern"
+#define MAX_CHAIN 8
+
+struct check_params {
+	const char *lut;
+	int iterations;
+	int tolerance;
+	uint32_t width;
+	uint32_t height;
+	const char *graphics_module;
+	bool verbose;
+};
+
+struct chain_filter {
+	const char *id;
+	const char *settings;
+	bool disabled;
+};
+
+struct filter_chain {
+	const char *name;
+	struct chain_filter filters[MAX_CHAIN];
+};
+
+/* filters are listed in the order they are applied */
+static const struct filter_chain chains[] = {
+	{
+		"color, color",
+		{
+			{"color_filter_v2",
+			 "{\"gamma\": 0.4, \"saturation\": 0.5}"},
+			{"color_filter_v2",
+			 "{\"hue_shift\": 60.0, \"contrast\": 0.3,"
+			 " \"opacity\": 0.8}"},
+		},
+	},
+	{
+		"color, sharpness, color, color",
+		{
+			{"color_filter_v2", "{\"brightness\": 0.1}"},
+			{"sharpness_filter_v2", "{\"sharpness\": 0.2}"},
+			{"color_filter_v2", "{\"gamma\": -0.5}"},
+			{"color_filter_v2",
+			 "{\"color_multiply\": 4286611711, \"opacity\": 0.7}"},
+		},
+	},
+	{
+		"color, disabled color, color",
+		{
+			{"color_filter_v2", "{\"saturation\": 1.5}"},
+			{"color_filter_v2", "{\"gamma\": 1.0}", true},
+			{"color_filter_v2", "{\"contrast\": -0.3}"},
+		},
+	},
+	{
+		"color, lut, color",
+		{
+			{"color_filter_v2", "{\"gamma\": 0.3}"},
+			{"clut_filter", "{\"clut_amount\": 0.75}"},
+			{"color_filter_v2", "{\"saturation\": 0.5}"},
+		},
+	},
+};
+
+#if defined(__linux__) || defined(__FreeBSD__)
+static Display *display = NULL;
+#endif
+
+static void log_handler(int lvl, const char *msg, va_list args, void *param)
+{
+	bool verbose = *(bool *)param;
+
+	if (lvl > LOG_WARNING && !verbose)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Test pattern source                                                       */
+
+struct pattern_data {
+	gs_texture_t *tex;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+static const char *pattern_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Fusion check pattern";
+}
+
+/* color gradients, with alpha going from opaque to transparent along the
+ * diagonal, so that the alpha handling between the filters is exercised as
+ * well */
+static void *pattern_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct pattern_data *pattern = bzalloc(sizeof(*pattern));
+	uint32_t cx = (uint32_t)obs_data_get_int(settings, "width");
+	uint32_t cy = (uint32_t)obs_data_get_int(settings, "height");
+	uint8_t *pixels = bmalloc(cx * cy * 4);
+
+	for (uint32_t y = 0; y < cy; y++) {
+		for (uint32_t x = 0; x < cx; x++) {
+			uint8_t *p = pixels + (y * cx + x) * 4;
+			uint32_t a = 255 - (x + y) * 255 / (cx + cy);
+
+			p[0] = (uint8_t)(x * 255 / cx);
+			p[1] = (uint8_t)(y * 255 / cy);
+			p[2] = (uint8_t)((x ^ y) & 0xFF);
+			p[3] = (uint8_t)a;
+		}
+	}
+
+	pattern->cx = cx;
+	pattern->cy = cy;
+
+	obs_enter_graphics();
+	pattern->tex = gs_texture_create(cx, cy, GS_RGBA, 1,
+					 (const uint8_t **)&pixels, 0);
+	obs_leave_graphics();
+
+	bfree(pixels);
+	UNUSED_PARAMETER(source);
+	return pattern;
+}
+
+static void pattern_destroy(void *data)
+{
+	struct pattern_data *pattern = data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(pattern->tex);
+	obs_leave_graphics();
+	bfree(pattern);
+}
+
+static void pattern_render(void *data, gs_effect_t *effect)
+{
+	struct pattern_data *pattern = data;
+
+	obs_source_draw(pattern->tex, 0, 0, 0, 0, false);
+	UNUSED_PARAMETER(effect);
+}
+
+static uint32_t pattern_get_width(void *data)
+{
+	struct pattern_data *pattern = data;
+	return pattern->cx;
+}
+
+static uint32_t pattern_get_height(void *data)
+{
+	struct pattern_data *pattern = data;
+	return pattern->cy;
+}
+
+static struct obs_source_info pattern_info = {
+	.id = PATTERN_ID,
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = pattern_get_name,
+	.create = pattern_create,
+	.destroy = pattern_destroy,
+	.video_render = pattern_render,
+	.get_width = pattern_get_width,
+	.get_height = pattern_get_height,
+};
+
+/* ------------------------------------------------------------------------- */
+/* Setup                                                                     */
+
+static bool startup(const struct check_params *params)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		fprintf(stderr, "Failed to open X display, set DISPLAY (for "
+				"example to an Xvfb server)\n");
+		return false;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+#endif
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to start libobs\n");
+		return false;
+	}
+
+	struct obs_video_info ovi = {
+		.graphics_module = params->graphics_module,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = params->width,
+		.base_height = params->height,
+		.output_width = params->width,
+		.output_height = params->height,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.gpu_conversion = true,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Failed to initialize video\n");
+		return false;
+	}
+
+	obs_register_source(&pattern_info);
+	obs_load_all_modules();
+	obs_post_load_modules();
+	return true;
+}
+
+static obs_source_t *create_chain(const struct check_params *params,
+				  const struct filter_chain *chain)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "width", params->width);
+	obs_data_set_int(settings, "height", params->height);
+
+	obs_source_t *source =
+		obs_source_create_private(PATTERN_ID, chain->name, settings);
+	obs_data_release(settings);
+
+	for (size_t i = 0; i < MAX_CHAIN && chain->filters[i].id; i++) {
+		const struct chain_filter *cf = &chain->filters[i];
+		bool is_lut = strcmp(cf->id, "clut_filter") == 0;
+		char name[32];
+
+		if (is_lut && !params->lut) {
+			obs_source_release(source);
+			return NULL;
+		}
+
+		settings = obs_data_create_from_json(cf->settings);
+		if (is_lut)
+			obs_data_set_string(settings, "image_path",
+					    params->lut);
+
+		snprintf(name, sizeof(name), "filter %d", (int)i);
+		obs_source_t *filter = obs_source_create_private(
+			cf->id, name, settings);
+		if (!filter) {
+			fprintf(stderr, "Failed to create filter '%s'\n",
+				cf->id);
+			obs_data_release(settings);
+			obs_source_release(source);
+			return NULL;
+		}
+
+		obs_source_set_enabled(filter, !cf->disabled);
+		obs_source_filter_add(source, filter);
+		obs_source_release(filter);
+		obs_data_release(settings);
+	}
+
+	return source;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Rendering                                                                 */
+
+/* The source is rendered from a main render callback, once per frame after
+ * libobs ticked all sources, so that the filters render to their targets
+ * again every time like they do in a scene. */
+struct render_job {
+	obs_source_t *source;
+	uint32_t cx;
+	uint32_t cy;
+	int iterations;
+	int rendered;
+	uint8_t *pixels;
+	uint64_t total;
+
+	gs_texrender_t *texrender;
+	gs_stagesurf_t *stagesurf;
+	os_event_t *finished;
+};
+
+static void render_job_draw(void *param, uint32_t base_cx, uint32_t base_cy)
+{
+	struct render_job *job = param;
+	const uint32_t cx = job->cx;
+	const uint32_t cy = job->cy;
+	struct vec4 clear_color;
+
+	if (job->rendered == job->iterations)
+		return;
+
+	if (!job->texrender) {
+		job->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		job->stagesurf = gs_stagesurface_create(cx, cy, GS_RGBA);
+	}
+
+	vec4_zero(&clear_color);
+
+	uint64_t start = os_gettime_ns();
+
+	gs_texrender_reset(job->texrender);
+	if (gs_texrender_begin(job->texrender, cx, cy)) {
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		gs_blend_state_push();
+		gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+		obs_source_video_render(job->source);
+		gs_blend_state_pop();
+
+		gs_texrender_end(job->texrender);
+	}
+
+	/* waits for the GPU, so the time includes the rendering */
+	gs_stage_texture(job->stagesurf,
+			 gs_texrender_get_texture(job->texrender));
+
+	uint8_t *data;
+	uint32_t linesize;
+
+	if (gs_stagesurface_map(job->stagesurf, &data, &linesize)) {
+		for (uint32_t y = 0; y < cy; y++)
+			memcpy(job->pixels + y * cx * 4, data + y * linesize,
+			       cx * 4);
+		gs_stagesurface_unmap(job->stagesurf);
+	}
+
+	job->total += os_gettime_ns() - start;
+
+	if (++job->rendered == job->iterations)
+		os_event_signal(job->finished);
+
+	UNUSED_PARAMETER(base_cx);
+	UNUSED_PARAMETER(base_cy);
+}
+
+/* renders the source iterations times and reads back the last image,
+ * returns the average time per render in microseconds */
+static double render_source(obs_source_t *source, uint32_t cx, uint32_t cy,
+			    int iterations, uint8_t *pixels)
+{
+	struct render_job job = {
+		.source = source,
+		.cx = cx,
+		.cy = cy,
+		.iterations = iterations,
+		.pixels = pixels,
+	};
+
+	if (os_event_init(&job.finished, OS_EVENT_TYPE_MANUAL) != 0)
+		return 0.0;
+
+	obs_add_main_render_callback(render_job_draw, &job);
+	os_event_wait(job.finished);
+	obs_remove_main_render_callback(render_job_draw, &job);
+
+	obs_enter_graphics();
+	gs_stagesurface_destroy(job.stagesurf);
+	gs_texrender_destroy(job.texrender);
+	obs_leave_graphics();
+
+	os_event_destroy(job.finished);
+	return (double)job.total / 1000.0 / (double)iterations;
+}
+
+static bool check_chain(const struct check_params *params,
+			const struct filter_chain *chain)
+{
+	obs_source_t *source = create_chain(params, chain);
+	if (!source) {
+		printf("%-32s skipped\n", chain->name);
+		return true;
+	}
+
+	const uint32_t cx = params->width;
+	const uint32_t cy = params->height;
+	uint8_t *separate = bzalloc(cx * cy * 4);
+	uint8_t *fused = bzalloc(cx * cy * 4);
+
+	obs_set_video_filter_fusion(false);
+	double separate_us = render_source(source, cx, cy, params->iterations,
+					   separate);
+	obs_set_video_filter_fusion(true);
+	double fused_us =
+		render_source(source, cx, cy, params->iterations, fused);
+
+	int max_diff = 0;
+	size_t over = 0;
+
+	for (size_t i = 0; i < (size_t)cx * cy * 4; i++) {
+		int diff = abs((int)separate[i] - (int)fused[i]);
+		if (diff > max_diff)
+			max_diff = diff;
+		if (diff > params->tolerance)
+			over++;
+	}
+
+	bool pass = max_diff <= params->tolerance;
+	printf("%-32s %12.1f %12.1f %9d %10zu  %s\n", chain->name, separate_us,
+	       fused_us, max_diff, over, pass ? "ok" : "FAILED");
+
+	bfree(separate);
+	bfree(fused);
+	obs_source_release(source);
+	return pass;
+}
+
+static bool parse_resolution(const char *val, uint32_t *cx, uint32_t *cy)
+{
+	return sscanf(val, "%ux%u", cx, cy) == 2 && *cx && *cy;
+}
+
+int main(int argc, char *argv[])
+{
+	struct check_params params = {
+		.iterations = 100,
+		.tolerance = 3,
+		.width = 1920,
+		.height = 1080,
+		.graphics_module = DEFAULT_GRAPHICS_MODULE,
+	};
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (strcmp(arg, "-v") == 0) {
+			params.verbose = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		const char *val = argv[++i];
+
+		if (strcmp(arg, "-l") == 0)
+			params.lut = val;
+		else if (strcmp(arg, "-n") == 0)
+			params.iterations = atoi(val);
+		else if (strcmp(arg, "-t") == 0)
+			params.tolerance = atoi(val);
+		else if (strcmp(arg, "-r") == 0) {
+			if (!parse_resolution(val, &params.width,
+					      &params.height)) {
+				fprintf(stderr, "Invalid resolution '%s'\n",
+					val);
+				return 1;
+			}
+		} else if (strcmp(arg, "-g") == 0)
+			params.graphics_module = val;
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+	}
+
+	if (params.iterations <= 0 || params.tolerance < 0) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	base_set_log_handler(log_handler, &params.verbose);
+
+	bool success = startup(&params);
+
+	if (success) {
+		printf("%-32s %12s %12s %9s %10s\n", "chain", "separate us",
+		       "fused us", "max diff", "over tol");
+
+		for (size_t i = 0; i < OBS_COUNTOF(chains); i++)
+			success = check_chain(&params, &chains[i]) && success;
+
+		/* leave the default behind */
+		obs_set_video_filter_fusion(true);
+	}
+
+	obs_shutdown();
+
+#if defined(__linux__) || defined(__FreeBSD__)
+	if (display)
+		XCloseDisplay(display);
+#endif
+
+	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	return success ? 0 : 1;
+}
@@ -0,0 +1,650 @@
+/*
+ * Headless benchmark for the whole libobs pipeline.
+ *
+ * Starts libobs without a frontend, either loads a scene collection or
+ * generates a scene from the test-input sources, optionally encodes and
+ * outputs the result, and after a fixed number of frames writes a JSON
+ * report with per-stage timings from the profiler, frame statistics and
+ * memory usage that can be compared between builds.
+ *
+ * usage: obs-bench [-c collection.json] [-n num_sources] [-s source_id]
+ *                  [-a num_audio_sources] [-f frames] [-r WxH] [-F fps]
+ *                  [-o none|null|file] [-p output_path] [-e video_encoder]
+ *                  [-A audio_encoder] [-b bitrate] [-g graphics_module]
+ *                  [-j report.json] [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <graphics/vec2.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <obs-nix-platform.h>
+#include <X11/Xlib.h>
+#endif
+
+#ifdef _WIN32
+#define DEFAULT_GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define DEFAULT_GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+/* Time allowed per frame before the benchmark gives up waiting */
+#define FRAME_TIMEOUT_MS 1000
+
+struct bench_params {
+	const char *collection;
+	int num_sources;
+	const char *source_id;
+	int num_audio_sources;
+	uint32_t frames;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+	const char *output;
+	const char *path;
+	const char *video_encoder;
+	const char *audio_encoder;
+	int bitrate;
+	const char *graphics_module;
+	const char *report;
+	bool verbose;
+};
+
+/* Pipeline stages, matched against profiler scope names */
+struct bench_stage {
+	const char *key;
+	const char *name;
+	bool prefix;
+
+	DARRAY(profiler_time_entry_t) times;
+	uint64_t max_usec;
+};
+
+static struct bench_stage stages[] = {
+	{"tick", "tick_sources", false},
+	{"render", "render_video", false},
+	{"gpu_conversion", "render_convert_texture", false},
+	{"download", "download_frame", false},
+	{"video_io", "video_thread(", true},
+	{"encode", "do_encode", false},
+	{"interleave", "interleave_packets", false},
+	{"mux", "output_encoded_packet", false},
+	{"audio_callback", "audio_thread(", true},
+};
+
+#define NUM_STAGES (sizeof(stages) / sizeof(stages[0]))
+
+#if defined(__linux__) || defined(__FreeBSD__)
+static Display *display = NULL;
+#endif
+
+static void log_handler(int lvl, const char *msg, va_list args, void *param)
+{
+	bool verbose = *(bool *)param;
+
+	if (lvl > LOG_WARNING && !verbose)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Setup                                                                     */
+
+static bool startup(const struct bench_params *params,
+		    profiler_name_store_t *names)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		fprintf(stderr, "Failed to open X display, set DISPLAY (for "
+				"example to an Xvfb server)\n");
+		return false;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+#endif
+
+	if (!obs_startup("en-US", NULL, names)) {
+		fprintf(stderr, "Failed to start libobs\n");
+		return false;
+	}
+
+	struct obs_video_info ovi = {
+		.graphics_module = params->graphics_module,
+		.fps_num = params->fps,
+		.fps_den = 1,
+		.base_width = params->width,
+		.base_height = params->height,
+		.output_width = params->width,
+		.output_height = params->height,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.gpu_conversion = true,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Failed to initialize video\n");
+		return false;
+	}
+
+	struct obs_audio_info oai = {
+		.samples_per_sec = 48000,
+		.speakers = SPEAKERS_STEREO,
+	};
+
+	if (!obs_reset_audio(&oai)) {
+		fprintf(stderr, "Failed to initialize audio\n");
+		return false;
+	}
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	return true;
+}
+
+static obs_source_t *load_collection(const char *file)
+{
+	obs_data_t *data = obs_data_create_from_json_file(file);
+	if (!data) {
+		fprintf(stderr, "Failed to load scene collection '%s'\n", file);
+		return NULL;
+	}
+
+	obs_data_array_t *sources = obs_data_get_array(data, "sources");
+	const char *current = obs_data_get_string(data, "current_scene");
+
+	obs_load_sources(sources, NULL, NULL);
+	obs_source_t *scene = obs_get_source_by_name(current);
+
+	if (!scene)
+		fprintf(stderr, "Scene '%s' not found in '%s'\n", current,
+			file);
+
+	obs_data_array_release(sources);
+	obs_data_release(data);
+	return scene;
+}
+
+static obs_source_t *create_scene(const struct bench_params *params)
+{
+	obs_scene_t *scene = obs_scene_create("obs-bench");
+	int cols = 1;
+	char name[64];
+
+	while (cols * cols < params->num_sources)
+		cols++;
+
+	float cell_cx = (float)params->width / (float)cols;
+	float cell_cy = (float)params->height / (float)cols;
+
+	for (int i = 0; i < params->num_sources; i++) {
+		snprintf(name, sizeof(name), "%s %d", params->source_id, i);
+
+		obs_source_t *source =
+			obs_source_create(params->source_id, name, NULL, NULL);
+		if (!source) {
+			fprintf(stderr, "Failed to create source '%s'\n",
+				params->source_id);
+			obs_scene_release(scene);
+			return NULL;
+		}
+
+		struct vec2 pos;
+		vec2_set(&pos, cell_cx * (float)(i % cols),
+			 cell_cy * (float)(i / cols));
+
+		obs_sceneitem_t *item = obs_scene_add(scene, source);
+		obs_sceneitem_set_pos(item, &pos);
+		obs_sceneitem_set_bounds_type(item, OBS_BOUNDS_SCALE_INNER);
+		vec2_set(&pos, cell_cx, cell_cy);
+		obs_sceneitem_set_bounds(item, &pos);
+
+		obs_source_release(source);
+	}
+
+	for (int i = 0; i < params->num_audio_sources; i++) {
+		snprintf(name, sizeof(name), "sinewave %d", i);
+
+		obs_source_t *source =
+			obs_source_create("test_sinewave", name, NULL, NULL);
+		if (!source)
+			continue;
+
+		obs_scene_add(scene, source);
+		obs_source_release(source);
+	}
+
+	obs_source_t *source = obs_source_get_ref(obs_scene_get_source(scene));
+	obs_scene_release(scene);
+	return source;
+}
+
+static obs_output_t *create_output(const struct bench_params *params,
+				   obs_encoder_t **venc, obs_encoder_t **aenc)
+{
+	bool file = strcmp(params->output, "file") == 0;
+	obs_data_t *settings;
+
+	settings = obs_data_create();
+	obs_data_set_int(settings, "bitrate", params->bitrate);
+	obs_data_set_string(settings, "rate_control", "CBR");
+	*venc = obs_video_encoder_create(params->video_encoder, "bench video",
+					 settings, NULL);
+	obs_data_release(settings);
+
+	*aenc = obs_audio_encoder_create(params->audio_encoder, "bench audio",
+					 NULL, 0, NULL);
+
+	if (!*venc || !*aenc) {
+		fprintf(stderr, "Failed to create encoders '%s' and '%s'\n",
+			params->video_encoder, params->audio_encoder);
+		return NULL;
+	}
+
+	obs_encoder_set_video(*venc, obs_get_video());
+	obs_encoder_set_audio(*aenc, obs_get_audio());
+
+	settings = obs_data_create();
+	obs_data_set_string(settings, "path", params->path);
+	obs_output_t *output =
+		obs_output_create(file ? "ffmpeg_muxer" : "null_output",
+				  "bench output", settings, NULL);
+	obs_data_release(settings);
+
+	if (!output) {
+		fprintf(stderr, "Failed to create %s output\n", params->output);
+		return NULL;
+	}
+
+	obs_output_set_video_encoder(output, *venc);
+	obs_output_set_audio_encoder(output, *aenc, 0);
+	return output;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Report                                                                    */
+
+static bool stage_matches(const struct bench_stage *stage, const char *name)
+{
+	if (stage->prefix)
+		return strncmp(name, stage->name, strlen(stage->name)) == 0;
+	return strcmp(name, stage->name) == 0;
+}
+
+static bool collect_entry(void *context, profiler_snapshot_entry_t *entry)
+{
+	const char *name = profiler_snapshot_entry_name(entry);
+
+	for (size_t i = 0; i < NUM_STAGES; i++) {
+		struct bench_stage *stage = &stages[i];
+		if (!stage_matches(stage, name))
+			continue;
+
+		profiler_time_entries_t *times =
+			profiler_snapshot_entry_times(entry);
+		da_push_back_da(stage->times, *times);
+
+		uint64_t max_usec = profiler_snapshot_entry_max_time(entry);
+		if (max_usec > stage->max_usec)
+			stage->max_usec = max_usec;
+	}
+
+	profiler_snapshot_enumerate_children(entry, collect_entry, context);
+	return true;
+}
+
+static int cmp_time_entry(const void *a, const void *b)
+{
+	const profiler_time_entry_t *ta = a;
+	const profiler_time_entry_t *tb = b;
+
+	if (ta->time_delta == tb->time_delta)
+		return 0;
+	return ta->time_delta < tb->time_delta ? -1 : 1;
+}
+
+static obs_data_t *stage_report(struct bench_stage *stage)
+{
+	obs_data_t *data = obs_data_create();
+	uint64_t calls = 0;
+	uint64_t total = 0;
+	uint64_t median = 0;
+	uint64_t p99 = 0;
+
+	qsort(stage->times.array, stage->times.num,
+	      sizeof(profiler_time_entry_t), cmp_time_entry);
+
+	for (size_t i = 0; i < stage->times.num; i++) {
+		calls += stage->times.array[i].count;
+		total += stage->times.array[i].time_delta *
+			 stage->times.array[i].count;
+	}
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < stage->times.num; i++) {
+		seen += stage->times.array[i].count;
+		if (!median && seen * 2 >= calls)
+			median = stage->times.array[i].time_delta;
+		if (seen * 100 >= calls * 99) {
+			p99 = stage->times.array[i].time_delta;
+			break;
+		}
+	}
+
+	obs_data_set_int(data, "calls", (long long)calls);
+	obs_data_set_double(data, "avg_ms",
+			    calls ? (double)total / (double)calls / 1000.0
+				  : 0.0);
+	obs_data_set_double(data, "median_ms", (double)median / 1000.0);
+	obs_data_set_double(data, "p99_ms", (double)p99 / 1000.0);
+	obs_data_set_double(data, "max_ms", (double)stage->max_usec / 1000.0);
+	obs_data_set_double(data, "total_ms", (double)total / 1000.0);
+	return data;
+}
+
+struct bench_counters {
+	uint32_t video_frames;
+	uint32_t skipped_frames;
+	uint32_t rendered_frames;
+	uint32_t lagged_frames;
+};
+
+static void get_counters(struct bench_counters *counters)
+{
+	video_t *video = obs_get_video();
+
+	counters->video_frames = video_output_get_total_frames(video);
+	counters->skipped_frames = video_output_get_skipped_frames(video);
+	counters->rendered_frames = obs_get_total_frames();
+	counters->lagged_frames = obs_get_lagged_frames();
+}
+
+static obs_data_t *create_report(const struct bench_params *params,
+				 const struct bench_counters *start,
+				 const struct bench_counters *end,
+				 obs_output_t *output, uint64_t wall_time_ns,
+				 uint64_t peak_rss)
+{
+	obs_data_t *report = obs_data_create();
+	obs_data_t *data;
+
+	obs_data_set_string(report, "libobs_version", obs_get_version_string());
+	obs_data_set_int(report, "width", params->width);
+	obs_data_set_int(report, "height", params->height);
+	obs_data_set_int(report, "fps", params->fps);
+	obs_data_set_string(report, "output", params->output);
+	if (params->collection) {
+		obs_data_set_string(report, "collection", params->collection);
+	} else {
+		obs_data_set_string(report, "source_id", params->source_id);
+		obs_data_set_int(report, "sources", params->num_sources);
+	}
+	obs_data_set_double(report, "wall_time_ms",
+			    (double)wall_time_ns / 1000000.0);
+
+	/* stages */
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	profiler_snapshot_enumerate_roots(snap, collect_entry, NULL);
+
+	data = obs_data_create();
+	for (size_t i = 0; i < NUM_STAGES; i++) {
+		obs_data_t *stage = stage_report(&stages[i]);
+		obs_data_set_obj(data, stages[i].key, stage);
+		obs_data_release(stage);
+		da_free(stages[i].times);
+	}
+	obs_data_set_obj(report, "stages", data);
+	obs_data_release(data);
+
+	profile_snapshot_free(snap);
+
+	/* frames */
+	data = obs_data_create();
+	obs_data_set_int(data, "video",
+			 end->video_frames - start->video_frames);
+	obs_data_set_int(data, "skipped",
+			 end->skipped_frames - start->skipped_frames);
+	obs_data_set_int(data, "rendered",
+			 end->rendered_frames - start->rendered_frames);
+	obs_data_set_int(data, "lagged",
+			 end->lagged_frames - start->lagged_frames);
+	if (output) {
+		obs_data_set_int(data, "output",
+				 obs_output_get_total_frames(output));
+		obs_data_set_int(data, "dropped",
+				 obs_output_get_frames_dropped(output));
+		obs_data_set_int(data, "output_bytes",
+				 (long long)obs_output_get_total_bytes(output));
+	}
+	obs_data_set_obj(report, "frames", data);
+	obs_data_release(data);
+
+	/* memory */
+	data = obs_data_create();
+	obs_data_set_int(data, "peak_resident_kb",
+			 (long long)(peak_rss / 1024));
+	obs_data_set_int(data, "resident_kb",
+			 (long long)(os_get_proc_resident_size() / 1024));
+	obs_data_set_int(data, "allocations", bnum_allocs());
+	obs_data_set_obj(report, "memory", data);
+	obs_data_release(data);
+
+	return report;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool run_bench(const struct bench_params *params)
+{
+	obs_encoder_t *venc = NULL;
+	obs_encoder_t *aenc = NULL;
+	obs_output_t *output = NULL;
+	obs_source_t *scene;
+	bool success = false;
+
+	if (params->collection)
+		scene = load_collection(params->collection);
+	else
+		scene = create_scene(params);
+	if (!scene)
+		return false;
+
+	obs_set_output_source(0, scene);
+
+	if (strcmp(params->output, "none") != 0) {
+		output = create_output(params, &venc, &aenc);
+		if (!output)
+			goto cleanup;
+
+		if (!obs_output_start(output)) {
+			fprintf(stderr, "Failed to start output: %s\n",
+				obs_output_get_last_error(output));
+			goto cleanup;
+		}
+	}
+
+	struct bench_counters start_counters;
+	struct bench_counters end_counters;
+	uint64_t peak_rss = 0;
+	uint64_t start_time = os_gettime_ns();
+	uint64_t timeout_ns = (uint64_t)params->frames * FRAME_TIMEOUT_MS *
+			      1000000ULL;
+
+	get_counters(&start_counters);
+
+	for (;;) {
+		os_sleep_ms(10);
+		get_counters(&end_counters);
+
+		uint64_t rss = os_get_proc_resident_size();
+		if (rss > peak_rss)
+			peak_rss = rss;
+
+		if (end_counters.video_frames - start_counters.video_frames >=
+		    params->frames)
+			break;
+
+		if (os_gettime_ns() - start_time > timeout_ns) {
+			fprintf(stderr, "Timed out waiting for frames\n");
+			goto cleanup;
+		}
+	}
+
+	uint64_t wall_time_ns = os_gettime_ns() - start_time;
+
+	if (output) {
+		obs_output_stop(output);
+		for (int i = 0; i < 1000 && obs_output_active(output); i++)
+			os_sleep_ms(10);
+	}
+
+	obs_data_t *report = create_report(params, &start_counters,
+					   &end_counters, output, wall_time_ns,
+					   peak_rss);
+
+	if (params->report) {
+		success = obs_data_save_json_pretty_safe(report, params->report,
+							 "tmp", "bak");
+		if (!success)
+			fprintf(stderr, "Failed to write report '%s'\n",
+				params->report);
+	} else {
+		printf("%s\n", obs_data_get_json_pretty(report));
+		success = true;
+	}
+
+	obs_data_release(report);
+
+cleanup:
+	obs_set_output_source(0, NULL);
+	obs_output_release(output);
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	obs_source_release(scene);
+	return success;
+}
+
+static bool parse_resolution(const char *val, uint32_t *cx, uint32_t *cy)
+{
+	return sscanf(val, "%" SCNu32 "x%" SCNu32, cx, cy) == 2 && *cx && *cy;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_params params = {
+		.num_sources = 16,
+		.source_id = "random",
+		.num_audio_sources = 1,
+		.frames = 600,
+		.width = 1920,
+		.height = 1080,
+		.fps = 60,
+		.output = "null",
+		.path = "obs-bench.mkv",
+		.video_encoder = "obs_x264",
+		.audio_encoder = "ffmpeg_aac",
+		.bitrate = 6000,
+		.graphics_module = DEFAULT_GRAPHICS_MODULE,
+	};
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (strcmp(arg, "-v") == 0) {
+			params.verbose = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for '%s'\n", arg);
+			return 1;
+		}
+
+		const char *val = argv[++i];
+
+		if (strcmp(arg, "-c") == 0)
+			params.collection = val;
+		else if (strcmp(arg, "-n") == 0)
+			params.num_sources = atoi(val);
+		else if (strcmp(arg, "-s") == 0)
+			params.source_id = val;
+		else if (strcmp(arg, "-a") == 0)
+			params.num_audio_sources = atoi(val);
+		else if (strcmp(arg, "-f") == 0)
+			params.frames = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "-r") == 0) {
+			if (!parse_resolution(val, &params.width,
+					      &params.height)) {
+				fprintf(stderr, "Invalid resolution '%s'\n",
+					val);
+				return 1;
+			}
+		} else if (strcmp(arg, "-F") == 0)
+			params.fps = (uint32_t)strtoul(val, NULL, 10);
+		else if (strcmp(arg, "-o") == 0)
+			params.output = val;
+		else if (strcmp(arg, "-p") == 0)
+			params.path = val;
+		else if (strcmp(arg, "-e") == 0)
+			params.video_encoder = val;
+		else if (strcmp(arg, "-A") == 0)
+			params.audio_encoder = val;
+		else if (strcmp(arg, "-b") == 0)
+			params.bitrate = atoi(val);
+		else if (strcmp(arg, "-g") == 0)
+			params.graphics_module = val;
+		else if (strcmp(arg, "-j") == 0)
+			params.report = val;
+		else {
+			fprintf(stderr, "Unknown option '%s'\n", arg);
+			return 1;
+		}
+	}
+
+	if (!params.frames || !params.fps || params.num_sources < 0 ||
+	    params.num_audio_sources < 0) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	if (strcmp(params.output, "none") != 0 &&
+	    strcmp(params.output, "null") != 0 &&
+	    strcmp(params.output, "file") != 0) {
+		fprintf(stderr, "Unknown output type '%s'\n", params.output);
+		return 1;
+	}
+
+	base_set_log_handler(log_handler, &params.verbose);
+
+	profiler_name_store_t *names = profiler_name_store_create();
+	profiler_start();
+
+	bool success = startup(&params, names) && run_bench(&params);
+
+	obs_shutdown();
+
+	profiler_stop();
+	profiler_free();
+	profiler_name_store_free(names);
+
+#if defined(__linux__) || defined(__FreeBSD__)
+	if (display)
+		XCloseDisplay(display);
+#endif
+
+	return success ? 0 : 1;
+}
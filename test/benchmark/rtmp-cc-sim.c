@@ -0,0 +1,403 @@
+/*
+ * Offline simulator for the rtmp-stream congestion controllers.
+ *
+ * Replays a link capacity trace against a synthetic encoder (keyframes,
+ * reference and non-reference frames, audio) feeding a send queue, the same
+ * way rtmp-stream drives the controller, and reports the resulting bitrate,
+ * latency, frame drops and how often the encoder bitrate was changed.
+ *
+ * The trace is a text file with one "<time_ms> <kbps>" pair per line, the
+ * capacity stays the same until the next line.  Lines starting with '#' are
+ * ignored.  Without a trace a built-in one with a few steps and a lossy
+ * section is used.
+ *
+ * usage: rtmp-cc-sim [-t trace] [-c controller] [-b video_kbps]
+ *                    [-a audio_kbps] [-f fps] [-g keyint_sec]
+ *                    [-d drop_threshold_ms] [-s seconds] [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include <obs-module.h>
+#include <obs-nal.h>
+#include <util/darray.h>
+
+#include "../../plugins/obs-outputs/rtmp-congestion.h"
+
+#define MS_TO_NS 1000000ULL
+
+struct trace_point {
+	uint64_t time_ms;
+	long kbps;
+};
+
+struct sim_params {
+	const char *controller;
+	long bitrate;
+	long audio_bitrate;
+	int fps;
+	int keyint_sec;
+	int64_t drop_threshold_ms;
+	uint64_t duration_ms;
+	bool verbose;
+};
+
+struct sim_stats {
+	uint64_t capacity_sum;
+	uint64_t video_bytes_sent;
+	uint64_t frames;
+	uint64_t frames_dropped;
+	uint64_t bitrate_changes;
+	uint64_t bitrate_delta_sum;
+	uint64_t latency_sum_ms;
+	uint64_t latency_max_ms;
+	uint64_t latency_count;
+	uint64_t late_frames; /* frames that took more than a second */
+};
+
+static DARRAY(struct trace_point) trace;
+
+static void builtin_trace(void)
+{
+	static const struct trace_point points[] = {
+		{0, 8000},      {30000, 3000}, {60000, 5000},
+		{90000, 2500},  {95000, 4500}, {100000, 1800},
+		{103000, 4000}, {108000, 2200}, {112000, 4200},
+		{120000, 6000},
+	};
+
+	for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+		da_push_back(trace, &points[i]);
+}
+
+static bool load_trace(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[256];
+
+	if (!f) {
+		fprintf(stderr, "Failed to open trace '%s'\n", path);
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		struct trace_point point;
+		unsigned long long time_ms;
+
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%llu %ld", &time_ms, &point.kbps) != 2)
+			continue;
+
+		point.time_ms = time_ms;
+		da_push_back(trace, &point);
+	}
+
+	fclose(f);
+
+	if (!trace.num) {
+		fprintf(stderr, "Trace '%s' is empty\n", path);
+		return false;
+	}
+	return true;
+}
+
+static long capacity_at(uint64_t time_ms)
+{
+	long kbps = trace.array[0].kbps;
+
+	for (size_t i = 0; i < trace.num; i++) {
+		if (trace.array[i].time_ms > time_ms)
+			break;
+		kbps = trace.array[i].kbps;
+	}
+
+	return kbps;
+}
+
+/* keyframe, then alternating reference and non-reference frames */
+static void make_video_packet(struct encoder_packet *pkt,
+			      const struct sim_params *params, long bitrate,
+			      uint64_t frame, uint64_t now)
+{
+	uint64_t gop_frames = (uint64_t)params->fps * params->keyint_sec;
+	uint64_t idx = frame % gop_frames;
+	double avg = (double)bitrate * 1000.0 / 8.0 / params->fps;
+	double norm = (double)gop_frames / (4.0 + (double)(gop_frames - 1));
+	double weight;
+
+	memset(pkt, 0, sizeof(*pkt));
+	pkt->type = OBS_ENCODER_VIDEO;
+	pkt->dts_usec = (int64_t)(now / 1000);
+	pkt->sys_dts_usec = pkt->dts_usec;
+
+	if (idx == 0) {
+		weight = 4.0;
+		pkt->keyframe = true;
+		pkt->priority = OBS_NAL_PRIORITY_HIGHEST;
+	} else if (idx % 2) {
+		weight = 1.2;
+		pkt->priority = OBS_NAL_PRIORITY_HIGH;
+	} else {
+		weight = 0.8;
+		pkt->priority = OBS_NAL_PRIORITY_DISPOSABLE;
+	}
+
+	/* +-20% noise */
+	weight *= 0.8 + 0.4 * ((double)rand() / (double)RAND_MAX);
+
+	pkt->drop_priority = pkt->priority;
+	pkt->size = (size_t)(avg * norm * weight);
+	if (!pkt->size)
+		pkt->size = 1;
+}
+
+static void run_sim(const struct sim_params *params,
+		    const struct rtmp_cc_ops *ops, struct sim_stats *stats)
+{
+	struct rtmp_cc_config config = {
+		.max_bitrate = params->bitrate,
+		.audio_bitrate = params->audio_bitrate,
+		.drop_threshold_usec = params->drop_threshold_ms * 1000,
+		.adapt_bitrate = true,
+	};
+	void *cc = ops->create(&config);
+	struct deque packets = {0};
+	struct dstr status = {0};
+
+	size_t queued_bytes = 0;
+	uint32_t wait_keyframe = 0;
+	long bitrate = params->bitrate;
+
+	struct encoder_packet sending = {0};
+	bool have_sending = false;
+	uint64_t send_beg = 0;
+	double sent = 0.0;
+	double budget = 0.0;
+
+	uint64_t frame = 0;
+	uint64_t next_frame_ns = 0;
+	uint64_t next_audio_ns = 0;
+	uint64_t audio_interval_ns = 1024ULL * 1000000000ULL / 48000;
+	size_t audio_size = (size_t)((double)params->audio_bitrate * 1000.0 /
+				     8.0 * (double)audio_interval_ns / 1e9);
+
+	srand(1);
+
+	for (uint64_t ms = 0; ms < params->duration_ms; ms++) {
+		uint64_t now = ms * MS_TO_NS;
+		long capacity = capacity_at(ms);
+		stats->capacity_sum += (uint64_t)capacity;
+
+		while (next_audio_ns <= now) {
+			struct encoder_packet pkt = {0};
+			pkt.type = OBS_ENCODER_AUDIO;
+			pkt.size = audio_size;
+			pkt.dts_usec = (int64_t)(next_audio_ns / 1000);
+			deque_push_back(&packets, &pkt, sizeof(pkt));
+			queued_bytes += pkt.size;
+			next_audio_ns += audio_interval_ns;
+		}
+
+		while (next_frame_ns <= now) {
+			struct rtmp_cc_decision decision;
+			struct encoder_packet pkt;
+
+			ops->update(cc, now, queued_bytes, &decision);
+
+			if (decision.drop_bytes) {
+				uint32_t cut;
+				size_t freed;
+				int dropped = rtmp_cc_drop_packets(
+					&packets, decision.drop_bytes, &freed,
+					&cut);
+				queued_bytes -= freed;
+				stats->frames_dropped += (uint64_t)dropped;
+				wait_keyframe |= cut;
+			}
+
+			if (decision.bitrate != bitrate) {
+				stats->bitrate_changes++;
+				stats->bitrate_delta_sum += (uint64_t)labs(
+					decision.bitrate - bitrate);
+				bitrate = decision.bitrate;
+			}
+
+			make_video_packet(&pkt, params, bitrate, frame++,
+					  next_frame_ns);
+			next_frame_ns += 1000000000ULL / params->fps;
+			stats->frames++;
+
+			if (wait_keyframe && !pkt.keyframe) {
+				stats->frames_dropped++;
+				continue;
+			}
+			wait_keyframe = 0;
+
+			deque_push_back(&packets, &pkt, sizeof(pkt));
+			queued_bytes += pkt.size;
+		}
+
+		/* send for one millisecond at the link capacity */
+		budget += (double)capacity * 1000.0 / 8.0 / 1000.0;
+
+		while (budget > 0.0) {
+			if (!have_sending) {
+				if (!packets.size) {
+					budget = 0.0;
+					break;
+				}
+				deque_pop_front(&packets, &sending,
+						sizeof(sending));
+				queued_bytes -= sending.size;
+				have_sending = true;
+				send_beg = now;
+				sent = 0.0;
+			}
+
+			double left = (double)sending.size - sent;
+			if (left > budget) {
+				sent += budget;
+				budget = 0.0;
+				break;
+			}
+
+			budget -= left;
+			have_sending = false;
+
+			struct rtmp_cc_sample sample = {
+				.send_beg = send_beg,
+				.send_end = now + MS_TO_NS,
+				.size = sending.size,
+				.queued_bytes = queued_bytes,
+			};
+			ops->packet_sent(cc, &sample);
+
+			if (sending.type == OBS_ENCODER_VIDEO) {
+				uint64_t latency = ms + 1 -
+						   (uint64_t)sending.dts_usec /
+							   1000;
+
+				stats->video_bytes_sent += sending.size;
+				stats->latency_sum_ms += latency;
+				stats->latency_count++;
+				if (latency > stats->latency_max_ms)
+					stats->latency_max_ms = latency;
+				if (latency > 1000)
+					stats->late_frames++;
+			}
+		}
+
+		if (params->verbose && ms % 1000 == 0 && ops->get_status) {
+			ops->get_status(cc, &status);
+			printf("%6" PRIu64 " s  link %5ld kbps  %s\n",
+			       ms / 1000, capacity, status.array);
+		}
+	}
+
+	while (packets.size) {
+		struct encoder_packet pkt;
+		deque_pop_front(&packets, &pkt, sizeof(pkt));
+	}
+
+	deque_free(&packets);
+	dstr_free(&status);
+	ops->destroy(cc);
+}
+
+int main(int argc, char *argv[])
+{
+	struct sim_params params = {
+		.controller = "bbr",
+		.bitrate = 6000,
+		.audio_bitrate = 160,
+		.fps = 60,
+		.keyint_sec = 2,
+		.drop_threshold_ms = 900,
+		.duration_ms = 0,
+	};
+	struct sim_stats stats = {0};
+	const char *trace_path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "-v") == 0) {
+			params.verbose = true;
+			continue;
+		}
+		if (!val)
+			break;
+
+		if (strcmp(arg, "-t") == 0)
+			trace_path = val;
+		else if (strcmp(arg, "-c") == 0)
+			params.controller = val;
+		else if (strcmp(arg, "-b") == 0)
+			params.bitrate = atol(val);
+		else if (strcmp(arg, "-a") == 0)
+			params.audio_bitrate = atol(val);
+		else if (strcmp(arg, "-f") == 0)
+			params.fps = atoi(val);
+		else if (strcmp(arg, "-g") == 0)
+			params.keyint_sec = atoi(val);
+		else if (strcmp(arg, "-d") == 0)
+			params.drop_threshold_ms = atoll(val);
+		else if (strcmp(arg, "-s") == 0)
+			params.duration_ms = strtoull(val, NULL, 10) * 1000;
+		i++;
+	}
+
+	const struct rtmp_cc_ops *ops = rtmp_cc_find(params.controller);
+	if (!ops) {
+		fprintf(stderr, "Unknown controller '%s'\n", params.controller);
+		return 1;
+	}
+	if (params.bitrate <= 0 || params.fps <= 0 || params.keyint_sec <= 0) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	if (trace_path) {
+		if (!load_trace(trace_path))
+			return 1;
+	} else {
+		builtin_trace();
+	}
+
+	if (!params.duration_ms)
+		params.duration_ms = trace.array[trace.num - 1].time_ms + 30000;
+
+	run_sim(&params, ops, &stats);
+
+	double seconds = (double)params.duration_ms / 1000.0;
+	printf("controller:       %s\n", params.controller);
+	printf("link average:     %.0f kbps\n",
+	       (double)stats.capacity_sum / (double)params.duration_ms);
+	printf("video goodput:    %.0f kbps\n",
+	       (double)stats.video_bytes_sent * 8.0 / 1000.0 / seconds);
+	printf("frames dropped:   %" PRIu64 " of %" PRIu64 " (%.2f%%)\n",
+	       stats.frames_dropped, stats.frames,
+	       stats.frames ? 100.0 * (double)stats.frames_dropped /
+				      (double)stats.frames
+			    : 0.0);
+	printf("latency:          %.0f ms average, %" PRIu64 " ms max, "
+	       "%" PRIu64 " frame(s) over 1 s\n",
+	       stats.latency_count ? (double)stats.latency_sum_ms /
+					     (double)stats.latency_count
+				   : 0.0,
+	       stats.latency_max_ms, stats.late_frames);
+	printf("bitrate changes:  %" PRIu64 " (%.1f per minute, "
+	       "%" PRIu64 " kbps total movement)\n",
+	       stats.bitrate_changes,
+	       (double)stats.bitrate_changes * 60.0 / seconds,
+	       stats.bitrate_delta_sum);
+
+	da_free(trace);
+	return 0;
+}
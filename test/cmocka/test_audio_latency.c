@@ -0,0 +1,146 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <obs-audio-latency.h>
+
+#define FRAMES 480
+
+#define assert_near(a, b, epsilon) assert_true(fabsf((a) - (b)) <= (epsilon))
+
+static void comp_step_is_limited(void **state)
+{
+	(void)state;
+
+	/* 0.5% of the packet at most, in either direction */
+	assert_int_equal(audio_latency_comp_step(48000, 0, FRAMES), 2);
+	assert_int_equal(audio_latency_comp_step(0, 48000, FRAMES), -2);
+	assert_int_equal(audio_latency_comp_step(48000, 47999, FRAMES), 1);
+	assert_int_equal(audio_latency_comp_step(47999, 48000, FRAMES), -1);
+	assert_int_equal(audio_latency_comp_step(1024, 1024, FRAMES), 0);
+
+	/* small packets still move */
+	assert_int_equal(audio_latency_comp_step(1024, 0, 64), 1);
+	assert_int_equal(audio_latency_comp_step(0, 1024, 64), -1);
+
+	/* but are never squeezed to nothing */
+	assert_int_equal(audio_latency_comp_step(0, 1024, 1), 0);
+	assert_int_equal(audio_latency_comp_step(1024, 0, 0), 0);
+}
+
+static void comp_step_reaches_target(void **state)
+{
+	long applied = 0;
+	long added = 0;
+	int packets = 0;
+
+	(void)state;
+
+	while (applied != 1024 && packets < 10000) {
+		long step = audio_latency_comp_step(1024, applied, FRAMES);
+
+		assert_true(step > 0);
+		applied += step;
+		added += step;
+		packets++;
+	}
+
+	assert_int_equal(applied, 1024);
+	assert_int_equal(added, 1024);
+	assert_int_equal(packets, 512);
+}
+
+static void stretch_keeps_constant_signal(void **state)
+{
+	float in[2][FRAMES];
+	float out[2][FRAMES + 2];
+	const float *in_planes[2] = {in[0], in[1]};
+	float *out_planes[2] = {out[0], out[1]};
+	float last[2] = {0.25f, -0.5f};
+
+	(void)state;
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		in[0][i] = 0.25f;
+		in[1][i] = -0.5f;
+	}
+
+	audio_latency_stretch(out_planes, in_planes, last, 2, FRAMES,
+			      FRAMES + 2);
+
+	for (size_t i = 0; i < FRAMES + 2; i++) {
+		assert_near(out[0][i], 0.25f, 1e-6f);
+		assert_near(out[1][i], -0.5f, 1e-6f);
+	}
+
+	assert_near(last[0], 0.25f, 1e-6f);
+	assert_near(last[1], -0.5f, 1e-6f);
+}
+
+/* a ramp stays a ramp, the packets join up and nothing jumps */
+static void stretch_is_continuous(void **state)
+{
+	const uint32_t sizes[] = {FRAMES + 2, FRAMES - 2, FRAMES};
+	float in[FRAMES];
+	float out[FRAMES + 2];
+	const float *in_planes[1] = {in};
+	float *out_planes[1] = {out};
+	float last[1] = {0.0f};
+	float prev = 0.0f;
+
+	(void)state;
+
+	for (size_t packet = 0; packet < 3; packet++) {
+		uint32_t out_frames = sizes[packet];
+		float step = 1.0f / (float)out_frames;
+
+		for (size_t i = 0; i < FRAMES; i++)
+			in[i] = prev + (float)(i + 1) / (float)FRAMES;
+
+		audio_latency_stretch(out_planes, in_planes, last, 1, FRAMES,
+				      out_frames);
+
+		for (size_t i = 0; i < out_frames; i++) {
+			assert_true(out[i] > prev);
+			assert_near(out[i] - prev, step, 1e-4f);
+			prev = out[i];
+		}
+
+		/* the last frame lands on the last input frame */
+		assert_near(out[out_frames - 1], in[FRAMES - 1], 1e-6f);
+		assert_near(last[0], in[FRAMES - 1], 1e-6f);
+	}
+}
+
+static void keep_last_tracks_packets(void **state)
+{
+	float in[FRAMES];
+	const float *in_planes[1] = {in};
+	float last[1] = {0.0f};
+
+	(void)state;
+
+	for (size_t i = 0; i < FRAMES; i++)
+		in[i] = (float)i;
+
+	audio_latency_keep_last(last, in_planes, 1, FRAMES);
+	assert_near(last[0], (float)(FRAMES - 1), 1e-6f);
+
+	audio_latency_keep_last(last, in_planes, 1, 0);
+	assert_near(last[0], (float)(FRAMES - 1), 1e-6f);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(comp_step_is_limited),
+		cmocka_unit_test(comp_step_reaches_target),
+		cmocka_unit_test(stretch_keeps_constant_signal),
+		cmocka_unit_test(stretch_is_continuous),
+		cmocka_unit_test(keep_last_tracks_packets),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,101 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/deque.h>
+
+/* leaves 128 bytes in the deque that wrap around the end of the buffer */
+static void fill_wrapped(struct deque *dq, uint8_t *expected)
+{
+	uint8_t data[96];
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t)i;
+
+	deque_reserve(dq, 128);
+	deque_push_back_zero(dq, dq->capacity - 32);
+	deque_pop_front(dq, NULL, dq->capacity - 64);
+	deque_push_back(dq, data, sizeof(data));
+
+	memset(expected, 0, 32);
+	memcpy(expected + 32, data, sizeof(data));
+}
+
+static void check_contents(struct deque *dq, const uint8_t *expected,
+			   size_t size)
+{
+	struct deque_span spans[2];
+	uint8_t peeked[128];
+	size_t num_spans;
+	size_t offset = 0;
+
+	assert_int_equal(dq->size, size);
+
+	deque_peek_front(dq, peeked, size);
+	assert_memory_equal(peeked, expected, size);
+
+	num_spans = deque_peek_span(dq, size, spans);
+	assert_true(num_spans == 1 || num_spans == 2);
+	if (dq->mirrored)
+		assert_int_equal(num_spans, 1);
+
+	for (size_t i = 0; i < num_spans; i++) {
+		assert_memory_equal(spans[i].data, expected + offset,
+				    spans[i].size);
+		offset += spans[i].size;
+	}
+
+	assert_int_equal(offset, size);
+}
+
+static void deque_span_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque dq;
+	uint8_t expected[128];
+
+	deque_init(&dq);
+	fill_wrapped(&dq, expected);
+	check_contents(&dq, expected, 128);
+
+	struct deque_span spans[2];
+	assert_int_equal(deque_peek_span(&dq, 128, spans), 2);
+
+	deque_free(&dq);
+}
+
+static void deque_mirrored_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque dq;
+	uint8_t expected[128];
+	uint8_t placed[16];
+
+	/* falls back to regular memory where mirroring is unsupported */
+	deque_init_mirrored(&dq);
+	fill_wrapped(&dq, expected);
+	check_contents(&dq, expected, 128);
+
+	/* a placement that straddles the end of the buffer */
+	memset(placed, 0xff, sizeof(placed));
+	deque_place(&dq, dq.capacity - dq.start_pos - 8, placed,
+		    sizeof(placed));
+	memcpy(expected + dq.capacity - dq.start_pos - 8, placed,
+	       sizeof(placed));
+	check_contents(&dq, expected, 128);
+
+	deque_free(&dq);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(deque_span_test),
+		cmocka_unit_test(deque_mirrored_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
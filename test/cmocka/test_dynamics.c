@@ -0,0 +1,281 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <math.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/c99defs.h>
+
+#include "dynamics.h"
+
+/* not a multiple of four, so the tails are covered as well */
+#define NUM_SAMPLES 1023
+#define MAX_CHANNELS 8
+
+static float ref_mul_to_db(float mul)
+{
+	return mul == 0.0f ? -INFINITY : 20.0f * log10f(mul);
+}
+
+static float ref_db_to_mul(float db)
+{
+	return isfinite(db) ? powf(10.0f, db / 20.0f) : 0.0f;
+}
+
+static uint32_t rand_state = 1;
+
+static float rand_sample(void)
+{
+	rand_state = rand_state * 1664525 + 1013904223;
+	return (float)(rand_state >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+/* noise with a slow volume swell, so that both attack and release are
+ * exercised */
+static void fill_channels(float data[MAX_CHANNELS][NUM_SAMPLES])
+{
+	for (size_t c = 0; c < MAX_CHANNELS; c++) {
+		for (size_t i = 0; i < NUM_SAMPLES; i++) {
+			float swell = sinf((float)i * 0.01f + (float)c);
+			data[c][i] = rand_sample() * swell * swell;
+		}
+	}
+}
+
+static void db_conversion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float mul[NUM_SAMPLES];
+	float db[NUM_SAMPLES];
+	float out[NUM_SAMPLES];
+
+	/* -140 dB to +40 dB */
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		mul[i] = powf(10.0f, -7.0f + 9.0f * (float)i / NUM_SAMPLES);
+
+	dyn_mul_to_db(db, mul, NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		assert_true(fabsf(db[i] - ref_mul_to_db(mul[i])) < 1e-4f);
+
+	dyn_db_to_mul(out, db, NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		assert_true(fabsf(out[i] / mul[i] - 1.0f) < 1e-5f);
+
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		db[i] = -140.0f + 180.0f * (float)i / NUM_SAMPLES;
+
+	dyn_db_to_mul(out, db, NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		assert_true(fabsf(out[i] / ref_db_to_mul(db[i]) - 1.0f) <
+			    1e-5f);
+
+	/* unity gain has to stay exact, silence has to stay silent */
+	float zero = 0.0f;
+	float one;
+
+	dyn_db_to_mul(&one, &zero, 1);
+	assert_true(one == 1.0f);
+
+	dyn_mul_to_db(out, &zero, 1);
+	assert_true(out[0] < -500.0f);
+	dyn_db_to_mul(out, out, 1);
+	assert_true(out[0] < 1e-25f);
+}
+
+static void peak_envelope_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float data[MAX_CHANNELS][NUM_SAMPLES];
+	float *samples[MAX_CHANNELS];
+	float env_buf[NUM_SAMPLES];
+	float ref_buf[NUM_SAMPLES];
+	const float attack_gain = 0.99f;
+	const float release_gain = 0.999f;
+
+	fill_channels(data);
+	for (size_t c = 0; c < MAX_CHANNELS; c++)
+		samples[c] = data[c];
+
+	for (size_t channels = 1; channels <= MAX_CHANNELS; channels++) {
+		float env = 0.25f;
+		float ref_env = 0.25f;
+
+		/* a missing channel has to be skipped, not treated as
+		 * silence */
+		if (channels == 6)
+			samples[2] = NULL;
+
+		dyn_peak_envelope(env_buf, samples, channels, NUM_SAMPLES,
+				  &env, attack_gain, release_gain);
+
+		memset(ref_buf, 0, sizeof(ref_buf));
+		for (size_t c = 0; c < channels; c++) {
+			float e = ref_env;
+
+			if (!samples[c])
+				continue;
+
+			for (size_t i = 0; i < NUM_SAMPLES; i++) {
+				float in = fabsf(samples[c][i]);
+				float coef = e < in ? attack_gain
+						    : release_gain;
+				e = in + coef * (e - in);
+				ref_buf[i] = fmaxf(ref_buf[i], e);
+			}
+		}
+		ref_env = ref_buf[NUM_SAMPLES - 1];
+
+		for (size_t i = 0; i < NUM_SAMPLES; i++)
+			assert_true(fabsf(env_buf[i] - ref_buf[i]) < 1e-6f);
+		assert_true(fabsf(env - ref_env) < 1e-6f);
+
+		samples[2] = data[2];
+	}
+}
+
+static void rms_envelope_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float data[MAX_CHANNELS][NUM_SAMPLES];
+	static float env[MAX_CHANNELS][NUM_SAMPLES];
+	float *samples[MAX_CHANNELS];
+	float *env_bufs[MAX_CHANNELS];
+	float runave[MAX_CHANNELS];
+	const float coef = 0.998f;
+
+	fill_channels(data);
+
+	for (size_t channels = 1; channels <= MAX_CHANNELS; channels++) {
+		for (size_t c = 0; c < MAX_CHANNELS; c++) {
+			samples[c] = data[c];
+			env_bufs[c] = env[c];
+			runave[c] = 0.01f * (float)c;
+		}
+
+		dyn_rms_envelope(env_bufs, samples, channels, NUM_SAMPLES,
+				 runave, coef);
+
+		for (size_t c = 0; c < channels; c++) {
+			float ave = 0.01f * (float)c;
+
+			for (size_t i = 0; i < NUM_SAMPLES; i++) {
+				float x = data[c][i];
+				ave = coef * ave + (1.0f - coef) * x * x;
+				assert_true(fabsf(env[c][i] - sqrtf(ave)) <
+					    1e-5f);
+			}
+
+			assert_true(fabsf(runave[c] - ave) < 1e-6f);
+		}
+	}
+}
+
+static void gain_curve_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float env[NUM_SAMPLES];
+	float gain[NUM_SAMPLES];
+	const float threshold = -18.0f;
+	const float output_gain = 1.5f;
+	const float knee = 10.0f;
+
+	/* -100 dB to +6 dB, plus silence */
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		env[i] = powf(10.0f, (-100.0f + 106.0f * (float)i /
+						      NUM_SAMPLES) /
+					     20.0f);
+	env[0] = 0.0f;
+
+	/* compressor at 10:1 */
+	const float slope = 1.0f - 1.0f / 10.0f;
+	dyn_compressor_gain(gain, env, NUM_SAMPLES, threshold, slope,
+			    output_gain);
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		float g = slope * (threshold - ref_mul_to_db(env[i]));
+		float ref = ref_db_to_mul(fminf(0, g)) * output_gain;
+		assert_true(fabsf(gain[i] / ref - 1.0f) < 1e-4f);
+	}
+
+	/* expander at 4:1 */
+	const float exp_slope = 1.0f - 4.0f;
+	dyn_expander_gain_db(gain, env, NUM_SAMPLES, threshold, exp_slope);
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		float diff = threshold - ref_mul_to_db(env[i]);
+		float ref = diff > 0.0f ? fmaxf(exp_slope * diff, -60.0f)
+					: 0.0f;
+		assert_true(fabsf(gain[i] - ref) < 1e-3f);
+	}
+
+	/* upward compressor at 0.5:1 with a soft knee */
+	const float upw_slope = 1.0f - 0.5f;
+	dyn_upward_gain_db(gain, env, NUM_SAMPLES, threshold, upw_slope, knee);
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		float env_db = ref_mul_to_db(env[i]);
+		float diff = threshold - env_db;
+		float ref = 0.0f;
+
+		if (env_db <= (threshold - 60.0f) / 2)
+			diff = env_db + 60.0f > 0 ? env_db + 60.0f : 0.0f;
+		if (threshold - knee / 2 >= env_db)
+			ref = upw_slope * diff;
+		if (env_db > threshold - knee / 2 &&
+		    threshold + knee / 2 > env_db)
+			ref = upw_slope * powf(diff + knee / 2, 2) /
+			      (2.0f * knee);
+
+		assert_true(fabsf(gain[i] - ref) < 1e-3f);
+	}
+}
+
+static void peak_level_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float data[MAX_CHANNELS][NUM_SAMPLES];
+	float *samples[MAX_CHANNELS];
+	float level[NUM_SAMPLES];
+
+	fill_channels(data);
+	for (size_t c = 0; c < MAX_CHANNELS; c++)
+		samples[c] = data[c];
+
+	dyn_peak_level(level, samples, 3, NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		float ref = fmaxf(fabsf(data[0][i]),
+				  fmaxf(fabsf(data[1][i]), fabsf(data[2][i])));
+		assert_true(level[i] == ref);
+	}
+
+	/* level holds the original first channel from here on */
+	memcpy(level, data[0], sizeof(level));
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		data[1][i] = 0.5f;
+
+	samples[1] = NULL;
+	dyn_apply_gain(samples, 2, data[1], NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		assert_true(data[0][i] == level[i] * 0.5f);
+
+	samples[1] = data[1];
+	dyn_peak_level(level, samples + 1, 1, NUM_SAMPLES);
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		assert_true(level[i] == 0.5f);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(db_conversion_test),
+		cmocka_unit_test(peak_envelope_test),
+		cmocka_unit_test(rms_envelope_test),
+		cmocka_unit_test(gain_curve_test),
+		cmocka_unit_test(peak_level_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
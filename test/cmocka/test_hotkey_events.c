@@ -0,0 +1,202 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-hotkey-events.h>
+
+#define MAX_BINDINGS 8
+#define MAX_CALLS 64
+
+struct hotkey_call {
+	size_t binding;
+	bool pressed;
+};
+
+struct hotkey_events_test {
+	struct obs_hotkey_event_index index;
+	obs_hotkey_binding_t bindings[MAX_BINDINGS];
+	size_t num_bindings;
+
+	struct hotkey_call calls[MAX_CALLS];
+	size_t num_calls;
+	size_t next_call;
+};
+
+static void set_pressed(void *data, obs_hotkey_binding_t *binding,
+			bool pressed)
+{
+	struct hotkey_events_test *test = data;
+
+	assert_true(binding->pressed != pressed);
+	binding->pressed = pressed;
+
+	assert_true(test->num_calls < MAX_CALLS);
+	test->calls[test->num_calls].binding =
+		(size_t)(binding - test->bindings);
+	test->calls[test->num_calls].pressed = pressed;
+	test->num_calls++;
+}
+
+static bool push(struct hotkey_events_test *test, obs_key_t key, bool pressed)
+{
+	struct obs_hotkey_event_dispatch dispatch = {
+		.bindings = test->bindings,
+		.num_bindings = test->num_bindings,
+		.strict_modifiers = true,
+		.set_pressed = set_pressed,
+		.data = test,
+	};
+
+	return obs_hotkey_event_index_process(&test->index, &dispatch, key,
+					      pressed);
+}
+
+static void expect_call(struct hotkey_events_test *test, size_t binding,
+			bool pressed)
+{
+	assert_true(test->next_call < test->num_calls);
+	assert_int_equal(test->calls[test->next_call].binding, binding);
+	assert_int_equal(test->calls[test->next_call].pressed, pressed);
+	test->next_call++;
+}
+
+static void expect_no_calls(struct hotkey_events_test *test)
+{
+	assert_int_equal(test->next_call, test->num_calls);
+}
+
+static size_t add_binding(struct hotkey_events_test *test, obs_key_t key,
+			  uint32_t modifiers)
+{
+	size_t idx = test->num_bindings++;
+
+	assert_true(idx < MAX_BINDINGS);
+	test->bindings[idx].key.key = key;
+	test->bindings[idx].key.modifiers = modifiers;
+	test->index.key_bindings_dirty = true;
+	return idx;
+}
+
+static int setup(void **state)
+{
+	*state = bzalloc(sizeof(struct hotkey_events_test));
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct hotkey_events_test *test = *state;
+
+	obs_hotkey_event_index_free(&test->index);
+	bfree(test);
+	return 0;
+}
+
+static void key_press_and_release(void **state)
+{
+	struct hotkey_events_test *test = *state;
+	size_t a = add_binding(test, OBS_KEY_A, 0);
+
+	assert_true(push(test, OBS_KEY_A, true));
+	expect_call(test, a, true);
+
+	/* auto repeat doesn't press it again */
+	assert_false(push(test, OBS_KEY_A, true));
+	expect_no_calls(test);
+
+	assert_true(push(test, OBS_KEY_A, false));
+	expect_call(test, a, false);
+
+	/* other keys don't touch it */
+	push(test, OBS_KEY_B, true);
+	push(test, OBS_KEY_B, false);
+	expect_no_calls(test);
+
+	/* neither do invalid ones */
+	assert_false(push(test, OBS_KEY_NONE, true));
+	assert_false(push(test, OBS_KEY_LAST_VALUE, true));
+	expect_no_calls(test);
+}
+
+static void key_with_modifiers(void **state)
+{
+	struct hotkey_events_test *test = *state;
+	size_t plain = add_binding(test, OBS_KEY_A, 0);
+	size_t ctrl = add_binding(test, OBS_KEY_A, INTERACT_CONTROL_KEY);
+
+	/* the modifier has to be down before the key */
+	push(test, OBS_KEY_A, true);
+	expect_call(test, plain, true);
+	push(test, OBS_KEY_CONTROL, true);
+	expect_call(test, plain, false);
+	push(test, OBS_KEY_A, false);
+	push(test, OBS_KEY_CONTROL, false);
+	expect_no_calls(test);
+
+	/* strict modifiers, only the binding with control is pressed, and
+	 * released as soon as the modifier is */
+	push(test, OBS_KEY_CONTROL, true);
+	push(test, OBS_KEY_A, true);
+	expect_call(test, ctrl, true);
+	expect_no_calls(test);
+	push(test, OBS_KEY_CONTROL, false);
+	expect_call(test, ctrl, false);
+	push(test, OBS_KEY_A, false);
+	expect_no_calls(test);
+}
+
+static void modifier_only_binding(void **state)
+{
+	struct hotkey_events_test *test = *state;
+	size_t shift = add_binding(test, OBS_KEY_NONE, INTERACT_SHIFT_KEY);
+
+	push(test, OBS_KEY_SHIFT, true);
+	expect_call(test, shift, true);
+
+	/* another modifier no longer matches */
+	push(test, OBS_KEY_ALT, true);
+	expect_call(test, shift, false);
+	push(test, OBS_KEY_ALT, false);
+	expect_call(test, shift, true);
+
+	push(test, OBS_KEY_SHIFT, false);
+	expect_call(test, shift, false);
+	expect_no_calls(test);
+}
+
+static void reset_forgets_held_keys(void **state)
+{
+	struct hotkey_events_test *test = *state;
+	size_t a = add_binding(test, OBS_KEY_A, 0);
+
+	push(test, OBS_KEY_A, true);
+	expect_call(test, a, true);
+
+	/* the release got lost while polling, the next press is not a repeat
+	 * and the release still gets through */
+	obs_hotkey_event_index_reset(&test->index);
+	test->bindings[a].pressed = false;
+
+	assert_true(push(test, OBS_KEY_A, true));
+	expect_call(test, a, true);
+	push(test, OBS_KEY_A, false);
+	expect_call(test, a, false);
+	expect_no_calls(test);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(key_press_and_release, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(key_with_modifiers, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(modifier_only_binding, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(reset_forgets_held_keys, setup,
+						teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
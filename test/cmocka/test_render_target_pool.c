@@ -0,0 +1,347 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <graphics/graphics-internal.h>
+
+/* texture-render.c is built into the test, the rest of the graphics
+ * subsystem is replaced by the stubs below, so no device is needed.  libobs
+ * is not linked, so the allocator is stubbed as well. */
+
+void *bmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void bfree(void *ptr)
+{
+	free(ptr);
+}
+
+struct gs_texture {
+	enum gs_color_format format;
+	uint32_t cx, cy;
+};
+
+static graphics_t *current_graphics;
+static int live_textures;
+static int context_enters;
+
+void gs_enter_context(graphics_t *graphics)
+{
+	current_graphics = graphics;
+	context_enters++;
+}
+
+void gs_leave_context(void)
+{
+	current_graphics = NULL;
+}
+
+graphics_t *gs_get_context(void)
+{
+	return current_graphics;
+}
+
+gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
+				enum gs_color_format color_format,
+				uint32_t levels, const uint8_t **data,
+				uint32_t flags)
+{
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+
+	gs_texture_t *tex = bzalloc(sizeof(*tex));
+	tex->format = color_format;
+	tex->cx = width;
+	tex->cy = height;
+	live_textures++;
+	return tex;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	/* the real one can't work without a context either */
+	assert_non_null(current_graphics);
+	live_textures--;
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->cx;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->cy;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+gs_zstencil_t *gs_zstencil_create(uint32_t width, uint32_t height,
+				  enum gs_zstencil_format format)
+{
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(format);
+	return NULL;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zstencil)
+{
+	UNUSED_PARAMETER(zstencil);
+}
+
+enum gs_color_space gs_get_color_space(void)
+{
+	return GS_CS_SRGB;
+}
+
+gs_texture_t *gs_get_render_target(void)
+{
+	return NULL;
+}
+
+gs_zstencil_t *gs_get_zstencil_target(void)
+{
+	return NULL;
+}
+
+void gs_set_render_target_with_color_space(gs_texture_t *tex,
+					   gs_zstencil_t *zstencil,
+					   enum gs_color_space space)
+{
+	UNUSED_PARAMETER(tex);
+	UNUSED_PARAMETER(zstencil);
+	UNUSED_PARAMETER(space);
+}
+
+void gs_set_viewport(int x, int y, int width, int height)
+{
+	UNUSED_PARAMETER(x);
+	UNUSED_PARAMETER(y);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+}
+
+void gs_viewport_push(void) {}
+void gs_viewport_pop(void) {}
+void gs_projection_push(void) {}
+void gs_projection_pop(void) {}
+void gs_matrix_push(void) {}
+void gs_matrix_pop(void) {}
+void gs_matrix_identity(void) {}
+
+/* ------------------------------------------------------------------------- */
+
+static int setup(void **state)
+{
+	graphics_t *graphics = bzalloc(sizeof(*graphics));
+
+	live_textures = 0;
+	context_enters = 0;
+	current_graphics = graphics;
+	*state = graphics;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	graphics_t *graphics = *state;
+
+	current_graphics = graphics;
+	gs_render_target_pool_free(graphics);
+	current_graphics = NULL;
+	bfree(graphics);
+
+	assert_int_equal(live_textures, 0);
+	return 0;
+}
+
+static struct gs_render_target_pool_info get_info(void)
+{
+	struct gs_render_target_pool_info info;
+	gs_render_target_pool_get_info(&info);
+	return info;
+}
+
+static void render(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	gs_texrender_reset(texrender);
+	assert_true(gs_texrender_begin(texrender, cx, cy));
+	gs_texrender_end(texrender);
+}
+
+static void reuse_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	gs_texture_t *a = gs_render_target_acquire(GS_RGBA, 64, 32);
+	gs_texture_t *b = gs_render_target_acquire(GS_RGBA, 64, 32);
+	assert_non_null(a);
+	assert_ptr_not_equal(a, b);
+	assert_int_equal(get_info().leased_count, 2);
+	assert_int_equal(get_info().leased_bytes, 2 * 64 * 32 * 4);
+
+	gs_render_target_release(a);
+	gs_render_target_release(b);
+	assert_int_equal(get_info().leased_count, 0);
+	assert_int_equal(get_info().free_count, 2);
+	assert_int_equal(get_info().free_bytes, 2 * 64 * 32 * 4);
+
+	/* the most recently released target first */
+	assert_ptr_equal(gs_render_target_acquire(GS_RGBA, 64, 32), b);
+
+	/* format and size have to match */
+	gs_texture_t *c = gs_render_target_acquire(GS_RGBA16F, 64, 32);
+	gs_texture_t *d = gs_render_target_acquire(GS_RGBA, 32, 64);
+	assert_ptr_not_equal(c, a);
+	assert_ptr_not_equal(d, a);
+	assert_ptr_equal(gs_render_target_acquire(GS_RGBA, 64, 32), a);
+
+	struct gs_render_target_pool_info info = get_info();
+	assert_int_equal(info.created, 4);
+	assert_int_equal(info.reused, 2);
+	assert_int_equal(info.free_count, 0);
+	assert_int_equal(live_textures, 4);
+
+	gs_render_target_release(a);
+	gs_render_target_release(b);
+	gs_render_target_release(c);
+	gs_render_target_release(d);
+	assert_int_equal(live_textures, 4);
+}
+
+static void trim_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	gs_render_target_release(gs_render_target_acquire(GS_RGBA, 16, 16));
+	gs_render_target_pool_next_frame(2);
+	gs_render_target_release(gs_render_target_acquire(GS_BGRA, 16, 16));
+
+	gs_render_target_pool_next_frame(2);
+	assert_int_equal(get_info().free_count, 2);
+
+	/* idle for more than two frames */
+	gs_render_target_pool_next_frame(2);
+	assert_int_equal(get_info().free_count, 1);
+	assert_int_equal(get_info().trimmed, 1);
+	assert_int_equal(live_textures, 1);
+
+	gs_render_target_pool_next_frame(2);
+	assert_int_equal(get_info().free_count, 0);
+	assert_int_equal(live_textures, 0);
+}
+
+static void transient_texrender_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	gs_texrender_t *texrender =
+		gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
+	gs_texrender_t *plain = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	render(texrender, 100, 50);
+	render(plain, 100, 50);
+	gs_texture_t *tex = gs_texrender_get_texture(texrender);
+	assert_non_null(tex);
+
+	/* drawn every frame, keeps its target */
+	for (int i = 0; i < 5; i++) {
+		gs_render_target_pool_next_frame(1);
+		render(texrender, 100, 50);
+	}
+	assert_ptr_equal(gs_texrender_get_texture(texrender), tex);
+	assert_int_equal(get_info().reclaimed, 0);
+
+	/* not drawn, the target goes back to the pool, the target of the
+	 * plain texrender is never taken away */
+	gs_render_target_pool_next_frame(1);
+	gs_render_target_pool_next_frame(1);
+	assert_null(gs_texrender_get_texture(texrender));
+	assert_non_null(gs_texrender_get_texture(plain));
+	assert_int_equal(get_info().reclaimed, 1);
+	assert_int_equal(get_info().free_count, 1);
+
+	/* and is handed out again when it is drawn the next time */
+	render(texrender, 100, 50);
+	assert_ptr_equal(gs_texrender_get_texture(texrender), tex);
+
+	/* a size change releases the old target */
+	render(texrender, 50, 50);
+	assert_int_equal(get_info().free_count, 1);
+
+	gs_texrender_destroy(texrender);
+	gs_texrender_destroy(plain);
+	assert_int_equal(get_info().free_count, 3);
+	assert_int_equal(get_info().leased_count, 0);
+}
+
+static void destroy_without_context_test(void **state)
+{
+	graphics_t *graphics = *state;
+
+	gs_texrender_t *texrender =
+		gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
+	render(texrender, 64, 64);
+	assert_int_equal(graphics->transient_texrenders.num, 1);
+
+	current_graphics = NULL;
+	gs_texrender_destroy(texrender);
+	assert_null(current_graphics);
+	assert_int_equal(context_enters, 1);
+
+	/* unregistered, the pool no longer walks the freed texrender, and its
+	 * target was given back to the pool */
+	current_graphics = graphics;
+	assert_int_equal(graphics->transient_texrenders.num, 0);
+	assert_int_equal(get_info().free_count, 1);
+	gs_render_target_pool_next_frame(0);
+	gs_render_target_pool_next_frame(0);
+	assert_int_equal(live_textures, 0);
+}
+
+static void destroy_after_pool_free_test(void **state)
+{
+	graphics_t *graphics = *state;
+
+	gs_texrender_t *texrender =
+		gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
+	render(texrender, 64, 64);
+
+	/* the texrender outlives the context it was registered with */
+	gs_render_target_pool_free(graphics);
+	assert_int_equal(graphics->transient_texrenders.num, 0);
+
+	gs_texrender_destroy(texrender);
+	assert_int_equal(context_enters, 0);
+	assert_int_equal(get_info().free_count, 1);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(reuse_test, setup, teardown),
+		cmocka_unit_test_setup_teardown(trim_test, setup, teardown),
+		cmocka_unit_test_setup_teardown(transient_texrender_test, setup,
+						teardown),
+		cmocka_unit_test_setup_teardown(destroy_without_context_test,
+						setup, teardown),
+		cmocka_unit_test_setup_teardown(destroy_after_pool_free_test,
+						setup, teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
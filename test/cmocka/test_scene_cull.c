@@ -0,0 +1,242 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <graphics/math-defs.h>
+#include <obs-scene-cull.h>
+
+#define SCENE_CX 1920
+#define SCENE_CY 1080
+
+static const struct obs_sceneitem_crop no_crop = {0};
+
+#define assert_near(a, b, epsilon) assert_true(fabsf((a) - (b)) <= (epsilon))
+
+/* same order of operations as update_item_transform */
+static void item_transform(struct matrix4 *transform, float x, float y,
+			   float rot, float scale)
+{
+	matrix4_identity(transform);
+	matrix4_scale3f(transform, transform, scale, scale, 1.0f);
+	matrix4_rotate_aa4f(transform, transform, 0.0f, 0.0f, 1.0f, RAD(rot));
+	matrix4_translate3f(transform, transform, x, y, 0.0f);
+}
+
+static enum item_cull add_item(struct scene_culler *culler, float x, float y,
+			       uint32_t cx, uint32_t cy, bool opaque)
+{
+	struct matrix4 transform;
+	struct vec2 draw_min;
+	struct vec2 draw_max;
+
+	item_transform(&transform, x, y, 0.0f, 1.0f);
+	scene_cull_item_bounds(&transform, cx, cy, &no_crop, &no_crop,
+			       &draw_min, &draw_max);
+	return scene_culler_add(culler, &draw_min, &draw_max, opaque);
+}
+
+static void off_canvas_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct scene_culler culler;
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+
+	assert_int_equal(add_item(&culler, -200.0f, 0.0f, 200, 200, false),
+			 ITEM_CULL_OFFSCREEN);
+	assert_int_equal(add_item(&culler, 1920.0f, 500.0f, 200, 200, false),
+			 ITEM_CULL_OFFSCREEN);
+	assert_int_equal(add_item(&culler, 0.0f, 1080.5f, 200, 200, false),
+			 ITEM_CULL_OFFSCREEN);
+	assert_int_equal(add_item(&culler, 100.0f, -300.0f, 200, 200, false),
+			 ITEM_CULL_OFFSCREEN);
+
+	/* a single partially touched pixel keeps the item */
+	assert_int_equal(add_item(&culler, -199.5f, 0.0f, 200, 200, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 1919.5f, 0.0f, 200, 200, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 0.0f, 0.0f, 1920, 1080, false),
+			 ITEM_CULL_NONE);
+}
+
+static void occlusion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct scene_culler culler;
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+
+	/* front to back: a transparent item never occludes */
+	assert_int_equal(add_item(&culler, 0.0f, 0.0f, 1920, 1080, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 100.0f, 100.0f, 50, 50, false),
+			 ITEM_CULL_NONE);
+
+	assert_int_equal(add_item(&culler, 100.0f, 100.0f, 800, 600, true),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 100.0f, 100.0f, 800, 600, true),
+			 ITEM_CULL_OCCLUDED);
+	assert_int_equal(add_item(&culler, 300.0f, 300.0f, 10, 10, false),
+			 ITEM_CULL_OCCLUDED);
+
+	/* sticking out by part of a pixel keeps the item */
+	assert_int_equal(add_item(&culler, 99.5f, 100.0f, 100, 100, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 850.0f, 100.0f, 100, 100, false),
+			 ITEM_CULL_NONE);
+
+	/* the part outside of the scene doesn't count */
+	assert_int_equal(add_item(&culler, 0.0f, 0.0f, 1920, 1080, true),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, -500.0f, -500.0f, 3000, 3000, false),
+			 ITEM_CULL_OCCLUDED);
+}
+
+/* a partially covered opaque item only occludes the pixels it covers */
+static void fractional_occluder_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct scene_culler culler;
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+
+	assert_int_equal(add_item(&culler, 10.5f, 10.5f, 100, 100, true),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 10.0f, 11.0f, 10, 10, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 11.0f, 11.0f, 100, 99, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 11.0f, 11.0f, 99, 99, false),
+			 ITEM_CULL_OCCLUDED);
+}
+
+/* scale to outer bounds with crop to bounds: a 1920x1080 source in 100x100
+ * bounds is cropped by 420 pixels on each side */
+static void crop_to_bounds_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct obs_sceneitem_crop bounds_crop = {420, 0, 420, 0};
+	const float scale = 100.0f / 1080.0f;
+	struct scene_culler culler;
+	struct matrix4 transform;
+	struct vec2 draw_min;
+	struct vec2 draw_max;
+
+	item_transform(&transform, 500.0f, 500.0f, 0.0f, scale);
+	scene_cull_item_bounds(&transform, 1920, 1080, &no_crop, &bounds_crop,
+			       &draw_min, &draw_max);
+
+	assert_near(draw_min.x, 500.0f, 0.01f);
+	assert_near(draw_min.y, 500.0f, 0.01f);
+	assert_near(draw_max.x, 600.0f, 0.01f);
+	assert_near(draw_max.y, 600.0f, 0.01f);
+
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+	assert_int_equal(scene_culler_add(&culler, &draw_min, &draw_max, true),
+			 ITEM_CULL_NONE);
+
+	/* right next to the bounds, where the uncropped source would be */
+	assert_int_equal(add_item(&culler, 600.0f, 500.0f, 50, 100, false),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 500.0f, 500.0f, 100, 100, false),
+			 ITEM_CULL_OCCLUDED);
+
+	/* the user crop and the crop to bounds add up */
+	const struct obs_sceneitem_crop crop = {0, 540, 0, 0};
+	item_transform(&transform, 0.0f, 0.0f, 0.0f, 1.0f);
+	scene_cull_item_bounds(&transform, 1920, 1080, &crop, &bounds_crop,
+			       &draw_min, &draw_max);
+	assert_near(draw_max.x, 1080.0f, 0.01f);
+	assert_near(draw_max.y, 540.0f, 0.01f);
+
+	/* a crop larger than the source leaves the minimum size */
+	const struct obs_sceneitem_crop big_crop = {1000, 0, 1000, 0};
+	scene_cull_item_bounds(&transform, 1920, 1080, &big_crop, &no_crop,
+			       &draw_min, &draw_max);
+	assert_near(draw_max.x, 2.0f, 0.01f);
+}
+
+static void rotated_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct scene_culler culler;
+	struct matrix4 transform;
+	struct vec2 draw_min;
+	struct vec2 draw_max;
+
+	/* a 200x100 item rotated by 90 degrees around its top left corner
+	 * stands 100x200 to the left of its position */
+	item_transform(&transform, 300.0f, 100.0f, 90.0f, 1.0f);
+	scene_cull_item_bounds(&transform, 200, 100, &no_crop, &no_crop,
+			       &draw_min, &draw_max);
+	assert_near(draw_min.x, 200.0f, 0.01f);
+	assert_near(draw_min.y, 100.0f, 0.01f);
+	assert_near(draw_max.x, 300.0f, 0.01f);
+	assert_near(draw_max.y, 300.0f, 0.01f);
+
+	/* the rounding of the rotation doesn't lose covered pixels */
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+	assert_int_equal(scene_culler_add(&culler, &draw_min, &draw_max, true),
+			 ITEM_CULL_NONE);
+	assert_int_equal(add_item(&culler, 200.0f, 100.0f, 100, 200, false),
+			 ITEM_CULL_OCCLUDED);
+
+	/* rotated out of the scene */
+	item_transform(&transform, 0.0f, 0.0f, 180.0f, 1.0f);
+	scene_cull_item_bounds(&transform, 200, 100, &no_crop, &no_crop,
+			       &draw_min, &draw_max);
+	assert_int_equal(scene_culler_add(&culler, &draw_min, &draw_max, false),
+			 ITEM_CULL_OFFSCREEN);
+
+	/* a 45 degree rotation touches the bounding box of the diamond */
+	item_transform(&transform, 1000.0f, 500.0f, 45.0f, 1.0f);
+	scene_cull_item_bounds(&transform, 100, 100, &no_crop, &no_crop,
+			       &draw_min, &draw_max);
+	const float half_diag = 100.0f * sqrtf(0.5f);
+	assert_near(draw_min.x, 1000.0f - half_diag, 0.01f);
+	assert_near(draw_max.x, 1000.0f + half_diag, 0.01f);
+	assert_near(draw_min.y, 500.0f, 0.01f);
+	assert_near(draw_max.y, 500.0f + 2.0f * half_diag, 0.01f);
+}
+
+static void max_occluders_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct scene_culler culler;
+	scene_culler_init(&culler, SCENE_CX, SCENE_CY);
+
+	for (int i = 0; i < SCENE_CULL_MAX_OCCLUDERS + 1; i++)
+		assert_int_equal(add_item(&culler, (float)i * 100.0f, 0.0f, 100,
+					  100, true),
+				 ITEM_CULL_NONE);
+
+	for (int i = 0; i < SCENE_CULL_MAX_OCCLUDERS; i++)
+		assert_int_equal(add_item(&culler, (float)i * 100.0f, 0.0f, 100,
+					  100, false),
+				 ITEM_CULL_OCCLUDED);
+
+	/* only the first opaque items are remembered */
+	assert_int_equal(add_item(&culler, SCENE_CULL_MAX_OCCLUDERS * 100.0f,
+				  0.0f, 100, 100, false),
+			 ITEM_CULL_NONE);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(off_canvas_test),
+		cmocka_unit_test(occlusion_test),
+		cmocka_unit_test(fractional_occluder_test),
+		cmocka_unit_test(crop_to_bounds_test),
+		cmocka_unit_test(rotated_test),
+		cmocka_unit_test(max_occluders_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,135 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <obs-scripting-event-queue.h>
+
+#define NUM_PRODUCERS 4
+#define EVENTS_PER_PRODUCER (SCRIPT_EVENT_QUEUE_SIZE * 4)
+
+/* events can't be NULL, NULL means the queue is empty */
+static inline void *to_event(uintptr_t val)
+{
+	return (void *)(val + 1);
+}
+
+static inline uintptr_t from_event(void *event)
+{
+	return (uintptr_t)event - 1;
+}
+
+static int setup(void **state)
+{
+	struct script_event_queue *q = bzalloc(sizeof(*q));
+	if (!script_event_queue_init(q)) {
+		bfree(q);
+		return -1;
+	}
+
+	*state = q;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct script_event_queue *q = *state;
+	script_event_queue_free(q);
+	bfree(q);
+	return 0;
+}
+
+static void event_queue_keeps_order_when_full(void **state)
+{
+	struct script_event_queue *q = *state;
+	const uintptr_t count = SCRIPT_EVENT_QUEUE_SIZE + 100;
+
+	for (uintptr_t i = 0; i < count; i++)
+		script_event_queue_push(q, to_event(i));
+
+	assert_int_equal(script_event_queue_size(q), count);
+	assert_int_equal(script_event_queue_overflowed(q), 100);
+
+	/* the overflow has to be drained before the ring is used again */
+	for (uintptr_t i = 0; i < 10; i++)
+		assert_int_equal(from_event(script_event_queue_pop(q)), i);
+	script_event_queue_push(q, to_event(count));
+
+	for (uintptr_t i = 10; i <= count; i++)
+		assert_int_equal(from_event(script_event_queue_pop(q)), i);
+
+	assert_null(script_event_queue_pop(q));
+	assert_int_equal(script_event_queue_size(q), 0);
+
+	/* and once it is, the ring is used again */
+	script_event_queue_push(q, to_event(0));
+	assert_int_equal(script_event_queue_overflowed(q), 101);
+	assert_int_equal(from_event(script_event_queue_pop(q)), 0);
+}
+
+struct producer {
+	struct script_event_queue *q;
+	uintptr_t id;
+	pthread_t thread;
+};
+
+static void *produce(void *data)
+{
+	struct producer *producer = data;
+
+	for (uintptr_t i = 0; i < EVENTS_PER_PRODUCER; i++)
+		script_event_queue_push(
+			producer->q,
+			to_event(producer->id * EVENTS_PER_PRODUCER + i));
+	return NULL;
+}
+
+static void event_queue_multiple_producers(void **state)
+{
+	struct script_event_queue *q = *state;
+	struct producer producers[NUM_PRODUCERS];
+	uintptr_t next[NUM_PRODUCERS] = {0};
+	size_t popped = 0;
+
+	for (uintptr_t i = 0; i < NUM_PRODUCERS; i++) {
+		producers[i].q = q;
+		producers[i].id = i;
+		assert_int_equal(pthread_create(&producers[i].thread, NULL,
+						produce, &producers[i]),
+				 0);
+	}
+
+	while (popped < NUM_PRODUCERS * EVENTS_PER_PRODUCER) {
+		void *event = script_event_queue_pop(q);
+		if (!event)
+			continue;
+
+		uintptr_t val = from_event(event);
+		uintptr_t id = val / EVENTS_PER_PRODUCER;
+
+		assert_true(id < NUM_PRODUCERS);
+		assert_int_equal(val % EVENTS_PER_PRODUCER, next[id]);
+		next[id]++;
+		popped++;
+	}
+
+	for (size_t i = 0; i < NUM_PRODUCERS; i++)
+		pthread_join(producers[i].thread, NULL);
+
+	assert_null(script_event_queue_pop(q));
+	assert_int_equal(script_event_queue_size(q), 0);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(
+			event_queue_keeps_order_when_full, setup, teardown),
+		cmocka_unit_test_setup_teardown(event_queue_multiple_producers,
+						setup, teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}